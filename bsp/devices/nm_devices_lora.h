@@ -35,6 +35,9 @@
 
 #define LORA_RADIO_MAX_PHYSICAL_PACKET 0xFF
 
+// STIMER frequency used for all radio timing (BUSY waits, timestamps)
+#define LORA_RADIO_TIMER_FREQUENCY 32768
+
 typedef enum {
     LORA_RADIO_STATUS_SUCCESS,
     LORA_RADIO_STATUS_FAIL,
@@ -137,54 +140,269 @@ typedef struct {
     lora_radio_iq_e eIQ;
 } lora_radio_packet_t;
 
+typedef enum {
+    LORA_RADIO_CAD_SYMBOL_1 = 0,
+    LORA_RADIO_CAD_SYMBOL_2,
+    LORA_RADIO_CAD_SYMBOL_4,
+    LORA_RADIO_CAD_SYMBOL_8,
+    LORA_RADIO_CAD_SYMBOL_16
+} lora_radio_cad_symbol_e;
+
+typedef enum {
+    LORA_RADIO_CAD_ONLY = 0, // return to standby once CAD is done
+    LORA_RADIO_CAD_RX        // stay in receive if activity is detected
+} lora_radio_cad_exit_e;
+
+typedef struct {
+    lora_radio_cad_symbol_e eSymbolNum;
+    uint8_t ui8DetectPeak;
+    uint8_t ui8DetectMin;
+    lora_radio_cad_exit_e eExitMode;
+} lora_radio_cad_t;
+
+// A validated radio configuration with the SX126x command parameters
+// computed up front by lora_radio_profile_init().  The driver never writes
+// to a profile, so one profile can be shared by any number of transfers.
+typedef struct {
+    lora_radio_modulation_t sModulation; // low data rate optimization resolved
+    lora_radio_packet_t sPacket;
+    uint8_t pui8Modulation[4]; // SetModulationParams
+    uint8_t pui8Packet[6];     // SetPacketParams
+    uint8_t pui8SyncWord[2];
+} lora_radio_profile_t;
+
 typedef enum {
     LORA_RADIO_TX,
     LORA_RADIO_RX,
-    LORA_RADIO_TXCARRIER
+    LORA_RADIO_TXCARRIER,
+    LORA_RADIO_CAD,
+    LORA_RADIO_RX_DUTY_CYCLE
 } lora_radio_mode_e;
 
 typedef struct {
-    uint32_t ui32SyncWord;
     uint32_t ui32Frequency;
     uint32_t ui32Timeout; // Transmit: timeout in ms
                           // Receive:
-                          //   [7:0]  number of symbols required for lock
-                          //   [31:8] delay in ms before reception, set to
-                          //          0 for continuous reception
-    lora_radio_modulation_t *psModulationParameters;
-    lora_radio_packet_t *psPacketParameters;
+                          //   [7:0]  symbols without a preamble after which
+                          //          a single reception times out, 0 to
+                          //          wait for a packet
+                          //   [31:8] receive timeout in 15.625 us steps, 0
+                          //          for a single reception without timeout
+                          //          or 0xFFFFFF for continuous reception
+                          // CAD:
+                          //   [31:8] receive timeout in 15.625 us steps
+                          //          when eExitMode is LORA_RADIO_CAD_RX
+                          // Receive duty cycle:
+                          //   [31:8] receive window in 15.625 us steps, set
+                          //          to 0 to derive the windows from the
+                          //          preamble length
+    const lora_radio_profile_t *psProfile; // not used by TXCARRIER
+    lora_radio_cad_t *psCadParameters;     // CAD only
+    uint32_t ui32SleepPeriod; // receive duty cycle only, 15.625 us steps
     uint8_t *pui8Payload;
+    uint8_t ui8PayloadLength; // transmit only
     uint8_t ui8Power;
     lora_radio_mode_e eMode;
 } lora_radio_transfer_t;
 
+// signal levels are reported in steps of 0.25 dB
+#define LORA_RADIO_QDB_PER_DB 4
+
+// Received packets live in a driver owned pool.  Holders of a packet beyond
+// the callback that delivered it take a reference with
+// lora_radio_packet_retain() and drop it with lora_radio_packet_release().
 typedef struct {
     uint8_t *pui8Payload;
     uint8_t ui8PayloadLength;
-    int8_t i8Rssi;
-    int8_t i8Snr;
-    int8_t i8Rscp;
+    uint8_t ui8CrcError;   // non-zero if the payload failed the CRC check
+    int16_t i16Rssi;       // average packet RSSI in 0.25 dBm
+    int16_t i16Snr;        // SNR in 0.25 dB, negative below the noise floor
+    int16_t i16SignalRssi; // RSSI of the despread signal in 0.25 dBm
+    volatile uint8_t ui8References;
+    uint32_t ui32Timestamp; // STIMER tick at which RXDONE was raised
+    uint32_t ui32TimeOnAir; // packet duration in us, the preamble started
+                            // ui32TimeOnAir before ui32Timestamp
 } lora_radio_physical_packet_t;
 
+typedef struct {
+    uint32_t ui32Allocated; // packets received into the pool
+    uint32_t ui32Dropped;   // packets lost because the pool was exhausted
+    uint32_t ui32InUse;     // buffers currently referenced
+} lora_radio_packet_pool_stats_t;
+
 typedef struct {
     uint32_t ui32Parameter;
     uint8_t *pui8Content;
 } lora_radio_config_t;
 
+typedef struct {
+    uint16_t ui16Address;
+    uint8_t ui8Value;
+} lora_radio_register_t;
+
+// wiring of an additional radio, see lora_radio_instance_initialize()
+typedef struct {
+    uint32_t ui32IomModule;
+    uint32_t ui32ChipSelect;
+    uint32_t ui32PinReset;
+    uint32_t ui32PinBusy;
+    uint32_t ui32PinDio1;
+    uint32_t ui32PinDio3;
+    uint32_t ui32SpiClock; // fastest SPI clock to try, 0 for the default
+} lora_radio_hw_config_t;
+
+// BUSY wait histogram: bin 0 counts waits shorter than one tick, bin n
+// waits of 2^(n-1) to 2^n - 1 ticks and the last bin all longer waits
+#define LORA_RADIO_BUSY_HISTOGRAM_BINS 8
+
+// BUSY line wait statistics, all durations are in STIMER ticks
+typedef struct {
+    uint32_t ui32Count;      // number of BUSY checks
+    uint32_t ui32Waits;      // checks that found BUSY asserted
+    uint32_t ui32Blocked;    // waits that yielded to the wait hook
+    uint32_t ui32Timeouts;   // waits abandoned with BUSY still asserted
+    uint32_t ui32LastTicks;  // duration of the most recent wait
+    uint32_t ui32MaxTicks;   // longest wait observed
+    uint64_t ui64TotalTicks; // cumulative wait time
+    uint32_t pui32Histogram[LORA_RADIO_BUSY_HISTOGRAM_BINS];
+} lora_radio_busy_stats_t;
+
+// Radio configuration writes sent to the chip or skipped because the chip
+// already holds the requested value
+typedef struct {
+    uint32_t ui32Sent;
+    uint32_t ui32Skipped;
+} lora_radio_command_stats_t;
+
+// Radio interrupt servicing, latencies are in STIMER ticks from the DIO
+// edge to the start of the SPI processing
+typedef struct {
+    uint32_t ui32Count;       // interrupts processed
+    uint32_t ui32Deferred;    // interrupts handed to the defer hook
+    uint32_t ui32LastLatency; // latency of the most recent interrupt
+    uint32_t ui32MaxLatency;  // longest latency observed
+} lora_radio_irq_stats_t;
+
+// Radio events seen by the interrupt processing
+typedef struct {
+    uint32_t ui32TxDone;
+    uint32_t ui32RxDone;      // includes packets that failed the CRC
+    uint32_t ui32CrcErrors;
+    uint32_t ui32Timeouts;
+    uint32_t ui32CadDone;
+    uint32_t ui32CadDetected;
+} lora_radio_event_stats_t;
+
+// Counters kept by the radio itself since its last reset, see GetStats and
+// GetDeviceErrors in the SX1262 datasheet
+typedef struct {
+    uint16_t ui16PacketsReceived;
+    uint16_t ui16CrcErrors;
+    uint16_t ui16HeaderErrors;
+    uint16_t ui16DeviceErrors; // OpError bit field
+} lora_radio_device_stats_t;
+
+// Blocks the caller for at most ui32Ticks STIMER ticks or until the release
+// callback registered alongside it is invoked from the BUSY interrupt with
+// the handle of the radio.  The hooks are shared by all radio instances.
+typedef void (*lora_radio_busy_wait_t)(uint32_t ui32Ticks);
+
+// Every call takes the handle returned at initialization, a NULL handle
+// refers to the on-board radio.  Callbacks and the interrupt defer hook are
+// kept by initialization and deinitialization, so they may be registered
+// before the radio is brought up.  lora_radio_callback_list_init() clears
+// the callbacks.
 extern uint32_t lora_radio_initialize(void **ppHandle);
+extern uint32_t
+lora_radio_instance_initialize(void **ppHandle,
+                               const lora_radio_hw_config_t *psConfig);
 extern uint32_t lora_radio_deinitialize(void *pHandle);
 extern uint32_t lora_radio_reset(void *pHandle);
 extern uint32_t lora_radio_power_ctrl(void *pHandle,
                                       lora_radio_power_state_e ePowerState);
 extern uint32_t lora_radio_config(void *pHandle, lora_radio_config_t *psConfig);
+extern uint32_t
+lora_radio_time_on_air_symbols(const lora_radio_modulation_t *psModulation,
+                               const lora_radio_packet_t *psPacket,
+                               uint8_t ui8PayloadLength);
+extern uint32_t
+lora_radio_time_on_air(const lora_radio_modulation_t *psModulation,
+                       const lora_radio_packet_t *psPacket,
+                       uint8_t ui8PayloadLength);
+extern void
+lora_radio_rx_duty_cycle_get(const lora_radio_modulation_t *psModulation,
+                             const lora_radio_packet_t *psPacket,
+                             uint32_t *pui32RxPeriod,
+                             uint32_t *pui32SleepPeriod);
+extern uint32_t
+lora_radio_profile_init(lora_radio_profile_t *psProfile,
+                        const lora_radio_modulation_t *psModulation,
+                        const lora_radio_packet_t *psPacket,
+                        uint16_t ui16SyncWord);
+extern uint32_t lora_radio_calibrate(void *pHandle, uint32_t ui32Frequency);
+extern void lora_radio_calibration_invalidate(void *pHandle);
 extern uint32_t lora_radio_transfer(void *pHandle,
                                     lora_radio_transfer_t *psTransaction);
-extern void lora_radio_callback_list_init();
-extern void lora_radio_callback_list_deinit();
-extern uint32_t lora_radio_callback_register(lora_radio_irq_e eIrq,
-                                             lora_radio_callback_t pfnCallback);
 extern uint32_t
-lora_radio_callback_deregister(lora_radio_irq_e eIrq,
+lora_radio_transfer_nonblocking(void *pHandle,
+                                lora_radio_transfer_t *psTransaction,
+                                lora_radio_callback_t pfnCallback,
+                                void *pCallbackContext);
+extern void lora_radio_callback_list_init(void *pHandle);
+extern void lora_radio_callback_list_deinit(void *pHandle);
+extern uint32_t
+lora_radio_callback_register(void *pHandle, lora_radio_irq_e eIrq,
+                             lora_radio_callback_t pfnCallback);
+extern uint32_t
+lora_radio_callback_deregister(void *pHandle, lora_radio_irq_e eIrq,
                                lora_radio_callback_t pfnCallback);
+extern void lora_radio_packet_retain(lora_radio_physical_packet_t *psPacket);
+extern void lora_radio_packet_release(lora_radio_physical_packet_t *psPacket);
+extern void
+lora_radio_packet_pool_stats_get(void *pHandle,
+                                 lora_radio_packet_pool_stats_t *psStats);
+extern void lora_radio_busy_wait_register(lora_radio_busy_wait_t pfnWait,
+                                          lora_radio_callback_t pfnRelease);
+extern void lora_radio_busy_stats_get(void *pHandle,
+                                      lora_radio_busy_stats_t *psStats);
+extern void lora_radio_busy_stats_reset(void *pHandle);
+// With a defer hook registered the DIO interrupt only latches the event and
+// calls the hook, the SPI work and the radio callbacks then run from
+// lora_radio_irq_service() in the caller's context.  Calls to
+// lora_radio_irq_service() must be serialized with the other lora_radio_*
+// calls.
+extern void lora_radio_irq_defer_register(void *pHandle,
+                                          lora_radio_callback_t pfnDefer);
+extern void lora_radio_irq_service(void *pHandle);
+extern void lora_radio_irq_stats_get(void *pHandle,
+                                     lora_radio_irq_stats_t *psStats);
+extern void lora_radio_irq_stats_reset(void *pHandle);
+extern void lora_radio_command_stats_get(void *pHandle,
+                                         lora_radio_command_stats_t *psStats);
+extern void lora_radio_command_stats_reset(void *pHandle);
+// Bulk register access.  The list goes out as back to back commands with
+// runs of consecutive addresses merged into one command.
+extern uint32_t
+lora_radio_registers_write(void *pHandle,
+                           const lora_radio_register_t *psRegisters,
+                           uint32_t ui32Count);
+extern uint32_t lora_radio_registers_read(void *pHandle,
+                                          lora_radio_register_t *psRegisters,
+                                          uint32_t ui32Count);
+// Reads 32 bits from the radio's wideband noise generator.  The radio is
+// left in standby with its interrupts masked, so reception has to be
+// restarted afterwards.
+extern uint32_t lora_radio_random(void *pHandle, uint32_t *pui32Random);
+extern void lora_radio_event_stats_get(void *pHandle,
+                                       lora_radio_event_stats_t *psStats);
+extern void lora_radio_event_stats_reset(void *pHandle);
+extern uint32_t lora_radio_device_stats_get(void *pHandle,
+                                            lora_radio_device_stats_t *psStats);
+extern uint32_t lora_radio_device_stats_reset(void *pHandle);
+// SPI clock in Hz picked by the link test at initialization
+extern uint32_t lora_radio_spi_clock_get(void *pHandle);
+// The driver services IOM 3, radios on other IOM modules need the matching
+// am_iomasterN_isr() to call lora_radio_iom_isr() with their handle.
+extern void lora_radio_iom_isr(void *pHandle);
 
 #endif /* __NM_DEVICES_LORA_H__ */
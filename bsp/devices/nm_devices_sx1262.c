@@ -112,6 +112,7 @@
 #define REG_SYNCWORD7 0x06C7
 #define REG_NODEADDRESS 0x06CD
 #define REG_BROADCASTADDR 0x06CE
+#define REG_LORASYNCTIMEOUT 0x0706
 #define REG_LORASYNCWORDMSB 0x0740
 #define REG_LORASYNCWORDLSB 0x0741
 #define REG_RANDOMNUMBERGEN0 0x0819
@@ -120,8 +121,10 @@
 #define REG_RANDOMNUMBERGEN3 0x081C
 #define REG_RXGAIN 0x08AC
 #define REG_OCPCONFIG 0x08E7
+#define REG_RTCCONTROL 0x0902
 #define REG_XTATRIM 0x0911
 #define REG_XTBTRIM 0x0912
+#define REG_EVENTMASK 0x0944
 
 // sleep modes
 #define SLEEP_COLD 0x00 // (no rtc timeout)
@@ -149,401 +152,924 @@
 //irq priority
 #define IRQ_GPIO_PRIORITY (4)
 
-static void *gSpiHandle;
-
-static uint8_t pui8ReceiveBuffer[LORA_RADIO_MAX_PHYSICAL_PACKET];
-static lora_radio_physical_packet_t sLoRaPhysicalPacket;
+// longest time to wait for BUSY to de-assert, about 100 ms in STIMER ticks
+#ifndef SX1262_BUSY_TIMEOUT
+#define SX1262_BUSY_TIMEOUT (LORA_RADIO_TIMER_FREQUENCY / 10)
+#endif
+
+// Receive duty cycle: each window covers this many symbols plus the time
+// the radio needs to wake up and lock
+#ifndef SX1262_RX_DUTY_CYCLE_SYMBOLS
+#define SX1262_RX_DUTY_CYCLE_SYMBOLS 2
+#endif
+#define SX1262_RX_DUTY_CYCLE_WAKEUP_US 1000
+
+// SetRx timeout for continuous reception
+#define SX1262_RX_CONTINUOUS 0xFFFFFF
+
+// time the receiver runs before the noise generator registers are read
+#define SX1262_RANDOM_SETTLE_US 1000
+
+// longest symbol timeout the mantissa and exponent encoding can hold
+#define SX1262_SYMBOL_TIMEOUT_MAX 248
+
+// non-blocking transport
+#define SX1262_IOM_QUEUE_SIZE     256
+#define SX1262_COMMAND_QUEUE_SIZE 20
+#define SX1262_COMMAND_PARAM_SIZE 8
+
+// SPI clocks tried by the startup link test, fastest first
+static const uint32_t pui32SpiClocks[] = {
+    AM_HAL_IOM_16MHZ, AM_HAL_IOM_12MHZ, AM_HAL_IOM_8MHZ, AM_HAL_IOM_6MHZ,
+    AM_HAL_IOM_4MHZ,  AM_HAL_IOM_2MHZ,  AM_HAL_IOM_1MHZ,
+};
+#define SPI_CLOCK_COUNT (sizeof(pui32SpiClocks) / sizeof(pui32SpiClocks[0]))
+#define SX1262_SPI_CLOCK_DEFAULT AM_HAL_IOM_4MHZ
+
+// a clock is accepted once this many pattern round trips read back intact
+#define SX1262_SPI_TEST_PASSES 4
+#define SX1262_SPI_TEST_LENGTH 64
+
+// reset value of the LoRa sync word register
+#define SX1262_LORASYNCWORD_RESET 0x1424
+
+typedef struct {
+    am_hal_iom_transfer_t sTransaction;
+    uint32_t pui32Param[SX1262_COMMAND_PARAM_SIZE / sizeof(uint32_t)];
+} sx1262_command_t;
+
+// One command of a scatter-gather transaction: up to three instruction
+// bytes, then an optional write and an optional read phase under the same
+// chip select.  Every segment gets its own NSS frame since the radio only
+// executes a command on the rising edge of NSS.
+typedef struct {
+    uint32_t ui32Instr;
+    uint32_t ui32InstrLen;
+    const uint8_t *pui8Tx;
+    uint32_t ui32TxLength;
+    uint8_t *pui8Rx;
+    uint32_t ui32RxLength;
+} sx1262_segment_t;
+
+// segments built at once by the bulk register functions
+#define SX1262_SEGMENT_MAX 8
+
+// Shadow of the configuration last written to the radio.  A write whose
+// parameters match the shadow is skipped.  Entries are keyed by the SPI
+// instruction so register writes can be tracked alongside commands.
+typedef struct {
+    bool bValid;
+    uint8_t ui8Length;
+    uint8_t pui8Param[SX1262_COMMAND_PARAM_SIZE];
+} sx1262_shadow_t;
+
+static const uint32_t pui32ShadowInstr[] = {
+    CMD_SETREGULATORMODE,
+    CMD_SETDIO2ASRFSWITCHCTRL,
+    CMD_SETPACKETTYPE,
+    CMD_SETPACKETPARAMS,
+    CMD_SETMODULATIONPARAMS,
+    CMD_SETRFFREQUENCY,
+    CMD_SETPACONFIG,
+    CMD_SETTXPARAMS,
+    CMD_SETBUFFERBASEADDRESS,
+    CMD_SETDIOIRQPARAMS,
+    CMD_SETCADPARAMS,
+    CMD_STOPTIMERONPREAMBLE,
+    CMD_SETLORASYMBNUMTIMEOUT,
+    (CMD_WRITEREGISTER << 16) | REG_LORASYNCWORDMSB,
+};
+#define SHADOW_SIZE (sizeof(pui32ShadowInstr) / sizeof(pui32ShadowInstr[0]))
+
+// band index of the last image calibration
+#define IMAGE_CALIBRATION_NONE (-1)
+
+// Received packets are read straight into a pool of reference counted
+// buffers that are handed to the callbacks without copying.
+#ifndef LORA_RADIO_PACKET_POOL_SIZE
+#define LORA_RADIO_PACKET_POOL_SIZE 4
+#endif
+
+typedef struct {
+    lora_radio_physical_packet_t sPacket;
+    uint8_t pui8Payload[LORA_RADIO_MAX_PHYSICAL_PACKET];
+} sx1262_packet_buffer_t;
 
 #define MAX_CALLBACK 12
-static uint32_t gui32LoRaRadioCallbackListLength;
-static lora_radio_irq_handler_t psLoRaRadioCallbackList[MAX_CALLBACK];
 
-static void lora_radio_isr(void);
+// number of radios the driver can serve, a NULL handle refers to the first
+#ifndef LORA_RADIO_INSTANCES
+#define LORA_RADIO_INSTANCES 1
+#endif
+
+#if LORA_RADIO_INSTANCES > 4
+#error "LORA_RADIO_INSTANCES must not exceed 4"
+#endif
+
+typedef struct {
+    bool bInUse;
+
+    // hardware
+    uint32_t ui32IomModule;
+    uint32_t ui32ChipSelect;
+    uint32_t ui32PinReset;
+    uint32_t ui32PinBusy;
+    uint32_t ui32PinDio1;
+    uint32_t ui32PinDio3;
+    void *pSpiHandle;
+    uint32_t ui32SpiClock;
+    uint32_t pui32IomQueue[SX1262_IOM_QUEUE_SIZE];
+
+    // command queue
+    sx1262_command_t psCommandQueue[SX1262_COMMAND_QUEUE_SIZE];
+    uint32_t ui32CommandCount;
+    volatile uint32_t ui32CommandIndex;
+    volatile uint32_t ui32CommandError;
+    bool bCommandQueueOpen;
+    volatile bool bCommandQueueActive;
+    volatile bool bCommandWaitBusy;
+    lora_radio_callback_t pfnCommandComplete;
+    void *pCommandContext;
+    uint32_t
+        pui32TransmitBuffer[(LORA_RADIO_MAX_PHYSICAL_PACKET + 3) / sizeof(uint32_t)];
+
+    // radio interrupts
+    volatile bool bIrqPending;
+    volatile uint32_t ui32IrqTimestamp;
+    lora_radio_callback_t pfnIrqDefer;
+    lora_radio_irq_stats_t sIrqStats;
+    uint32_t ui32CallbackListLength;
+    lora_radio_irq_handler_t psCallbackList[MAX_CALLBACK];
+
+    // configuration cache
+    sx1262_shadow_t psShadow[SHADOW_SIZE];
+    lora_radio_command_stats_t sCommandStats;
+    lora_radio_event_stats_t sEventStats;
+    int32_t i32CalibratedBand;
+
+    // reception
+    sx1262_packet_buffer_t psPacketPool[LORA_RADIO_PACKET_POOL_SIZE];
+    lora_radio_packet_pool_stats_t sPacketPoolStats;
+    lora_radio_modulation_t sRxModulation; // used to derive the time-on-air
+    lora_radio_packet_t sRxPacket;
+    bool bCadExitRx; // the radio moves on to receive when CAD detects activity
+
+    volatile bool bBusyWaiting;
+    bool bAsleep; // BUSY stays high until NSS wakes the chip
+    lora_radio_busy_stats_t sBusyStats;
+} sx1262_context_t;
+
+static sx1262_context_t psRadioContext[LORA_RADIO_INSTANCES];
+
+// the BUSY wait hooks belong to the platform and are shared by all radios
+static lora_radio_busy_wait_t gpfnBusyWait;
+static lora_radio_callback_t gpfnBusyRelease;
+
+static sx1262_context_t *sx1262_context_get(void *pHandle)
+{
+    return pHandle ? (sx1262_context_t *)pHandle : &psRadioContext[0];
+}
+static void lora_radio_isr(sx1262_context_t *psRadio);
+static void sx1262_irq_process(sx1262_context_t *psRadio,
+                               uint32_t ui32Timestamp);
+static void sx1262_irq_dispatch(sx1262_context_t *psRadio);
+
+static bool sx1262_is_busy(sx1262_context_t *psRadio)
+{
+    uint32_t state;
+
+    am_hal_gpio_state_read(psRadio->ui32PinBusy, AM_HAL_GPIO_INPUT_READ,
+                           &state);
+
+    return state != 0;
+}
+
+// A wait may only be handed to the wait hook from thread context with
+// interrupts unmasked.  From an ISR or inside a critical section the BUSY
+// interrupt cannot be serviced, so the wait falls back to polling.
+static bool sx1262_busy_can_block(void)
+{
+    return gpfnBusyWait && (__get_IPSR() == 0) && (__get_PRIMASK() == 0) &&
+           (__get_BASEPRI() == 0);
+}
+
+static void sx1262_command_next(sx1262_context_t *psRadio);
+
+static void sx1262_busy_isr(sx1262_context_t *psRadio)
+{
+    if (psRadio->bCommandWaitBusy) {
+        am_hal_gpio_interrupt_disable(AM_HAL_GPIO_BIT(psRadio->ui32PinBusy));
+        psRadio->bCommandWaitBusy = false;
+        sx1262_command_next(psRadio);
+        return;
+    }
+
+    if (psRadio->bBusyWaiting && gpfnBusyRelease) {
+        gpfnBusyRelease(psRadio);
+    }
+}
 
-static void sx1262_block_on_busy(void)
+static uint32_t sx1262_busy_histogram_bin(uint32_t ui32Ticks)
 {
-    uint32_t state = 1;
+    uint32_t ui32Bin = 0;
 
-    while (state) {
-        am_hal_gpio_state_read(AM_BSP_GPIO_RADIO_BUSY, AM_HAL_GPIO_INPUT_READ,
-                               &state);
+    while (ui32Ticks && (ui32Bin < LORA_RADIO_BUSY_HISTOGRAM_BINS - 1)) {
+        ui32Ticks >>= 1;
+        ui32Bin++;
     }
+
+    return ui32Bin;
 }
 
-static void sx1262_write_command(uint8_t cmd, const uint8_t *data, uint8_t len)
+static void sx1262_block_on_busy(sx1262_context_t *psRadio)
 {
-    am_hal_iom_transfer_t Transaction;
+    uint32_t ui32Start, ui32Elapsed = 0, ui32Bin;
+
+    psRadio->sBusyStats.ui32Count++;
+    if (!sx1262_is_busy(psRadio)) {
+        return;
+    }
+
+    ui32Start = am_hal_stimer_counter_get();
+
+    if (sx1262_busy_can_block()) {
+        // BUSY is re-checked after arming the interrupt so that a falling
+        // edge between the first check and the enable is not lost.
+        am_hal_gpio_interrupt_clear(AM_HAL_GPIO_BIT(psRadio->ui32PinBusy));
+        psRadio->bBusyWaiting = true;
+        am_hal_gpio_interrupt_enable(AM_HAL_GPIO_BIT(psRadio->ui32PinBusy));
+
+        while (sx1262_is_busy(psRadio) && (ui32Elapsed < SX1262_BUSY_TIMEOUT)) {
+            gpfnBusyWait(SX1262_BUSY_TIMEOUT - ui32Elapsed);
+            ui32Elapsed = am_hal_stimer_counter_get() - ui32Start;
+        }
+
+        am_hal_gpio_interrupt_disable(AM_HAL_GPIO_BIT(psRadio->ui32PinBusy));
+        psRadio->bBusyWaiting = false;
+        psRadio->sBusyStats.ui32Blocked++;
+    } else {
+        while (sx1262_is_busy(psRadio) && (ui32Elapsed < SX1262_BUSY_TIMEOUT)) {
+            ui32Elapsed = am_hal_stimer_counter_get() - ui32Start;
+        }
+    }
+
+    if (sx1262_is_busy(psRadio)) {
+        psRadio->sBusyStats.ui32Timeouts++;
+    }
+
+    ui32Bin = sx1262_busy_histogram_bin(ui32Elapsed);
+    psRadio->sBusyStats.ui32Waits++;
+    psRadio->sBusyStats.pui32Histogram[ui32Bin]++;
+    psRadio->sBusyStats.ui32LastTicks = ui32Elapsed;
+    psRadio->sBusyStats.ui64TotalTicks += ui32Elapsed;
+    if (ui32Elapsed > psRadio->sBusyStats.ui32MaxTicks) {
+        psRadio->sBusyStats.ui32MaxTicks = ui32Elapsed;
+    }
+}
 
-    Transaction.ui32InstrLen = 1;
-    Transaction.ui32Instr = cmd;
-    Transaction.eDirection = AM_HAL_IOM_TX;
-    Transaction.ui32NumBytes = len;
-    Transaction.pui32TxBuffer = (uint32_t *)data;
-    Transaction.bContinue = false;
-    Transaction.ui8RepeatCount = 0;
-    Transaction.ui32PauseCondition = 0;
-    Transaction.ui32StatusSetClr = 0;
-    Transaction.uPeerInfo.ui32SpiChipSelect = AM_BSP_RADIO_NSS_CHNL;
+static void sx1262_shadow_invalidate(sx1262_context_t *psRadio)
+{
+    for (uint32_t i = 0; i < SHADOW_SIZE; i++) {
+        psRadio->psShadow[i].bValid = false;
+    }
+}
 
-    sx1262_block_on_busy();
-    am_hal_iom_blocking_transfer(gSpiHandle, &Transaction);
+// forgets the shadowed registers after writes that went around the shadow
+static void sx1262_shadow_invalidate_registers(sx1262_context_t *psRadio)
+{
+    for (uint32_t i = 0; i < SHADOW_SIZE; i++) {
+        if ((pui32ShadowInstr[i] >> 16) == CMD_WRITEREGISTER) {
+            psRadio->psShadow[i].bValid = false;
+        }
+    }
 }
 
-static void sx1262_write_registers(uint16_t addr, const uint8_t *data,
-                                   uint8_t len)
+// returns true if the write can be skipped, otherwise records the new value
+static bool sx1262_shadow_update(sx1262_context_t *psRadio,
+                                 uint32_t ui32Instr, const uint8_t *data,
+                                 uint32_t len)
 {
-    uint32_t instruction = (CMD_WRITEREGISTER << 16) | addr;
+    if (len > SX1262_COMMAND_PARAM_SIZE) {
+        return false;
+    }
 
-    am_hal_iom_transfer_t Transaction;
+    for (uint32_t i = 0; i < SHADOW_SIZE; i++) {
+        sx1262_shadow_t *psEntry = &psRadio->psShadow[i];
 
-    Transaction.ui32InstrLen = 3;
-    Transaction.ui32Instr = instruction;
-    Transaction.eDirection = AM_HAL_IOM_TX;
-    Transaction.ui32NumBytes = len;
-    Transaction.pui32TxBuffer = (uint32_t *)data;
-    Transaction.bContinue = false;
-    Transaction.ui8RepeatCount = 0;
-    Transaction.ui32PauseCondition = 0;
-    Transaction.ui32StatusSetClr = 0;
-    Transaction.uPeerInfo.ui32SpiChipSelect = AM_BSP_RADIO_NSS_CHNL;
+        if (pui32ShadowInstr[i] != ui32Instr) {
+            continue;
+        }
+
+        if (psEntry->bValid && (psEntry->ui8Length == len) &&
+            (memcmp(psEntry->pui8Param, data, len) == 0)) {
+            return true;
+        }
+
+        psEntry->bValid = true;
+        psEntry->ui8Length = len;
+        memcpy(psEntry->pui8Param, data, len);
+        break;
+    }
+
+    return false;
+}
 
-    sx1262_block_on_busy();
-    am_hal_iom_blocking_transfer(gSpiHandle, &Transaction);
+static bool sx1262_interrupts_masked(void)
+{
+    return (__get_IPSR() != 0) || (__get_PRIMASK() != 0) ||
+           (__get_BASEPRI() != 0);
 }
 
-static void sx1262_write_buffer(uint8_t off, const uint8_t *data, uint8_t len)
+static void sx1262_command_complete(void *pCallbackCtxt, uint32_t ui32Status)
 {
-    am_hal_iom_transfer_t Transaction;
+    sx1262_context_t *psRadio = (sx1262_context_t *)pCallbackCtxt;
 
-    Transaction.ui32InstrLen = 2;
-    Transaction.ui32Instr = (CMD_WRITEBUFFER << 8) | off;
-    Transaction.eDirection = AM_HAL_IOM_TX;
-    Transaction.ui32NumBytes = len;
-    Transaction.pui32TxBuffer = (uint32_t *)data;
-    Transaction.bContinue = false;
-    Transaction.ui8RepeatCount = 0;
-    Transaction.ui32PauseCondition = 0;
-    Transaction.ui32StatusSetClr = 0;
-    Transaction.uPeerInfo.ui32SpiChipSelect = AM_BSP_RADIO_NSS_CHNL;
+    if (ui32Status != AM_HAL_STATUS_SUCCESS) {
+        psRadio->ui32CommandError = ui32Status;
+        psRadio->ui32CommandIndex = psRadio->ui32CommandCount;
+    }
 
-    sx1262_block_on_busy();
-    am_hal_iom_blocking_transfer(gSpiHandle, &Transaction);
+    sx1262_command_next(psRadio);
 }
 
-static void sx1262_write_fifo(uint8_t *buf, uint8_t len)
+// Issues the next queued command once BUSY is released.  Runs from the IOM
+// and BUSY interrupts, or with interrupts disabled when the queue is started.
+static void sx1262_command_next(sx1262_context_t *psRadio)
 {
-    static const uint8_t ui8FifoOffsets[] = {0, 0};
-    sx1262_write_command(CMD_SETBUFFERBASEADDRESS, ui8FifoOffsets, 2);
+    if (psRadio->ui32CommandIndex >= psRadio->ui32CommandCount) {
+        // the shadow was updated when the queue was built
+        if (psRadio->ui32CommandError != AM_HAL_STATUS_SUCCESS) {
+            sx1262_shadow_invalidate(psRadio);
+            psRadio->i32CalibratedBand = IMAGE_CALIBRATION_NONE;
+        }
+        psRadio->bCommandQueueActive = false;
+
+        if (psRadio->pfnCommandComplete) {
+            psRadio->pfnCommandComplete(psRadio->pCommandContext);
+        }
+
+        // radio interrupts that arrived while the bus was owned by the queue
+        if (psRadio->bIrqPending) {
+            sx1262_irq_dispatch(psRadio);
+        }
+        return;
+    }
+
+    if (sx1262_is_busy(psRadio)) {
+        psRadio->bCommandWaitBusy = true;
+        am_hal_gpio_interrupt_clear(AM_HAL_GPIO_BIT(psRadio->ui32PinBusy));
+        am_hal_gpio_interrupt_enable(AM_HAL_GPIO_BIT(psRadio->ui32PinBusy));
+
+        if (sx1262_is_busy(psRadio)) {
+            return;
+        }
+
+        am_hal_gpio_interrupt_disable(AM_HAL_GPIO_BIT(psRadio->ui32PinBusy));
+        am_hal_gpio_interrupt_clear(AM_HAL_GPIO_BIT(psRadio->ui32PinBusy));
+        psRadio->bCommandWaitBusy = false;
+    }
+
+    sx1262_command_t *psCommand =
+        &psRadio->psCommandQueue[psRadio->ui32CommandIndex++];
+    uint32_t ui32Status =
+        am_hal_iom_nonblocking_transfer(psRadio->pSpiHandle,
+                                        &psCommand->sTransaction,
+                                        sx1262_command_complete, psRadio);
+    if (ui32Status != AM_HAL_STATUS_SUCCESS) {
+        psRadio->ui32CommandError = ui32Status;
+        psRadio->ui32CommandIndex = psRadio->ui32CommandCount;
+        sx1262_command_next(psRadio);
+    }
+}
+
+static void sx1262_command_queue_begin(sx1262_context_t *psRadio)
+{
+    psRadio->ui32CommandCount = 0;
+    psRadio->ui32CommandIndex = 0;
+    psRadio->ui32CommandError = AM_HAL_STATUS_SUCCESS;
+    psRadio->bCommandQueueOpen = true;
+}
+
+static uint32_t sx1262_command_queue_commit(sx1262_context_t *psRadio,
+                                            lora_radio_callback_t pfnCallback,
+                                            void *pCallbackContext)
+{
+    psRadio->bCommandQueueOpen = false;
+
+    if (psRadio->ui32CommandError != AM_HAL_STATUS_SUCCESS) {
+        sx1262_shadow_invalidate(psRadio);
+        psRadio->i32CalibratedBand = IMAGE_CALIBRATION_NONE;
+        return LORA_RADIO_STATUS_FAIL;
+    }
+
+    psRadio->pfnCommandComplete = pfnCallback;
+    psRadio->pCommandContext = pCallbackContext;
+    psRadio->bCommandQueueActive = true;
+
+    uint32_t ui32Critical = am_hal_interrupt_master_disable();
+    sx1262_command_next(psRadio);
+    am_hal_interrupt_master_set(ui32Critical);
+
+    return LORA_RADIO_STATUS_SUCCESS;
+}
+
+// Waits for an outstanding command queue to drain before the bus is used in
+// blocking mode.  When the IOM and BUSY interrupts cannot be taken, they are
+// serviced by polling instead.
+static void sx1262_command_queue_wait(sx1262_context_t *psRadio)
+{
+    uint32_t ui32Status;
+
+    while (psRadio->bCommandQueueActive) {
+        if (!sx1262_interrupts_masked()) {
+            continue;
+        }
+
+        if ((am_hal_iom_interrupt_status_get(psRadio->pSpiHandle, true,
+                                             &ui32Status) ==
+             AM_HAL_STATUS_SUCCESS) &&
+            ui32Status) {
+            am_hal_iom_interrupt_clear(psRadio->pSpiHandle, ui32Status);
+            am_hal_iom_interrupt_service(psRadio->pSpiHandle, ui32Status);
+        }
+
+        if (psRadio->bCommandWaitBusy && !sx1262_is_busy(psRadio)) {
+            sx1262_busy_isr(psRadio);
+        }
+    }
+}
+
+static void sx1262_command_enqueue(sx1262_context_t *psRadio,
+                                   am_hal_iom_transfer_t *psTransaction)
+{
+    if (psRadio->ui32CommandCount >= SX1262_COMMAND_QUEUE_SIZE) {
+        psRadio->ui32CommandError = AM_HAL_STATUS_OUT_OF_RANGE;
+        return;
+    }
+
+    sx1262_command_t *psCommand =
+        &psRadio->psCommandQueue[psRadio->ui32CommandCount++];
+    memcpy(&psCommand->sTransaction, psTransaction,
+           sizeof(am_hal_iom_transfer_t));
+
+    // short parameter blocks usually live on the caller's stack
+    if ((psTransaction->eDirection == AM_HAL_IOM_TX) &&
+        (psTransaction->ui32NumBytes <= SX1262_COMMAND_PARAM_SIZE)) {
+        memcpy(psCommand->pui32Param, psTransaction->pui32TxBuffer,
+               psTransaction->ui32NumBytes);
+        psCommand->sTransaction.pui32TxBuffer = psCommand->pui32Param;
+    }
+}
+
+static void sx1262_iom_transfer_init(sx1262_context_t *psRadio,
+                                     am_hal_iom_transfer_t *psTransfer,
+                                     uint32_t ui32Instr, uint32_t ui32InstrLen)
+{
+    memset(psTransfer, 0, sizeof(am_hal_iom_transfer_t));
+    psTransfer->ui32Instr = ui32Instr;
+    psTransfer->ui32InstrLen = ui32InstrLen;
+    psTransfer->uPeerInfo.ui32SpiChipSelect = psRadio->ui32ChipSelect;
+}
+
+static void sx1262_iom_transfer_issue(sx1262_context_t *psRadio,
+                                      am_hal_iom_transfer_t *psTransfer)
+{
+    if (psRadio->bCommandQueueOpen) {
+        sx1262_command_enqueue(psRadio, psTransfer);
+    } else {
+        am_hal_iom_blocking_transfer(psRadio->pSpiHandle, psTransfer);
+    }
+}
+
+// A sleeping chip holds BUSY high and ignores the frame that wakes it, so
+// one is sent before anything waits on BUSY.
+static void sx1262_wakeup(sx1262_context_t *psRadio)
+{
+    static const uint8_t ui8Nop = 0;
+    am_hal_iom_transfer_t sTransfer;
+
+    sx1262_iom_transfer_init(psRadio, &sTransfer, CMD_GETSTATUS, 1);
+    sTransfer.eDirection = AM_HAL_IOM_TX;
+    sTransfer.ui32NumBytes = 1;
+    sTransfer.pui32TxBuffer = (uint32_t *)&ui8Nop;
+    am_hal_iom_blocking_transfer(psRadio->pSpiHandle, &sTransfer);
 
-    sx1262_write_buffer(0, buf, len);
+    psRadio->bAsleep = false;
 }
 
-static uint8_t sx1262_read_command(uint8_t cmd, uint8_t *data, uint8_t len)
+// Runs the segments back to back.  While a command queue is being built
+// they are appended to it and go out as one IOM command list, read buffers
+// must then stay valid until the queue completes.
+static void sx1262_spi_transaction(sx1262_context_t *psRadio,
+                                   const sx1262_segment_t *psSegments,
+                                   uint32_t ui32Count)
 {
-    am_hal_iom_transfer_t Transaction;
+    am_hal_iom_transfer_t sTransfer;
+
+    if (!psRadio->bCommandQueueOpen) {
+        sx1262_command_queue_wait(psRadio);
+        if (psRadio->bAsleep) {
+            sx1262_wakeup(psRadio);
+        }
+    }
+
+    for (uint32_t i = 0; i < ui32Count; i++) {
+        const sx1262_segment_t *psSegment = &psSegments[i];
+        bool bRead = psSegment->ui32RxLength != 0;
+        uint32_t ui32Instr = psSegment->ui32Instr;
+        uint32_t ui32InstrLen = psSegment->ui32InstrLen;
+
+        if (!psRadio->bCommandQueueOpen) {
+            sx1262_block_on_busy(psRadio);
+        }
+
+        if (!bRead) {
+            psRadio->sCommandStats.ui32Sent++;
+        }
 
-    Transaction.ui32InstrLen = 1;
-    Transaction.ui32Instr = cmd;
-    Transaction.eDirection = AM_HAL_IOM_RX;
-    Transaction.ui32NumBytes = len;
-    Transaction.pui32RxBuffer = (uint32_t *)data;
-    Transaction.bContinue = false;
-    Transaction.ui8RepeatCount = 0;
-    Transaction.ui32PauseCondition = 0;
-    Transaction.ui32StatusSetClr = 0;
-    Transaction.uPeerInfo.ui32SpiChipSelect = AM_BSP_RADIO_NSS_CHNL;
+        // the write phase keeps NSS asserted when a read follows
+        if (psSegment->ui32TxLength || !bRead) {
+            sx1262_iom_transfer_init(psRadio, &sTransfer, ui32Instr,
+                                     ui32InstrLen);
+            sTransfer.eDirection = AM_HAL_IOM_TX;
+            sTransfer.ui32NumBytes = psSegment->ui32TxLength;
+            sTransfer.pui32TxBuffer = (uint32_t *)psSegment->pui8Tx;
+            sTransfer.bContinue = bRead;
+            sx1262_iom_transfer_issue(psRadio, &sTransfer);
+
+            ui32Instr = 0;
+            ui32InstrLen = 0;
+        }
+
+        if (bRead) {
+            sx1262_iom_transfer_init(psRadio, &sTransfer, ui32Instr,
+                                     ui32InstrLen);
+            sTransfer.eDirection = AM_HAL_IOM_RX;
+            sTransfer.ui32NumBytes = psSegment->ui32RxLength;
+            sTransfer.pui32RxBuffer = (uint32_t *)psSegment->pui8Rx;
+            sx1262_iom_transfer_issue(psRadio, &sTransfer);
+        }
+    }
+}
+
+static void sx1262_spi_write(sx1262_context_t *psRadio, uint32_t ui32Instr,
+                             uint32_t ui32InstrLen, const uint8_t *data,
+                             uint32_t len)
+{
+    sx1262_segment_t sSegment = {.ui32Instr = ui32Instr,
+                                 .ui32InstrLen = ui32InstrLen,
+                                 .pui8Tx = data,
+                                 .ui32TxLength = len};
+
+    if (sx1262_shadow_update(psRadio, ui32Instr, data, len)) {
+        psRadio->sCommandStats.ui32Skipped++;
+        return;
+    }
 
-    sx1262_block_on_busy();
-    am_hal_iom_blocking_transfer(gSpiHandle, &Transaction);
+    sx1262_spi_transaction(psRadio, &sSegment, 1);
 }
 
-static void sx1262_read_registers(uint16_t addr, uint8_t *data, uint8_t len)
+static void sx1262_spi_read(sx1262_context_t *psRadio, uint32_t ui32Instr,
+                            uint32_t ui32InstrLen, const uint8_t *tx,
+                            uint32_t txlen, uint8_t *data, uint32_t len)
 {
-    uint16_t offset =
-        __bswap16(addr); // offset = (addr >> 8) | ((addr & 0xFF) << 8)
-    uint32_t instruction = (offset << 8) | CMD_READREGISTER;
+    sx1262_segment_t sSegment = {.ui32Instr = ui32Instr,
+                                 .ui32InstrLen = ui32InstrLen,
+                                 .pui8Tx = tx,
+                                 .ui32TxLength = txlen,
+                                 .pui8Rx = data,
+                                 .ui32RxLength = len};
+
+    sx1262_spi_transaction(psRadio, &sSegment, 1);
+}
 
-    am_hal_iom_transfer_t Transaction;
+static void sx1262_write_command(sx1262_context_t *psRadio, uint8_t cmd,
+                                 const uint8_t *data, uint8_t len)
+{
+    sx1262_spi_write(psRadio, cmd, 1, data, len);
+}
 
-    Transaction.ui32InstrLen = 0;
-    Transaction.ui32Instr = 0;
-    Transaction.eDirection = AM_HAL_IOM_TX;
-    Transaction.ui32NumBytes = 4;
-    Transaction.pui32TxBuffer = (uint32_t *)&instruction;
-    Transaction.bContinue = true;
-    Transaction.ui8RepeatCount = 0;
-    Transaction.ui32PauseCondition = 0;
-    Transaction.ui32StatusSetClr = 0;
-    Transaction.uPeerInfo.ui32SpiChipSelect = AM_BSP_RADIO_NSS_CHNL;
+static void sx1262_write_registers(sx1262_context_t *psRadio, uint16_t addr,
+                                   const uint8_t *data, uint8_t len)
+{
+    sx1262_spi_write(psRadio, (CMD_WRITEREGISTER << 16) | addr, 3, data, len);
+}
 
-    sx1262_block_on_busy();
-    am_hal_iom_blocking_transfer(gSpiHandle, &Transaction);
+static void sx1262_write_buffer(sx1262_context_t *psRadio, uint8_t off,
+                                const uint8_t *data, uint8_t len)
+{
+    sx1262_spi_write(psRadio, (CMD_WRITEBUFFER << 8) | off, 2, data, len);
+}
 
-    Transaction.ui32InstrLen = 0;
-    Transaction.ui32Instr = 0;
-    Transaction.eDirection = AM_HAL_IOM_RX;
-    Transaction.ui32NumBytes = len;
-    Transaction.pui32RxBuffer = (uint32_t *)data;
-    Transaction.bContinue = false;
-    Transaction.ui8RepeatCount = 0;
-    Transaction.ui32PauseCondition = 0;
-    Transaction.ui32StatusSetClr = 0;
-    Transaction.uPeerInfo.ui32SpiChipSelect = AM_BSP_RADIO_NSS_CHNL;
+static void sx1262_write_fifo(sx1262_context_t *psRadio, uint8_t *buf,
+                              uint8_t len)
+{
+    static const uint8_t ui8FifoOffsets[] = {0, 0};
+    sx1262_write_command(psRadio, CMD_SETBUFFERBASEADDRESS, ui8FifoOffsets, 2);
 
-    am_hal_iom_blocking_transfer(gSpiHandle, &Transaction);
+    sx1262_write_buffer(psRadio, 0, buf, len);
 }
 
-static void sx1262_read_buffer(uint8_t off, uint8_t *data, uint8_t len)
+static void sx1262_read_command(sx1262_context_t *psRadio, uint8_t cmd,
+                                uint8_t *data, uint8_t len)
 {
-    uint32_t instruction = (CMD_READBUFFER << 16) | (off << 8);
+    sx1262_spi_read(psRadio, cmd, 1, NULL, 0, data, len);
+}
 
-    am_hal_iom_transfer_t Transaction;
+static void sx1262_read_registers(sx1262_context_t *psRadio, uint16_t addr,
+                                  uint8_t *data, uint8_t len)
+{
+    // the status byte returned after the address is clocked out as a NOP
+    static const uint8_t ui8Nop = 0;
 
-    Transaction.ui32InstrLen = 3;
-    Transaction.ui32Instr = instruction;
-    Transaction.eDirection = AM_HAL_IOM_RX;
-    Transaction.ui32NumBytes = len;
-    Transaction.pui32RxBuffer = (uint32_t *)data;
-    Transaction.bContinue = false;
-    Transaction.ui8RepeatCount = 0;
-    Transaction.ui32PauseCondition = 0;
-    Transaction.ui32StatusSetClr = 0;
-    Transaction.uPeerInfo.ui32SpiChipSelect = AM_BSP_RADIO_NSS_CHNL;
+    sx1262_spi_read(psRadio, (CMD_READREGISTER << 16) | addr, 3, &ui8Nop, 1,
+                    data, len);
+}
 
-    sx1262_block_on_busy();
-    am_hal_iom_blocking_transfer(gSpiHandle, &Transaction);
+static void sx1262_read_buffer(sx1262_context_t *psRadio, uint8_t off,
+                               uint8_t *data, uint8_t len)
+{
+    sx1262_spi_read(psRadio, (CMD_READBUFFER << 16) | (off << 8), 3, NULL, 0,
+                    data, len);
 }
 
-static uint8_t sx1262_read_fifo(uint8_t *buf)
+static uint8_t sx1262_read_fifo(sx1262_context_t *psRadio, uint8_t *buf)
 {
     // get buffer status
     uint8_t status[4];
-    sx1262_read_command(CMD_GETRXBUFFERSTATUS, status, 4);
+    sx1262_read_command(psRadio, CMD_GETRXBUFFERSTATUS, status, 4);
 
     // read buffer
     uint8_t len = status[1];
     uint8_t off = status[2];
-    sx1262_read_buffer(off, buf, len);
+    sx1262_read_buffer(psRadio, off, buf, len);
 
     // return length
     return len;
 }
 
-void sx1262_set_mode(uint8_t mode, uint32_t ui32Parameter)
+void sx1262_set_mode(sx1262_context_t *psRadio, uint8_t mode,
+                     uint32_t ui32Parameter)
 {
     switch (mode) {
     case CMD_SETSLEEP:
     case CMD_SETSTANDBY:
-        sx1262_write_command(mode, (uint8_t *)&ui32Parameter, 1);
+        sx1262_write_command(psRadio, mode, (uint8_t *)&ui32Parameter, 1);
         break;
     case CMD_SETFS:
+    case CMD_SETCAD:
     case CMD_SETTXCONTINUOUSWAVE:
-        sx1262_write_command(mode, NULL, 0);
+        sx1262_write_command(psRadio, mode, NULL, 0);
         break;
     case CMD_SETTX:
     case CMD_SETRX: {
         uint8_t timeout[3] = {(ui32Parameter >> 16) & 0xFF,
                               (ui32Parameter >> 8) & 0xFF,
                               ui32Parameter & 0xFF};
-        sx1262_write_command(mode, timeout, 3);
+        sx1262_write_command(psRadio, mode, timeout, 3);
     } break;
     }
 }
 
-static void sx1262_config_regulator()
+static void sx1262_config_regulator(sx1262_context_t *psRadio)
 {
     uint8_t mode = REGMODE_DCDC;
-    sx1262_write_command(CMD_SETREGULATORMODE, &mode, 1);
+    sx1262_write_command(psRadio, CMD_SETREGULATORMODE, &mode, 1);
 }
 
 // use DIO2 to drive antenna rf switch
-static void sx1262_set_dio2_rf_switch_ctrl(uint8_t enable)
+static void sx1262_set_dio2_rf_switch_ctrl(sx1262_context_t *psRadio,
+                                           uint8_t enable)
 {
-    sx1262_write_command(CMD_SETDIO2ASRFSWITCHCTRL, &enable, 1);
+    sx1262_write_command(psRadio, CMD_SETDIO2ASRFSWITCHCTRL, &enable, 1);
 }
 
 // set radio to PACKET_TYPE_LORA or PACKET_TYPE_FSK mode
-static void sx1262_init_packet_type()
+static void sx1262_init_packet_type(sx1262_context_t *psRadio)
 {
     uint8_t type = PACKET_TYPE_LORA;
-    sx1262_write_command(CMD_SETPACKETTYPE, &type, 1);
+    sx1262_write_command(psRadio, CMD_SETPACKETTYPE, &type, 1);
 }
 
 // calibrate the image rejection
-static void CalibrateImage(uint32_t freq)
-{
-    static const struct {
-        uint32_t min;
-        uint32_t max;
-        uint8_t freq[2];
-    } bands[] = {
-        {430000000, 440000000, (uint8_t[]){0x6B, 0x6F}},
-        {470000000, 510000000, (uint8_t[]){0x75, 0x81}},
-        {779000000, 787000000, (uint8_t[]){0xC1, 0xC5}},
-        {863000000, 870000000, (uint8_t[]){0xD7, 0xDB}},
-        {902000000, 928000000, (uint8_t[]){0xE1, 0xE9}},
-    };
-
+//
+// Image calibration keeps BUSY asserted for several milliseconds, so it is
+// only performed when the frequency moves to a different band or the last
+// calibration has been invalidated.
+static const struct {
+    uint32_t min;
+    uint32_t max;
+    uint8_t freq[2];
+} bands[] = {
+    {430000000, 440000000, {0x6B, 0x6F}},
+    {470000000, 510000000, {0x75, 0x81}},
+    {779000000, 787000000, {0xC1, 0xC5}},
+    {863000000, 870000000, {0xD7, 0xDB}},
+    {902000000, 928000000, {0xE1, 0xE9}},
+};
+
+static int32_t sx1262_band_get(uint32_t freq)
+{
     for (int i = 0; i < sizeof(bands) / sizeof(bands[0]); i++) {
         if (freq >= bands[i].min && freq <= bands[i].max) {
-            sx1262_write_command(CMD_CALIBRATEIMAGE, bands[i].freq, 2);
+            return i;
         }
     }
+
+    return IMAGE_CALIBRATION_NONE;
+}
+
+static void CalibrateImage(sx1262_context_t *psRadio, uint32_t freq,
+                           bool bForce)
+{
+    int32_t i32Band = sx1262_band_get(freq);
+
+    if (i32Band == IMAGE_CALIBRATION_NONE) {
+        return;
+    }
+
+    if (!bForce && (i32Band == psRadio->i32CalibratedBand)) {
+        return;
+    }
+
+    sx1262_write_command(psRadio, CMD_CALIBRATEIMAGE, bands[i32Band].freq, 2);
+    psRadio->i32CalibratedBand = i32Band;
 }
 
-static void sx1262_set_frequency(uint32_t freq)
+static void sx1262_set_frequency(sx1262_context_t *psRadio, uint32_t freq)
 {
-    CalibrateImage(freq);
+    CalibrateImage(psRadio, freq, false);
 
     uint32_t v = (uint32_t)(((uint64_t)freq << 25) / 32000000);
     uint32_t f = __bswap32(v);
 
-    sx1262_write_command(CMD_SETRFFREQUENCY, (uint8_t *)&f, 4);
+    sx1262_write_command(psRadio, CMD_SETRFFREQUENCY, (uint8_t *)&f, 4);
 }
 
-static void
-sx1262_config_modulation(lora_radio_modulation_t *psModulationParameters)
+// SX1262 bandwidth register values indexed by lora_radio_bandwidth_e
+static const uint8_t pui8BandwidthRegister[] = {0x00, 0x08, 0x01, 0x09, 0x02,
+                                                0x0A, 0x03, 0x04, 0x05, 0x06};
+
+// bandwidths in Hz indexed by lora_radio_bandwidth_e
+static const uint32_t pui32BandwidthHz[] = {7810,  10420, 15630,  20830,
+                                            31250, 41670, 62500,  125000,
+                                            250000, 500000};
+
+// low data rate optimization is mandated once the symbol time exceeds 16 ms
+static lora_radio_low_data_rate_optimization_e
+sx1262_ldro_get(const lora_radio_modulation_t *psModulationParameters)
 {
-    uint8_t param[4];
-    param[0] = psModulationParameters->eSpreadingFactor;
+    lora_radio_spreading_factor_e eSpreadingFactor =
+        psModulationParameters->eSpreadingFactor;
+
     switch (psModulationParameters->eBandwidth) {
     case LORA_RADIO_BW_7:
-        param[1] = 0x00;
-        psModulationParameters->eLowDataRateOptimization = 0x01;
-        break;
     case LORA_RADIO_BW_10:
-        param[1] = 0x08;
-        psModulationParameters->eLowDataRateOptimization = 0x01;
-        break;
     case LORA_RADIO_BW_15:
-        param[1] = 0x01;
-        psModulationParameters->eLowDataRateOptimization = 0x01;
-        break;
     case LORA_RADIO_BW_20:
-        param[1] = 0x09;
-        psModulationParameters->eLowDataRateOptimization = 0x01;
-        break;
     case LORA_RADIO_BW_31:
-        param[1] = 0x02;
-        psModulationParameters->eLowDataRateOptimization = 0x01;
-        break;
+        return LORA_RADIO_LDR_OPT_ON;
     case LORA_RADIO_BW_41:
-        param[1] = 0x0A;
-        if (psModulationParameters->eSpreadingFactor >= LORA_RADIO_SF9) {
-            psModulationParameters->eLowDataRateOptimization = 0x01;
-        } else {
-            psModulationParameters->eLowDataRateOptimization = 0x00;
-        }
-        break;
+        return (eSpreadingFactor >= LORA_RADIO_SF9) ? LORA_RADIO_LDR_OPT_ON
+                                                    : LORA_RADIO_LDR_OPT_OFF;
     case LORA_RADIO_BW_62:
-        param[1] = 0x03;
-        if (psModulationParameters->eSpreadingFactor >= LORA_RADIO_SF10) {
-            psModulationParameters->eLowDataRateOptimization = 0x01;
-        } else {
-            psModulationParameters->eLowDataRateOptimization = 0x00;
-        }
-        break;
+        return (eSpreadingFactor >= LORA_RADIO_SF10) ? LORA_RADIO_LDR_OPT_ON
+                                                     : LORA_RADIO_LDR_OPT_OFF;
     case LORA_RADIO_BW_125:
-        if (psModulationParameters->eSpreadingFactor >= LORA_RADIO_SF11) {
-            psModulationParameters->eLowDataRateOptimization = 0x01;
-        } else {
-            psModulationParameters->eLowDataRateOptimization = 0x00;
-        }
-        param[1] = 0x04;
-        break;
+        return (eSpreadingFactor >= LORA_RADIO_SF11) ? LORA_RADIO_LDR_OPT_ON
+                                                     : LORA_RADIO_LDR_OPT_OFF;
     case LORA_RADIO_BW_250:
-        if (psModulationParameters->eSpreadingFactor >= LORA_RADIO_SF12) {
-            psModulationParameters->eLowDataRateOptimization = 0x01;
-        } else {
-            psModulationParameters->eLowDataRateOptimization = 0x00;
-        }
-        param[1] = 0x05;
-        break;
-    case LORA_RADIO_BW_500:
-        param[1] = 0x06;
-        psModulationParameters->eLowDataRateOptimization = 0x00;
-        break;
+        return (eSpreadingFactor >= LORA_RADIO_SF12) ? LORA_RADIO_LDR_OPT_ON
+                                                     : LORA_RADIO_LDR_OPT_OFF;
+    default:
+        return LORA_RADIO_LDR_OPT_OFF;
     }
-
-    param[2] = psModulationParameters->eCodingRate + 1;
-    param[3] = psModulationParameters->eLowDataRateOptimization;
-
-    sx1262_write_command(CMD_SETMODULATIONPARAMS, param, 4);
 }
 
-static void sx1262_config_packet(lora_radio_packet_t *psPacketParameters)
+// the payload length is the only packet parameter that changes per packet
+static void sx1262_config_profile(sx1262_context_t *psRadio,
+                                  const lora_radio_profile_t *psProfile,
+                                  uint8_t ui8PayloadLength)
 {
     uint8_t param[6];
 
-    uint16_t ui16PreambleLength = psPacketParameters->ui16PreambleLength;
-    param[0] = (ui16PreambleLength >> 8);
-    param[1] = ui16PreambleLength;
-    param[2] = psPacketParameters->ePacketLength;
-    param[3] = psPacketParameters->ui8PayloadLength;
-    param[4] = psPacketParameters->eCRC;
-    param[5] = psPacketParameters->eIQ;
+    memcpy(param, psProfile->pui8Packet, 6);
+    param[3] = ui8PayloadLength;
 
-    sx1262_write_command(CMD_SETPACKETPARAMS, param, 6);
+    sx1262_init_packet_type(psRadio);
+    sx1262_write_command(psRadio, CMD_SETPACKETPARAMS, param, 6);
+    sx1262_write_command(psRadio, CMD_SETMODULATIONPARAMS,
+                         psProfile->pui8Modulation, 4);
+    sx1262_write_registers(psRadio, REG_LORASYNCWORDMSB,
+                           psProfile->pui8SyncWord, 2);
 }
 
-static void sx1262_interrupt_clear(uint16_t mask)
+static void sx1262_interrupt_clear(sx1262_context_t *psRadio, uint16_t mask)
 {
     uint8_t buf[2] = {mask >> 8, mask & 0xFF};
-    sx1262_write_command(CMD_CLEARIRQSTATUS, buf, 2);
+    sx1262_write_command(psRadio, CMD_CLEARIRQSTATUS, buf, 2);
+}
+
+static void sx1262_stop_timer_on_preamble(sx1262_context_t *psRadio,
+                                          uint8_t enable)
+{
+    sx1262_write_command(psRadio, CMD_STOPTIMERONPREAMBLE, &enable, 1);
 }
 
-static void sx1262_stop_timer_on_preamble(uint8_t enable)
+// Number of symbols without a preamble lock after which a single reception
+// times out, 0 disables the timeout.  The chip rounds counts above 63 badly,
+// those are programmed as mantissa and exponent through the sync timeout
+// register instead.
+static void sx1262_set_symbol_timeout(sx1262_context_t *psRadio, uint8_t nsym)
 {
-    sx1262_write_command(CMD_STOPTIMERONPREAMBLE, &enable, 1);
+    uint8_t mant, exp = 0, reg;
+
+    if (nsym > SX1262_SYMBOL_TIMEOUT_MAX) {
+        nsym = SX1262_SYMBOL_TIMEOUT_MAX;
+    }
+
+    mant = (nsym + 1) >> 1;
+    while (mant > 31) {
+        mant = (mant + 3) >> 2;
+        exp++;
+    }
+
+    reg = mant << (2 * exp + 1);
+    sx1262_write_command(psRadio, CMD_SETLORASYMBNUMTIMEOUT, &reg, 1);
+
+    if (nsym != 0) {
+        reg = exp + (mant << 3);
+        sx1262_write_registers(psRadio, REG_LORASYNCTIMEOUT, &reg, 1);
+    }
 }
 
-// set number of symbols for reception
-static void sx1262_set_symbol_timeout(uint8_t nsym)
+// In implicit header mode the RTC keeps running after the reception ends
+// and may raise a stray timeout later on, stop it and clear the event
+// (SX1261/2 datasheet, section 15.3)
+static void sx1262_implicit_timeout_stop(sx1262_context_t *psRadio)
 {
-    sx1262_write_command(CMD_SETLORASYMBNUMTIMEOUT, &nsym, 1);
+    uint8_t reg = 0;
+
+    sx1262_write_registers(psRadio, REG_RTCCONTROL, &reg, 1);
+    sx1262_read_registers(psRadio, REG_EVENTMASK, &reg, 1);
+    reg |= 0x02;
+    sx1262_write_registers(psRadio, REG_EVENTMASK, &reg, 1);
 }
 
-static uint16_t sx1262_interrupt_status_get(void)
+static uint16_t sx1262_interrupt_status_get(sx1262_context_t *psRadio)
 {
     uint8_t buf[3];
-    sx1262_read_command(CMD_GETIRQSTATUS, buf, 3);
+    sx1262_read_command(psRadio, CMD_GETIRQSTATUS, buf, 3);
 
     return ((uint16_t)(buf[1] << 8) | buf[2]);
 }
 
-static void sx1262_get_packet_status(int8_t *rssi, int8_t *snr, int8_t *rscp)
+// The response follows the chip status byte.  RSSI is reported as -x/2 dBm
+// and SNR as a two's complement value in 0.25 dB, both are kept at full
+// resolution in 0.25 dB steps.
+static void sx1262_get_packet_status(sx1262_context_t *psRadio,
+                                     int16_t *rssi, int16_t *snr,
+                                     int16_t *signal)
 {
-    uint8_t buf[3];
-    sx1262_read_command(CMD_GETPACKETSTATUS, buf, 3);
-    *rssi = -buf[0] / 2;
-    *snr = buf[1] / 4;
-    *rscp = -buf[2] / 2;
+    uint8_t buf[4];
+    sx1262_read_command(psRadio, CMD_GETPACKETSTATUS, buf, 4);
+    *rssi = -2 * (int16_t)buf[1];
+    *snr = (int8_t)buf[2];
+    *signal = -2 * (int16_t)buf[3];
 }
 
-static uint16_t sx1262_get_error_status(void)
+static uint16_t sx1262_get_error_status(sx1262_context_t *psRadio)
 {
     uint8_t buf[3];
-    sx1262_read_command(CMD_GETDEVICEERRORS, buf, 3);
+    sx1262_read_command(psRadio, CMD_GETDEVICEERRORS, buf, 3);
     return ((uint16_t)(buf[1] << 8) | buf[2]);
 }
 
-static uint16_t sx1262_get_device_status(void)
+static uint16_t sx1262_get_device_status(sx1262_context_t *psRadio)
 {
     uint8_t buf;
-    sx1262_read_command(CMD_GETSTATUS, &buf, 1);
+    sx1262_read_command(psRadio, CMD_GETSTATUS, &buf, 1);
     return buf;
 }
 
 // set and enable irq mask for dio1
-static void sx1262_interrupt_enable(uint16_t mask)
+// CRC and header errors are latched in the status without raising DIO1 so
+// that they can be counted when the reception completes
+static void sx1262_interrupt_enable(sx1262_context_t *psRadio, uint16_t mask)
 {
-    uint8_t param[] = {mask >> 8, mask & 0xFF, mask >> 8, mask & 0xFF,
-                       0x00,      0x00,        0x00,      0x00};
-    sx1262_write_command(CMD_SETDIOIRQPARAMS, param, 8);
+    uint16_t irq = mask;
+
+    if (mask & LORA_RADIO_RXDONE) {
+        irq |= LORA_RADIO_CRCERR | LORA_RADIO_HEADERERR;
+    }
+
+    uint8_t param[] = {irq >> 8, irq & 0xFF, mask >> 8, mask & 0xFF,
+                       0x00,     0x00,       0x00,      0x00};
+    sx1262_write_command(psRadio, CMD_SETDIOIRQPARAMS, param, 8);
 }
 
 // set tx power (in dBm)
-static void sx1262_set_power(int8_t i8Power)
+static void sx1262_set_power(sx1262_context_t *psRadio, int8_t i8Power)
 {
     // high power PA: -9 ... +22 dBm
     if (i8Power > 22) {
@@ -555,201 +1081,536 @@ static void sx1262_set_power(int8_t i8Power)
     }
 
     // set PA config (and reset OCP to 140mA)
-    sx1262_write_command(CMD_SETPACONFIG,
+    sx1262_write_command(psRadio, CMD_SETPACONFIG,
                          (const uint8_t[]){0x04, 0x07, 0x00, 0x01}, 4);
 
     uint8_t ui8TransmitParameters[2];
     ui8TransmitParameters[0] = (uint8_t)i8Power;
     ui8TransmitParameters[1] = 0x04; // ramp time 200us
-    sx1262_write_command(CMD_SETTXPARAMS, ui8TransmitParameters, 2);
+    sx1262_write_command(psRadio, CMD_SETTXPARAMS, ui8TransmitParameters, 2);
 }
 
-// set sync word for LoRa
-static void sx1262_set_syncword(uint16_t ui16SyncWord)
+static void sx1262_transmit(sx1262_context_t *psRadio,
+                            lora_radio_transfer_t *psTransaction)
 {
-    uint8_t buf[2] = {ui16SyncWord >> 8, ui16SyncWord & 0xFF};
-    sx1262_write_registers(REG_LORASYNCWORDMSB, buf, 2);
+    sx1262_set_mode(psRadio, CMD_SETSTANDBY, STDBY_RC);
+
+    sx1262_config_profile(psRadio, psTransaction->psProfile,
+                          psTransaction->ui8PayloadLength);
+
+    sx1262_set_frequency(psRadio, psTransaction->ui32Frequency);
+    sx1262_set_power(psRadio, psTransaction->ui8Power);
+
+    sx1262_write_fifo(psRadio, psTransaction->pui8Payload,
+                      psTransaction->ui8PayloadLength);
+    sx1262_interrupt_clear(psRadio, LORA_RADIO_IRQ_ALL);
+    sx1262_interrupt_enable(psRadio, LORA_RADIO_TXDONE | LORA_RADIO_TIMEOUT);
+    sx1262_set_mode(psRadio, CMD_SETTX,
+                    (psTransaction->ui32Timeout >> 8) & 0xFFFFFF);
+}
+
+static void sx1262_transmit_carrier(sx1262_context_t *psRadio,
+                                    lora_radio_transfer_t *psTransaction)
+{
+    sx1262_config_regulator(psRadio);
+    sx1262_set_dio2_rf_switch_ctrl(psRadio, 1);
+    sx1262_set_mode(psRadio, CMD_SETSTANDBY, STDBY_RC);
+
+    sx1262_set_frequency(psRadio, psTransaction->ui32Frequency);
+    sx1262_set_power(psRadio, psTransaction->ui8Power);
+    sx1262_interrupt_clear(psRadio, LORA_RADIO_IRQ_ALL);
+
+    sx1262_set_mode(psRadio, CMD_SETTXCONTINUOUSWAVE, 0);
 }
 
-static void sx1262_transmit(void *pHandle, lora_radio_transfer_t *psTransaction)
+static void sx1262_receive_setup(sx1262_context_t *psRadio,
+                                 lora_radio_transfer_t *psTransaction)
 {
-    lora_radio_modulation_t *psModulationParameters =
-        psTransaction->psModulationParameters;
-    lora_radio_packet_t *psPacketParameters = psTransaction->psPacketParameters;
+    const lora_radio_profile_t *psProfile = psTransaction->psProfile;
 
-    sx1262_set_mode(CMD_SETSTANDBY, STDBY_RC);
+    sx1262_set_mode(psRadio, CMD_SETSTANDBY, STDBY_RC);
 
-    sx1262_init_packet_type();
-    sx1262_config_packet(psPacketParameters);
-    sx1262_config_modulation(psModulationParameters);
+    sx1262_config_profile(psRadio, psProfile,
+                          psProfile->sPacket.ui8PayloadLength);
 
-    sx1262_set_frequency(psTransaction->ui32Frequency);
-    sx1262_set_power(psTransaction->ui8Power);
-    sx1262_set_syncword(psTransaction->ui32SyncWord);
+    sx1262_set_frequency(psRadio, psTransaction->ui32Frequency);
 
-    sx1262_write_fifo(psTransaction->pui8Payload,
-                      psPacketParameters->ui8PayloadLength);
-    sx1262_interrupt_clear(LORA_RADIO_IRQ_ALL);
-    sx1262_interrupt_enable(LORA_RADIO_TXDONE | LORA_RADIO_TIMEOUT);
-    sx1262_set_mode(CMD_SETTX, (psTransaction->ui32Timeout >> 8) & 0xFFFFFF);
+    memcpy(&psRadio->sRxModulation, &psProfile->sModulation,
+           sizeof(lora_radio_modulation_t));
+    memcpy(&psRadio->sRxPacket, &psProfile->sPacket,
+           sizeof(lora_radio_packet_t));
 }
 
-static void sx1262_transmit_carrier(void *pHandle,
-                                    lora_radio_transfer_t *psTransaction)
+static void sx1262_receive(sx1262_context_t *psRadio,
+                           lora_radio_transfer_t *psTransaction)
 {
-    sx1262_config_regulator();
-    sx1262_set_dio2_rf_switch_ctrl(1);
-    sx1262_set_mode(CMD_SETSTANDBY, STDBY_RC);
+    uint32_t ui32RxTimeout = (psTransaction->ui32Timeout >> 8) & 0xFFFFFF;
+    uint8_t ui8Symbols = psTransaction->ui32Timeout & 0xFF;
+
+    sx1262_receive_setup(psRadio, psTransaction);
+
+    // The symbol timeout is kept by the chip across receptions, it is
+    // written every time so that a value left over from a single reception
+    // cannot end a continuous one right away.  The timer runs until the
+    // header is found rather than stopping at the preamble, so noise that
+    // looks like a preamble does not hold the receiver open.
+    if (ui32RxTimeout == SX1262_RX_CONTINUOUS) {
+        ui8Symbols = 0;
+    }
+    sx1262_stop_timer_on_preamble(psRadio, 0);
+    sx1262_set_symbol_timeout(psRadio, ui8Symbols);
 
-    sx1262_set_frequency(psTransaction->ui32Frequency);
-    sx1262_set_power(psTransaction->ui8Power);
-    sx1262_interrupt_clear(LORA_RADIO_IRQ_ALL);
+    sx1262_interrupt_clear(psRadio, LORA_RADIO_IRQ_ALL);
+    sx1262_interrupt_enable(psRadio, LORA_RADIO_RXDONE | LORA_RADIO_TIMEOUT);
 
-    sx1262_set_mode(CMD_SETTXCONTINUOUSWAVE, 0);
+    sx1262_set_mode(psRadio, CMD_SETRX, ui32RxTimeout);
 }
 
-static void sx1262_receive(void *pHandle, lora_radio_transfer_t *psTransaction)
+// The radio alternates between sleep and short receive windows until a
+// preamble is detected.  Transmitters must send a preamble longer than one
+// sleep period plus two receive windows.
+static void sx1262_receive_duty_cycle(sx1262_context_t *psRadio,
+                                      lora_radio_transfer_t *psTransaction)
 {
-    lora_radio_modulation_t *psModulationParameters =
-        psTransaction->psModulationParameters;
-    lora_radio_packet_t *psPacketParameters = psTransaction->psPacketParameters;
+    uint32_t ui32RxPeriod = (psTransaction->ui32Timeout >> 8) & 0xFFFFFF;
+    uint32_t ui32SleepPeriod = psTransaction->ui32SleepPeriod;
 
-    sx1262_set_mode(CMD_SETSTANDBY, STDBY_RC);
+    if (ui32RxPeriod == 0) {
+        lora_radio_rx_duty_cycle_get(&psTransaction->psProfile->sModulation,
+                                     &psTransaction->psProfile->sPacket,
+                                     &ui32RxPeriod, &ui32SleepPeriod);
+    }
 
-    sx1262_init_packet_type();
-    sx1262_config_packet(psPacketParameters);
-    sx1262_config_modulation(psModulationParameters);
+    sx1262_receive_setup(psRadio, psTransaction);
+    sx1262_set_symbol_timeout(psRadio, 0);
 
-    sx1262_set_frequency(psTransaction->ui32Frequency);
-    sx1262_set_syncword(psTransaction->ui32SyncWord);
+    sx1262_interrupt_clear(psRadio, LORA_RADIO_IRQ_ALL);
+    sx1262_interrupt_enable(psRadio, LORA_RADIO_RXDONE | LORA_RADIO_TIMEOUT);
 
-    // FIXME:
-    // The following two lines causes immediate timeout and freezes
-    // for variable length packets.
-    /*
-    if (psPacketParameters->ePacketLength == LORA_RADIO_PACKET_LENGTH_FIXED)
-    {
-        sx1262_stop_timer_on_preamble(0);
-        sx1262_set_symbol_timeout(psTransaction->ui32Timeout & 0xFF);
+    // the preamble is too short to sleep through, listen continuously
+    if (ui32SleepPeriod == 0) {
+        sx1262_set_mode(psRadio, CMD_SETRX, 0xFFFFFF);
+        return;
     }
-    */
 
-    sx1262_interrupt_clear(LORA_RADIO_IRQ_ALL);
-    sx1262_interrupt_enable(LORA_RADIO_RXDONE | LORA_RADIO_TIMEOUT);
+    uint8_t param[] = {(ui32RxPeriod >> 16) & 0xFF,
+                       (ui32RxPeriod >> 8) & 0xFF,
+                       ui32RxPeriod & 0xFF,
+                       (ui32SleepPeriod >> 16) & 0xFF,
+                       (ui32SleepPeriod >> 8) & 0xFF,
+                       ui32SleepPeriod & 0xFF};
+    sx1262_write_command(psRadio, CMD_SETRXDUTYCYCLE, param, 6);
+}
 
-    sx1262_set_mode(CMD_SETRX, (psTransaction->ui32Timeout >> 8) & 0xFFFFFF);
+static void sx1262_config_cad(sx1262_context_t *psRadio,
+                              lora_radio_cad_t *psCadParameters,
+                              uint32_t ui32Timeout)
+{
+    uint8_t param[] = {psCadParameters->eSymbolNum,
+                       psCadParameters->ui8DetectPeak,
+                       psCadParameters->ui8DetectMin,
+                       psCadParameters->eExitMode,
+                       (ui32Timeout >> 16) & 0xFF,
+                       (ui32Timeout >> 8) & 0xFF,
+                       ui32Timeout & 0xFF};
+    sx1262_write_command(psRadio, CMD_SETCADPARAMS, param, 7);
 }
 
-uint32_t lora_radio_initialize(void **ppHandle)
+// Channel activity detection.  CADDONE is always raised, CADDETECTED is
+// raised alongside it when a LoRa preamble was found on the channel.
+static void sx1262_cad(sx1262_context_t *psRadio,
+                       lora_radio_transfer_t *psTransaction)
 {
-    uint32_t status = AM_HAL_STATUS_SUCCESS;
+    const lora_radio_profile_t *psProfile = psTransaction->psProfile;
+    lora_radio_cad_t *psCadParameters = psTransaction->psCadParameters;
+    uint16_t ui16Irq = LORA_RADIO_CADDONE | LORA_RADIO_CADDETECTED;
 
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_NRESET, g_AM_HAL_GPIO_OUTPUT);
-    am_hal_gpio_state_write(AM_BSP_GPIO_RADIO_NRESET,
-                            AM_HAL_GPIO_OUTPUT_TRISTATE_DISABLE);
-    am_hal_gpio_state_write(AM_BSP_GPIO_RADIO_NRESET, AM_HAL_GPIO_OUTPUT_SET);
+    sx1262_set_mode(psRadio, CMD_SETSTANDBY, STDBY_RC);
 
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_BUSY, g_AM_HAL_GPIO_INPUT);
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_DIO1, g_AM_HAL_GPIO_INPUT);
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_DIO3, g_AM_HAL_GPIO_INPUT);
+    sx1262_config_profile(psRadio, psProfile,
+                          psProfile->sPacket.ui8PayloadLength);
 
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_CLK, g_AM_BSP_GPIO_RADIO_CLK);
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_MISO, g_AM_BSP_GPIO_RADIO_MISO);
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_MOSI, g_AM_BSP_GPIO_RADIO_MOSI);
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_NSS, g_AM_BSP_GPIO_RADIO_NSS);
+    sx1262_set_frequency(psRadio, psTransaction->ui32Frequency);
+    sx1262_set_symbol_timeout(psRadio, 0);
+
+    sx1262_config_cad(psRadio, psCadParameters,
+                      (psTransaction->ui32Timeout >> 8) & 0xFFFFFF);
+
+    // a detected preamble may be followed by a reception
+    if (psCadParameters->eExitMode == LORA_RADIO_CAD_RX) {
+        memcpy(&psRadio->sRxModulation, &psProfile->sModulation,
+               sizeof(lora_radio_modulation_t));
+        memcpy(&psRadio->sRxPacket, &psProfile->sPacket,
+               sizeof(lora_radio_packet_t));
+        ui16Irq |= LORA_RADIO_RXDONE | LORA_RADIO_TIMEOUT;
+    }
+    psRadio->bCadExitRx = (psCadParameters->eExitMode == LORA_RADIO_CAD_RX);
+
+    sx1262_interrupt_clear(psRadio, LORA_RADIO_IRQ_ALL);
+    sx1262_interrupt_enable(psRadio, ui16Irq);
 
-    am_hal_gpio_interrupt_clear(AM_HAL_GPIO_BIT(AM_BSP_GPIO_RADIO_DIO1));
-    am_hal_gpio_interrupt_clear(AM_HAL_GPIO_BIT(AM_BSP_GPIO_RADIO_DIO3));
+    sx1262_set_mode(psRadio, CMD_SETCAD, 0);
+}
+
+// GPIO handlers carry no argument, each instance gets its own trampolines
+#define SX1262_INSTANCE_ISR(n)                                                 \
+    static void sx1262_busy_isr##n(void)                                       \
+    {                                                                          \
+        sx1262_busy_isr(&psRadioContext[n]);                                   \
+    }                                                                          \
+    static void lora_radio_isr##n(void)                                        \
+    {                                                                          \
+        lora_radio_isr(&psRadioContext[n]);                                    \
+    }
 
-    am_hal_gpio_interrupt_register(AM_BSP_GPIO_RADIO_DIO1, lora_radio_isr);
-    am_hal_gpio_interrupt_register(AM_BSP_GPIO_RADIO_DIO3, lora_radio_isr);
+SX1262_INSTANCE_ISR(0)
+#if LORA_RADIO_INSTANCES > 1
+SX1262_INSTANCE_ISR(1)
+#endif
+#if LORA_RADIO_INSTANCES > 2
+SX1262_INSTANCE_ISR(2)
+#endif
+#if LORA_RADIO_INSTANCES > 3
+SX1262_INSTANCE_ISR(3)
+#endif
+
+static const am_hal_gpio_handler_t pfnBusyIsr[LORA_RADIO_INSTANCES] = {
+    sx1262_busy_isr0,
+#if LORA_RADIO_INSTANCES > 1
+    sx1262_busy_isr1,
+#endif
+#if LORA_RADIO_INSTANCES > 2
+    sx1262_busy_isr2,
+#endif
+#if LORA_RADIO_INSTANCES > 3
+    sx1262_busy_isr3,
+#endif
+};
+
+static const am_hal_gpio_handler_t pfnRadioIsr[LORA_RADIO_INSTANCES] = {
+    lora_radio_isr0,
+#if LORA_RADIO_INSTANCES > 1
+    lora_radio_isr1,
+#endif
+#if LORA_RADIO_INSTANCES > 2
+    lora_radio_isr2,
+#endif
+#if LORA_RADIO_INSTANCES > 3
+    lora_radio_isr3,
+#endif
+};
+
+static IRQn_Type sx1262_iom_irq(sx1262_context_t *psRadio)
+{
+    return (IRQn_Type)(IOMSTR0_IRQn + psRadio->ui32IomModule);
+}
 
+static uint32_t sx1262_spi_clock_set(sx1262_context_t *psRadio,
+                                     uint32_t ui32Clock)
+{
     am_hal_iom_config_t sSpiConfig;
+    uint32_t ui32Status;
+
     sSpiConfig.eInterfaceMode = AM_HAL_IOM_SPI_MODE;
-    sSpiConfig.ui32ClockFreq = AM_HAL_IOM_4MHZ;
+    sSpiConfig.ui32ClockFreq = ui32Clock;
     sSpiConfig.eSpiMode = AM_HAL_IOM_SPI_MODE_0;
+    sSpiConfig.pNBTxnBuf = psRadio->pui32IomQueue;
+    sSpiConfig.ui32NBTxnBufLength = SX1262_IOM_QUEUE_SIZE;
 
-    if (am_hal_iom_initialize(3, &gSpiHandle) != AM_HAL_STATUS_SUCCESS) {
-        return LORA_RADIO_STATUS_FAIL;
-    }
-
-    if (am_hal_iom_power_ctrl(gSpiHandle, AM_HAL_SYSCTRL_WAKE, false) !=
-        AM_HAL_STATUS_SUCCESS) {
-        return LORA_RADIO_STATUS_FAIL;
-    }
+    // the IOM can only be reconfigured while disabled
+    am_hal_iom_disable(psRadio->pSpiHandle);
 
-    if (am_hal_iom_configure(gSpiHandle, &sSpiConfig) !=
-        AM_HAL_STATUS_SUCCESS) {
-        return LORA_RADIO_STATUS_FAIL;
+    ui32Status = am_hal_iom_configure(psRadio->pSpiHandle, &sSpiConfig);
+    if (ui32Status != AM_HAL_STATUS_SUCCESS) {
+        return ui32Status;
     }
 
-    if (am_hal_iom_enable(gSpiHandle) != AM_HAL_STATUS_SUCCESS) {
-        return LORA_RADIO_STATUS_FAIL;
+    ui32Status = am_hal_iom_enable(psRadio->pSpiHandle);
+    if (ui32Status == AM_HAL_STATUS_SUCCESS) {
+        psRadio->ui32SpiClock = ui32Clock;
     }
 
-    lora_radio_reset(&ppHandle);
+    return ui32Status;
+}
 
-    //    status = sx1262_get_device_status();
+// Checks the link at the current clock: the sync word register must hold
+// its reset value and patterns written to the data buffer must read back
+// unchanged.  Only valid right after a reset.
+static bool sx1262_spi_test(sx1262_context_t *psRadio)
+{
+    uint32_t pui32Pattern[SX1262_SPI_TEST_LENGTH / sizeof(uint32_t)];
+    uint32_t pui32Readback[SX1262_SPI_TEST_LENGTH / sizeof(uint32_t)];
+    static const uint8_t pui8Seed[SX1262_SPI_TEST_PASSES] = {0x00, 0x55,
+                                                             0xAA, 0xFF};
+    uint8_t *pui8Pattern = (uint8_t *)pui32Pattern;
+    uint8_t pui8SyncWord[2];
+
+    sx1262_read_registers(psRadio, REG_LORASYNCWORDMSB, pui8SyncWord, 2);
+    if (((pui8SyncWord[0] << 8) | pui8SyncWord[1]) !=
+        SX1262_LORASYNCWORD_RESET) {
+        return false;
+    }
 
-    am_hal_gpio_interrupt_enable(AM_HAL_GPIO_BIT(AM_BSP_GPIO_RADIO_DIO1));
-    am_hal_gpio_interrupt_enable(AM_HAL_GPIO_BIT(AM_BSP_GPIO_RADIO_DIO3));
-    NVIC_EnableIRQ(GPIO_IRQn);
+    for (uint32_t ui32Pass = 0; ui32Pass < SX1262_SPI_TEST_PASSES;
+         ui32Pass++) {
+        for (uint32_t i = 0; i < SX1262_SPI_TEST_LENGTH; i++) {
+            pui8Pattern[i] = (uint8_t)(i * 0x1D) ^ pui8Seed[ui32Pass];
+        }
 
-    //set priority below 0 to facilitate *FromISR FreeRTOS APIs
-    NVIC_SetPriority(GPIO_IRQn, IRQ_GPIO_PRIORITY);
+        memset(pui32Readback, 0, SX1262_SPI_TEST_LENGTH);
+        sx1262_write_buffer(psRadio, 0, pui8Pattern, SX1262_SPI_TEST_LENGTH);
+        sx1262_read_buffer(psRadio, 0, (uint8_t *)pui32Readback,
+                           SX1262_SPI_TEST_LENGTH);
 
-    sx1262_set_mode(CMD_SETSTANDBY, STDBY_RC);
-    sx1262_config_regulator();
-    sx1262_set_dio2_rf_switch_ctrl(1);
-    sx1262_init_packet_type();
+        if (memcmp(pui32Pattern, pui32Readback, SX1262_SPI_TEST_LENGTH)) {
+            return false;
+        }
+    }
 
-    return LORA_RADIO_STATUS_SUCCESS;
+    return true;
 }
 
-uint32_t lora_radio_deinitialize(void *pHandle)
+// Runs the link test from ui32MaxClock downwards and keeps the fastest
+// clock that passes.
+static uint32_t sx1262_spi_clock_select(sx1262_context_t *psRadio,
+                                        uint32_t ui32MaxClock)
 {
-    am_hal_gpio_interrupt_disable(AM_HAL_GPIO_BIT(AM_BSP_GPIO_RADIO_DIO1));
-    am_hal_gpio_interrupt_disable(AM_HAL_GPIO_BIT(AM_BSP_GPIO_RADIO_DIO3));
+    if (ui32MaxClock == 0) {
+        ui32MaxClock = SX1262_SPI_CLOCK_DEFAULT;
+    }
 
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_NRESET, g_AM_HAL_GPIO_DISABLE);
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_BUSY, g_AM_HAL_GPIO_DISABLE);
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_DIO1, g_AM_HAL_GPIO_DISABLE);
-    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_DIO3, g_AM_HAL_GPIO_DISABLE);
+    for (uint32_t i = 0; i < SPI_CLOCK_COUNT; i++) {
+        if (pui32SpiClocks[i] > ui32MaxClock) {
+            continue;
+        }
 
-    am_hal_iom_uninitialize(gSpiHandle);
-    am_hal_iom_power_ctrl(gSpiHandle, AM_HAL_SYSCTRL_DEEPSLEEP, false);
-    am_bsp_iom_pins_disable(3, AM_HAL_IOM_SPI_MODE);
-    am_hal_iom_disable(gSpiHandle);
+        if (sx1262_spi_clock_set(psRadio, pui32SpiClocks[i]) !=
+            AM_HAL_STATUS_SUCCESS) {
+            continue;
+        }
 
-    return LORA_RADIO_STATUS_SUCCESS;
+        if (sx1262_spi_test(psRadio)) {
+            return LORA_RADIO_STATUS_SUCCESS;
+        }
+    }
+
+    return LORA_RADIO_STATUS_FAIL;
 }
 
-uint32_t lora_radio_reset(void *pHandle)
+static uint32_t sx1262_initialize(sx1262_context_t *psRadio,
+                                  const lora_radio_hw_config_t *psConfig)
 {
-    am_hal_gpio_state_write(AM_BSP_GPIO_RADIO_NRESET, AM_HAL_GPIO_OUTPUT_CLEAR);
-    am_util_delay_us(100);
-    am_hal_gpio_state_write(AM_BSP_GPIO_RADIO_NRESET, AM_HAL_GPIO_OUTPUT_SET);
+    uint32_t ui32Instance = psRadio - psRadioContext;
+    lora_radio_irq_handler_t psCallbackList[MAX_CALLBACK];
+    uint32_t ui32CallbackListLength = psRadio->ui32CallbackListLength;
+    lora_radio_callback_t pfnIrqDefer = psRadio->pfnIrqDefer;
+
+    // Callbacks and the defer hook belong to the client, which may register
+    // them before the radio is brought up or keep them across a deinit and
+    // initialize.  Everything else starts from scratch.
+    memcpy(psCallbackList, psRadio->psCallbackList, sizeof(psCallbackList));
+    memset(psRadio, 0, sizeof(sx1262_context_t));
+    memcpy(psRadio->psCallbackList, psCallbackList, sizeof(psCallbackList));
+    psRadio->ui32CallbackListLength = ui32CallbackListLength;
+    psRadio->pfnIrqDefer = pfnIrqDefer;
+
+    psRadio->bInUse = true;
+    psRadio->ui32IomModule = psConfig->ui32IomModule;
+    psRadio->ui32ChipSelect = psConfig->ui32ChipSelect;
+    psRadio->ui32PinReset = psConfig->ui32PinReset;
+    psRadio->ui32PinBusy = psConfig->ui32PinBusy;
+    psRadio->ui32PinDio1 = psConfig->ui32PinDio1;
+    psRadio->ui32PinDio3 = psConfig->ui32PinDio3;
+    psRadio->i32CalibratedBand = IMAGE_CALIBRATION_NONE;
+
+    am_hal_gpio_pinconfig(psRadio->ui32PinReset, g_AM_HAL_GPIO_OUTPUT);
+    am_hal_gpio_state_write(psRadio->ui32PinReset,
+                            AM_HAL_GPIO_OUTPUT_TRISTATE_DISABLE);
+    am_hal_gpio_state_write(psRadio->ui32PinReset, AM_HAL_GPIO_OUTPUT_SET);
 
-    sx1262_config_regulator();
-    sx1262_set_mode(CMD_SETSTANDBY, STDBY_RC);
-    sx1262_set_dio2_rf_switch_ctrl(1);
-    sx1262_init_packet_type();
+    am_hal_gpio_pinconfig(psRadio->ui32PinBusy, g_AM_BSP_GPIO_RADIO_BUSY);
+    am_hal_gpio_pinconfig(psRadio->ui32PinDio1, g_AM_HAL_GPIO_INPUT);
+    am_hal_gpio_pinconfig(psRadio->ui32PinDio3, g_AM_HAL_GPIO_INPUT);
 
-    return LORA_RADIO_STATUS_SUCCESS;
-}
+    am_hal_gpio_interrupt_clear(AM_HAL_GPIO_BIT(psRadio->ui32PinBusy));
+    am_hal_gpio_interrupt_clear(AM_HAL_GPIO_BIT(psRadio->ui32PinDio1));
+    am_hal_gpio_interrupt_clear(AM_HAL_GPIO_BIT(psRadio->ui32PinDio3));
 
-uint32_t lora_radio_power_ctrl(void *pHandle,
-                               lora_radio_power_state_e ePowerState)
-{
-    switch (ePowerState) {
-    case LORA_RADIO_SLEEP:
-        sx1262_set_mode(CMD_SETSLEEP, SLEEP_WARM);
-        break;
-    case LORA_RADIO_DEEPSLEEP:
-        sx1262_set_mode(CMD_SETSLEEP, SLEEP_COLD);
-        break;
-    case LORA_RADIO_STANDBY:
-        sx1262_set_mode(CMD_SETSTANDBY, STDBY_RC);
+    // the BUSY interrupt is only enabled for the duration of a blocking wait
+    am_hal_gpio_interrupt_register(psRadio->ui32PinBusy,
+                                   pfnBusyIsr[ui32Instance]);
+    am_hal_gpio_interrupt_register(psRadio->ui32PinDio1,
+                                   pfnRadioIsr[ui32Instance]);
+    am_hal_gpio_interrupt_register(psRadio->ui32PinDio3,
+                                   pfnRadioIsr[ui32Instance]);
+
+    if (am_hal_iom_initialize(psRadio->ui32IomModule, &psRadio->pSpiHandle) !=
+        AM_HAL_STATUS_SUCCESS) {
+        psRadio->bInUse = false;
+        return LORA_RADIO_STATUS_FAIL;
+    }
+
+    if (am_hal_iom_power_ctrl(psRadio->pSpiHandle, AM_HAL_SYSCTRL_WAKE,
+                              false) != AM_HAL_STATUS_SUCCESS) {
+        psRadio->bInUse = false;
+        return LORA_RADIO_STATUS_FAIL;
+    }
+
+    if (sx1262_spi_clock_set(psRadio, SX1262_SPI_CLOCK_DEFAULT) !=
+        AM_HAL_STATUS_SUCCESS) {
+        psRadio->bInUse = false;
+        return LORA_RADIO_STATUS_FAIL;
+    }
+
+    // the IOM shares the GPIO priority so that the command queue is never
+    // preempted by the BUSY interrupt that advances it
+    NVIC_SetPriority(sx1262_iom_irq(psRadio), IRQ_GPIO_PRIORITY);
+    NVIC_EnableIRQ(sx1262_iom_irq(psRadio));
+
+    // the reset and the link test below already wait on BUSY through the
+    // interrupt, priority below 0 to facilitate *FromISR FreeRTOS APIs
+    NVIC_SetPriority(GPIO_IRQn, IRQ_GPIO_PRIORITY);
+    NVIC_EnableIRQ(GPIO_IRQn);
+
+    lora_radio_reset(psRadio);
+
+    //    status = sx1262_get_device_status(psRadio);
+
+    if (sx1262_spi_clock_select(psRadio, psConfig->ui32SpiClock) !=
+        LORA_RADIO_STATUS_SUCCESS) {
+        psRadio->bInUse = false;
+        return LORA_RADIO_STATUS_FAIL;
+    }
+
+    am_hal_gpio_interrupt_enable(AM_HAL_GPIO_BIT(psRadio->ui32PinDio1));
+    am_hal_gpio_interrupt_enable(AM_HAL_GPIO_BIT(psRadio->ui32PinDio3));
+
+    sx1262_set_mode(psRadio, CMD_SETSTANDBY, STDBY_RC);
+    sx1262_config_regulator(psRadio);
+    sx1262_set_dio2_rf_switch_ctrl(psRadio, 1);
+    sx1262_init_packet_type(psRadio);
+
+    return LORA_RADIO_STATUS_SUCCESS;
+}
+
+#ifndef AM_BSP_RADIO_SPI_CLOCK_MAX
+#define AM_BSP_RADIO_SPI_CLOCK_MAX SX1262_SPI_CLOCK_DEFAULT
+#endif
+
+// the on-board radio, always the first instance
+uint32_t lora_radio_initialize(void **ppHandle)
+{
+    static const lora_radio_hw_config_t sBoardConfig = {
+        .ui32IomModule = 3,
+        .ui32ChipSelect = AM_BSP_RADIO_NSS_CHNL,
+        .ui32PinReset = AM_BSP_GPIO_RADIO_NRESET,
+        .ui32PinBusy = AM_BSP_GPIO_RADIO_BUSY,
+        .ui32PinDio1 = AM_BSP_GPIO_RADIO_DIO1,
+        .ui32PinDio3 = AM_BSP_GPIO_RADIO_DIO3,
+        .ui32SpiClock = AM_BSP_RADIO_SPI_CLOCK_MAX};
+    sx1262_context_t *psRadio = &psRadioContext[0];
+
+    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_CLK, g_AM_BSP_GPIO_RADIO_CLK);
+    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_MISO, g_AM_BSP_GPIO_RADIO_MISO);
+    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_MOSI, g_AM_BSP_GPIO_RADIO_MOSI);
+    am_hal_gpio_pinconfig(AM_BSP_GPIO_RADIO_NSS, g_AM_BSP_GPIO_RADIO_NSS);
+
+    if (ppHandle) {
+        *ppHandle = psRadio;
+    }
+
+    return sx1262_initialize(psRadio, &sBoardConfig);
+}
+
+// Additional radios.  The SPI pins are set up through the BSP for the IOM
+// module, and am_iomasterN_isr() of any module other than 3 must call
+// lora_radio_iom_isr() with the handle.
+uint32_t lora_radio_instance_initialize(void **ppHandle,
+                                        const lora_radio_hw_config_t *psConfig)
+{
+    for (uint32_t i = 0; i < LORA_RADIO_INSTANCES; i++) {
+        sx1262_context_t *psRadio = &psRadioContext[i];
+
+        if (psRadio->bInUse) {
+            continue;
+        }
+
+        am_bsp_iom_pins_enable(psConfig->ui32IomModule, AM_HAL_IOM_SPI_MODE);
+        *ppHandle = psRadio;
+
+        return sx1262_initialize(psRadio, psConfig);
+    }
+
+    return LORA_RADIO_STATUS_IN_USE;
+}
+
+uint32_t lora_radio_deinitialize(void *pHandle)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    am_hal_gpio_interrupt_disable(AM_HAL_GPIO_BIT(psRadio->ui32PinBusy));
+    am_hal_gpio_interrupt_disable(AM_HAL_GPIO_BIT(psRadio->ui32PinDio1));
+    am_hal_gpio_interrupt_disable(AM_HAL_GPIO_BIT(psRadio->ui32PinDio3));
+
+    am_hal_gpio_pinconfig(psRadio->ui32PinReset, g_AM_HAL_GPIO_DISABLE);
+    am_hal_gpio_pinconfig(psRadio->ui32PinBusy, g_AM_HAL_GPIO_DISABLE);
+    am_hal_gpio_pinconfig(psRadio->ui32PinDio1, g_AM_HAL_GPIO_DISABLE);
+    am_hal_gpio_pinconfig(psRadio->ui32PinDio3, g_AM_HAL_GPIO_DISABLE);
+
+    sx1262_command_queue_wait(psRadio);
+    NVIC_DisableIRQ(sx1262_iom_irq(psRadio));
+
+    am_hal_iom_uninitialize(psRadio->pSpiHandle);
+    am_hal_iom_power_ctrl(psRadio->pSpiHandle, AM_HAL_SYSCTRL_DEEPSLEEP, false);
+    am_bsp_iom_pins_disable(psRadio->ui32IomModule, AM_HAL_IOM_SPI_MODE);
+    am_hal_iom_disable(psRadio->pSpiHandle);
+
+    psRadio->pSpiHandle = NULL;
+    psRadio->bInUse = false;
+
+    return LORA_RADIO_STATUS_SUCCESS;
+}
+
+uint32_t lora_radio_reset(void *pHandle)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    sx1262_shadow_invalidate(psRadio);
+    psRadio->i32CalibratedBand = IMAGE_CALIBRATION_NONE;
+
+    am_hal_gpio_state_write(psRadio->ui32PinReset, AM_HAL_GPIO_OUTPUT_CLEAR);
+    am_util_delay_us(100);
+    am_hal_gpio_state_write(psRadio->ui32PinReset, AM_HAL_GPIO_OUTPUT_SET);
+
+    sx1262_config_regulator(psRadio);
+    sx1262_set_mode(psRadio, CMD_SETSTANDBY, STDBY_RC);
+    sx1262_set_dio2_rf_switch_ctrl(psRadio, 1);
+    sx1262_init_packet_type(psRadio);
+
+    return LORA_RADIO_STATUS_SUCCESS;
+}
+
+uint32_t lora_radio_power_ctrl(void *pHandle,
+                               lora_radio_power_state_e ePowerState)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    // not every register survives a warm start, so any sleep invalidates
+    // the shadow
+    switch (ePowerState) {
+    case LORA_RADIO_SLEEP:
+        sx1262_set_mode(psRadio, CMD_SETSLEEP, SLEEP_WARM);
+        sx1262_shadow_invalidate(psRadio);
+        psRadio->bAsleep = true;
+        break;
+    case LORA_RADIO_DEEPSLEEP:
+        sx1262_set_mode(psRadio, CMD_SETSLEEP, SLEEP_COLD);
+        sx1262_shadow_invalidate(psRadio);
+        psRadio->bAsleep = true;
+        psRadio->i32CalibratedBand = IMAGE_CALIBRATION_NONE;
+        break;
+    case LORA_RADIO_STANDBY:
+        sx1262_set_mode(psRadio, CMD_SETSTANDBY, STDBY_RC);
         break;
     default:
         return LORA_RADIO_STATUS_INVALID_ARG;
@@ -758,18 +1619,32 @@ uint32_t lora_radio_power_ctrl(void *pHandle,
     return LORA_RADIO_STATUS_SUCCESS;
 }
 
-uint32_t lora_radio_transfer(void *pHandle,
-                             lora_radio_transfer_t *psTransaction)
+static uint32_t sx1262_transfer(sx1262_context_t *psRadio,
+                                lora_radio_transfer_t *psTransaction)
 {
+    if ((psTransaction->eMode != LORA_RADIO_TXCARRIER) &&
+        (psTransaction->psProfile == NULL)) {
+        return LORA_RADIO_STATUS_INVALID_ARG;
+    }
+
     switch (psTransaction->eMode) {
     case LORA_RADIO_TX:
-        sx1262_transmit(pHandle, psTransaction);
+        sx1262_transmit(psRadio, psTransaction);
         break;
     case LORA_RADIO_RX:
-        sx1262_receive(pHandle, psTransaction);
+        sx1262_receive(psRadio, psTransaction);
         break;
     case LORA_RADIO_TXCARRIER:
-        sx1262_transmit_carrier(pHandle, psTransaction);
+        sx1262_transmit_carrier(psRadio, psTransaction);
+        break;
+    case LORA_RADIO_RX_DUTY_CYCLE:
+        sx1262_receive_duty_cycle(psRadio, psTransaction);
+        break;
+    case LORA_RADIO_CAD:
+        if (psTransaction->psCadParameters == NULL) {
+            return LORA_RADIO_STATUS_INVALID_ARG;
+        }
+        sx1262_cad(psRadio, psTransaction);
         break;
     default:
         return LORA_RADIO_STATUS_INVALID_ARG;
@@ -778,57 +1653,258 @@ uint32_t lora_radio_transfer(void *pHandle,
     return LORA_RADIO_STATUS_SUCCESS;
 }
 
-void lora_radio_callback_list_init()
+// Packet length in symbols per SX126x datasheet section 6.1.4.  The count
+// is returned in quarter symbols to carry the fractional preamble overhead.
+uint32_t
+lora_radio_time_on_air_symbols(const lora_radio_modulation_t *psModulation,
+                               const lora_radio_packet_t *psPacket,
+                               uint8_t ui8PayloadLength)
+{
+    int32_t i32SpreadingFactor = psModulation->eSpreadingFactor;
+    int32_t i32Bits, i32Divisor, i32Symbols;
+    uint32_t ui32QuarterSymbols;
+
+    i32Bits = 8 * ui8PayloadLength - 4 * i32SpreadingFactor;
+    if (psPacket->eCRC == LORA_RADIO_CRC_ON) {
+        i32Bits += 16;
+    }
+    if (psPacket->ePacketLength == LORA_RADIO_PACKET_LENGTH_VARIABLE) {
+        i32Bits += 20;
+    }
+
+    if (i32SpreadingFactor < LORA_RADIO_SF7) {
+        ui32QuarterSymbols = 4 * psPacket->ui16PreambleLength + 25;
+    } else {
+        i32Bits += 8;
+        ui32QuarterSymbols = 4 * psPacket->ui16PreambleLength + 17;
+    }
+
+    i32Divisor = 4 * i32SpreadingFactor;
+    if (sx1262_ldro_get(psModulation) == LORA_RADIO_LDR_OPT_ON) {
+        i32Divisor -= 8;
+    }
+
+    i32Symbols = 8;
+    if (i32Bits > 0) {
+        i32Symbols += ((i32Bits + i32Divisor - 1) / i32Divisor) *
+                      (psModulation->eCodingRate + 5);
+    }
+    ui32QuarterSymbols += 4 * i32Symbols;
+
+    return ui32QuarterSymbols;
+}
+
+uint32_t lora_radio_time_on_air(const lora_radio_modulation_t *psModulation,
+                                const lora_radio_packet_t *psPacket,
+                                uint8_t ui8PayloadLength)
+{
+    uint32_t ui32QuarterSymbols = lora_radio_time_on_air_symbols(
+        psModulation, psPacket, ui8PayloadLength);
+
+    return (uint32_t)(((uint64_t)ui32QuarterSymbols
+                       << psModulation->eSpreadingFactor) *
+                      1000000 /
+                      (4 * pui32BandwidthHz[psModulation->eBandwidth]));
+}
+
+// Derive the receive duty cycle windows from the preamble length.  The sleep
+// period is chosen so that a full receive window always falls within the
+// preamble, it is 0 when the preamble is too short for duty cycling.
+void lora_radio_rx_duty_cycle_get(const lora_radio_modulation_t *psModulation,
+                                  const lora_radio_packet_t *psPacket,
+                                  uint32_t *pui32RxPeriod,
+                                  uint32_t *pui32SleepPeriod)
+{
+    uint32_t ui32SymbolUs =
+        (uint32_t)(((uint64_t)1000000 << psModulation->eSpreadingFactor) /
+                   pui32BandwidthHz[psModulation->eBandwidth]);
+    uint32_t ui32PreambleUs =
+        ((4 * psPacket->ui16PreambleLength + 17) * ui32SymbolUs) / 4;
+    uint32_t ui32RxUs = SX1262_RX_DUTY_CYCLE_SYMBOLS * ui32SymbolUs +
+                        SX1262_RX_DUTY_CYCLE_WAKEUP_US;
+    uint32_t ui32SleepUs = 0;
+
+    if (ui32PreambleUs > 2 * ui32RxUs) {
+        ui32SleepUs = ui32PreambleUs - 2 * ui32RxUs;
+    }
+
+    // convert to 15.625 us steps
+    *pui32RxPeriod = (ui32RxUs * 64) / 1000;
+    *pui32SleepPeriod = (ui32SleepUs * 64) / 1000;
+}
+
+// Validates the configuration and lays out the command parameters once so
+// that transfers only copy bytes.  Switching between profiles costs the
+// commands whose bytes differ, the shadow skips the rest.
+uint32_t lora_radio_profile_init(lora_radio_profile_t *psProfile,
+                                 const lora_radio_modulation_t *psModulation,
+                                 const lora_radio_packet_t *psPacket,
+                                 uint16_t ui16SyncWord)
+{
+    if ((psModulation->eSpreadingFactor < LORA_RADIO_SF5) ||
+        (psModulation->eSpreadingFactor > LORA_RADIO_SF12) ||
+        (psModulation->eBandwidth > LORA_RADIO_BW_500) ||
+        (psModulation->eCodingRate > LORA_CR_4_8)) {
+        return LORA_RADIO_STATUS_INVALID_ARG;
+    }
+
+    // implicit header packets are received with the length set here
+    if ((psPacket->ePacketLength > LORA_RADIO_PACKET_LENGTH_FIXED) ||
+        ((psPacket->ePacketLength == LORA_RADIO_PACKET_LENGTH_FIXED) &&
+         (psPacket->ui8PayloadLength == 0)) ||
+        (psPacket->eCRC > LORA_RADIO_CRC_ON) ||
+        (psPacket->eIQ > LORA_RADIO_IQ_INVERTED) ||
+        (psPacket->ui16PreambleLength == 0)) {
+        return LORA_RADIO_STATUS_INVALID_ARG;
+    }
+
+    memcpy(&psProfile->sModulation, psModulation,
+           sizeof(lora_radio_modulation_t));
+    memcpy(&psProfile->sPacket, psPacket, sizeof(lora_radio_packet_t));
+    psProfile->sModulation.eLowDataRateOptimization =
+        sx1262_ldro_get(psModulation);
+
+    psProfile->pui8Modulation[0] = psModulation->eSpreadingFactor;
+    psProfile->pui8Modulation[1] =
+        pui8BandwidthRegister[psModulation->eBandwidth];
+    psProfile->pui8Modulation[2] = psModulation->eCodingRate + 1;
+    psProfile->pui8Modulation[3] =
+        psProfile->sModulation.eLowDataRateOptimization;
+
+    psProfile->pui8Packet[0] = psPacket->ui16PreambleLength >> 8;
+    psProfile->pui8Packet[1] = psPacket->ui16PreambleLength & 0xFF;
+    psProfile->pui8Packet[2] = psPacket->ePacketLength;
+    psProfile->pui8Packet[3] = psPacket->ui8PayloadLength;
+    psProfile->pui8Packet[4] = psPacket->eCRC;
+    psProfile->pui8Packet[5] = psPacket->eIQ;
+
+    psProfile->pui8SyncWord[0] = ui16SyncWord >> 8;
+    psProfile->pui8SyncWord[1] = ui16SyncWord & 0xFF;
+
+    return LORA_RADIO_STATUS_SUCCESS;
+}
+
+uint32_t lora_radio_calibrate(void *pHandle, uint32_t ui32Frequency)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    if (sx1262_band_get(ui32Frequency) == IMAGE_CALIBRATION_NONE) {
+        return LORA_RADIO_STATUS_OUT_OF_RANGE;
+    }
+
+    sx1262_set_mode(psRadio, CMD_SETSTANDBY, STDBY_RC);
+    CalibrateImage(psRadio, ui32Frequency, true);
+
+    return LORA_RADIO_STATUS_SUCCESS;
+}
+
+void lora_radio_calibration_invalidate(void *pHandle)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    psRadio->i32CalibratedBand = IMAGE_CALIBRATION_NONE;
+}
+
+uint32_t lora_radio_transfer(void *pHandle,
+                             lora_radio_transfer_t *psTransaction)
+{
+    return sx1262_transfer(sx1262_context_get(pHandle), psTransaction);
+}
+
+uint32_t lora_radio_transfer_nonblocking(void *pHandle,
+                                         lora_radio_transfer_t *psTransaction,
+                                         lora_radio_callback_t pfnCallback,
+                                         void *pCallbackContext)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+    lora_radio_transfer_t sTransaction;
+    uint32_t ui32Status;
+
+    if (psRadio->bCommandQueueActive) {
+        return LORA_RADIO_STATUS_IN_USE;
+    }
+
+    if (psRadio->bAsleep) {
+        sx1262_wakeup(psRadio);
+    }
+
+    // the payload must outlive the call, keep a private copy for the queue
+    memcpy(&sTransaction, psTransaction, sizeof(lora_radio_transfer_t));
+    if (sTransaction.eMode == LORA_RADIO_TX) {
+        memcpy(psRadio->pui32TransmitBuffer, psTransaction->pui8Payload,
+               psTransaction->ui8PayloadLength);
+        sTransaction.pui8Payload = (uint8_t *)psRadio->pui32TransmitBuffer;
+    }
+
+    sx1262_command_queue_begin(psRadio);
+    ui32Status = sx1262_transfer(psRadio, &sTransaction);
+    if (ui32Status != LORA_RADIO_STATUS_SUCCESS) {
+        psRadio->bCommandQueueOpen = false;
+        return ui32Status;
+    }
+
+    return sx1262_command_queue_commit(psRadio, pfnCallback,
+                                       pCallbackContext);
+}
+
+void lora_radio_callback_list_init(void *pHandle)
 {
-    memset(psLoRaRadioCallbackList, 0,
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    memset(psRadio->psCallbackList, 0,
            MAX_CALLBACK * sizeof(lora_radio_irq_handler_t));
-    gui32LoRaRadioCallbackListLength = 0;
+    psRadio->ui32CallbackListLength = 0;
 }
 
-void lora_radio_callback_list_deinit()
+void lora_radio_callback_list_deinit(void *pHandle)
 {
-    memset(psLoRaRadioCallbackList, 0,
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    memset(psRadio->psCallbackList, 0,
            MAX_CALLBACK * sizeof(lora_radio_irq_handler_t));
-    gui32LoRaRadioCallbackListLength = 0;
+    psRadio->ui32CallbackListLength = 0;
 }
 
-uint32_t lora_radio_callback_register(lora_radio_irq_e eIrq,
+uint32_t lora_radio_callback_register(void *pHandle, lora_radio_irq_e eIrq,
                                       lora_radio_callback_t pfnCallback)
 {
-    if (gui32LoRaRadioCallbackListLength >= MAX_CALLBACK) {
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    if (psRadio->ui32CallbackListLength >= MAX_CALLBACK) {
         return LORA_RADIO_STATUS_FAIL;
     }
-    psLoRaRadioCallbackList[gui32LoRaRadioCallbackListLength].eIRQ = eIrq;
-    psLoRaRadioCallbackList[gui32LoRaRadioCallbackListLength].pfnCallback =
+    psRadio->psCallbackList[psRadio->ui32CallbackListLength].eIRQ = eIrq;
+    psRadio->psCallbackList[psRadio->ui32CallbackListLength].pfnCallback =
         pfnCallback;
-    gui32LoRaRadioCallbackListLength++;
+    psRadio->ui32CallbackListLength++;
 
     return LORA_RADIO_STATUS_SUCCESS;
 }
 
-uint32_t lora_radio_callback_deregister(lora_radio_irq_e eIrq,
+uint32_t lora_radio_callback_deregister(void *pHandle, lora_radio_irq_e eIrq,
                                         lora_radio_callback_t pfnCallback)
 {
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
     uint8_t i = 0;
     uint8_t ui8Found = 0;
 
-    for (i = 0; i < gui32LoRaRadioCallbackListLength; i++) {
-        if ((psLoRaRadioCallbackList[i].eIRQ == eIrq) &&
-            (psLoRaRadioCallbackList[i].pfnCallback == pfnCallback)) {
+    for (i = 0; i < psRadio->ui32CallbackListLength; i++) {
+        if ((psRadio->psCallbackList[i].eIRQ == eIrq) &&
+            (psRadio->psCallbackList[i].pfnCallback == pfnCallback)) {
             ui8Found = 1;
             break;
         }
     }
 
     if (ui8Found) {
-        while (i < (gui32LoRaRadioCallbackListLength - 1)) {
-            psLoRaRadioCallbackList[i].eIRQ =
-                psLoRaRadioCallbackList[i + 1].eIRQ;
-            psLoRaRadioCallbackList[i].pfnCallback =
-                psLoRaRadioCallbackList[i + 1].pfnCallback;
+        while (i < (psRadio->ui32CallbackListLength - 1)) {
+            psRadio->psCallbackList[i].eIRQ =
+                psRadio->psCallbackList[i + 1].eIRQ;
+            psRadio->psCallbackList[i].pfnCallback =
+                psRadio->psCallbackList[i + 1].pfnCallback;
             i++;
         }
-        gui32LoRaRadioCallbackListLength--;
+        psRadio->ui32CallbackListLength--;
 
         return LORA_RADIO_STATUS_SUCCESS;
     }
@@ -836,34 +1912,482 @@ uint32_t lora_radio_callback_deregister(lora_radio_irq_e eIrq,
     return LORA_RADIO_STATUS_FAIL;
 }
 
-static void lora_radio_isr(void)
+void lora_radio_busy_wait_register(lora_radio_busy_wait_t pfnWait,
+                                   lora_radio_callback_t pfnRelease)
+{
+    gpfnBusyWait = NULL;
+    gpfnBusyRelease = pfnRelease;
+    gpfnBusyWait = pfnWait;
+}
+
+void lora_radio_busy_stats_get(void *pHandle,
+                               lora_radio_busy_stats_t *psStats)
 {
-    uint8_t i, ui8PacketLength;
-    uint16_t ui16IrqStatus = sx1262_interrupt_status_get();
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
 
+    memcpy(psStats, &psRadio->sBusyStats, sizeof(lora_radio_busy_stats_t));
+}
+
+void lora_radio_busy_stats_reset(void *pHandle)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    memset(&psRadio->sBusyStats, 0, sizeof(lora_radio_busy_stats_t));
+}
+
+void lora_radio_irq_defer_register(void *pHandle,
+                                   lora_radio_callback_t pfnDefer)
+{
+    sx1262_context_get(pHandle)->pfnIrqDefer = pfnDefer;
+}
+
+void lora_radio_irq_stats_get(void *pHandle, lora_radio_irq_stats_t *psStats)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    memcpy(psStats, &psRadio->sIrqStats, sizeof(lora_radio_irq_stats_t));
+}
+
+void lora_radio_irq_stats_reset(void *pHandle)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    memset(&psRadio->sIrqStats, 0, sizeof(lora_radio_irq_stats_t));
+}
+
+void lora_radio_command_stats_get(void *pHandle,
+                                  lora_radio_command_stats_t *psStats)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    memcpy(psStats, &psRadio->sCommandStats,
+           sizeof(lora_radio_command_stats_t));
+}
+
+void lora_radio_command_stats_reset(void *pHandle)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    memset(&psRadio->sCommandStats, 0, sizeof(lora_radio_command_stats_t));
+}
+
+// Consecutive addresses are merged into one command, the radio increments
+// the register address on its own.
+uint32_t lora_radio_registers_write(void *pHandle,
+                                    const lora_radio_register_t *psRegisters,
+                                    uint32_t ui32Count)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+    sx1262_segment_t psSegments[SX1262_SEGMENT_MAX];
+    uint8_t pui8Data[SX1262_SEGMENT_MAX * SX1262_COMMAND_PARAM_SIZE];
+    uint32_t ui32Segments = 0, ui32Length = 0;
+
+    for (uint32_t i = 0; i < ui32Count; i++) {
+        if (ui32Segments &&
+            (psRegisters[i].ui16Address ==
+             psRegisters[i - 1].ui16Address + 1) &&
+            (psSegments[ui32Segments - 1].ui32TxLength <
+             SX1262_COMMAND_PARAM_SIZE)) {
+            pui8Data[ui32Length++] = psRegisters[i].ui8Value;
+            psSegments[ui32Segments - 1].ui32TxLength++;
+            continue;
+        }
+
+        if (ui32Segments == SX1262_SEGMENT_MAX) {
+            sx1262_spi_transaction(psRadio, psSegments, ui32Segments);
+            ui32Segments = 0;
+            ui32Length = 0;
+        }
+
+        psSegments[ui32Segments].ui32Instr =
+            (CMD_WRITEREGISTER << 16) | psRegisters[i].ui16Address;
+        psSegments[ui32Segments].ui32InstrLen = 3;
+        psSegments[ui32Segments].pui8Tx = &pui8Data[ui32Length];
+        psSegments[ui32Segments].ui32TxLength = 1;
+        psSegments[ui32Segments].pui8Rx = NULL;
+        psSegments[ui32Segments].ui32RxLength = 0;
+        pui8Data[ui32Length++] = psRegisters[i].ui8Value;
+        ui32Segments++;
+    }
+
+    if (ui32Segments) {
+        sx1262_spi_transaction(psRadio, psSegments, ui32Segments);
+    }
+
+    // the writes bypass the shadow, which may now be stale
+    sx1262_shadow_invalidate_registers(psRadio);
+
+    return LORA_RADIO_STATUS_SUCCESS;
+}
+
+uint32_t lora_radio_registers_read(void *pHandle,
+                                   lora_radio_register_t *psRegisters,
+                                   uint32_t ui32Count)
+{
+    static const uint8_t ui8Nop = 0;
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+    sx1262_segment_t psSegments[SX1262_SEGMENT_MAX];
+    uint8_t pui8Data[SX1262_SEGMENT_MAX * SX1262_COMMAND_PARAM_SIZE];
+    uint32_t ui32First = 0, ui32Segments = 0, ui32Length = 0;
+
+    if (psRadio->bCommandQueueOpen) {
+        return LORA_RADIO_STATUS_IN_USE;
+    }
+
+    for (uint32_t i = 0; i <= ui32Count; i++) {
+        if ((i < ui32Count) && ui32Segments &&
+            (psRegisters[i].ui16Address ==
+             psRegisters[i - 1].ui16Address + 1) &&
+            (psSegments[ui32Segments - 1].ui32RxLength <
+             SX1262_COMMAND_PARAM_SIZE)) {
+            psSegments[ui32Segments - 1].ui32RxLength++;
+            ui32Length++;
+            continue;
+        }
+
+        if ((ui32Segments == SX1262_SEGMENT_MAX) ||
+            ((i == ui32Count) && ui32Segments)) {
+            sx1262_spi_transaction(psRadio, psSegments, ui32Segments);
+            for (uint32_t j = 0; j < ui32Length; j++) {
+                psRegisters[ui32First + j].ui8Value = pui8Data[j];
+            }
+            ui32First = i;
+            ui32Segments = 0;
+            ui32Length = 0;
+        }
+
+        if (i == ui32Count) {
+            break;
+        }
+
+        psSegments[ui32Segments].ui32Instr =
+            (CMD_READREGISTER << 16) | psRegisters[i].ui16Address;
+        psSegments[ui32Segments].ui32InstrLen = 3;
+        psSegments[ui32Segments].pui8Tx = &ui8Nop;
+        psSegments[ui32Segments].ui32TxLength = 1;
+        psSegments[ui32Segments].pui8Rx = &pui8Data[ui32Length];
+        psSegments[ui32Segments].ui32RxLength = 1;
+        ui32Length++;
+        ui32Segments++;
+    }
+
+    return LORA_RADIO_STATUS_SUCCESS;
+}
+
+// The noise generator only runs while the receiver is on, so the receiver
+// is opened briefly with every interrupt masked and the registers are read
+// before returning to standby.
+uint32_t lora_radio_random(void *pHandle, uint32_t *pui32Random)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+    lora_radio_register_t psRegisters[] = {
+        {REG_RANDOMNUMBERGEN0, 0},
+        {REG_RANDOMNUMBERGEN1, 0},
+        {REG_RANDOMNUMBERGEN2, 0},
+        {REG_RANDOMNUMBERGEN3, 0},
+    };
+    uint32_t ui32Status;
+
+    if (psRadio->bCommandQueueOpen) {
+        return LORA_RADIO_STATUS_IN_USE;
+    }
+
+    sx1262_set_mode(psRadio, CMD_SETSTANDBY, STDBY_RC);
+    sx1262_interrupt_enable(psRadio, 0);
+    sx1262_set_mode(psRadio, CMD_SETRX, SX1262_RX_CONTINUOUS);
+    am_util_delay_us(SX1262_RANDOM_SETTLE_US);
+
+    ui32Status = lora_radio_registers_read(pHandle, psRegisters, 4);
+    sx1262_set_mode(psRadio, CMD_SETSTANDBY, STDBY_RC);
+    if (ui32Status != LORA_RADIO_STATUS_SUCCESS) {
+        return ui32Status;
+    }
+
+    *pui32Random = ((uint32_t)psRegisters[0].ui8Value << 24) |
+                   ((uint32_t)psRegisters[1].ui8Value << 16) |
+                   ((uint32_t)psRegisters[2].ui8Value << 8) |
+                   psRegisters[3].ui8Value;
+
+    return LORA_RADIO_STATUS_SUCCESS;
+}
+
+void lora_radio_event_stats_get(void *pHandle,
+                                lora_radio_event_stats_t *psStats)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    memcpy(psStats, &psRadio->sEventStats, sizeof(lora_radio_event_stats_t));
+}
+
+void lora_radio_event_stats_reset(void *pHandle)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    memset(&psRadio->sEventStats, 0, sizeof(lora_radio_event_stats_t));
+}
+
+uint32_t lora_radio_device_stats_get(void *pHandle,
+                                     lora_radio_device_stats_t *psStats)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+    uint8_t buf[7];
+
+    if (psRadio->bCommandQueueOpen) {
+        return LORA_RADIO_STATUS_IN_USE;
+    }
+
+    // the first byte of each response is the chip status
+    sx1262_read_command(psRadio, CMD_GETSTATS, buf, 7);
+    psStats->ui16PacketsReceived = (buf[1] << 8) | buf[2];
+    psStats->ui16CrcErrors = (buf[3] << 8) | buf[4];
+    psStats->ui16HeaderErrors = (buf[5] << 8) | buf[6];
+    psStats->ui16DeviceErrors = sx1262_get_error_status(psRadio);
+
+    return LORA_RADIO_STATUS_SUCCESS;
+}
+
+uint32_t lora_radio_device_stats_reset(void *pHandle)
+{
+    static const uint8_t ui8Zero[6] = {0};
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+
+    if (psRadio->bCommandQueueOpen) {
+        return LORA_RADIO_STATUS_IN_USE;
+    }
+
+    sx1262_write_command(psRadio, CMD_RESETSTATS, ui8Zero, 6);
+    sx1262_write_command(psRadio, CMD_CLEARDEVICEERRORS, ui8Zero, 2);
+
+    return LORA_RADIO_STATUS_SUCCESS;
+}
+
+uint32_t lora_radio_spi_clock_get(void *pHandle)
+{
+    return sx1262_context_get(pHandle)->ui32SpiClock;
+}
+
+void lora_radio_iom_isr(void *pHandle)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+    uint32_t ui32Status;
+
+    if (am_hal_iom_interrupt_status_get(psRadio->pSpiHandle, true,
+                                        &ui32Status) == AM_HAL_STATUS_SUCCESS) {
+        am_hal_iom_interrupt_clear(psRadio->pSpiHandle, ui32Status);
+        am_hal_iom_interrupt_service(psRadio->pSpiHandle, ui32Status);
+    }
+}
+
+// the on-board radio is wired to IOM 3
+void am_iomaster3_isr(void)
+{
+    for (uint32_t i = 0; i < LORA_RADIO_INSTANCES; i++) {
+        if (psRadioContext[i].bInUse &&
+            (psRadioContext[i].ui32IomModule == 3)) {
+            lora_radio_iom_isr(&psRadioContext[i]);
+        }
+    }
+}
+
+static lora_radio_physical_packet_t *
+sx1262_packet_alloc(sx1262_context_t *psRadio)
+{
+    lora_radio_physical_packet_t *psPacket = NULL;
+    uint32_t ui32Critical = am_hal_interrupt_master_disable();
+
+    for (uint32_t i = 0; i < LORA_RADIO_PACKET_POOL_SIZE; i++) {
+        if (psRadio->psPacketPool[i].sPacket.ui8References == 0) {
+            psPacket = &psRadio->psPacketPool[i].sPacket;
+            psPacket->ui8References = 1;
+            psPacket->pui8Payload = psRadio->psPacketPool[i].pui8Payload;
+            psRadio->sPacketPoolStats.ui32Allocated++;
+            break;
+        }
+    }
+
+    if (psPacket == NULL) {
+        psRadio->sPacketPoolStats.ui32Dropped++;
+    }
+
+    am_hal_interrupt_master_set(ui32Critical);
+
+    return psPacket;
+}
+
+void lora_radio_packet_retain(lora_radio_physical_packet_t *psPacket)
+{
+    uint32_t ui32Critical = am_hal_interrupt_master_disable();
+    psPacket->ui8References++;
+    am_hal_interrupt_master_set(ui32Critical);
+}
+
+void lora_radio_packet_release(lora_radio_physical_packet_t *psPacket)
+{
+    uint32_t ui32Critical = am_hal_interrupt_master_disable();
+    if (psPacket->ui8References) {
+        psPacket->ui8References--;
+    }
+    am_hal_interrupt_master_set(ui32Critical);
+}
+
+void lora_radio_packet_pool_stats_get(void *pHandle,
+                                      lora_radio_packet_pool_stats_t *psStats)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+    uint32_t ui32Critical = am_hal_interrupt_master_disable();
+
+    memcpy(psStats, &psRadio->sPacketPoolStats,
+           sizeof(lora_radio_packet_pool_stats_t));
+    psStats->ui32InUse = 0;
+    for (uint32_t i = 0; i < LORA_RADIO_PACKET_POOL_SIZE; i++) {
+        if (psRadio->psPacketPool[i].sPacket.ui8References) {
+            psStats->ui32InUse++;
+        }
+    }
+
+    am_hal_interrupt_master_set(ui32Critical);
+}
+
+static void sx1262_event_stats_update(sx1262_context_t *psRadio,
+                                      uint16_t ui16IrqStatus)
+{
+    lora_radio_event_stats_t *psStats = &psRadio->sEventStats;
+
+    if (ui16IrqStatus & LORA_RADIO_TXDONE) {
+        psStats->ui32TxDone++;
+    }
     if (ui16IrqStatus & LORA_RADIO_RXDONE) {
-        ui8PacketLength = sx1262_read_fifo(pui8ReceiveBuffer);
-        sLoRaPhysicalPacket.pui8Payload = pui8ReceiveBuffer;
-        sLoRaPhysicalPacket.ui8PayloadLength = ui8PacketLength;
+        psStats->ui32RxDone++;
+        if (ui16IrqStatus & LORA_RADIO_CRCERR) {
+            psStats->ui32CrcErrors++;
+        }
+    }
+    if (ui16IrqStatus & LORA_RADIO_TIMEOUT) {
+        psStats->ui32Timeouts++;
+    }
+    if (ui16IrqStatus & LORA_RADIO_CADDONE) {
+        psStats->ui32CadDone++;
+    }
+    if (ui16IrqStatus & LORA_RADIO_CADDETECTED) {
+        psStats->ui32CadDetected++;
+    }
+}
+
+static void sx1262_irq_process(sx1262_context_t *psRadio,
+                               uint32_t ui32Timestamp)
+{
+    uint8_t i;
+    uint16_t ui16IrqStatus;
+    lora_radio_physical_packet_t *psPacket = NULL;
+
+    uint32_t ui32Latency = am_hal_stimer_counter_get() - ui32Timestamp;
+    psRadio->sIrqStats.ui32Count++;
+    psRadio->sIrqStats.ui32LastLatency = ui32Latency;
+    if (ui32Latency > psRadio->sIrqStats.ui32MaxLatency) {
+        psRadio->sIrqStats.ui32MaxLatency = ui32Latency;
+    }
+
+    ui16IrqStatus = sx1262_interrupt_status_get(psRadio);
+    sx1262_event_stats_update(psRadio, ui16IrqStatus);
+
+    if ((ui16IrqStatus & (LORA_RADIO_RXDONE | LORA_RADIO_TIMEOUT)) &&
+        (psRadio->sRxPacket.ePacketLength == LORA_RADIO_PACKET_LENGTH_FIXED)) {
+        sx1262_implicit_timeout_stop(psRadio);
+    }
 
-        sx1262_get_packet_status(&sLoRaPhysicalPacket.i8Rssi,
-                                 &sLoRaPhysicalPacket.i8Snr,
-                                 &sLoRaPhysicalPacket.i8Rscp);
+    if (ui16IrqStatus & LORA_RADIO_RXDONE) {
+        psPacket = sx1262_packet_alloc(psRadio);
+        if (psPacket) {
+            psPacket->ui8PayloadLength =
+                sx1262_read_fifo(psRadio, psPacket->pui8Payload);
+            sx1262_get_packet_status(psRadio, &psPacket->i16Rssi,
+                                     &psPacket->i16Snr,
+                                     &psPacket->i16SignalRssi);
+            psPacket->ui8CrcError = (ui16IrqStatus & LORA_RADIO_CRCERR) != 0;
+            psPacket->ui32Timestamp = ui32Timestamp;
+            psPacket->ui32TimeOnAir =
+                lora_radio_time_on_air(&psRadio->sRxModulation,
+                                       &psRadio->sRxPacket,
+                                       psPacket->ui8PayloadLength);
+        } else {
+            // no free buffer, the packet is dropped
+            ui16IrqStatus &= ~LORA_RADIO_RXDONE;
+        }
     }
 
-    for (i = 0; i < gui32LoRaRadioCallbackListLength; i++) {
-        if ((psLoRaRadioCallbackList[i].eIRQ & ui16IrqStatus) &&
+    // A callback that keeps the packet beyond its own scope must retain it.
+    // The reference held by the driver is released once all callbacks ran.
+    for (i = 0; i < psRadio->ui32CallbackListLength; i++) {
+        if ((psRadio->psCallbackList[i].eIRQ & ui16IrqStatus) &&
             (ui16IrqStatus & LORA_RADIO_RXDONE)) {
-            // callback will still trigger if ui8PacketLength is zero
-            // if ((ui8PacketLength > 0) && (psLoRaRadioCallbackList[i].pfnCallback))
-            if (psLoRaRadioCallbackList[i].pfnCallback)
-                psLoRaRadioCallbackList[i].pfnCallback(&sLoRaPhysicalPacket);
-        } else if (psLoRaRadioCallbackList[i].eIRQ & ui16IrqStatus) {
-            if (psLoRaRadioCallbackList[i].pfnCallback)
-                psLoRaRadioCallbackList[i].pfnCallback(NULL);
+            // callback will still trigger if ui8PayloadLength is zero
+            if (psRadio->psCallbackList[i].pfnCallback)
+                psRadio->psCallbackList[i].pfnCallback(psPacket);
+        } else if (psRadio->psCallbackList[i].eIRQ & ui16IrqStatus) {
+            if (psRadio->psCallbackList[i].pfnCallback)
+                psRadio->psCallbackList[i].pfnCallback(NULL);
         }
     }
 
-    sx1262_interrupt_enable(0);
-    sx1262_interrupt_clear(LORA_RADIO_IRQ_ALL);
+    if (psPacket) {
+        lora_radio_packet_release(psPacket);
+    }
+
+    if ((ui16IrqStatus & LORA_RADIO_CADDETECTED) && psRadio->bCadExitRx) {
+        psRadio->bCadExitRx = false;
+        sx1262_interrupt_clear(psRadio, LORA_RADIO_IRQ_ALL);
+        sx1262_interrupt_enable(psRadio,
+                                LORA_RADIO_RXDONE | LORA_RADIO_TIMEOUT);
+        return;
+    }
+
+    sx1262_interrupt_enable(psRadio, 0);
+    sx1262_interrupt_clear(psRadio, LORA_RADIO_IRQ_ALL);
+}
+
+// Hand a latched interrupt to the defer hook, or process it in place when
+// no hook is registered
+static void sx1262_irq_dispatch(sx1262_context_t *psRadio)
+{
+    if (psRadio->pfnIrqDefer) {
+        psRadio->sIrqStats.ui32Deferred++;
+        psRadio->pfnIrqDefer(psRadio);
+        return;
+    }
+
+    psRadio->bIrqPending = false;
+    sx1262_irq_process(psRadio, psRadio->ui32IrqTimestamp);
+}
+
+void lora_radio_irq_service(void *pHandle)
+{
+    sx1262_context_t *psRadio = sx1262_context_get(pHandle);
+    uint32_t ui32Critical = am_hal_interrupt_master_disable();
+
+    // an interrupt latched while the command queue owns the bus is
+    // dispatched again once the queue drains
+    if (!psRadio->bIrqPending || psRadio->bCommandQueueActive) {
+        am_hal_interrupt_master_set(ui32Critical);
+        return;
+    }
+
+    psRadio->bIrqPending = false;
+    uint32_t ui32Timestamp = psRadio->ui32IrqTimestamp;
+    am_hal_interrupt_master_set(ui32Critical);
+
+    sx1262_irq_process(psRadio, ui32Timestamp);
+}
+
+static void lora_radio_isr(sx1262_context_t *psRadio)
+{
+    // latch the event time before any SPI traffic
+    psRadio->ui32IrqTimestamp = am_hal_stimer_counter_get();
+    psRadio->bIrqPending = true;
+
+    // the command queue owns the bus, process the interrupt once it drains
+    if (psRadio->bCommandQueueActive) {
+        return;
+    }
+
+    sx1262_irq_dispatch(psRadio);
 }
@@ -111,6 +111,17 @@ extern const uint32_t am_bsp_psSpiChipSelect[AM_REG_IOM_NUM_MODULES];
 #define AM_BSP_PWM_LED_TIMER_SEG            AM_HAL_CTIMER_TIMERB
 #define AM_BSP_PWM_LED_TIMER_INT            AM_HAL_CTIMER_INT_TIMERB2C0
 
+//*****************************************************************************
+//
+// Radio definitions.
+//
+//*****************************************************************************
+//
+// Fastest SPI clock used for the SX1262.  The radio driver steps down from
+// here at startup until the link reads back reliably.
+//
+#define AM_BSP_RADIO_SPI_CLOCK_MAX          AM_HAL_IOM_16MHZ
+
 //*****************************************************************************
 //
 // UART definitions.
@@ -0,0 +1,86 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "am_bsp.h"
+
+const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_NRESET = {
+    .uFuncSel = AM_HAL_PIN_44_GPIO,
+    .eDriveStrength = AM_HAL_GPIO_PIN_DRIVESTRENGTH_2MA};
+
+const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_BUSY = {
+    .uFuncSel = AM_HAL_PIN_39_GPIO,
+    .eDriveStrength = AM_HAL_GPIO_PIN_DRIVESTRENGTH_2MA,
+    .eGPInput = AM_HAL_GPIO_PIN_INPUT_ENABLE,
+    .eIntDir = AM_HAL_GPIO_PIN_INTDIR_HI2LO};
+
+const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_DIO1 = {
+    .uFuncSel = AM_HAL_PIN_40_GPIO,
+    .eDriveStrength = AM_HAL_GPIO_PIN_DRIVESTRENGTH_2MA,
+    .eGPInput = AM_HAL_GPIO_PIN_INPUT_ENABLE,
+    .eIntDir = AM_HAL_GPIO_PIN_INTDIR_LO2HI};
+
+const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_DIO3 = {
+    .uFuncSel = AM_HAL_PIN_47_GPIO,
+    .eDriveStrength = AM_HAL_GPIO_PIN_DRIVESTRENGTH_2MA,
+    .eGPInput = AM_HAL_GPIO_PIN_INPUT_ENABLE,
+    .eIntDir = AM_HAL_GPIO_PIN_INTDIR_LO2HI};
+
+const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_NSS = {
+    .uFuncSel = AM_HAL_PIN_36_NCE36,
+    .eDriveStrength = AM_HAL_GPIO_PIN_DRIVESTRENGTH_2MA,
+    .eGPOutcfg = AM_HAL_GPIO_PIN_OUTCFG_PUSHPULL,
+    .eGPInput = AM_HAL_GPIO_PIN_INPUT_NONE,
+    .uIOMnum = 3,
+    .uNCE = 1,
+    .eCEpol = AM_HAL_GPIO_PIN_CEPOL_ACTIVELOW};
+
+const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_MISO = {
+    .uFuncSel = AM_HAL_PIN_43_M3MISO,
+    .uIOMnum = 3};
+
+const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_MOSI = {
+    .uFuncSel = AM_HAL_PIN_38_M3MOSI,
+    .eDriveStrength = AM_HAL_GPIO_PIN_DRIVESTRENGTH_2MA,
+    .uIOMnum = 3};
+
+const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_CLK = {
+    .uFuncSel = AM_HAL_PIN_42_M3SCK,
+    .eDriveStrength = AM_HAL_GPIO_PIN_DRIVESTRENGTH_12MA,
+    .uIOMnum = 3};
+
+// the simulated IOMs have no pins to route
+void am_bsp_iom_pins_enable(uint32_t ui32Module, am_hal_iom_mode_e eIOMMode)
+{
+}
+
+void am_bsp_iom_pins_disable(uint32_t ui32Module, am_hal_iom_mode_e eIOMMode)
+{
+}
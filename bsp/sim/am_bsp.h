@@ -0,0 +1,78 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef AM_BSP_H
+#define AM_BSP_H
+
+// Board support for the host simulator.  The radio is wired as on the
+// NM180100: IOM 3 with chip select 1 and the same GPIO numbers, so the
+// drivers run unchanged against the simulated SX1262.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "am_mcu_apollo.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AM_BSP_GPIO_RADIO_NRESET 44
+#define AM_BSP_GPIO_RADIO_BUSY   39
+#define AM_BSP_GPIO_RADIO_DIO1   40
+#define AM_BSP_GPIO_RADIO_DIO3   47
+#define AM_BSP_GPIO_RADIO_NSS    36
+#define AM_BSP_RADIO_NSS_CHNL    1
+#define AM_BSP_GPIO_RADIO_MISO   43
+#define AM_BSP_GPIO_RADIO_MOSI   38
+#define AM_BSP_GPIO_RADIO_CLK    42
+
+extern const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_NRESET;
+extern const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_BUSY;
+extern const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_DIO1;
+extern const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_DIO3;
+extern const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_NSS;
+extern const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_MISO;
+extern const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_MOSI;
+extern const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_RADIO_CLK;
+
+#define AM_BSP_RADIO_SPI_CLOCK_MAX AM_HAL_IOM_16MHZ
+
+extern void am_bsp_iom_pins_enable(uint32_t ui32Module,
+                                   am_hal_iom_mode_e eIOMMode);
+extern void am_bsp_iom_pins_disable(uint32_t ui32Module,
+                                    am_hal_iom_mode_e eIOMMode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AM_BSP_H
@@ -0,0 +1,294 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef AM_MCU_APOLLO_H
+#define AM_MCU_APOLLO_H
+
+// Host stand-in for the Apollo3 HAL.  Only the types and calls used by the
+// radio drivers are provided, with the same names and values as the
+// AmbiqSuite headers.  The peripherals are emulated in sim_hal.c against
+// the virtual clock of the simulator.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AM_HAL_STATUS_SUCCESS           0
+#define AM_HAL_STATUS_FAIL              1
+#define AM_HAL_STATUS_INVALID_HANDLE    2
+#define AM_HAL_STATUS_IN_USE            3
+#define AM_HAL_STATUS_TIMEOUT           4
+#define AM_HAL_STATUS_OUT_OF_RANGE      5
+#define AM_HAL_STATUS_INVALID_ARG       6
+#define AM_HAL_STATUS_INVALID_OPERATION 7
+#define AM_HAL_STATUS_MEM_ERR           8
+#define AM_HAL_STATUS_HW_ERR            9
+
+//
+// Interrupts
+//
+typedef enum {
+    GPIO_IRQn = 13,
+    IOMSTR0_IRQn = 6,
+    IOMSTR1_IRQn = 7,
+    IOMSTR2_IRQn = 8,
+    IOMSTR3_IRQn = 9,
+    IOMSTR4_IRQn = 10,
+    IOMSTR5_IRQn = 11,
+} IRQn_Type;
+
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_DisableIRQ(IRQn_Type IRQn);
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+
+uint32_t __get_IPSR(void);
+uint32_t __get_PRIMASK(void);
+uint32_t __get_BASEPRI(void);
+void __set_BASEPRI(uint32_t basePri);
+
+uint32_t am_hal_interrupt_master_disable(void);
+uint32_t am_hal_interrupt_master_enable(void);
+void am_hal_interrupt_master_set(uint32_t ui32InterruptState);
+
+//
+// System control
+//
+typedef enum {
+    AM_HAL_SYSCTRL_WAKE,
+    AM_HAL_SYSCTRL_NORMALSLEEP,
+    AM_HAL_SYSCTRL_DEEPSLEEP
+} am_hal_sysctrl_power_state_e;
+
+//
+// GPIO
+//
+#define AM_HAL_GPIO_MAX_PADS 50
+#define AM_HAL_GPIO_BIT(n) (((uint64_t)0x1) << (n))
+
+#define AM_HAL_PIN_36_NCE36  1
+#define AM_HAL_PIN_38_M3MOSI 5
+#define AM_HAL_PIN_39_GPIO   3
+#define AM_HAL_PIN_40_GPIO   3
+#define AM_HAL_PIN_42_M3SCK  5
+#define AM_HAL_PIN_43_M3MISO 5
+#define AM_HAL_PIN_44_GPIO   3
+#define AM_HAL_PIN_47_GPIO   3
+
+typedef enum {
+    AM_HAL_GPIO_PIN_DRIVESTRENGTH_2MA = 0x0,
+    AM_HAL_GPIO_PIN_DRIVESTRENGTH_4MA = 0x1,
+    AM_HAL_GPIO_PIN_DRIVESTRENGTH_8MA = 0x2,
+    AM_HAL_GPIO_PIN_DRIVESTRENGTH_12MA = 0x3
+} am_hal_gpio_drivestrength_e;
+
+typedef enum {
+    AM_HAL_GPIO_PIN_OUTCFG_DISABLE = 0x0,
+    AM_HAL_GPIO_PIN_OUTCFG_PUSHPULL = 0x1,
+    AM_HAL_GPIO_PIN_OUTCFG_OPENDRAIN = 0x2,
+    AM_HAL_GPIO_PIN_OUTCFG_TRISTATE = 0x3
+} am_hal_gpio_outcfg_e;
+
+typedef enum {
+    AM_HAL_GPIO_PIN_INPUT_AUTO = 0x0,
+    AM_HAL_GPIO_PIN_INPUT_NONE = 0x0,
+    AM_HAL_GPIO_PIN_INPUT_ENABLE = 0x1
+} am_hal_gpio_input_e;
+
+typedef enum {
+    AM_HAL_GPIO_PIN_INTDIR_LO2HI = 0x0,
+    AM_HAL_GPIO_PIN_INTDIR_HI2LO = 0x1,
+    AM_HAL_GPIO_PIN_INTDIR_NONE = 0x2,
+    AM_HAL_GPIO_PIN_INTDIR_BOTH = 0x3
+} am_hal_gpio_intdir_e;
+
+typedef enum {
+    AM_HAL_GPIO_PIN_CEPOL_ACTIVELOW = 0x0,
+    AM_HAL_GPIO_PIN_CEPOL_ACTIVEHIGH = 0x1
+} am_hal_gpio_cepol_e;
+
+typedef struct {
+    uint32_t uFuncSel : 3;
+    uint32_t ePowerSw : 2;
+    uint32_t ePullup : 4;
+    uint32_t eDriveStrength : 2;
+    uint32_t eGPOutcfg : 2;
+    uint32_t eGPInput : 1;
+    uint32_t eIntDir : 2;
+    uint32_t eGPRdZero : 1;
+    uint32_t uIOMnum : 3;
+    uint32_t uNCE : 2;
+    uint32_t eCEpol : 1;
+    uint32_t uRsvd23 : 9;
+} am_hal_gpio_pincfg_t;
+
+extern const am_hal_gpio_pincfg_t g_AM_HAL_GPIO_DISABLE;
+extern const am_hal_gpio_pincfg_t g_AM_HAL_GPIO_OUTPUT;
+extern const am_hal_gpio_pincfg_t g_AM_HAL_GPIO_INPUT;
+
+typedef enum {
+    AM_HAL_GPIO_INPUT_READ,
+    AM_HAL_GPIO_OUTPUT_READ,
+    AM_HAL_GPIO_ENABLE_READ
+} am_hal_gpio_read_type_e;
+
+typedef enum {
+    AM_HAL_GPIO_OUTPUT_CLEAR,
+    AM_HAL_GPIO_OUTPUT_SET,
+    AM_HAL_GPIO_OUTPUT_TOGGLE,
+    AM_HAL_GPIO_OUTPUT_TRISTATE_DISABLE,
+    AM_HAL_GPIO_OUTPUT_TRISTATE_ENABLE,
+    AM_HAL_GPIO_OUTPUT_TRISTATE_TOGGLE
+} am_hal_gpio_write_type_e;
+
+typedef void (*am_hal_gpio_handler_t)(void);
+
+uint32_t am_hal_gpio_pinconfig(uint32_t ui32Pin,
+                               am_hal_gpio_pincfg_t sPincfg);
+uint32_t am_hal_gpio_state_read(uint32_t ui32Pin,
+                                am_hal_gpio_read_type_e eReadType,
+                                uint32_t *pui32ReadState);
+uint32_t am_hal_gpio_state_write(uint32_t ui32Pin,
+                                 am_hal_gpio_write_type_e eWriteType);
+uint32_t am_hal_gpio_interrupt_register(uint32_t ui32GPIONumber,
+                                        am_hal_gpio_handler_t pfnHandler);
+uint32_t am_hal_gpio_interrupt_enable(uint64_t ui64InterruptMask);
+uint32_t am_hal_gpio_interrupt_disable(uint64_t ui64InterruptMask);
+uint32_t am_hal_gpio_interrupt_clear(uint64_t ui64InterruptMask);
+uint32_t am_hal_gpio_interrupt_status_get(bool bEnabledOnly,
+                                          uint64_t *pui64IntStatus);
+uint32_t am_hal_gpio_interrupt_service(uint64_t ui64Status);
+
+//
+// IOM
+//
+#define AM_REG_IOM_NUM_MODULES 6
+
+#define AM_HAL_IOM_48MHZ  48000000
+#define AM_HAL_IOM_24MHZ  24000000
+#define AM_HAL_IOM_16MHZ  16000000
+#define AM_HAL_IOM_12MHZ  12000000
+#define AM_HAL_IOM_8MHZ   8000000
+#define AM_HAL_IOM_6MHZ   6000000
+#define AM_HAL_IOM_4MHZ   4000000
+#define AM_HAL_IOM_3MHZ   3000000
+#define AM_HAL_IOM_2MHZ   2000000
+#define AM_HAL_IOM_1_5MHZ 1500000
+#define AM_HAL_IOM_1MHZ   1000000
+#define AM_HAL_IOM_750KHZ 750000
+#define AM_HAL_IOM_500KHZ 500000
+#define AM_HAL_IOM_400KHZ 400000
+#define AM_HAL_IOM_375KHZ 375000
+#define AM_HAL_IOM_250KHZ 250000
+#define AM_HAL_IOM_100KHZ 100000
+
+#define AM_HAL_IOM_INT_CMDCMP 0x00000001
+#define AM_HAL_IOM_INT_ERR    0x00003E00
+#define AM_HAL_IOM_INT_ALL    0x00003FFF
+
+typedef enum { AM_HAL_IOM_SPI_MODE, AM_HAL_IOM_I2C_MODE } am_hal_iom_mode_e;
+
+typedef enum {
+    AM_HAL_IOM_SPI_MODE_0,
+    AM_HAL_IOM_SPI_MODE_1,
+    AM_HAL_IOM_SPI_MODE_2,
+    AM_HAL_IOM_SPI_MODE_3,
+} am_hal_iom_spi_mode_e;
+
+typedef enum {
+    AM_HAL_IOM_TX,
+    AM_HAL_IOM_RX,
+    AM_HAL_IOM_FULLDUPLEX,
+} am_hal_iom_dir_e;
+
+typedef struct {
+    am_hal_iom_mode_e eInterfaceMode;
+    uint32_t ui32ClockFreq;
+    am_hal_iom_spi_mode_e eSpiMode;
+    uint32_t *pNBTxnBuf;
+    uint32_t ui32NBTxnBufLength;
+} am_hal_iom_config_t;
+
+typedef struct {
+    union {
+        uint32_t ui32SpiChipSelect;
+        uint32_t ui32I2CDevAddr;
+    } uPeerInfo;
+    uint32_t ui32InstrLen;
+    uint32_t ui32Instr;
+    uint32_t ui32NumBytes;
+    am_hal_iom_dir_e eDirection;
+    uint32_t *pui32TxBuffer;
+    uint32_t *pui32RxBuffer;
+    bool bContinue;
+    uint8_t ui8RepeatCount;
+    uint8_t ui8Priority;
+    uint32_t ui32PauseCondition;
+    uint32_t ui32StatusSetClr;
+} am_hal_iom_transfer_t;
+
+typedef void (*am_hal_iom_callback_t)(void *pCallbackCtxt,
+                                      uint32_t transactionStatus);
+
+uint32_t am_hal_iom_initialize(uint32_t ui32Module, void **ppHandle);
+uint32_t am_hal_iom_uninitialize(void *pHandle);
+uint32_t am_hal_iom_power_ctrl(void *pHandle,
+                               am_hal_sysctrl_power_state_e ePowerState,
+                               bool bRetainState);
+uint32_t am_hal_iom_configure(void *pHandle, am_hal_iom_config_t *psConfig);
+uint32_t am_hal_iom_enable(void *pHandle);
+uint32_t am_hal_iom_disable(void *pHandle);
+uint32_t am_hal_iom_blocking_transfer(void *pHandle,
+                                      am_hal_iom_transfer_t *psTransaction);
+uint32_t am_hal_iom_nonblocking_transfer(void *pHandle,
+                                         am_hal_iom_transfer_t *psTransaction,
+                                         am_hal_iom_callback_t pfnCallback,
+                                         void *pCallbackCtxt);
+uint32_t am_hal_iom_interrupt_enable(void *pHandle, uint32_t ui32IntMask);
+uint32_t am_hal_iom_interrupt_disable(void *pHandle, uint32_t ui32IntMask);
+uint32_t am_hal_iom_interrupt_status_get(void *pHandle, bool bEnabledOnly,
+                                         uint32_t *pui32IntStatus);
+uint32_t am_hal_iom_interrupt_clear(void *pHandle, uint32_t ui32IntMask);
+uint32_t am_hal_iom_interrupt_service(void *pHandle, uint32_t ui32IntMask);
+
+//
+// STIMER, counts at 32768 Hz
+//
+uint32_t am_hal_stimer_counter_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AM_MCU_APOLLO_H
@@ -0,0 +1,94 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+// The FreeRTOS API subset used by the platform tasks, implemented on the
+// simulator's virtual clock so that lora_direct runs unchanged on the host.
+//
+// Tasks are cooperative user-level threads.  The highest priority ready
+// task runs until it blocks, yields or calls into the API while a higher
+// priority task is ready; an interrupt never switches tasks by itself.
+// When every task is blocked the virtual clock jumps to the next radio
+// event or task timeout.  The thread that calls sim_freertos_init() becomes
+// a task of priority tskIDLE_PRIORITY, so a test drives the system with the
+// ordinary blocking calls, vTaskDelay() lets everything else run.
+//
+// Critical sections mask interrupts through BASEPRI like the Cortex-M4
+// port, the mask is kept per task across switches.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOSConfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define portBASE_TYPE long
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFUL)
+
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs)                                               \
+    ((TickType_t)(((TickType_t)(xTimeInMs) * configTICK_RATE_HZ) / 1000))
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL (pdFALSE)
+#define pdPASS (pdTRUE)
+#define errQUEUE_EMPTY ((BaseType_t)0)
+#define errQUEUE_FULL ((BaseType_t)0)
+
+#define tskIDLE_PRIORITY ((UBaseType_t)0)
+
+// the switch happens at the next API call of the interrupted task
+extern void sim_freertos_yield_from_isr(BaseType_t xSwitchRequired);
+#define portYIELD_FROM_ISR(x) sim_freertos_yield_from_isr(x)
+#define portEND_SWITCHING_ISR(x) sim_freertos_yield_from_isr(x)
+
+// Discards all tasks and queues and makes the caller the idle priority
+// task.  Call after sim_init().
+extern void sim_freertos_init(void);
+// virtual time in us with every task blocked since sim_freertos_init(), the
+// processor would be asleep
+extern uint64_t sim_freertos_idle_time(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_FREERTOS_H
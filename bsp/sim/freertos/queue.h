@@ -0,0 +1,88 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SIM_FREERTOS_QUEUE_H
+#define SIM_FREERTOS_QUEUE_H
+
+#ifndef SIM_FREERTOS_H
+#error "include FreeRTOS.h first"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct QueueDefinition *QueueHandle_t;
+
+#define queueSEND_TO_BACK ((BaseType_t)0)
+#define queueSEND_TO_FRONT ((BaseType_t)1)
+
+extern QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength,
+                                  UBaseType_t uxItemSize);
+extern void vQueueDelete(QueueHandle_t xQueue);
+extern BaseType_t xQueueGenericSend(QueueHandle_t xQueue,
+                                    const void *pvItemToQueue,
+                                    TickType_t xTicksToWait,
+                                    BaseType_t xCopyPosition);
+extern BaseType_t
+xQueueGenericSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue,
+                         BaseType_t *pxHigherPriorityTaskWoken,
+                         BaseType_t xCopyPosition);
+extern BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer,
+                                TickType_t xTicksToWait);
+extern BaseType_t xQueueReceiveFromISR(QueueHandle_t xQueue, void *pvBuffer,
+                                       BaseType_t *pxHigherPriorityTaskWoken);
+extern BaseType_t xQueueReset(QueueHandle_t xQueue);
+extern UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue);
+extern UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue);
+
+#define xQueueSend(xQueue, pvItemToQueue, xTicksToWait)                        \
+    xQueueGenericSend((xQueue), (pvItemToQueue), (xTicksToWait),               \
+                      queueSEND_TO_BACK)
+#define xQueueSendToBack(xQueue, pvItemToQueue, xTicksToWait)                  \
+    xQueueGenericSend((xQueue), (pvItemToQueue), (xTicksToWait),               \
+                      queueSEND_TO_BACK)
+#define xQueueSendToFront(xQueue, pvItemToQueue, xTicksToWait)                 \
+    xQueueGenericSend((xQueue), (pvItemToQueue), (xTicksToWait),               \
+                      queueSEND_TO_FRONT)
+#define xQueueSendFromISR(xQueue, pvItemToQueue, pxHigherPriorityTaskWoken)    \
+    xQueueGenericSendFromISR((xQueue), (pvItemToQueue),                        \
+                             (pxHigherPriorityTaskWoken), queueSEND_TO_BACK)
+#define xQueueSendToFrontFromISR(xQueue, pvItemToQueue,                        \
+                                 pxHigherPriorityTaskWoken)                    \
+    xQueueGenericSendFromISR((xQueue), (pvItemToQueue),                        \
+                             (pxHigherPriorityTaskWoken), queueSEND_TO_FRONT)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_FREERTOS_QUEUE_H
@@ -0,0 +1,70 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SIM_FREERTOS_SEMPHR_H
+#define SIM_FREERTOS_SEMPHR_H
+
+#include "queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// semaphores are queues of empty items, a mutex remembers its holder
+typedef QueueHandle_t SemaphoreHandle_t;
+
+extern QueueHandle_t xQueueCreateMutex(void);
+extern BaseType_t xQueueSemaphoreTake(QueueHandle_t xQueue,
+                                      TickType_t xTicksToWait);
+extern BaseType_t xQueueTakeMutexRecursive(QueueHandle_t xMutex,
+                                           TickType_t xTicksToWait);
+extern BaseType_t xQueueGiveMutexRecursive(QueueHandle_t xMutex);
+
+#define xSemaphoreCreateBinary() xQueueCreate(1, 0)
+#define xSemaphoreCreateMutex() xQueueCreateMutex()
+#define xSemaphoreCreateRecursiveMutex() xQueueCreateMutex()
+#define vSemaphoreDelete(xSemaphore) vQueueDelete(xSemaphore)
+#define xSemaphoreTake(xSemaphore, xBlockTime)                                 \
+    xQueueSemaphoreTake((xSemaphore), (xBlockTime))
+#define xSemaphoreGive(xSemaphore)                                             \
+    xQueueGenericSend((xSemaphore), NULL, 0, queueSEND_TO_BACK)
+#define xSemaphoreTakeRecursive(xMutex, xBlockTime)                            \
+    xQueueTakeMutexRecursive((xMutex), (xBlockTime))
+#define xSemaphoreGiveRecursive(xMutex) xQueueGiveMutexRecursive(xMutex)
+#define xSemaphoreGiveFromISR(xSemaphore, pxHigherPriorityTaskWoken)           \
+    xQueueGenericSendFromISR((xSemaphore), NULL, (pxHigherPriorityTaskWoken), \
+                             queueSEND_TO_BACK)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_FREERTOS_SEMPHR_H
@@ -0,0 +1,78 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SIM_LORAMAC_SX126X_BOARD_H
+#define SIM_LORAMAC_SX126X_BOARD_H
+
+// The board interface of LoRaMac-node sx126x-board.h, implemented for the
+// NM180100 by features/loramac-node/src/boards/nm180100/sx1262-board.c.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sx126x.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void SX126xIoInit(void);
+void SX126xIoIrqInit(DioIrqHandler dioIrq);
+void SX126xIoDeInit(void);
+void SX126xIoTcxoInit(void);
+void SX126xIoRfSwitchInit(void);
+void SX126xReset(void);
+void SX126xWaitOnBusy(void);
+void SX126xWakeup(void);
+void SX126xWriteCommand(RadioCommands_t opcode, uint8_t *buffer,
+                        uint16_t size);
+uint8_t SX126xReadCommand(RadioCommands_t opcode, uint8_t *buffer,
+                          uint16_t size);
+void SX126xWriteRegisters(uint16_t address, uint8_t *buffer, uint16_t size);
+void SX126xWriteRegister(uint16_t address, uint8_t value);
+void SX126xReadRegisters(uint16_t address, uint8_t *buffer, uint16_t size);
+uint8_t SX126xReadRegister(uint16_t address);
+void SX126xWriteBuffer(uint8_t offset, uint8_t *buffer, uint8_t size);
+void SX126xReadBuffer(uint8_t offset, uint8_t *buffer, uint8_t size);
+void SX126xSetRfTxPower(int8_t power);
+uint8_t SX126xGetDeviceId(void);
+void SX126xAntSwOn(void);
+void SX126xAntSwOff(void);
+bool SX126xCheckRfFrequency(uint32_t frequency);
+uint32_t SX126xGetBoardTcxoWakeupTime(void);
+RadioOperatingModes_t SX126xGetOperatingMode(void);
+void SX126xSetOperatingMode(RadioOperatingModes_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_LORAMAC_SX126X_BOARD_H
@@ -0,0 +1,125 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SIM_LORAMAC_SX126X_H
+#define SIM_LORAMAC_SX126X_H
+
+// The part of LoRaMac-node sx126x.h the board layer and its host tests
+// use, with the values of the LoRaMac-node release the firmware builds
+// against.  The three driver functions declared here are reimplemented in
+// sim_loramac.c, the rest of the driver is not built on the host.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SX1261 1
+#define SX1262 2
+
+#define REG_LR_SYNCWORD 0x0740
+#define REG_OCP 0x08E7
+#define REG_TX_CLAMP_CFG 0x08D8
+
+typedef void(DioIrqHandler)(void *context);
+
+typedef enum {
+    MODE_SLEEP = 0x00,
+    MODE_STDBY_RC,
+    MODE_STDBY_XOSC,
+    MODE_FS,
+    MODE_TX,
+    MODE_RX,
+    MODE_RX_DC,
+    MODE_CAD,
+} RadioOperatingModes_t;
+
+typedef enum {
+    RADIO_RAMP_10_US = 0x00,
+    RADIO_RAMP_20_US = 0x01,
+    RADIO_RAMP_40_US = 0x02,
+    RADIO_RAMP_80_US = 0x03,
+    RADIO_RAMP_200_US = 0x04,
+    RADIO_RAMP_800_US = 0x05,
+    RADIO_RAMP_1700_US = 0x06,
+    RADIO_RAMP_3400_US = 0x07,
+} RadioRampTimes_t;
+
+typedef enum {
+    IRQ_RADIO_NONE = 0x0000,
+    IRQ_TX_DONE = 0x0001,
+    IRQ_RX_DONE = 0x0002,
+    IRQ_PREAMBLE_DETECTED = 0x0004,
+    IRQ_SYNCWORD_VALID = 0x0008,
+    IRQ_HEADER_VALID = 0x0010,
+    IRQ_HEADER_ERROR = 0x0020,
+    IRQ_CRC_ERROR = 0x0040,
+    IRQ_CAD_DONE = 0x0080,
+    IRQ_CAD_ACTIVITY_DETECTED = 0x0100,
+    IRQ_RX_TX_TIMEOUT = 0x0200,
+    IRQ_RADIO_ALL = 0xFFFF,
+} RadioIrqMasks_t;
+
+typedef enum {
+    RADIO_GET_STATUS = 0xC0,
+    RADIO_WRITE_REGISTER = 0x0D,
+    RADIO_READ_REGISTER = 0x1D,
+    RADIO_WRITE_BUFFER = 0x0E,
+    RADIO_READ_BUFFER = 0x1E,
+    RADIO_SET_SLEEP = 0x84,
+    RADIO_SET_STANDBY = 0x80,
+    RADIO_SET_TX = 0x83,
+    RADIO_SET_RX = 0x82,
+    RADIO_SET_RFFREQUENCY = 0x86,
+    RADIO_SET_PACKETTYPE = 0x8A,
+    RADIO_SET_MODULATIONPARAMS = 0x8B,
+    RADIO_SET_PACKETPARAMS = 0x8C,
+    RADIO_SET_TXPARAMS = 0x8E,
+    RADIO_SET_BUFFERBASEADDRESS = 0x8F,
+    RADIO_SET_PACONFIG = 0x95,
+    RADIO_SET_RFSWITCHMODE = 0x9D,
+    RADIO_CFG_DIOIRQ = 0x08,
+    RADIO_CLR_IRQSTATUS = 0x02,
+    RADIO_GET_IRQSTATUS = 0x12,
+    RADIO_GET_RXBUFFERSTATUS = 0x13,
+} RadioCommands_t;
+
+void SX126xCheckDeviceReady(void);
+void SX126xSetDio2AsRfSwitchCtrl(uint8_t enable);
+void SX126xSetTxParams(int8_t power, RadioRampTimes_t rampTime);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_LORAMAC_SX126X_H
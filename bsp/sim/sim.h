@@ -0,0 +1,160 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+// Host simulator for SX1262 radios.
+//
+// The Apollo3 IOM, GPIO, STIMER and interrupt calls made by the radio
+// drivers are emulated against a virtual clock in microseconds.  Each
+// simulated SX1262 decodes the SPI command set, keeps its registers, data
+// buffer and IRQ status, drives BUSY, DIO1 and DIO3, and schedules TXDONE,
+// RXDONE, TIMEOUT and CADDONE from the time-on-air of the programmed
+// packet.  All radios share one virtual channel with log-distance path
+// loss, a noise floor per bandwidth and collisions resolved by capture.
+//
+// Time only moves when the code under test calls into the HAL (SPI
+// transfers, BUSY polls, delays) or when the harness calls
+// sim_time_advance().  Radio events raise GPIO and IOM interrupts, which
+// run the registered handlers as ISRs whenever interrupts are unmasked.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "am_bsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_SX1262_NODES_MAX 8
+
+typedef struct {
+    uint32_t ui32IomModule;
+    uint32_t ui32ChipSelect;
+    uint32_t ui32PinReset;
+    uint32_t ui32PinBusy;
+    uint32_t ui32PinDio1;
+    uint32_t ui32PinDio3;
+
+    // reads are corrupted above this SPI clock, 0 selects 16 MHz
+    uint32_t ui32SpiClockMax;
+
+    // position on the virtual channel in metres
+    double dX;
+    double dY;
+} sim_sx1262_config_t;
+
+// the on-board radio as lora_radio_initialize() expects it
+#define SIM_SX1262_BOARD_CONFIG                                                \
+    {                                                                          \
+        .ui32IomModule = 3, .ui32ChipSelect = AM_BSP_RADIO_NSS_CHNL,           \
+        .ui32PinReset = AM_BSP_GPIO_RADIO_NRESET,                              \
+        .ui32PinBusy = AM_BSP_GPIO_RADIO_BUSY,                                 \
+        .ui32PinDio1 = AM_BSP_GPIO_RADIO_DIO1,                                 \
+        .ui32PinDio3 = AM_BSP_GPIO_RADIO_DIO3                                  \
+    }
+
+typedef struct {
+    uint32_t ui32Commands;
+    uint32_t ui32BusyViolations; // commands clocked in while BUSY was high
+    uint32_t ui32Wakeups;
+
+    uint32_t ui32TxPackets;
+    uint64_t ui64TxAirtime; // in us
+
+    uint32_t ui32RxPackets; // RXDONE, including CRC errors
+    uint32_t ui32RxCrcErrors;
+    uint32_t ui32RxCollisions; // packets corrupted by an interferer
+    uint32_t ui32RxTimeouts;
+
+    // compatible packets that were on the channel but never locked on
+    uint32_t ui32MissedNotListening;
+    uint32_t ui32MissedBelowSensitivity;
+    uint32_t ui32MissedReceiverBusy;
+
+    uint32_t ui32CadDone;
+    uint32_t ui32CadDetected;
+} sim_sx1262_stats_t;
+
+typedef struct {
+    double dPathLossExponent;
+    double dReferenceLoss;    // dB at 1 m
+    double dNoiseFigure;      // dB
+    double dCaptureThreshold; // dB a same-SF packet must exceed interferers
+    double dSfRejection;      // dB an interferer with another SF may exceed
+} sim_channel_config_t;
+
+// Resets the clock, the emulated peripherals and removes all radios
+void sim_init(void);
+
+uint64_t sim_time_get(void);
+void sim_time_advance(uint64_t ui64Microseconds);
+void sim_run_until(uint64_t ui64Time);
+// time of the next scheduled event, UINT64_MAX if there is none
+uint64_t sim_time_next(void);
+
+// pin state reads since sim_init(), each one costs the caller 1 us
+uint32_t sim_gpio_read_count(uint32_t ui32Pin);
+
+// drives an input pin at the given time the way an external device would,
+// an edge raises the pin interrupt as configured
+void sim_gpio_drive_at(uint32_t ui32Pin, bool bLevel, uint64_t ui64Time);
+
+void sim_channel_configure(const sim_channel_config_t *psConfig);
+void sim_channel_config_get(sim_channel_config_t *psConfig);
+
+// fixes the loss between two radios instead of deriving it from distance,
+// a negative loss returns the pair to the path-loss model
+void sim_channel_path_loss_set(int32_t i32NodeA, int32_t i32NodeB,
+                               double dLoss);
+
+// returns the node index or -1 when the table is full
+int32_t sim_sx1262_create(const sim_sx1262_config_t *psConfig);
+void sim_sx1262_position_set(int32_t i32Node, double dX, double dY);
+void sim_sx1262_stats_get(int32_t i32Node, sim_sx1262_stats_t *psStats);
+void sim_sx1262_stats_reset(int32_t i32Node);
+
+// Replays recorded BUSY high times, one per command in the order the
+// commands reach the radio, in place of the timing model.  The model takes
+// over again once the trace is used up.  The array is not copied, NULL
+// clears the trace.
+void sim_sx1262_busy_trace_set(int32_t i32Node, const uint32_t *pui32Us,
+                               uint32_t ui32Count);
+// entries of the trace consumed so far
+uint32_t sim_sx1262_busy_trace_position(int32_t i32Node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_H
@@ -0,0 +1,205 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <math.h>
+#include <string.h>
+
+#include "sim_private.h"
+
+// thermal noise density in dBm/Hz
+#define SIM_CHANNEL_THERMAL_NOISE (-174.0)
+
+// losses below the distance of one metre are clamped
+#define SIM_CHANNEL_DISTANCE_MIN 1.0
+
+// demodulator SNR limits for SF5 to SF12 (SX1261/2 datasheet, 6.1.1.4)
+static const double pdSnrFloor[] = {-5.0,  -7.5,  -7.5,  -10.0,
+                                    -12.5, -15.0, -17.5, -20.0};
+
+static const sim_channel_config_t gsDefaultConfig = {
+    .dPathLossExponent = 2.7,
+    .dReferenceLoss = 40.0,
+    .dNoiseFigure = 6.0,
+    .dCaptureThreshold = 6.0,
+    .dSfRejection = 16.0,
+};
+
+static sim_channel_config_t gsConfig;
+static sim_transmission_t gpsTransmissions[SIM_CHANNEL_TRANSMISSIONS];
+static double gpdX[SIM_SX1262_NODES_MAX];
+static double gpdY[SIM_SX1262_NODES_MAX];
+static double gpdLoss[SIM_SX1262_NODES_MAX][SIM_SX1262_NODES_MAX];
+
+void sim_channel_init(void)
+{
+    gsConfig = gsDefaultConfig;
+    memset(gpsTransmissions, 0, sizeof(gpsTransmissions));
+    memset(gpdX, 0, sizeof(gpdX));
+    memset(gpdY, 0, sizeof(gpdY));
+
+    for (uint32_t i = 0; i < SIM_SX1262_NODES_MAX; i++) {
+        for (uint32_t j = 0; j < SIM_SX1262_NODES_MAX; j++) {
+            gpdLoss[i][j] = -1.0;
+        }
+    }
+}
+
+void sim_channel_configure(const sim_channel_config_t *psConfig)
+{
+    gsConfig = *psConfig;
+}
+
+void sim_channel_config_get(sim_channel_config_t *psConfig)
+{
+    *psConfig = gsConfig;
+}
+
+void sim_channel_path_loss_set(int32_t i32NodeA, int32_t i32NodeB,
+                               double dLoss)
+{
+    if ((i32NodeA < 0) || (i32NodeA >= SIM_SX1262_NODES_MAX) ||
+        (i32NodeB < 0) || (i32NodeB >= SIM_SX1262_NODES_MAX)) {
+        return;
+    }
+
+    gpdLoss[i32NodeA][i32NodeB] = dLoss;
+    gpdLoss[i32NodeB][i32NodeA] = dLoss;
+}
+
+void sim_channel_position_set(int32_t i32Node, double dX, double dY)
+{
+    if ((i32Node < 0) || (i32Node >= SIM_SX1262_NODES_MAX)) {
+        return;
+    }
+
+    gpdX[i32Node] = dX;
+    gpdY[i32Node] = dY;
+}
+
+sim_transmission_t *sim_channel_begin(void)
+{
+    for (uint32_t i = 0; i < SIM_CHANNEL_TRANSMISSIONS; i++) {
+        sim_transmission_t *psTransmission = &gpsTransmissions[i];
+
+        if (!psTransmission->bActive) {
+            memset(psTransmission, 0, sizeof(sim_transmission_t));
+            psTransmission->bActive = true;
+            return psTransmission;
+        }
+    }
+
+    return NULL;
+}
+
+void sim_channel_end(sim_transmission_t *psTransmission)
+{
+    psTransmission->bActive = false;
+}
+
+sim_transmission_t *sim_channel_get(uint32_t ui32Index)
+{
+    if (ui32Index >= SIM_CHANNEL_TRANSMISSIONS) {
+        return NULL;
+    }
+
+    return gpsTransmissions[ui32Index].bActive ? &gpsTransmissions[ui32Index]
+                                               : NULL;
+}
+
+// log-distance model unless the pair has a fixed loss
+static double sim_channel_path_loss(int32_t i32From, int32_t i32To)
+{
+    double dDistance;
+
+    if (gpdLoss[i32From][i32To] >= 0.0) {
+        return gpdLoss[i32From][i32To];
+    }
+
+    dDistance = hypot(gpdX[i32From] - gpdX[i32To], gpdY[i32From] - gpdY[i32To]);
+    if (dDistance < SIM_CHANNEL_DISTANCE_MIN) {
+        dDistance = SIM_CHANNEL_DISTANCE_MIN;
+    }
+
+    return gsConfig.dReferenceLoss +
+           10.0 * gsConfig.dPathLossExponent * log10(dDistance);
+}
+
+double sim_channel_power(const sim_transmission_t *psTransmission,
+                         int32_t i32Node)
+{
+    return psTransmission->i8Power -
+           sim_channel_path_loss(psTransmission->i32Source, i32Node);
+}
+
+double sim_channel_noise(uint32_t ui32Bandwidth)
+{
+    return SIM_CHANNEL_THERMAL_NOISE + 10.0 * log10((double)ui32Bandwidth) +
+           gsConfig.dNoiseFigure;
+}
+
+double sim_channel_snr_floor(uint8_t ui8SpreadingFactor)
+{
+    if (ui8SpreadingFactor < 5) {
+        ui8SpreadingFactor = 5;
+    }
+
+    if (ui8SpreadingFactor > 12) {
+        ui8SpreadingFactor = 12;
+    }
+
+    return pdSnrFloor[ui8SpreadingFactor - 5];
+}
+
+bool sim_channel_overlaps(const sim_transmission_t *psTransmission,
+                          uint32_t ui32Frequency, uint32_t ui32Bandwidth)
+{
+    int64_t i64Offset =
+        (int64_t)psTransmission->ui32Frequency - (int64_t)ui32Frequency;
+    int64_t i64Span =
+        ((int64_t)psTransmission->ui32Bandwidth + ui32Bandwidth) / 2;
+
+    return (i64Offset < i64Span) && (i64Offset > -i64Span);
+}
+
+// Same-SF packets need the capture margin over the interferer.  Different
+// spreading factors are quasi-orthogonal and only an interferer that is
+// stronger by more than the rejection destroys the packet.
+bool sim_channel_collides(double dSignal, uint8_t ui8SpreadingFactor,
+                          double dInterference,
+                          const sim_transmission_t *psInterferer)
+{
+    if (psInterferer->bCarrier ||
+        (psInterferer->ui8SpreadingFactor == ui8SpreadingFactor)) {
+        return (dSignal - dInterference) < gsConfig.dCaptureThreshold;
+    }
+
+    return (dInterference - dSignal) > gsConfig.dSfRejection;
+}
@@ -0,0 +1,714 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+// FreeRTOS on the virtual clock, see freertos/FreeRTOS.h.  Tasks run on
+// ucontext stacks and switch only inside API calls.
+
+#define _XOPEN_SOURCE 600
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "am_mcu_apollo.h"
+#include "sim.h"
+
+#define SIM_TASK_STACK_SIZE (256 * 1024)
+#define SIM_TICK_US (1000000 / configTICK_RATE_HZ)
+#define SIM_FOREVER UINT64_MAX
+
+typedef enum {
+    SIM_TASK_READY,
+    SIM_TASK_BLOCKED,
+    SIM_TASK_DELETED
+} sim_task_state_e;
+
+struct tskTaskControlBlock {
+    ucontext_t sContext;
+    void *pvStack;
+    TaskFunction_t pfnTask;
+    void *pvParameters;
+    UBaseType_t uxPriority;
+    sim_task_state_e eState;
+    const void *pvWaitObject; // queue the task is blocked on
+    uint64_t ui64WakeTime;    // SIM_FOREVER without a timeout
+    uint32_t ui32CriticalNesting;
+    uint32_t ui32Turn; // round robin among equal priorities
+    struct tskTaskControlBlock *psNext;
+    char pcName[16];
+};
+
+struct QueueDefinition {
+    uint8_t *pui8Storage;
+    UBaseType_t uxLength;
+    UBaseType_t uxItemSize;
+    UBaseType_t uxCount;
+    UBaseType_t uxHead; // oldest item
+    bool bMutex;
+    TaskHandle_t psHolder;
+    UBaseType_t uxRecursion; // takes of a recursive mutex by its holder
+    struct QueueDefinition *psNext;
+};
+
+static struct tskTaskControlBlock gsMainTask;
+static TaskHandle_t gpsTasks;
+static TaskHandle_t gpsCurrentTask;
+static struct QueueDefinition *gpsQueues;
+static uint32_t gui32Turn;
+static uint32_t gui32SchedulerSuspended;
+static uint64_t gui64IdleTime;
+
+void sim_freertos_assert(const char *pcFile, int iLine)
+{
+    fprintf(stderr, "sim: FreeRTOS assertion failed at %s:%d\n", pcFile,
+            iLine);
+    abort();
+}
+
+static bool sim_task_in_isr(void)
+{
+    return __get_IPSR() != 0;
+}
+
+//
+// scheduling
+//
+static void sim_task_timeouts(void)
+{
+    uint64_t ui64Now = sim_time_get();
+
+    for (TaskHandle_t psTask = gpsTasks; psTask; psTask = psTask->psNext) {
+        if ((psTask->eState == SIM_TASK_BLOCKED) &&
+            (psTask->ui64WakeTime <= ui64Now)) {
+            psTask->eState = SIM_TASK_READY;
+            psTask->pvWaitObject = NULL;
+        }
+    }
+}
+
+// highest priority ready task, the one that waited longest among equals
+static TaskHandle_t sim_task_select(void)
+{
+    TaskHandle_t psSelected = NULL;
+
+    sim_task_timeouts();
+
+    for (TaskHandle_t psTask = gpsTasks; psTask; psTask = psTask->psNext) {
+        if (psTask->eState != SIM_TASK_READY) {
+            continue;
+        }
+
+        if (!psSelected || (psTask->uxPriority > psSelected->uxPriority) ||
+            ((psTask->uxPriority == psSelected->uxPriority) &&
+             ((int32_t)(psTask->ui32Turn - psSelected->ui32Turn) < 0))) {
+            psSelected = psTask;
+        }
+    }
+
+    return psSelected;
+}
+
+// nothing can run: let the clock run to the next event or task timeout
+static void sim_task_idle(void)
+{
+    uint64_t ui64Start = sim_time_get();
+    uint64_t ui64Next = sim_time_next();
+
+    for (TaskHandle_t psTask = gpsTasks; psTask; psTask = psTask->psNext) {
+        if ((psTask->eState == SIM_TASK_BLOCKED) &&
+            (psTask->ui64WakeTime < ui64Next)) {
+            ui64Next = psTask->ui64WakeTime;
+        }
+    }
+
+    if (ui64Next == SIM_FOREVER) {
+        fprintf(stderr, "sim: every task is blocked forever\n");
+        abort();
+    }
+
+    sim_run_until(ui64Next);
+    gui64IdleTime += sim_time_get() - ui64Start;
+}
+
+static void sim_task_mask_restore(TaskHandle_t psTask)
+{
+    __set_BASEPRI(psTask->ui32CriticalNesting
+                      ? configMAX_SYSCALL_INTERRUPT_PRIORITY
+                      : 0);
+}
+
+// Hands the processor to the task that should run.  The caller has
+// already changed its own state if it is blocking.
+static void sim_task_schedule(void)
+{
+    TaskHandle_t psCurrent = gpsCurrentTask;
+    TaskHandle_t psNext;
+
+    configASSERT(!sim_task_in_isr());
+
+    psCurrent->ui32Turn = ++gui32Turn;
+
+    // interrupts are open while idle, the critical section of a blocking
+    // task is restored when it runs again
+    __set_BASEPRI(0);
+    while ((psNext = sim_task_select()) == NULL) {
+        sim_task_idle();
+    }
+
+    if (psNext != psCurrent) {
+        gpsCurrentTask = psNext;
+        sim_task_mask_restore(psNext);
+        swapcontext(&psCurrent->sContext, &psNext->sContext);
+    }
+
+    sim_task_mask_restore(gpsCurrentTask);
+}
+
+// Switches to a ready task of higher priority than the caller, called
+// on the way through the API as the port would on the PendSV interrupt.
+static void sim_task_preempt(void)
+{
+    TaskHandle_t psCurrent = gpsCurrentTask;
+
+    if (sim_task_in_isr() || psCurrent->ui32CriticalNesting ||
+        gui32SchedulerSuspended) {
+        return;
+    }
+
+    for (TaskHandle_t psTask = gpsTasks; psTask; psTask = psTask->psNext) {
+        if ((psTask->eState == SIM_TASK_READY) &&
+            (psTask->uxPriority > psCurrent->uxPriority)) {
+            sim_task_schedule();
+            return;
+        }
+    }
+}
+
+static void sim_task_block(const void *pvObject, uint64_t ui64WakeTime)
+{
+    configASSERT(gpsCurrentTask->ui32CriticalNesting == 0);
+    configASSERT(gui32SchedulerSuspended == 0);
+
+    gpsCurrentTask->eState = SIM_TASK_BLOCKED;
+    gpsCurrentTask->pvWaitObject = pvObject;
+    gpsCurrentTask->ui64WakeTime = ui64WakeTime;
+    sim_task_schedule();
+}
+
+// readies the tasks waiting on the object, returns pdTRUE if one of them
+// has a higher priority than the running task
+static BaseType_t sim_task_wake(const void *pvObject)
+{
+    BaseType_t xHigher = pdFALSE;
+
+    for (TaskHandle_t psTask = gpsTasks; psTask; psTask = psTask->psNext) {
+        if ((psTask->eState == SIM_TASK_BLOCKED) &&
+            (psTask->pvWaitObject == pvObject)) {
+            psTask->eState = SIM_TASK_READY;
+            psTask->pvWaitObject = NULL;
+            if (psTask->uxPriority > gpsCurrentTask->uxPriority) {
+                xHigher = pdTRUE;
+            }
+        }
+    }
+
+    return xHigher;
+}
+
+// blocking calls wake on the tick boundary, as with the tick interrupt
+static uint64_t sim_task_deadline(TickType_t xTicks)
+{
+    if (xTicks == portMAX_DELAY) {
+        return SIM_FOREVER;
+    }
+
+    return (sim_time_get() / SIM_TICK_US + xTicks) * SIM_TICK_US;
+}
+
+void sim_freertos_yield_from_isr(BaseType_t xSwitchRequired)
+{
+    // the interrupted task switches at its next API call
+}
+
+//
+// tasks
+//
+static void sim_task_entry(void)
+{
+    TaskHandle_t psTask = gpsCurrentTask;
+
+    psTask->pfnTask(psTask->pvParameters);
+    vTaskDelete(NULL);
+}
+
+void sim_freertos_init(void)
+{
+    TaskHandle_t psTask = gpsTasks;
+    struct QueueDefinition *psQueue = gpsQueues;
+
+    configASSERT(!gpsCurrentTask || (gpsCurrentTask == &gsMainTask));
+
+    while (psTask) {
+        TaskHandle_t psNext = psTask->psNext;
+
+        if (psTask != &gsMainTask) {
+            free(psTask->pvStack);
+            free(psTask);
+        }
+        psTask = psNext;
+    }
+
+    while (psQueue) {
+        struct QueueDefinition *psNext = psQueue->psNext;
+
+        free(psQueue->pui8Storage);
+        free(psQueue);
+        psQueue = psNext;
+    }
+
+    memset(&gsMainTask, 0, sizeof(gsMainTask));
+    strcpy(gsMainTask.pcName, "main");
+    gsMainTask.uxPriority = tskIDLE_PRIORITY;
+    gsMainTask.eState = SIM_TASK_READY;
+
+    gpsTasks = &gsMainTask;
+    gpsCurrentTask = &gsMainTask;
+    gpsQueues = NULL;
+    gui32Turn = 0;
+    gui32SchedulerSuspended = 0;
+    gui64IdleTime = 0;
+}
+
+uint64_t sim_freertos_idle_time(void)
+{
+    return gui64IdleTime;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName,
+                       uint16_t usStackDepth, void *pvParameters,
+                       UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+    TaskHandle_t psTask = calloc(1, sizeof(struct tskTaskControlBlock));
+
+    configASSERT(gpsCurrentTask);
+    configASSERT(uxPriority < configMAX_PRIORITIES);
+
+    if (!psTask) {
+        return pdFAIL;
+    }
+
+    psTask->pvStack = malloc(SIM_TASK_STACK_SIZE);
+    if (!psTask->pvStack) {
+        free(psTask);
+        return pdFAIL;
+    }
+
+    getcontext(&psTask->sContext);
+    psTask->sContext.uc_stack.ss_sp = psTask->pvStack;
+    psTask->sContext.uc_stack.ss_size = SIM_TASK_STACK_SIZE;
+    psTask->sContext.uc_link = NULL;
+    makecontext(&psTask->sContext, sim_task_entry, 0);
+
+    psTask->pfnTask = pxTaskCode;
+    psTask->pvParameters = pvParameters;
+    psTask->uxPriority = uxPriority;
+    psTask->eState = SIM_TASK_READY;
+    psTask->ui32Turn = ++gui32Turn;
+    strncpy(psTask->pcName, pcName ? pcName : "", sizeof(psTask->pcName) - 1);
+
+    psTask->psNext = gpsTasks;
+    gpsTasks = psTask;
+
+    if (pxCreatedTask) {
+        *pxCreatedTask = psTask;
+    }
+
+    sim_task_preempt();
+
+    return pdPASS;
+}
+
+// the stack of a deleted task is reclaimed by sim_freertos_init()
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    TaskHandle_t psTask = xTaskToDelete ? xTaskToDelete : gpsCurrentTask;
+
+    configASSERT(psTask != &gsMainTask);
+
+    psTask->eState = SIM_TASK_DELETED;
+    psTask->ui32CriticalNesting = 0;
+    if (psTask == gpsCurrentTask) {
+        sim_task_schedule();
+    }
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+    if (xTicksToDelay == 0) {
+        vTaskYield();
+        return;
+    }
+
+    sim_task_block(NULL, sim_task_deadline(xTicksToDelay));
+}
+
+void vTaskYield(void)
+{
+    sim_task_schedule();
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(sim_time_get() / SIM_TICK_US);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return gpsCurrentTask;
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+    if (!gpsCurrentTask) {
+        return taskSCHEDULER_NOT_STARTED;
+    }
+
+    return gui32SchedulerSuspended ? taskSCHEDULER_SUSPENDED
+                                   : taskSCHEDULER_RUNNING;
+}
+
+void vTaskSuspendAll(void)
+{
+    gui32SchedulerSuspended++;
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    configASSERT(gui32SchedulerSuspended);
+
+    gui32SchedulerSuspended--;
+    sim_task_preempt();
+
+    return pdFALSE;
+}
+
+//
+// critical sections
+//
+void vPortEnterCritical(void)
+{
+    __set_BASEPRI(configMAX_SYSCALL_INTERRUPT_PRIORITY);
+    gpsCurrentTask->ui32CriticalNesting++;
+}
+
+void vPortExitCritical(void)
+{
+    configASSERT(gpsCurrentTask->ui32CriticalNesting);
+
+    if (--gpsCurrentTask->ui32CriticalNesting == 0) {
+        __set_BASEPRI(0);
+        sim_task_preempt();
+    }
+}
+
+UBaseType_t ulPortSetInterruptMaskFromISR(void)
+{
+    UBaseType_t uxMask = __get_BASEPRI();
+
+    __set_BASEPRI(configMAX_SYSCALL_INTERRUPT_PRIORITY);
+
+    return uxMask;
+}
+
+void vPortClearInterruptMaskFromISR(UBaseType_t uxMask)
+{
+    __set_BASEPRI(uxMask);
+}
+
+//
+// queues and semaphores
+//
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    struct QueueDefinition *psQueue;
+
+    configASSERT(uxQueueLength);
+
+    psQueue = calloc(1, sizeof(struct QueueDefinition));
+    if (!psQueue) {
+        return NULL;
+    }
+
+    if (uxItemSize) {
+        psQueue->pui8Storage = malloc(uxQueueLength * uxItemSize);
+        if (!psQueue->pui8Storage) {
+            free(psQueue);
+            return NULL;
+        }
+    }
+
+    psQueue->uxLength = uxQueueLength;
+    psQueue->uxItemSize = uxItemSize;
+    psQueue->psNext = gpsQueues;
+    gpsQueues = psQueue;
+
+    return psQueue;
+}
+
+QueueHandle_t xQueueCreateMutex(void)
+{
+    QueueHandle_t psQueue = xQueueCreate(1, 0);
+
+    if (psQueue) {
+        psQueue->bMutex = true;
+        psQueue->uxCount = 1;
+    }
+
+    return psQueue;
+}
+
+// queues stay allocated until sim_freertos_init()
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    configASSERT(xQueue);
+
+    xQueue->uxCount = 0;
+}
+
+static bool sim_queue_put(QueueHandle_t psQueue, const void *pvItem,
+                          BaseType_t xPosition)
+{
+    UBaseType_t uxIndex;
+
+    if (psQueue->uxCount >= psQueue->uxLength) {
+        return false;
+    }
+
+    if (psQueue->bMutex) {
+        // only the holder may give a mutex back
+        configASSERT(psQueue->psHolder == gpsCurrentTask);
+        psQueue->psHolder = NULL;
+    }
+
+    if (xPosition == queueSEND_TO_FRONT) {
+        psQueue->uxHead =
+            (psQueue->uxHead + psQueue->uxLength - 1) % psQueue->uxLength;
+        uxIndex = psQueue->uxHead;
+    } else {
+        uxIndex = (psQueue->uxHead + psQueue->uxCount) % psQueue->uxLength;
+    }
+
+    if (psQueue->uxItemSize) {
+        memcpy(&psQueue->pui8Storage[uxIndex * psQueue->uxItemSize], pvItem,
+               psQueue->uxItemSize);
+    }
+    psQueue->uxCount++;
+
+    return true;
+}
+
+static bool sim_queue_get(QueueHandle_t psQueue, void *pvBuffer)
+{
+    if (psQueue->uxCount == 0) {
+        return false;
+    }
+
+    if (psQueue->uxItemSize) {
+        memcpy(pvBuffer,
+               &psQueue->pui8Storage[psQueue->uxHead * psQueue->uxItemSize],
+               psQueue->uxItemSize);
+    }
+    psQueue->uxHead = (psQueue->uxHead + 1) % psQueue->uxLength;
+    psQueue->uxCount--;
+
+    if (psQueue->bMutex) {
+        psQueue->psHolder = gpsCurrentTask;
+    }
+
+    return true;
+}
+
+// Senders and receivers of a queue wait on the same object and check
+// again when they are woken.
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void *pvItemToQueue,
+                             TickType_t xTicksToWait,
+                             BaseType_t xCopyPosition)
+{
+    uint64_t ui64Deadline = sim_task_deadline(xTicksToWait);
+
+    configASSERT(xQueue);
+    configASSERT(!sim_task_in_isr());
+
+    while (1) {
+        if (sim_queue_put(xQueue, pvItemToQueue, xCopyPosition)) {
+            sim_task_wake(xQueue);
+            sim_task_preempt();
+            return pdPASS;
+        }
+
+        if ((xTicksToWait == 0) || (sim_time_get() >= ui64Deadline)) {
+            return errQUEUE_FULL;
+        }
+
+        sim_task_block(xQueue, ui64Deadline);
+    }
+}
+
+BaseType_t xQueueGenericSendFromISR(QueueHandle_t xQueue,
+                                    const void *pvItemToQueue,
+                                    BaseType_t *pxHigherPriorityTaskWoken,
+                                    BaseType_t xCopyPosition)
+{
+    BaseType_t xHigher;
+
+    configASSERT(xQueue);
+
+    if (!sim_queue_put(xQueue, pvItemToQueue, xCopyPosition)) {
+        return errQUEUE_FULL;
+    }
+
+    xHigher = sim_task_wake(xQueue);
+    if (pxHigherPriorityTaskWoken && xHigher) {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer,
+                         TickType_t xTicksToWait)
+{
+    uint64_t ui64Deadline = sim_task_deadline(xTicksToWait);
+
+    configASSERT(xQueue);
+    configASSERT(!sim_task_in_isr());
+
+    while (1) {
+        if (sim_queue_get(xQueue, pvBuffer)) {
+            sim_task_wake(xQueue);
+            sim_task_preempt();
+            return pdPASS;
+        }
+
+        if ((xTicksToWait == 0) || (sim_time_get() >= ui64Deadline)) {
+            return errQUEUE_EMPTY;
+        }
+
+        sim_task_block(xQueue, ui64Deadline);
+    }
+}
+
+BaseType_t xQueueSemaphoreTake(QueueHandle_t xQueue, TickType_t xTicksToWait)
+{
+    return xQueueReceive(xQueue, NULL, xTicksToWait);
+}
+
+BaseType_t xQueueTakeMutexRecursive(QueueHandle_t xMutex,
+                                    TickType_t xTicksToWait)
+{
+    configASSERT(xMutex && xMutex->bMutex);
+
+    if (xMutex->psHolder == gpsCurrentTask) {
+        xMutex->uxRecursion++;
+        return pdPASS;
+    }
+
+    if (xQueueReceive(xMutex, NULL, xTicksToWait) != pdPASS) {
+        return pdFAIL;
+    }
+    xMutex->uxRecursion = 1;
+
+    return pdPASS;
+}
+
+// the mutex is released once every take has been given back
+BaseType_t xQueueGiveMutexRecursive(QueueHandle_t xMutex)
+{
+    configASSERT(xMutex && xMutex->bMutex);
+
+    if (xMutex->psHolder != gpsCurrentTask) {
+        return pdFAIL;
+    }
+
+    if (--xMutex->uxRecursion) {
+        return pdPASS;
+    }
+
+    return xQueueGenericSend(xMutex, NULL, 0, queueSEND_TO_BACK);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t xQueue, void *pvBuffer,
+                                BaseType_t *pxHigherPriorityTaskWoken)
+{
+    BaseType_t xHigher;
+
+    configASSERT(xQueue);
+
+    if (!sim_queue_get(xQueue, pvBuffer)) {
+        return errQUEUE_EMPTY;
+    }
+
+    xHigher = sim_task_wake(xQueue);
+    if (pxHigherPriorityTaskWoken && xHigher) {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+
+    return pdPASS;
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+    configASSERT(xQueue);
+
+    xQueue->uxCount = 0;
+    xQueue->uxHead = 0;
+    sim_task_wake(xQueue);
+
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+    return xQueue->uxCount;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue)
+{
+    return xQueue->uxLength - xQueue->uxCount;
+}
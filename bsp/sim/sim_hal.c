@@ -0,0 +1,922 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "am_mcu_apollo.h"
+#include "am_util.h"
+
+#include "sim_private.h"
+
+// cost of a GPIO read, keeps polling loops moving through virtual time
+#define SIM_GPIO_READ_US 1
+
+// setup time of an IOM command on top of the bits on the wire
+#define SIM_IOM_SETUP_US 1
+
+#define SIM_EVENT_MAX 256
+#define SIM_IOM_QUEUE_SIZE 32
+
+#define SIM_STIMER_FREQUENCY 32768
+
+typedef struct {
+    bool bUsed;
+    uint64_t ui64Time;
+    uint32_t ui32Sequence;
+    sim_event_handler_t pfnHandler;
+    void *pvContext;
+    uint32_t ui32Arg;
+} sim_event_t;
+
+typedef struct {
+    am_hal_iom_transfer_t sTransfer;
+    am_hal_iom_callback_t pfnCallback;
+    void *pvContext;
+} sim_iom_command_t;
+
+typedef struct {
+    bool bInitialized;
+    bool bEnabled;
+    uint32_t ui32Module;
+    uint32_t ui32Clock;
+    uint32_t ui32IntStatus;
+    uint32_t ui32IntEnable;
+
+    // chip select held between transfers with bContinue set
+    bool bFrameOpen;
+    sim_sx1262_t *psSelected;
+
+    // non-blocking commands are clocked out one after the other, their
+    // callbacks run from am_hal_iom_interrupt_service()
+    sim_iom_command_t psPending[SIM_IOM_QUEUE_SIZE];
+    uint32_t ui32PendingHead;
+    uint32_t ui32PendingCount;
+    sim_iom_command_t psDone[SIM_IOM_QUEUE_SIZE];
+    uint32_t ui32DoneHead;
+    uint32_t ui32DoneCount;
+} sim_iom_t;
+
+typedef struct {
+    am_hal_gpio_pincfg_t sConfig;
+    bool bOutput;
+    bool bDriven; // level set by a simulated device
+    bool bInput;
+    am_hal_gpio_handler_t pfnHandler;
+    uint32_t ui32Reads;
+} sim_gpio_t;
+
+static uint64_t gui64Now;
+static sim_event_t gpsEvents[SIM_EVENT_MAX];
+static uint32_t gui32EventSequence;
+
+static uint32_t gui32Primask;
+static uint32_t gui32Basepri;
+static uint32_t gui32Ipsr;
+static uint32_t gui32NvicEnabled;
+
+static sim_gpio_t gpsGpio[AM_HAL_GPIO_MAX_PADS];
+static uint64_t gui64GpioStatus;
+static uint64_t gui64GpioEnabled;
+
+static sim_iom_t gpsIom[AM_REG_IOM_NUM_MODULES];
+
+const am_hal_gpio_pincfg_t g_AM_HAL_GPIO_DISABLE = {.uFuncSel = 3};
+const am_hal_gpio_pincfg_t g_AM_HAL_GPIO_OUTPUT = {
+    .uFuncSel = 3,
+    .eDriveStrength = AM_HAL_GPIO_PIN_DRIVESTRENGTH_2MA,
+    .eGPOutcfg = AM_HAL_GPIO_PIN_OUTCFG_PUSHPULL};
+const am_hal_gpio_pincfg_t g_AM_HAL_GPIO_INPUT = {
+    .uFuncSel = 3, .eGPInput = AM_HAL_GPIO_PIN_INPUT_ENABLE};
+
+// Interrupt handlers of the application.  Without one the interrupt is
+// serviced the way the usual handler would.
+extern void am_gpio_isr(void) __attribute__((weak));
+extern void am_iomaster0_isr(void) __attribute__((weak));
+extern void am_iomaster1_isr(void) __attribute__((weak));
+extern void am_iomaster2_isr(void) __attribute__((weak));
+extern void am_iomaster3_isr(void) __attribute__((weak));
+extern void am_iomaster4_isr(void) __attribute__((weak));
+extern void am_iomaster5_isr(void) __attribute__((weak));
+
+static void sim_interrupt_deliver(void);
+
+void sim_init(void)
+{
+    gui64Now = 0;
+    gui32EventSequence = 0;
+    memset(gpsEvents, 0, sizeof(gpsEvents));
+
+    gui32Primask = 0;
+    gui32Basepri = 0;
+    gui32Ipsr = 0;
+    gui32NvicEnabled = 0;
+
+    memset(gpsGpio, 0, sizeof(gpsGpio));
+    gui64GpioStatus = 0;
+    gui64GpioEnabled = 0;
+
+    memset(gpsIom, 0, sizeof(gpsIom));
+
+    sim_channel_init();
+    sim_sx1262_init();
+}
+
+//
+// Virtual clock
+//
+uint64_t sim_time_get(void)
+{
+    return gui64Now;
+}
+
+void sim_event_schedule(uint64_t ui64Time, sim_event_handler_t pfnHandler,
+                        void *pvContext, uint32_t ui32Arg)
+{
+    for (uint32_t i = 0; i < SIM_EVENT_MAX; i++) {
+        sim_event_t *psEvent = &gpsEvents[i];
+
+        if (psEvent->bUsed) {
+            continue;
+        }
+
+        psEvent->bUsed = true;
+        psEvent->ui64Time = ui64Time < gui64Now ? gui64Now : ui64Time;
+        psEvent->ui32Sequence = gui32EventSequence++;
+        psEvent->pfnHandler = pfnHandler;
+        psEvent->pvContext = pvContext;
+        psEvent->ui32Arg = ui32Arg;
+        return;
+    }
+
+    fprintf(stderr, "sim: event table full\n");
+    abort();
+}
+
+static sim_event_t *sim_event_next(uint64_t ui64Limit)
+{
+    sim_event_t *psNext = NULL;
+
+    for (uint32_t i = 0; i < SIM_EVENT_MAX; i++) {
+        sim_event_t *psEvent = &gpsEvents[i];
+
+        if (!psEvent->bUsed || (psEvent->ui64Time > ui64Limit)) {
+            continue;
+        }
+
+        if (!psNext || (psEvent->ui64Time < psNext->ui64Time) ||
+            ((psEvent->ui64Time == psNext->ui64Time) &&
+             ((int32_t)(psEvent->ui32Sequence - psNext->ui32Sequence) < 0))) {
+            psNext = psEvent;
+        }
+    }
+
+    return psNext;
+}
+
+// Runs the events due up to ui64Time.  Handlers may call back into the HAL
+// and move the clock past ui64Time, it never runs backwards.
+void sim_run_until(uint64_t ui64Time)
+{
+    sim_event_t *psEvent;
+
+    while ((psEvent = sim_event_next(ui64Time)) != NULL) {
+        sim_event_t sEvent = *psEvent;
+
+        psEvent->bUsed = false;
+        if (sEvent.ui64Time > gui64Now) {
+            gui64Now = sEvent.ui64Time;
+        }
+
+        sEvent.pfnHandler(sEvent.pvContext, sEvent.ui32Arg);
+        sim_interrupt_deliver();
+    }
+
+    if (ui64Time > gui64Now) {
+        gui64Now = ui64Time;
+    }
+
+    sim_interrupt_deliver();
+}
+
+void sim_time_advance(uint64_t ui64Microseconds)
+{
+    sim_run_until(gui64Now + ui64Microseconds);
+}
+
+uint64_t sim_time_next(void)
+{
+    sim_event_t *psEvent = sim_event_next(UINT64_MAX);
+
+    return psEvent ? psEvent->ui64Time : UINT64_MAX;
+}
+
+//
+// Interrupts
+//
+static bool sim_irq_enabled(IRQn_Type eIrq)
+{
+    return (gui32NvicEnabled & (1UL << eIrq)) != 0;
+}
+
+static void sim_iom_isr(uint32_t ui32Module)
+{
+    static void (*const pfnIsr[AM_REG_IOM_NUM_MODULES])(void) = {
+        am_iomaster0_isr, am_iomaster1_isr, am_iomaster2_isr,
+        am_iomaster3_isr, am_iomaster4_isr, am_iomaster5_isr};
+    sim_iom_t *psIom = &gpsIom[ui32Module];
+    uint32_t ui32Status;
+
+    if (pfnIsr[ui32Module]) {
+        pfnIsr[ui32Module]();
+    }
+
+    // nobody took the interrupt, service it to avoid retriggering
+    if (psIom->ui32IntStatus) {
+        am_hal_iom_interrupt_status_get(psIom, false, &ui32Status);
+        am_hal_iom_interrupt_clear(psIom, ui32Status);
+        am_hal_iom_interrupt_service(psIom, ui32Status);
+    }
+}
+
+static void sim_gpio_isr(void)
+{
+    uint64_t ui64Status;
+
+    if (am_gpio_isr) {
+        am_gpio_isr();
+        return;
+    }
+
+    am_hal_gpio_interrupt_status_get(true, &ui64Status);
+    am_hal_gpio_interrupt_clear(ui64Status);
+    am_hal_gpio_interrupt_service(ui64Status);
+}
+
+// Takes pending interrupts in priority order as long as thread code is not
+// masking them.  Handlers do not nest, anything raised while one runs is
+// taken after it returns.
+static void sim_interrupt_deliver(void)
+{
+    bool bTaken;
+
+    do {
+        bTaken = false;
+
+        if (gui32Primask || gui32Basepri || gui32Ipsr) {
+            return;
+        }
+
+        for (uint32_t i = 0; i < AM_REG_IOM_NUM_MODULES; i++) {
+            IRQn_Type eIrq = (IRQn_Type)(IOMSTR0_IRQn + i);
+            sim_iom_t *psIom = &gpsIom[i];
+
+            if (psIom->bInitialized && psIom->ui32IntStatus &&
+                sim_irq_enabled(eIrq)) {
+                gui32Ipsr = eIrq + 16;
+                sim_iom_isr(i);
+                gui32Ipsr = 0;
+                bTaken = true;
+                break;
+            }
+        }
+
+        if (!bTaken && (gui64GpioStatus & gui64GpioEnabled) &&
+            sim_irq_enabled(GPIO_IRQn)) {
+            gui32Ipsr = GPIO_IRQn + 16;
+            sim_gpio_isr();
+            gui32Ipsr = 0;
+            bTaken = true;
+        }
+    } while (bTaken);
+}
+
+void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    gui32NvicEnabled |= 1UL << IRQn;
+    sim_interrupt_deliver();
+}
+
+void NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    gui32NvicEnabled &= ~(1UL << IRQn);
+}
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority)
+{
+}
+
+uint32_t __get_IPSR(void)
+{
+    return gui32Ipsr;
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return gui32Primask;
+}
+
+uint32_t __get_BASEPRI(void)
+{
+    return gui32Basepri;
+}
+
+void __set_BASEPRI(uint32_t basePri)
+{
+    gui32Basepri = basePri;
+    sim_interrupt_deliver();
+}
+
+uint32_t am_hal_interrupt_master_disable(void)
+{
+    uint32_t ui32State = gui32Primask;
+
+    gui32Primask = 1;
+    return ui32State;
+}
+
+uint32_t am_hal_interrupt_master_enable(void)
+{
+    uint32_t ui32State = gui32Primask;
+
+    gui32Primask = 0;
+    sim_interrupt_deliver();
+    return ui32State;
+}
+
+void am_hal_interrupt_master_set(uint32_t ui32InterruptState)
+{
+    gui32Primask = ui32InterruptState ? 1 : 0;
+    sim_interrupt_deliver();
+}
+
+//
+// Timers
+//
+uint32_t am_hal_stimer_counter_get(void)
+{
+    return (uint32_t)((gui64Now * SIM_STIMER_FREQUENCY) / 1000000);
+}
+
+void am_util_delay_us(uint32_t ui32MicroSeconds)
+{
+    sim_time_advance(ui32MicroSeconds);
+}
+
+void am_util_delay_ms(uint32_t ui32MilliSeconds)
+{
+    sim_time_advance((uint64_t)ui32MilliSeconds * 1000);
+}
+
+//
+// GPIO
+//
+void sim_gpio_input_drive(uint32_t ui32Pin, bool bLevel)
+{
+    sim_gpio_t *psPin;
+    bool bEdge;
+
+    if (ui32Pin >= AM_HAL_GPIO_MAX_PADS) {
+        return;
+    }
+
+    // the first level driven is the initial state, not an edge
+    psPin = &gpsGpio[ui32Pin];
+    if (!psPin->bDriven || (psPin->bInput == bLevel)) {
+        psPin->bDriven = true;
+        psPin->bInput = bLevel;
+        return;
+    }
+
+    psPin->bInput = bLevel;
+
+    switch (psPin->sConfig.eIntDir) {
+    case AM_HAL_GPIO_PIN_INTDIR_LO2HI:
+        bEdge = bLevel;
+        break;
+    case AM_HAL_GPIO_PIN_INTDIR_HI2LO:
+        bEdge = !bLevel;
+        break;
+    case AM_HAL_GPIO_PIN_INTDIR_BOTH:
+        bEdge = true;
+        break;
+    default:
+        bEdge = false;
+        break;
+    }
+
+    // the raw status latches whether or not the interrupt is enabled
+    if (bEdge && psPin->sConfig.eGPInput) {
+        gui64GpioStatus |= AM_HAL_GPIO_BIT(ui32Pin);
+    }
+}
+
+static void sim_gpio_drive_event(void *pvContext, uint32_t ui32Arg)
+{
+    sim_gpio_input_drive((uint32_t)(uintptr_t)pvContext, ui32Arg != 0);
+}
+
+void sim_gpio_drive_at(uint32_t ui32Pin, bool bLevel, uint64_t ui64Time)
+{
+    sim_event_schedule(ui64Time, sim_gpio_drive_event,
+                       (void *)(uintptr_t)ui32Pin, bLevel);
+}
+
+uint32_t am_hal_gpio_pinconfig(uint32_t ui32Pin, am_hal_gpio_pincfg_t sPincfg)
+{
+    if (ui32Pin >= AM_HAL_GPIO_MAX_PADS) {
+        return AM_HAL_STATUS_OUT_OF_RANGE;
+    }
+
+    gpsGpio[ui32Pin].sConfig = sPincfg;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t sim_gpio_read_count(uint32_t ui32Pin)
+{
+    return (ui32Pin < AM_HAL_GPIO_MAX_PADS) ? gpsGpio[ui32Pin].ui32Reads : 0;
+}
+
+uint32_t am_hal_gpio_state_read(uint32_t ui32Pin,
+                                am_hal_gpio_read_type_e eReadType,
+                                uint32_t *pui32ReadState)
+{
+    sim_gpio_t *psPin;
+
+    if (ui32Pin >= AM_HAL_GPIO_MAX_PADS) {
+        return AM_HAL_STATUS_OUT_OF_RANGE;
+    }
+
+    sim_time_advance(SIM_GPIO_READ_US);
+
+    psPin = &gpsGpio[ui32Pin];
+    psPin->ui32Reads++;
+    switch (eReadType) {
+    case AM_HAL_GPIO_INPUT_READ:
+        *pui32ReadState = psPin->bDriven ? psPin->bInput : psPin->bOutput;
+        break;
+    case AM_HAL_GPIO_OUTPUT_READ:
+        *pui32ReadState = psPin->bOutput;
+        break;
+    case AM_HAL_GPIO_ENABLE_READ:
+        *pui32ReadState = psPin->sConfig.eGPOutcfg != 0;
+        break;
+    default:
+        return AM_HAL_STATUS_INVALID_ARG;
+    }
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_gpio_state_write(uint32_t ui32Pin,
+                                 am_hal_gpio_write_type_e eWriteType)
+{
+    sim_gpio_t *psPin;
+
+    if (ui32Pin >= AM_HAL_GPIO_MAX_PADS) {
+        return AM_HAL_STATUS_OUT_OF_RANGE;
+    }
+
+    psPin = &gpsGpio[ui32Pin];
+    switch (eWriteType) {
+    case AM_HAL_GPIO_OUTPUT_CLEAR:
+        psPin->bOutput = false;
+        break;
+    case AM_HAL_GPIO_OUTPUT_SET:
+        psPin->bOutput = true;
+        break;
+    case AM_HAL_GPIO_OUTPUT_TOGGLE:
+        psPin->bOutput = !psPin->bOutput;
+        break;
+    default:
+        return AM_HAL_STATUS_SUCCESS;
+    }
+
+    sim_sx1262_reset_drive(ui32Pin, psPin->bOutput);
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_gpio_interrupt_register(uint32_t ui32GPIONumber,
+                                        am_hal_gpio_handler_t pfnHandler)
+{
+    if (ui32GPIONumber >= AM_HAL_GPIO_MAX_PADS) {
+        return AM_HAL_STATUS_OUT_OF_RANGE;
+    }
+
+    gpsGpio[ui32GPIONumber].pfnHandler = pfnHandler;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_gpio_interrupt_enable(uint64_t ui64InterruptMask)
+{
+    gui64GpioEnabled |= ui64InterruptMask;
+    sim_interrupt_deliver();
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_gpio_interrupt_disable(uint64_t ui64InterruptMask)
+{
+    gui64GpioEnabled &= ~ui64InterruptMask;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_gpio_interrupt_clear(uint64_t ui64InterruptMask)
+{
+    gui64GpioStatus &= ~ui64InterruptMask;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_gpio_interrupt_status_get(bool bEnabledOnly,
+                                          uint64_t *pui64IntStatus)
+{
+    *pui64IntStatus = gui64GpioStatus;
+    if (bEnabledOnly) {
+        *pui64IntStatus &= gui64GpioEnabled;
+    }
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_gpio_interrupt_service(uint64_t ui64Status)
+{
+    for (uint32_t i = 0; i < AM_HAL_GPIO_MAX_PADS; i++) {
+        if ((ui64Status & AM_HAL_GPIO_BIT(i)) && gpsGpio[i].pfnHandler) {
+            gpsGpio[i].pfnHandler();
+        }
+    }
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+//
+// IOM
+//
+static sim_iom_t *sim_iom_get(void *pHandle)
+{
+    sim_iom_t *psIom = (sim_iom_t *)pHandle;
+
+    if ((psIom < gpsIom) || (psIom >= &gpsIom[AM_REG_IOM_NUM_MODULES]) ||
+        !psIom->bInitialized) {
+        return NULL;
+    }
+
+    return psIom;
+}
+
+static uint64_t sim_iom_duration(sim_iom_t *psIom,
+                                 const am_hal_iom_transfer_t *psTransfer)
+{
+    uint64_t ui64Bits =
+        8 * (uint64_t)(psTransfer->ui32InstrLen + psTransfer->ui32NumBytes);
+
+    return SIM_IOM_SETUP_US +
+           (ui64Bits * 1000000 + psIom->ui32Clock - 1) / psIom->ui32Clock;
+}
+
+// Clocks the instruction, most significant byte first, and the data
+// through the selected radio.  Nothing answers on an empty chip select.
+static void sim_iom_exchange(sim_iom_t *psIom,
+                             const am_hal_iom_transfer_t *psTransfer)
+{
+    const uint8_t *pui8Tx = (const uint8_t *)psTransfer->pui32TxBuffer;
+    uint8_t *pui8Rx = (uint8_t *)psTransfer->pui32RxBuffer;
+    sim_sx1262_t *psNode;
+
+    if (!psIom->bFrameOpen) {
+        psIom->bFrameOpen = true;
+        psIom->psSelected = sim_sx1262_find(
+            psIom->ui32Module, psTransfer->uPeerInfo.ui32SpiChipSelect);
+        if (psIom->psSelected) {
+            sim_sx1262_select(psIom->psSelected);
+        }
+    }
+    psNode = psIom->psSelected;
+
+    for (uint32_t i = psTransfer->ui32InstrLen; i > 0; i--) {
+        uint8_t ui8Byte = (psTransfer->ui32Instr >> (8 * (i - 1))) & 0xFF;
+
+        if (psNode) {
+            sim_sx1262_exchange(psNode, ui8Byte, psIom->ui32Clock);
+        }
+    }
+
+    for (uint32_t i = 0; i < psTransfer->ui32NumBytes; i++) {
+        bool bTx = psTransfer->eDirection == AM_HAL_IOM_TX;
+        uint8_t ui8Mosi = bTx ? pui8Tx[i] : 0x00;
+        uint8_t ui8Miso = 0xFF;
+
+        if (psNode) {
+            ui8Miso = sim_sx1262_exchange(psNode, ui8Mosi, psIom->ui32Clock);
+        }
+
+        if (!bTx) {
+            pui8Rx[i] = ui8Miso;
+        }
+    }
+
+    if (!psTransfer->bContinue) {
+        psIom->bFrameOpen = false;
+        psIom->psSelected = NULL;
+        if (psNode) {
+            sim_sx1262_deselect(psNode);
+        }
+    }
+}
+
+static void sim_iom_complete(void *pvContext, uint32_t ui32Arg)
+{
+    sim_iom_t *psIom = (sim_iom_t *)pvContext;
+    sim_iom_command_t *psCommand = &psIom->psPending[psIom->ui32PendingHead];
+
+    if (!psIom->bInitialized || (psIom->ui32PendingCount == 0)) {
+        return;
+    }
+
+    sim_iom_exchange(psIom, &psCommand->sTransfer);
+
+    if (psIom->ui32DoneCount < SIM_IOM_QUEUE_SIZE) {
+        uint32_t ui32Tail = (psIom->ui32DoneHead + psIom->ui32DoneCount) %
+                            SIM_IOM_QUEUE_SIZE;
+        psIom->psDone[ui32Tail] = *psCommand;
+        psIom->ui32DoneCount++;
+    }
+    psIom->ui32IntStatus |= AM_HAL_IOM_INT_CMDCMP;
+
+    psIom->ui32PendingHead = (psIom->ui32PendingHead + 1) % SIM_IOM_QUEUE_SIZE;
+    psIom->ui32PendingCount--;
+
+    if (psIom->ui32PendingCount) {
+        psCommand = &psIom->psPending[psIom->ui32PendingHead];
+        sim_event_schedule(gui64Now +
+                               sim_iom_duration(psIom, &psCommand->sTransfer),
+                           sim_iom_complete, psIom, 0);
+    }
+}
+
+uint32_t am_hal_iom_initialize(uint32_t ui32Module, void **ppHandle)
+{
+    sim_iom_t *psIom;
+
+    if (ui32Module >= AM_REG_IOM_NUM_MODULES) {
+        return AM_HAL_STATUS_OUT_OF_RANGE;
+    }
+
+    psIom = &gpsIom[ui32Module];
+    if (psIom->bInitialized) {
+        return AM_HAL_STATUS_INVALID_OPERATION;
+    }
+
+    memset(psIom, 0, sizeof(sim_iom_t));
+    psIom->bInitialized = true;
+    psIom->ui32Module = ui32Module;
+    psIom->ui32Clock = AM_HAL_IOM_1MHZ;
+    *ppHandle = psIom;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_iom_uninitialize(void *pHandle)
+{
+    sim_iom_t *psIom = sim_iom_get(pHandle);
+
+    if (!psIom) {
+        return AM_HAL_STATUS_INVALID_HANDLE;
+    }
+
+    psIom->bInitialized = false;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_iom_power_ctrl(void *pHandle,
+                               am_hal_sysctrl_power_state_e ePowerState,
+                               bool bRetainState)
+{
+    // also called on a handle that has just been uninitialized
+    return pHandle ? AM_HAL_STATUS_SUCCESS : AM_HAL_STATUS_INVALID_HANDLE;
+}
+
+uint32_t am_hal_iom_configure(void *pHandle, am_hal_iom_config_t *psConfig)
+{
+    sim_iom_t *psIom = sim_iom_get(pHandle);
+
+    if (!psIom) {
+        return AM_HAL_STATUS_INVALID_HANDLE;
+    }
+
+    if (psIom->bEnabled) {
+        return AM_HAL_STATUS_INVALID_OPERATION;
+    }
+
+    if ((psConfig->ui32ClockFreq == 0) ||
+        (psConfig->ui32ClockFreq > AM_HAL_IOM_48MHZ)) {
+        return AM_HAL_STATUS_OUT_OF_RANGE;
+    }
+
+    psIom->ui32Clock = psConfig->ui32ClockFreq;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_iom_enable(void *pHandle)
+{
+    sim_iom_t *psIom = sim_iom_get(pHandle);
+
+    if (!psIom) {
+        return AM_HAL_STATUS_INVALID_HANDLE;
+    }
+
+    psIom->bEnabled = true;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_iom_disable(void *pHandle)
+{
+    sim_iom_t *psIom = (sim_iom_t *)pHandle;
+
+    if (!psIom) {
+        return AM_HAL_STATUS_INVALID_HANDLE;
+    }
+
+    psIom->bEnabled = false;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+// The bus is held for the transfer time, interrupts raised meanwhile are
+// taken before the call returns.
+uint32_t am_hal_iom_blocking_transfer(void *pHandle,
+                                      am_hal_iom_transfer_t *psTransaction)
+{
+    sim_iom_t *psIom = sim_iom_get(pHandle);
+
+    if (!psIom) {
+        return AM_HAL_STATUS_INVALID_HANDLE;
+    }
+
+    if (!psIom->bEnabled || psIom->ui32PendingCount) {
+        return AM_HAL_STATUS_INVALID_OPERATION;
+    }
+
+    sim_iom_exchange(psIom, psTransaction);
+    sim_time_advance(sim_iom_duration(psIom, psTransaction));
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+// Buffers must stay valid until the callback, the data is clocked at the
+// end of the transfer time.
+uint32_t am_hal_iom_nonblocking_transfer(void *pHandle,
+                                         am_hal_iom_transfer_t *psTransaction,
+                                         am_hal_iom_callback_t pfnCallback,
+                                         void *pCallbackCtxt)
+{
+    sim_iom_t *psIom = sim_iom_get(pHandle);
+    sim_iom_command_t *psCommand;
+
+    if (!psIom) {
+        return AM_HAL_STATUS_INVALID_HANDLE;
+    }
+
+    if (!psIom->bEnabled) {
+        return AM_HAL_STATUS_INVALID_OPERATION;
+    }
+
+    if (psIom->ui32PendingCount >= SIM_IOM_QUEUE_SIZE) {
+        return AM_HAL_STATUS_OUT_OF_RANGE;
+    }
+
+    psCommand = &psIom->psPending[(psIom->ui32PendingHead +
+                                   psIom->ui32PendingCount) %
+                                  SIM_IOM_QUEUE_SIZE];
+    psCommand->sTransfer = *psTransaction;
+    psCommand->pfnCallback = pfnCallback;
+    psCommand->pvContext = pCallbackCtxt;
+
+    if (psIom->ui32PendingCount++ == 0) {
+        sim_event_schedule(gui64Now + sim_iom_duration(psIom, psTransaction),
+                           sim_iom_complete, psIom, 0);
+    }
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_iom_interrupt_enable(void *pHandle, uint32_t ui32IntMask)
+{
+    sim_iom_t *psIom = sim_iom_get(pHandle);
+
+    if (!psIom) {
+        return AM_HAL_STATUS_INVALID_HANDLE;
+    }
+
+    psIom->ui32IntEnable |= ui32IntMask;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_iom_interrupt_disable(void *pHandle, uint32_t ui32IntMask)
+{
+    sim_iom_t *psIom = sim_iom_get(pHandle);
+
+    if (!psIom) {
+        return AM_HAL_STATUS_INVALID_HANDLE;
+    }
+
+    psIom->ui32IntEnable &= ~ui32IntMask;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+// command completion is always enabled while non-blocking transfers run
+uint32_t am_hal_iom_interrupt_status_get(void *pHandle, bool bEnabledOnly,
+                                         uint32_t *pui32IntStatus)
+{
+    sim_iom_t *psIom = sim_iom_get(pHandle);
+
+    if (!psIom) {
+        return AM_HAL_STATUS_INVALID_HANDLE;
+    }
+
+    *pui32IntStatus = psIom->ui32IntStatus;
+    if (bEnabledOnly) {
+        *pui32IntStatus &= psIom->ui32IntEnable | AM_HAL_IOM_INT_CMDCMP;
+    }
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_iom_interrupt_clear(void *pHandle, uint32_t ui32IntMask)
+{
+    sim_iom_t *psIom = sim_iom_get(pHandle);
+
+    if (!psIom) {
+        return AM_HAL_STATUS_INVALID_HANDLE;
+    }
+
+    psIom->ui32IntStatus &= ~ui32IntMask;
+
+    return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_iom_interrupt_service(void *pHandle, uint32_t ui32IntMask)
+{
+    sim_iom_t *psIom = sim_iom_get(pHandle);
+
+    if (!psIom) {
+        return AM_HAL_STATUS_INVALID_HANDLE;
+    }
+
+    if (!(ui32IntMask & AM_HAL_IOM_INT_CMDCMP)) {
+        return AM_HAL_STATUS_SUCCESS;
+    }
+
+    // a callback may queue further transfers
+    while (psIom->ui32DoneCount) {
+        sim_iom_command_t sCommand = psIom->psDone[psIom->ui32DoneHead];
+
+        psIom->ui32DoneHead = (psIom->ui32DoneHead + 1) % SIM_IOM_QUEUE_SIZE;
+        psIom->ui32DoneCount--;
+
+        if (sCommand.pfnCallback) {
+            sCommand.pfnCallback(sCommand.pvContext, AM_HAL_STATUS_SUCCESS);
+        }
+    }
+
+    return AM_HAL_STATUS_SUCCESS;
+}
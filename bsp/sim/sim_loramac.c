@@ -0,0 +1,92 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+// The LoRaMac-node pieces the NM180100 board layer calls back into, so that
+// sx1262-board.c runs unchanged against the simulated radios.  The driver
+// functions follow sx126x.c of LoRaMac-node for the SX1262, the critical
+// section ones board.c of the NM180100.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <am_mcu_apollo.h>
+
+#include <sx126x-board.h>
+#include <utilities.h>
+
+void BoardCriticalSectionBegin(uint32_t *mask)
+{
+    *mask = am_hal_interrupt_master_disable();
+}
+
+void BoardCriticalSectionEnd(uint32_t *mask)
+{
+    am_hal_interrupt_master_set(*mask);
+}
+
+void SX126xCheckDeviceReady(void)
+{
+    RadioOperatingModes_t eMode = SX126xGetOperatingMode();
+
+    if ((eMode == MODE_SLEEP) || (eMode == MODE_RX_DC)) {
+        SX126xWakeup();
+        SX126xAntSwOn();
+    }
+    SX126xWaitOnBusy();
+}
+
+void SX126xSetDio2AsRfSwitchCtrl(uint8_t enable)
+{
+    SX126xWriteCommand(RADIO_SET_RFSWITCHMODE, &enable, 1);
+}
+
+void SX126xSetTxParams(int8_t power, RadioRampTimes_t rampTime)
+{
+    uint8_t pui8PaConfig[4] = {0x04, 0x07, 0x00, 0x01};
+    uint8_t pui8Buffer[2];
+
+    // better resistance to antenna mismatch, DS_SX1261-2 V1.2 section 15.2
+    SX126xWriteRegister(REG_TX_CLAMP_CFG,
+                        SX126xReadRegister(REG_TX_CLAMP_CFG) | (0x0F << 1));
+
+    SX126xWriteCommand(RADIO_SET_PACONFIG, pui8PaConfig, 4);
+    if (power > 22) {
+        power = 22;
+    } else if (power < -9) {
+        power = -9;
+    }
+    // 160 mA for the whole device
+    SX126xWriteRegister(REG_OCP, 0x38);
+
+    pui8Buffer[0] = power;
+    pui8Buffer[1] = (uint8_t)rampTime;
+    SX126xWriteCommand(RADIO_SET_TXPARAMS, pui8Buffer, 2);
+}
@@ -0,0 +1,123 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SIM_PRIVATE_H
+#define SIM_PRIVATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sim.h"
+
+//
+// virtual clock, events at the same time run in the order scheduled
+//
+typedef void (*sim_event_handler_t)(void *pvContext, uint32_t ui32Arg);
+
+void sim_event_schedule(uint64_t ui64Time, sim_event_handler_t pfnHandler,
+                        void *pvContext, uint32_t ui32Arg);
+
+//
+// emulated peripherals
+//
+// level of an input pin driven by a simulated device
+void sim_gpio_input_drive(uint32_t ui32Pin, bool bLevel);
+
+//
+// SX1262 model
+//
+typedef struct sim_sx1262 sim_sx1262_t;
+
+void sim_sx1262_init(void);
+sim_sx1262_t *sim_sx1262_find(uint32_t ui32Module, uint32_t ui32ChipSelect);
+
+// one NSS frame: select, one exchange per byte, deselect
+void sim_sx1262_select(sim_sx1262_t *psNode);
+uint8_t sim_sx1262_exchange(sim_sx1262_t *psNode, uint8_t ui8Mosi,
+                            uint32_t ui32Clock);
+void sim_sx1262_deselect(sim_sx1262_t *psNode);
+
+// NRESET written by the host
+void sim_sx1262_reset_drive(uint32_t ui32Pin, bool bLevel);
+
+//
+// virtual channel
+//
+#define SIM_CHANNEL_TRANSMISSIONS 32
+#define SIM_CHANNEL_FOREVER UINT64_MAX
+
+typedef struct {
+    bool bActive;
+    bool bCarrier; // unmodulated, interferes but cannot be received
+    int32_t i32Source;
+    uint64_t ui64Start;
+    uint64_t ui64End;
+
+    uint32_t ui32Frequency;
+    uint32_t ui32Bandwidth;
+    uint8_t ui8SpreadingFactor;
+    uint8_t ui8CodingRate;
+    bool bLowDataRate;
+    uint16_t ui16Preamble;
+    bool bImplicitHeader;
+    bool bCrc;
+    bool bInvertIq;
+    uint16_t ui16SyncWord;
+    int8_t i8Power;
+
+    uint8_t ui8Length;
+    uint8_t pui8Payload[256];
+} sim_transmission_t;
+
+void sim_channel_init(void);
+void sim_channel_position_set(int32_t i32Node, double dX, double dY);
+
+sim_transmission_t *sim_channel_begin(void);
+void sim_channel_end(sim_transmission_t *psTransmission);
+sim_transmission_t *sim_channel_get(uint32_t ui32Index);
+
+// received power in dBm of a transmission at a node
+double sim_channel_power(const sim_transmission_t *psTransmission,
+                         int32_t i32Node);
+double sim_channel_noise(uint32_t ui32Bandwidth);
+double sim_channel_snr_floor(uint8_t ui8SpreadingFactor);
+
+// true if the transmission falls into a receiver's band
+bool sim_channel_overlaps(const sim_transmission_t *psTransmission,
+                          uint32_t ui32Frequency, uint32_t ui32Bandwidth);
+
+// true if an interferer received at dInterference destroys a packet
+// received at dSignal
+bool sim_channel_collides(double dSignal, uint8_t ui8SpreadingFactor,
+                          double dInterference,
+                          const sim_transmission_t *psInterferer);
+
+#endif // SIM_PRIVATE_H
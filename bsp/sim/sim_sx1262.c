@@ -0,0 +1,1527 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <math.h>
+#include <string.h>
+
+#include "am_mcu_apollo.h"
+
+#include "sim_private.h"
+
+// commands (SX1261/2 datasheet, chapter 13)
+#define CMD_RESETSTATS 0x00
+#define CMD_CLEARIRQSTATUS 0x02
+#define CMD_CLEARDEVICEERRORS 0x07
+#define CMD_SETDIOIRQPARAMS 0x08
+#define CMD_WRITEREGISTER 0x0D
+#define CMD_WRITEBUFFER 0x0E
+#define CMD_GETSTATS 0x10
+#define CMD_GETPACKETTYPE 0x11
+#define CMD_GETIRQSTATUS 0x12
+#define CMD_GETRXBUFFERSTATUS 0x13
+#define CMD_GETPACKETSTATUS 0x14
+#define CMD_GETRSSIINST 0x15
+#define CMD_GETDEVICEERRORS 0x17
+#define CMD_READREGISTER 0x1D
+#define CMD_READBUFFER 0x1E
+#define CMD_SETSTANDBY 0x80
+#define CMD_SETRX 0x82
+#define CMD_SETTX 0x83
+#define CMD_SETSLEEP 0x84
+#define CMD_SETRFFREQUENCY 0x86
+#define CMD_SETCADPARAMS 0x88
+#define CMD_CALIBRATE 0x89
+#define CMD_SETPACKETTYPE 0x8A
+#define CMD_SETMODULATIONPARAMS 0x8B
+#define CMD_SETPACKETPARAMS 0x8C
+#define CMD_SETTXPARAMS 0x8E
+#define CMD_SETBUFFERBASEADDRESS 0x8F
+#define CMD_SETRXTXFALLBACKMODE 0x93
+#define CMD_SETRXDUTYCYCLE 0x94
+#define CMD_SETPACONFIG 0x95
+#define CMD_SETREGULATORMODE 0x96
+#define CMD_SETDIO3ASTCXOCTRL 0x97
+#define CMD_CALIBRATEIMAGE 0x98
+#define CMD_SETDIO2ASRFSWITCHCTRL 0x9D
+#define CMD_STOPTIMERONPREAMBLE 0x9F
+#define CMD_SETLORASYMBNUMTIMEOUT 0xA0
+#define CMD_GETSTATUS 0xC0
+#define CMD_SETFS 0xC1
+#define CMD_SETCAD 0xC5
+#define CMD_SETTXCONTINUOUSWAVE 0xD1
+#define CMD_SETTXINFINITEPREAMBLE 0xD2
+
+#define REG_LORASYNCTIMEOUT 0x0706
+#define REG_LORASYNCWORDMSB 0x0740
+#define REG_LORASYNCWORDLSB 0x0741
+#define REG_RXGAIN 0x08AC
+#define REG_OCPCONFIG 0x08E7
+#define REG_XTATRIM 0x0911
+#define REG_XTBTRIM 0x0912
+#define REG_RANDOMNUMBERGEN0 0x0819
+#define REG_RANDOMNUMBERGEN3 0x081C
+
+#define IRQ_TXDONE 0x0001
+#define IRQ_RXDONE 0x0002
+#define IRQ_PREAMBLEDETECTED 0x0004
+#define IRQ_HEADERVALID 0x0010
+#define IRQ_CRCERR 0x0040
+#define IRQ_CADDONE 0x0080
+#define IRQ_CADDETECTED 0x0100
+#define IRQ_TIMEOUT 0x0200
+
+// chip mode and command status fields of the status byte
+#define STATUS_MODE_STDBY_RC 0x2
+#define STATUS_MODE_STDBY_XOSC 0x3
+#define STATUS_MODE_FS 0x4
+#define STATUS_MODE_RX 0x5
+#define STATUS_MODE_TX 0x6
+#define STATUS_CMD_DATA_AVAILABLE 0x2
+#define STATUS_CMD_TIMEOUT 0x3
+#define STATUS_CMD_ERROR 0x4
+#define STATUS_CMD_TX_DONE 0x6
+
+#define PACKET_TYPE_LORA 0x01
+
+#define FALLBACK_FS 0x40
+#define FALLBACK_STDBY_XOSC 0x30
+#define FALLBACK_STDBY_RC 0x20
+
+#define SLEEP_WARM 0x04
+
+#define RX_SINGLE 0x000000
+#define RX_CONTINUOUS 0xFFFFFF
+#define CAD_EXIT_RX 0x01
+
+// BUSY high times in us, estimated from the datasheet switching times
+#define SIM_BUSY_ACCESS_US 1
+#define SIM_BUSY_COMMAND_US 5
+#define SIM_BUSY_STANDBY_US 30
+#define SIM_BUSY_FS_US 50
+#define SIM_BUSY_TX_US 120
+#define SIM_BUSY_RX_US 90
+#define SIM_BUSY_CALIBRATE_US 3500
+#define SIM_BUSY_IMAGE_US 2500
+#define SIM_BUSY_BOOT_US 3500
+#define SIM_BUSY_WAKE_WARM_US 340
+#define SIM_BUSY_WAKE_COLD_US 3500
+
+// symbols the demodulator needs to lock on a preamble
+#define SIM_LOCK_SYMBOLS 4
+
+#define SIM_REGISTER_SIZE 0x1000
+#define SIM_FRAME_SIZE 264
+#define SIM_RESPONSE_SIZE 8
+
+// timeouts and periods are counted in 15.625 us steps
+#define SIM_STEPS_TO_US(x) (((uint64_t)(x) * 15625) / 1000)
+
+typedef enum {
+    SIM_MODE_RESET,
+    SIM_MODE_SLEEP,
+    SIM_MODE_STDBY_RC,
+    SIM_MODE_STDBY_XOSC,
+    SIM_MODE_FS,
+    SIM_MODE_TX,
+    SIM_MODE_TX_CW,
+    SIM_MODE_RX,
+    SIM_MODE_RX_DUTY,
+    SIM_MODE_CAD,
+} sim_mode_e;
+
+struct sim_sx1262 {
+    bool bUsed;
+    int32_t i32Index;
+    sim_sx1262_config_t sConfig;
+    sim_sx1262_stats_t sStats;
+
+    sim_mode_e eMode;
+    uint32_t ui32Generation; // events of an earlier mode are dropped
+    uint64_t ui64BusyUntil;
+    bool bBusy;
+    // recorded BUSY times replayed in place of the model, not copied
+    const uint32_t *pui32BusyTrace;
+    uint32_t ui32BusyTraceLength;
+    uint32_t ui32BusyTraceIndex;
+    bool bWarmStart;
+    uint8_t ui8CommandStatus;
+
+    // NSS frame
+    bool bSelected;
+    bool bIgnored;
+    uint32_t ui32FrameLength;
+    uint8_t pui8Frame[SIM_FRAME_SIZE];
+    uint8_t pui8Response[SIM_RESPONSE_SIZE];
+
+    uint8_t pui8Register[SIM_REGISTER_SIZE];
+    uint8_t pui8Buffer[256];
+    uint32_t ui32Noise; // receiver noise behind the random number registers
+
+    // configuration
+    uint8_t ui8PacketType;
+    uint8_t pui8Modulation[8];
+    uint8_t pui8Packet[9];
+    uint8_t pui8Cad[7];
+    uint32_t ui32Frequency;
+    int8_t i8Power;
+    uint8_t ui8TxBase;
+    uint8_t ui8RxBase;
+    uint8_t ui8Fallback;
+    uint16_t ui16IrqMask;
+    uint16_t ui16Dio1Mask;
+    uint16_t ui16Dio3Mask;
+    uint16_t ui16Irq;
+    bool bStopOnPreamble;
+
+    // last reception
+    uint8_t ui8RxLength;
+    uint8_t ui8RxStart;
+    uint8_t ui8RssiPacket;
+    int8_t i8SnrPacket;
+    uint8_t ui8SignalRssiPacket;
+    uint16_t ui16PacketsReceived;
+    uint16_t ui16CrcErrors;
+    uint16_t ui16HeaderErrors;
+
+    // radio activity
+    uint32_t ui32Timeout;
+    uint32_t ui32RxPeriod;
+    uint32_t ui32SleepPeriod;
+    bool bListening;
+    bool bDutyAsleep;
+    bool bTimerRunning;
+    sim_transmission_t *psTransmission;
+
+    // packet the receiver is locking or locked on
+    sim_transmission_t *psLock;
+    uint32_t ui32LockSequence;
+    bool bLocked;
+    bool bCorrupt;
+    double dSignal;
+};
+
+static sim_sx1262_t gpsNodes[SIM_SX1262_NODES_MAX];
+
+// bandwidth register values 0x00 to 0x0A in Hz, 0 where undefined
+static const uint32_t pui32Bandwidth[] = {7810,   15630,  31250,  62500,
+                                          125000, 250000, 500000, 0,
+                                          10420,  20830,  41670};
+
+static void sim_sx1262_signal_start(sim_sx1262_t *psNode,
+                                    sim_transmission_t *psTransmission);
+static void sim_sx1262_signal_end(sim_sx1262_t *psNode,
+                                  sim_transmission_t *psTransmission,
+                                  bool bAborted);
+
+//
+// LoRa timing of the programmed modulation
+//
+static uint8_t sim_sx1262_sf(sim_sx1262_t *psNode)
+{
+    return psNode->pui8Modulation[0];
+}
+
+static uint32_t sim_sx1262_bandwidth(sim_sx1262_t *psNode)
+{
+    uint8_t ui8Bw = psNode->pui8Modulation[1];
+
+    if (ui8Bw >= sizeof(pui32Bandwidth) / sizeof(pui32Bandwidth[0]) ||
+        pui32Bandwidth[ui8Bw] == 0) {
+        return 125000;
+    }
+
+    return pui32Bandwidth[ui8Bw];
+}
+
+static double sim_sx1262_symbol_us(uint8_t ui8Sf, uint32_t ui32Bandwidth)
+{
+    return ldexp(1000000.0, ui8Sf) / ui32Bandwidth;
+}
+
+// SX1261/2 datasheet, section 6.1.4
+static uint64_t sim_sx1262_time_on_air(const sim_transmission_t *psTx)
+{
+    int32_t i32Sf = psTx->ui8SpreadingFactor;
+    int32_t i32Bits, i32Divisor, i32Symbols = 8;
+    double dQuarterSymbols;
+
+    i32Bits = 8 * psTx->ui8Length - 4 * i32Sf;
+    i32Bits += psTx->bCrc ? 16 : 0;
+    i32Bits += psTx->bImplicitHeader ? 0 : 20;
+
+    if (i32Sf < 7) {
+        dQuarterSymbols = 4.0 * psTx->ui16Preamble + 25;
+    } else {
+        i32Bits += 8;
+        dQuarterSymbols = 4.0 * psTx->ui16Preamble + 17;
+    }
+
+    i32Divisor = 4 * (i32Sf - (psTx->bLowDataRate ? 2 : 0));
+    if ((i32Bits > 0) && (i32Divisor > 0)) {
+        i32Symbols += ((i32Bits + i32Divisor - 1) / i32Divisor) *
+                      (psTx->ui8CodingRate + 4);
+    }
+    dQuarterSymbols += 4.0 * i32Symbols;
+
+    return (uint64_t)(dQuarterSymbols *
+                      sim_sx1262_symbol_us(i32Sf, psTx->ui32Bandwidth) / 4);
+}
+
+// The command value is converted by the chip to mantissa and exponent in
+// REG_LORASYNCTIMEOUT, which may be written directly as well.
+static uint32_t sim_sx1262_symbol_timeout(sim_sx1262_t *psNode)
+{
+    uint8_t ui8Reg = psNode->pui8Register[REG_LORASYNCTIMEOUT];
+
+    return (uint32_t)(ui8Reg >> 3) << (2 * (ui8Reg & 0x7) + 1);
+}
+
+//
+// pins
+//
+static bool sim_sx1262_busy(sim_sx1262_t *psNode)
+{
+    return (psNode->eMode == SIM_MODE_RESET) ||
+           (psNode->eMode == SIM_MODE_SLEEP) || psNode->bDutyAsleep ||
+           (sim_time_get() < psNode->ui64BusyUntil);
+}
+
+static void sim_sx1262_busy_update(sim_sx1262_t *psNode)
+{
+    bool bBusy = sim_sx1262_busy(psNode);
+
+    if (bBusy != psNode->bBusy) {
+        psNode->bBusy = bBusy;
+        sim_gpio_input_drive(psNode->sConfig.ui32PinBusy, bBusy);
+    }
+}
+
+static void sim_sx1262_busy_end(void *pvContext, uint32_t ui32Arg)
+{
+    sim_sx1262_busy_update((sim_sx1262_t *)pvContext);
+}
+
+static void sim_sx1262_busy_set(sim_sx1262_t *psNode, uint32_t ui32Us)
+{
+    uint64_t ui64Until = sim_time_get() + ui32Us;
+
+    if (ui64Until > psNode->ui64BusyUntil) {
+        psNode->ui64BusyUntil = ui64Until;
+        sim_event_schedule(ui64Until, sim_sx1262_busy_end, psNode, 0);
+    }
+
+    sim_sx1262_busy_update(psNode);
+}
+
+static void sim_sx1262_dio_update(sim_sx1262_t *psNode)
+{
+    sim_gpio_input_drive(psNode->sConfig.ui32PinDio1,
+                         (psNode->ui16Irq & psNode->ui16Dio1Mask) != 0);
+    sim_gpio_input_drive(psNode->sConfig.ui32PinDio3,
+                         (psNode->ui16Irq & psNode->ui16Dio3Mask) != 0);
+}
+
+// only interrupts enabled in the IRQ mask are latched
+static void sim_sx1262_irq_raise(sim_sx1262_t *psNode, uint16_t ui16Irq)
+{
+    psNode->ui16Irq |= ui16Irq & psNode->ui16IrqMask;
+    sim_sx1262_dio_update(psNode);
+}
+
+//
+// modes
+//
+static void sim_sx1262_defaults(sim_sx1262_t *psNode)
+{
+    memset(psNode->pui8Register, 0, SIM_REGISTER_SIZE);
+    psNode->pui8Register[REG_LORASYNCWORDMSB] = 0x14;
+    psNode->pui8Register[REG_LORASYNCWORDLSB] = 0x24;
+    psNode->pui8Register[REG_RXGAIN] = 0x94;
+    psNode->pui8Register[REG_OCPCONFIG] = 0x18;
+    psNode->pui8Register[REG_XTATRIM] = 0x05;
+    psNode->pui8Register[REG_XTBTRIM] = 0x05;
+
+    psNode->ui8PacketType = 0;
+    memset(psNode->pui8Modulation, 0, sizeof(psNode->pui8Modulation));
+    memset(psNode->pui8Packet, 0, sizeof(psNode->pui8Packet));
+    memset(psNode->pui8Cad, 0, sizeof(psNode->pui8Cad));
+    psNode->ui32Frequency = 0;
+    psNode->i8Power = 0;
+    psNode->ui8TxBase = 0;
+    psNode->ui8RxBase = 0;
+    psNode->ui8Fallback = FALLBACK_STDBY_RC;
+    psNode->ui16IrqMask = 0;
+    psNode->ui16Dio1Mask = 0;
+    psNode->ui16Dio3Mask = 0;
+    psNode->ui16Irq = 0;
+    psNode->bStopOnPreamble = false;
+    psNode->ui16PacketsReceived = 0;
+    psNode->ui16CrcErrors = 0;
+    psNode->ui16HeaderErrors = 0;
+    psNode->ui8CommandStatus = 0;
+}
+
+static void sim_sx1262_lock_clear(sim_sx1262_t *psNode)
+{
+    psNode->psLock = NULL;
+    psNode->bLocked = false;
+    psNode->bCorrupt = false;
+    psNode->ui32LockSequence++;
+}
+
+// ends the own transmission, receivers of an aborted one lose the packet
+static void sim_sx1262_transmission_end(sim_sx1262_t *psNode, bool bAborted)
+{
+    sim_transmission_t *psTransmission = psNode->psTransmission;
+
+    if (!psTransmission) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < SIM_SX1262_NODES_MAX; i++) {
+        if (gpsNodes[i].bUsed && (&gpsNodes[i] != psNode)) {
+            sim_sx1262_signal_end(&gpsNodes[i], psTransmission, bAborted);
+        }
+    }
+
+    sim_channel_end(psTransmission);
+    psNode->psTransmission = NULL;
+}
+
+// Leaves the current mode.  Pending events are invalidated and anything on
+// the air is stopped.
+static void sim_sx1262_mode_set(sim_sx1262_t *psNode, sim_mode_e eMode)
+{
+    sim_sx1262_transmission_end(psNode, true);
+    sim_sx1262_lock_clear(psNode);
+
+    psNode->ui32Generation++;
+    psNode->bListening = false;
+    psNode->bDutyAsleep = false;
+    psNode->bTimerRunning = false;
+    psNode->eMode = eMode;
+
+    sim_sx1262_busy_update(psNode);
+}
+
+static void sim_sx1262_fallback(sim_sx1262_t *psNode)
+{
+    switch (psNode->ui8Fallback) {
+    case FALLBACK_FS:
+        sim_sx1262_mode_set(psNode, SIM_MODE_FS);
+        break;
+    case FALLBACK_STDBY_XOSC:
+        sim_sx1262_mode_set(psNode, SIM_MODE_STDBY_XOSC);
+        break;
+    default:
+        sim_sx1262_mode_set(psNode, SIM_MODE_STDBY_RC);
+        break;
+    }
+}
+
+static uint8_t sim_sx1262_status(sim_sx1262_t *psNode)
+{
+    uint8_t ui8Mode;
+
+    switch (psNode->eMode) {
+    case SIM_MODE_STDBY_XOSC:
+        ui8Mode = STATUS_MODE_STDBY_XOSC;
+        break;
+    case SIM_MODE_FS:
+        ui8Mode = STATUS_MODE_FS;
+        break;
+    case SIM_MODE_TX:
+    case SIM_MODE_TX_CW:
+        ui8Mode = STATUS_MODE_TX;
+        break;
+    case SIM_MODE_RX:
+    case SIM_MODE_RX_DUTY:
+    case SIM_MODE_CAD:
+        ui8Mode = STATUS_MODE_RX;
+        break;
+    default:
+        ui8Mode = STATUS_MODE_STDBY_RC;
+        break;
+    }
+
+    return (ui8Mode << 4) | (psNode->ui8CommandStatus << 1);
+}
+
+//
+// transmission
+//
+static void sim_sx1262_tx_end(void *pvContext, uint32_t ui32Generation)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+
+    if (ui32Generation != psNode->ui32Generation) {
+        return;
+    }
+
+    sim_sx1262_transmission_end(psNode, false);
+    psNode->ui8CommandStatus = STATUS_CMD_TX_DONE;
+    sim_sx1262_irq_raise(psNode, IRQ_TXDONE);
+    sim_sx1262_fallback(psNode);
+}
+
+static void sim_sx1262_tx_timeout(void *pvContext, uint32_t ui32Generation)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+
+    if (ui32Generation != psNode->ui32Generation) {
+        return;
+    }
+
+    psNode->ui8CommandStatus = STATUS_CMD_TIMEOUT;
+    sim_sx1262_irq_raise(psNode, IRQ_TIMEOUT);
+    sim_sx1262_fallback(psNode);
+}
+
+static sim_transmission_t *sim_sx1262_transmission_begin(sim_sx1262_t *psNode)
+{
+    sim_transmission_t *psTx = sim_channel_begin();
+
+    if (!psTx) {
+        return NULL;
+    }
+
+    psTx->i32Source = psNode->i32Index;
+    psTx->ui64Start = sim_time_get();
+    psTx->ui32Frequency = psNode->ui32Frequency;
+    psTx->ui32Bandwidth = sim_sx1262_bandwidth(psNode);
+    psTx->ui8SpreadingFactor = sim_sx1262_sf(psNode);
+    psTx->ui8CodingRate = psNode->pui8Modulation[2];
+    psTx->bLowDataRate = psNode->pui8Modulation[3] != 0;
+    psTx->ui16Preamble = (psNode->pui8Packet[0] << 8) | psNode->pui8Packet[1];
+    psTx->bImplicitHeader = psNode->pui8Packet[2] != 0;
+    psTx->ui8Length = psNode->pui8Packet[3];
+    psTx->bCrc = psNode->pui8Packet[4] != 0;
+    psTx->bInvertIq = psNode->pui8Packet[5] != 0;
+    psTx->ui16SyncWord = (psNode->pui8Register[REG_LORASYNCWORDMSB] << 8) |
+                         psNode->pui8Register[REG_LORASYNCWORDLSB];
+    psTx->i8Power = psNode->i8Power;
+    psNode->psTransmission = psTx;
+
+    return psTx;
+}
+
+static void sim_sx1262_signal_broadcast(sim_sx1262_t *psNode)
+{
+    for (uint32_t i = 0; i < SIM_SX1262_NODES_MAX; i++) {
+        if (gpsNodes[i].bUsed && (&gpsNodes[i] != psNode)) {
+            sim_sx1262_signal_start(&gpsNodes[i], psNode->psTransmission);
+        }
+    }
+}
+
+static void sim_sx1262_tx_start(void *pvContext, uint32_t ui32Generation)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+    sim_transmission_t *psTx;
+    uint64_t ui64TimeOnAir;
+
+    if (ui32Generation != psNode->ui32Generation) {
+        return;
+    }
+
+    psTx = sim_sx1262_transmission_begin(psNode);
+    if (!psTx) {
+        sim_sx1262_fallback(psNode);
+        return;
+    }
+
+    for (uint32_t i = 0; i < psTx->ui8Length; i++) {
+        psTx->pui8Payload[i] =
+            psNode->pui8Buffer[(uint8_t)(psNode->ui8TxBase + i)];
+    }
+
+    ui64TimeOnAir = sim_sx1262_time_on_air(psTx);
+    psTx->ui64End = psTx->ui64Start + ui64TimeOnAir;
+    psNode->sStats.ui32TxPackets++;
+    psNode->sStats.ui64TxAirtime += ui64TimeOnAir;
+
+    sim_event_schedule(psTx->ui64End, sim_sx1262_tx_end, psNode,
+                       psNode->ui32Generation);
+    if (psNode->ui32Timeout) {
+        sim_event_schedule(psTx->ui64Start +
+                               SIM_STEPS_TO_US(psNode->ui32Timeout),
+                           sim_sx1262_tx_timeout, psNode,
+                           psNode->ui32Generation);
+    }
+
+    sim_sx1262_signal_broadcast(psNode);
+}
+
+static void sim_sx1262_carrier_start(void *pvContext, uint32_t ui32Generation)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+    sim_transmission_t *psTx;
+
+    if (ui32Generation != psNode->ui32Generation) {
+        return;
+    }
+
+    psTx = sim_sx1262_transmission_begin(psNode);
+    if (!psTx) {
+        return;
+    }
+
+    psTx->bCarrier = true;
+    psTx->ui64End = SIM_CHANNEL_FOREVER;
+
+    sim_sx1262_signal_broadcast(psNode);
+}
+
+//
+// reception
+//
+static bool sim_sx1262_compatible(sim_sx1262_t *psNode,
+                                  const sim_transmission_t *psTx)
+{
+    uint16_t ui16SyncWord = (psNode->pui8Register[REG_LORASYNCWORDMSB] << 8) |
+                            psNode->pui8Register[REG_LORASYNCWORDLSB];
+
+    return !psTx->bCarrier &&
+           (psTx->ui8SpreadingFactor == sim_sx1262_sf(psNode)) &&
+           (psTx->ui32Bandwidth == sim_sx1262_bandwidth(psNode)) &&
+           (psTx->bInvertIq == (psNode->pui8Packet[5] != 0)) &&
+           (psTx->ui16SyncWord == ui16SyncWord);
+}
+
+static void sim_sx1262_lock(void *pvContext, uint32_t ui32Sequence)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+    uint16_t ui16Irq = IRQ_PREAMBLEDETECTED;
+
+    if ((ui32Sequence != psNode->ui32LockSequence) || !psNode->psLock ||
+        !psNode->bListening) {
+        return;
+    }
+
+    // the header is not timed separately, the timer stops either way
+    psNode->bLocked = true;
+    psNode->bTimerRunning = false;
+    if (!psNode->psLock->bImplicitHeader) {
+        ui16Irq |= IRQ_HEADERVALID;
+    }
+    sim_sx1262_irq_raise(psNode, ui16Irq);
+}
+
+// Another transmission appeared in the band of a listening receiver.  A
+// compatible packet strong enough to demodulate is locked on after a few
+// preamble symbols, anything else interferes with the packet in progress.
+static void sim_sx1262_signal_start(sim_sx1262_t *psNode,
+                                    sim_transmission_t *psTx)
+{
+    bool bCompatible = sim_sx1262_compatible(psNode, psTx);
+    uint32_t ui32Bandwidth = sim_sx1262_bandwidth(psNode);
+    double dPower, dSymbolUs;
+    uint64_t ui64Lock;
+
+    if (!sim_channel_overlaps(psTx, psNode->ui32Frequency, ui32Bandwidth)) {
+        return;
+    }
+
+    if (!psNode->bListening) {
+        if (bCompatible) {
+            psNode->sStats.ui32MissedNotListening++;
+        }
+        return;
+    }
+
+    dPower = sim_channel_power(psTx, psNode->i32Index);
+
+    if (psNode->psLock) {
+        if (!psNode->bCorrupt &&
+            sim_channel_collides(psNode->dSignal, sim_sx1262_sf(psNode),
+                                 dPower, psTx)) {
+            psNode->bCorrupt = true;
+        }
+        if (bCompatible) {
+            psNode->sStats.ui32MissedReceiverBusy++;
+        }
+        return;
+    }
+
+    if (!bCompatible) {
+        return;
+    }
+
+    if (dPower - sim_channel_noise(ui32Bandwidth) <
+        sim_channel_snr_floor(psTx->ui8SpreadingFactor)) {
+        psNode->sStats.ui32MissedBelowSensitivity++;
+        return;
+    }
+
+    // too little of the preamble is left to synchronise on
+    dSymbolUs =
+        sim_sx1262_symbol_us(psTx->ui8SpreadingFactor, psTx->ui32Bandwidth);
+    ui64Lock = sim_time_get() + (uint64_t)(SIM_LOCK_SYMBOLS * dSymbolUs);
+    if (ui64Lock >
+        psTx->ui64Start + (uint64_t)(psTx->ui16Preamble * dSymbolUs)) {
+        psNode->sStats.ui32MissedNotListening++;
+        return;
+    }
+
+    sim_sx1262_lock_clear(psNode);
+    psNode->psLock = psTx;
+    psNode->dSignal = dPower;
+
+    // transmissions already on the air interfere from the start
+    for (uint32_t i = 0; i < SIM_CHANNEL_TRANSMISSIONS; i++) {
+        sim_transmission_t *psOther = sim_channel_get(i);
+
+        if (!psOther || (psOther == psTx) ||
+            (psOther->i32Source == psNode->i32Index) ||
+            !sim_channel_overlaps(psOther, psNode->ui32Frequency,
+                                  ui32Bandwidth)) {
+            continue;
+        }
+
+        if (sim_channel_collides(dPower, psTx->ui8SpreadingFactor,
+                                 sim_channel_power(psOther, psNode->i32Index),
+                                 psOther)) {
+            psNode->bCorrupt = true;
+        }
+    }
+
+    sim_event_schedule(ui64Lock, sim_sx1262_lock, psNode,
+                       psNode->ui32LockSequence);
+}
+
+static uint8_t sim_sx1262_rssi_encode(double dRssi)
+{
+    double dValue = -2.0 * dRssi;
+
+    return dValue < 0.0 ? 0 : dValue > 255.0 ? 255 : (uint8_t)dValue;
+}
+
+static void sim_sx1262_packet_receive(sim_sx1262_t *psNode,
+                                      const sim_transmission_t *psTx)
+{
+    double dNoise = sim_channel_noise(sim_sx1262_bandwidth(psNode));
+    double dSnr = psNode->dSignal - dNoise;
+    bool bImplicit = psNode->pui8Packet[2] != 0;
+    bool bCrc = bImplicit ? psNode->pui8Packet[4] != 0 : psTx->bCrc;
+    bool bCorrupt = psNode->bCorrupt;
+    uint8_t ui8Length = bImplicit ? psNode->pui8Packet[3] : psTx->ui8Length;
+    uint16_t ui16Irq = IRQ_RXDONE;
+
+    // an implicit header receiver decodes garbage if the settings differ
+    if (bImplicit &&
+        (!psTx->bImplicitHeader || (psTx->ui8Length != ui8Length) ||
+         (psTx->bCrc != bCrc) ||
+         (psTx->ui8CodingRate != psNode->pui8Modulation[2]))) {
+        bCorrupt = true;
+    }
+
+    for (uint32_t i = 0; i < ui8Length; i++) {
+        uint8_t ui8Byte = i < psTx->ui8Length ? psTx->pui8Payload[i] : 0;
+
+        if (bCorrupt && (i == ui8Length / 2)) {
+            ui8Byte ^= 0x5A;
+        }
+        psNode->pui8Buffer[(uint8_t)(psNode->ui8RxBase + i)] = ui8Byte;
+    }
+
+    psNode->ui8RxLength = ui8Length;
+    psNode->ui8RxStart = psNode->ui8RxBase;
+    psNode->ui8RssiPacket = sim_sx1262_rssi_encode(
+        10.0 * log10(pow(10.0, psNode->dSignal / 10.0) +
+                     pow(10.0, dNoise / 10.0)));
+    psNode->i8SnrPacket = dSnr < -32.0  ? -128
+                          : dSnr > 31.0 ? 127
+                                        : (int8_t)(4.0 * dSnr);
+    psNode->ui8SignalRssiPacket = sim_sx1262_rssi_encode(psNode->dSignal);
+
+    psNode->ui16PacketsReceived++;
+    psNode->sStats.ui32RxPackets++;
+    if (psNode->bCorrupt) {
+        psNode->sStats.ui32RxCollisions++;
+    }
+    if (bCorrupt && bCrc) {
+        psNode->ui16CrcErrors++;
+        psNode->sStats.ui32RxCrcErrors++;
+        ui16Irq |= IRQ_CRCERR;
+    }
+
+    psNode->ui8CommandStatus = STATUS_CMD_DATA_AVAILABLE;
+    sim_sx1262_irq_raise(psNode, ui16Irq);
+}
+
+// A transmission left the air.  A receiver locked on it delivers the
+// packet and stays listening only in continuous mode.
+static void sim_sx1262_signal_end(sim_sx1262_t *psNode,
+                                  sim_transmission_t *psTx, bool bAborted)
+{
+    if (psNode->psLock != psTx) {
+        return;
+    }
+
+    if (!psNode->bLocked || bAborted) {
+        sim_sx1262_lock_clear(psNode);
+        return;
+    }
+
+    sim_sx1262_packet_receive(psNode, psTx);
+    sim_sx1262_lock_clear(psNode);
+
+    if ((psNode->eMode == SIM_MODE_RX) &&
+        (psNode->ui32Timeout == RX_CONTINUOUS)) {
+        return;
+    }
+
+    sim_sx1262_fallback(psNode);
+}
+
+static void sim_sx1262_rx_timeout(void *pvContext, uint32_t ui32Generation)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+
+    if ((ui32Generation != psNode->ui32Generation) ||
+        !psNode->bTimerRunning) {
+        return;
+    }
+
+    psNode->sStats.ui32RxTimeouts++;
+    psNode->ui8CommandStatus = STATUS_CMD_TIMEOUT;
+    sim_sx1262_irq_raise(psNode, IRQ_TIMEOUT);
+    sim_sx1262_fallback(psNode);
+}
+
+// no preamble within the symbol timeout ends any reception, continuous or
+// not (SX1261/2 datasheet, 13.4.9)
+static void sim_sx1262_symbol_timeout_expired(void *pvContext,
+                                              uint32_t ui32Generation)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+
+    if ((ui32Generation != psNode->ui32Generation) || psNode->bLocked) {
+        return;
+    }
+
+    psNode->sStats.ui32RxTimeouts++;
+    psNode->ui8CommandStatus = STATUS_CMD_TIMEOUT;
+    sim_sx1262_irq_raise(psNode, IRQ_TIMEOUT);
+    sim_sx1262_fallback(psNode);
+}
+
+// starts listening and picks up packets whose preamble is still on the air
+static void sim_sx1262_listen(sim_sx1262_t *psNode)
+{
+    psNode->bListening = true;
+
+    for (uint32_t i = 0; i < SIM_CHANNEL_TRANSMISSIONS; i++) {
+        sim_transmission_t *psTx = sim_channel_get(i);
+
+        if (psTx && (psTx->i32Source != psNode->i32Index)) {
+            sim_sx1262_signal_start(psNode, psTx);
+        }
+    }
+}
+
+static void sim_sx1262_rx_begin(sim_sx1262_t *psNode, uint32_t ui32Timeout)
+{
+    uint32_t ui32Symbols = sim_sx1262_symbol_timeout(psNode);
+    uint64_t ui64Now = sim_time_get();
+
+    psNode->ui32Timeout = ui32Timeout;
+    if ((ui32Timeout != RX_SINGLE) && (ui32Timeout != RX_CONTINUOUS)) {
+        psNode->bTimerRunning = true;
+        sim_event_schedule(ui64Now + SIM_STEPS_TO_US(ui32Timeout),
+                           sim_sx1262_rx_timeout, psNode,
+                           psNode->ui32Generation);
+    }
+
+    if (ui32Symbols) {
+        double dSymbolUs = sim_sx1262_symbol_us(sim_sx1262_sf(psNode),
+                                                sim_sx1262_bandwidth(psNode));
+        sim_event_schedule(ui64Now + (uint64_t)(ui32Symbols * dSymbolUs),
+                           sim_sx1262_symbol_timeout_expired, psNode,
+                           psNode->ui32Generation);
+    }
+
+    sim_sx1262_listen(psNode);
+}
+
+static void sim_sx1262_rx_start(void *pvContext, uint32_t ui32Generation)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+
+    if (ui32Generation != psNode->ui32Generation) {
+        return;
+    }
+
+    sim_sx1262_rx_begin(psNode, psNode->ui32Timeout);
+}
+
+static void sim_sx1262_duty_window(void *pvContext, uint32_t ui32Generation);
+
+static void sim_sx1262_duty_sleep(void *pvContext, uint32_t ui32Generation)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+
+    if (ui32Generation != psNode->ui32Generation) {
+        return;
+    }
+
+    // a preamble found in the window is received to the end
+    if (psNode->psLock) {
+        return;
+    }
+
+    psNode->bListening = false;
+    psNode->bDutyAsleep = true;
+    sim_sx1262_busy_update(psNode);
+
+    sim_event_schedule(sim_time_get() +
+                           SIM_STEPS_TO_US(psNode->ui32SleepPeriod),
+                       sim_sx1262_duty_window, psNode, ui32Generation);
+}
+
+static void sim_sx1262_duty_window(void *pvContext, uint32_t ui32Generation)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+
+    if (ui32Generation != psNode->ui32Generation) {
+        return;
+    }
+
+    psNode->bDutyAsleep = false;
+    sim_sx1262_busy_update(psNode);
+
+    sim_event_schedule(sim_time_get() + SIM_STEPS_TO_US(psNode->ui32RxPeriod),
+                       sim_sx1262_duty_sleep, psNode, ui32Generation);
+    sim_sx1262_listen(psNode);
+}
+
+//
+// channel activity detection
+//
+static void sim_sx1262_cad_end(void *pvContext, uint32_t ui32Generation)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+    uint32_t ui32Bandwidth = sim_sx1262_bandwidth(psNode);
+    double dNoise = sim_channel_noise(ui32Bandwidth);
+    uint16_t ui16Irq = IRQ_CADDONE;
+
+    if (ui32Generation != psNode->ui32Generation) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < SIM_CHANNEL_TRANSMISSIONS; i++) {
+        sim_transmission_t *psTx = sim_channel_get(i);
+
+        if (!psTx || (psTx->i32Source == psNode->i32Index) ||
+            !sim_sx1262_compatible(psNode, psTx) ||
+            !sim_channel_overlaps(psTx, psNode->ui32Frequency,
+                                  ui32Bandwidth)) {
+            continue;
+        }
+
+        if (sim_channel_power(psTx, psNode->i32Index) - dNoise >=
+            sim_channel_snr_floor(psTx->ui8SpreadingFactor)) {
+            ui16Irq |= IRQ_CADDETECTED;
+            break;
+        }
+    }
+
+    psNode->sStats.ui32CadDone++;
+    if (ui16Irq & IRQ_CADDETECTED) {
+        psNode->sStats.ui32CadDetected++;
+    }
+    sim_sx1262_irq_raise(psNode, ui16Irq);
+
+    if ((ui16Irq & IRQ_CADDETECTED) &&
+        (psNode->pui8Cad[3] == CAD_EXIT_RX)) {
+        psNode->eMode = SIM_MODE_RX;
+        sim_sx1262_rx_begin(psNode, (psNode->pui8Cad[4] << 16) |
+                                        (psNode->pui8Cad[5] << 8) |
+                                        psNode->pui8Cad[6]);
+        return;
+    }
+
+    sim_sx1262_mode_set(psNode, SIM_MODE_STDBY_RC);
+}
+
+// CAD listens for 1 to 16 symbols plus about half a symbol of processing
+static void sim_sx1262_cad_start(void *pvContext, uint32_t ui32Generation)
+{
+    sim_sx1262_t *psNode = (sim_sx1262_t *)pvContext;
+    uint8_t ui8SymbolNum = psNode->pui8Cad[0] > 4 ? 4 : psNode->pui8Cad[0];
+    double dSymbolUs;
+
+    if (ui32Generation != psNode->ui32Generation) {
+        return;
+    }
+
+    dSymbolUs = sim_sx1262_symbol_us(sim_sx1262_sf(psNode),
+                                     sim_sx1262_bandwidth(psNode));
+    sim_event_schedule(sim_time_get() +
+                           (uint64_t)(((1 << ui8SymbolNum) + 0.5) * dSymbolUs),
+                       sim_sx1262_cad_end, psNode, ui32Generation);
+}
+
+//
+// SPI
+//
+static uint32_t sim_sx1262_param24(const uint8_t *pui8Param)
+{
+    return (pui8Param[0] << 16) | (pui8Param[1] << 8) | pui8Param[2];
+}
+
+static double sim_sx1262_rssi_instant(sim_sx1262_t *psNode)
+{
+    uint32_t ui32Bandwidth = sim_sx1262_bandwidth(psNode);
+    double dPower = pow(10.0, sim_channel_noise(ui32Bandwidth) / 10.0);
+
+    for (uint32_t i = 0; i < SIM_CHANNEL_TRANSMISSIONS; i++) {
+        sim_transmission_t *psTx = sim_channel_get(i);
+
+        if (psTx && (psTx->i32Source != psNode->i32Index) &&
+            sim_channel_overlaps(psTx, psNode->ui32Frequency,
+                                 ui32Bandwidth)) {
+            dPower += pow(10.0, sim_channel_power(psTx, psNode->i32Index) /
+                                    10.0);
+        }
+    }
+
+    return 10.0 * log10(dPower);
+}
+
+// response bytes that follow the status of a get command
+static void sim_sx1262_response_build(sim_sx1262_t *psNode, uint8_t ui8Opcode)
+{
+    uint8_t *pui8Response = psNode->pui8Response;
+
+    memset(pui8Response, 0, SIM_RESPONSE_SIZE);
+
+    switch (ui8Opcode) {
+    case CMD_GETIRQSTATUS:
+        pui8Response[0] = psNode->ui16Irq >> 8;
+        pui8Response[1] = psNode->ui16Irq & 0xFF;
+        break;
+    case CMD_GETRXBUFFERSTATUS:
+        pui8Response[0] = psNode->ui8RxLength;
+        pui8Response[1] = psNode->ui8RxStart;
+        break;
+    case CMD_GETPACKETSTATUS:
+        pui8Response[0] = psNode->ui8RssiPacket;
+        pui8Response[1] = (uint8_t)psNode->i8SnrPacket;
+        pui8Response[2] = psNode->ui8SignalRssiPacket;
+        break;
+    case CMD_GETRSSIINST:
+        pui8Response[0] =
+            sim_sx1262_rssi_encode(sim_sx1262_rssi_instant(psNode));
+        break;
+    case CMD_GETSTATS:
+        pui8Response[0] = psNode->ui16PacketsReceived >> 8;
+        pui8Response[1] = psNode->ui16PacketsReceived & 0xFF;
+        pui8Response[2] = psNode->ui16CrcErrors >> 8;
+        pui8Response[3] = psNode->ui16CrcErrors & 0xFF;
+        pui8Response[4] = psNode->ui16HeaderErrors >> 8;
+        pui8Response[5] = psNode->ui16HeaderErrors & 0xFF;
+        break;
+    case CMD_GETPACKETTYPE:
+        pui8Response[0] = psNode->ui8PacketType;
+        break;
+    default:
+        break;
+    }
+}
+
+// Each radio draws its own reproducible noise, different from every other
+// radio in the simulation.
+static uint8_t sim_sx1262_noise(sim_sx1262_t *psNode)
+{
+    uint32_t x = psNode->ui32Noise;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    psNode->ui32Noise = x;
+
+    return x >> 24;
+}
+
+// Data clocked out on MISO for byte ui32Index of the frame.  The status is
+// returned until the addressed data starts.
+static uint8_t sim_sx1262_miso(sim_sx1262_t *psNode, uint32_t ui32Index)
+{
+    const uint8_t *pui8Frame = psNode->pui8Frame;
+    uint16_t ui16Address;
+
+    switch (pui8Frame[0]) {
+    case CMD_READREGISTER:
+        if (ui32Index < 4) {
+            break;
+        }
+        ui16Address = (pui8Frame[1] << 8) | pui8Frame[2];
+        ui16Address += ui32Index - 4;
+        if ((ui16Address >= REG_RANDOMNUMBERGEN0) &&
+            (ui16Address <= REG_RANDOMNUMBERGEN3) && psNode->bListening) {
+            return sim_sx1262_noise(psNode);
+        }
+        return psNode->pui8Register[ui16Address & (SIM_REGISTER_SIZE - 1)];
+    case CMD_READBUFFER:
+        if (ui32Index < 3) {
+            break;
+        }
+        return psNode->pui8Buffer[(uint8_t)(pui8Frame[1] + ui32Index - 3)];
+    case CMD_GETIRQSTATUS:
+    case CMD_GETRXBUFFERSTATUS:
+    case CMD_GETPACKETSTATUS:
+    case CMD_GETRSSIINST:
+    case CMD_GETSTATS:
+    case CMD_GETPACKETTYPE:
+    case CMD_GETDEVICEERRORS:
+        if (ui32Index < 2) {
+            break;
+        }
+        if (ui32Index == 2) {
+            sim_sx1262_response_build(psNode, pui8Frame[0]);
+        }
+        if (ui32Index - 2 < SIM_RESPONSE_SIZE) {
+            return psNode->pui8Response[ui32Index - 2];
+        }
+        return 0;
+    default:
+        break;
+    }
+
+    return sim_sx1262_status(psNode);
+}
+
+static uint32_t sim_sx1262_command_execute(sim_sx1262_t *psNode)
+{
+    const uint8_t *p = &psNode->pui8Frame[1];
+    uint32_t n = psNode->ui32FrameLength - 1;
+    uint16_t ui16Address;
+
+    switch (psNode->pui8Frame[0]) {
+    case CMD_SETSLEEP:
+        psNode->bWarmStart = n && (p[0] & SLEEP_WARM);
+        sim_sx1262_mode_set(psNode, SIM_MODE_SLEEP);
+        memset(psNode->pui8Buffer, 0, sizeof(psNode->pui8Buffer));
+        return 0;
+    case CMD_SETSTANDBY:
+        sim_sx1262_mode_set(psNode, (n && p[0]) ? SIM_MODE_STDBY_XOSC
+                                                : SIM_MODE_STDBY_RC);
+        return SIM_BUSY_STANDBY_US;
+    case CMD_SETFS:
+        sim_sx1262_mode_set(psNode, SIM_MODE_FS);
+        return SIM_BUSY_FS_US;
+    case CMD_SETTX:
+        sim_sx1262_mode_set(psNode, SIM_MODE_TX);
+        psNode->ui32Timeout = n >= 3 ? sim_sx1262_param24(p) : 0;
+        sim_event_schedule(sim_time_get() + SIM_BUSY_TX_US,
+                           sim_sx1262_tx_start, psNode,
+                           psNode->ui32Generation);
+        return SIM_BUSY_TX_US;
+    case CMD_SETTXCONTINUOUSWAVE:
+    case CMD_SETTXINFINITEPREAMBLE:
+        sim_sx1262_mode_set(psNode, SIM_MODE_TX_CW);
+        sim_event_schedule(sim_time_get() + SIM_BUSY_TX_US,
+                           sim_sx1262_carrier_start, psNode,
+                           psNode->ui32Generation);
+        return SIM_BUSY_TX_US;
+    case CMD_SETRX:
+        sim_sx1262_mode_set(psNode, SIM_MODE_RX);
+        psNode->ui32Timeout = n >= 3 ? sim_sx1262_param24(p) : 0;
+        sim_event_schedule(sim_time_get() + SIM_BUSY_RX_US,
+                           sim_sx1262_rx_start, psNode,
+                           psNode->ui32Generation);
+        return SIM_BUSY_RX_US;
+    case CMD_SETRXDUTYCYCLE:
+        if (n < 6) {
+            break;
+        }
+        sim_sx1262_mode_set(psNode, SIM_MODE_RX_DUTY);
+        psNode->ui32Timeout = RX_SINGLE;
+        psNode->ui32RxPeriod = sim_sx1262_param24(p);
+        psNode->ui32SleepPeriod = sim_sx1262_param24(p + 3);
+        sim_event_schedule(sim_time_get() + SIM_BUSY_RX_US,
+                           sim_sx1262_duty_window, psNode,
+                           psNode->ui32Generation);
+        return SIM_BUSY_RX_US;
+    case CMD_SETCAD:
+        sim_sx1262_mode_set(psNode, SIM_MODE_CAD);
+        sim_event_schedule(sim_time_get() + SIM_BUSY_RX_US,
+                           sim_sx1262_cad_start, psNode,
+                           psNode->ui32Generation);
+        return SIM_BUSY_RX_US;
+    case CMD_CALIBRATE:
+        return SIM_BUSY_CALIBRATE_US;
+    case CMD_CALIBRATEIMAGE:
+        return SIM_BUSY_IMAGE_US;
+    case CMD_SETREGULATORMODE:
+    case CMD_SETPACONFIG:
+    case CMD_SETDIO2ASRFSWITCHCTRL:
+    case CMD_SETDIO3ASTCXOCTRL:
+    case CMD_CLEARDEVICEERRORS:
+        return SIM_BUSY_COMMAND_US;
+    case CMD_SETRXTXFALLBACKMODE:
+        if (n >= 1) {
+            psNode->ui8Fallback = p[0];
+        }
+        return SIM_BUSY_COMMAND_US;
+    case CMD_WRITEREGISTER:
+        if (n < 2) {
+            break;
+        }
+        ui16Address = (p[0] << 8) | p[1];
+        for (uint32_t i = 2; i < n; i++) {
+            psNode->pui8Register[(ui16Address + i - 2) &
+                                 (SIM_REGISTER_SIZE - 1)] = p[i];
+        }
+        return SIM_BUSY_ACCESS_US;
+    case CMD_WRITEBUFFER:
+        if (n < 1) {
+            break;
+        }
+        for (uint32_t i = 1; i < n; i++) {
+            psNode->pui8Buffer[(uint8_t)(p[0] + i - 1)] = p[i];
+        }
+        return SIM_BUSY_ACCESS_US;
+    case CMD_READREGISTER:
+    case CMD_READBUFFER:
+    case CMD_GETSTATUS:
+    case CMD_GETIRQSTATUS:
+    case CMD_GETRXBUFFERSTATUS:
+    case CMD_GETPACKETSTATUS:
+    case CMD_GETRSSIINST:
+    case CMD_GETSTATS:
+    case CMD_GETPACKETTYPE:
+    case CMD_GETDEVICEERRORS:
+        return SIM_BUSY_ACCESS_US;
+    case CMD_SETDIOIRQPARAMS:
+        if (n < 8) {
+            break;
+        }
+        psNode->ui16IrqMask = (p[0] << 8) | p[1];
+        psNode->ui16Dio1Mask = (p[2] << 8) | p[3];
+        psNode->ui16Dio3Mask = (p[6] << 8) | p[7];
+        sim_sx1262_dio_update(psNode);
+        return SIM_BUSY_COMMAND_US;
+    case CMD_CLEARIRQSTATUS:
+        if (n < 2) {
+            break;
+        }
+        psNode->ui16Irq &= ~((p[0] << 8) | p[1]);
+        sim_sx1262_dio_update(psNode);
+        return SIM_BUSY_COMMAND_US;
+    case CMD_SETRFFREQUENCY:
+        if (n < 4) {
+            break;
+        }
+        psNode->ui32Frequency = (uint32_t)(
+            ((uint64_t)((p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]) *
+             32000000) >>
+            25);
+        return SIM_BUSY_COMMAND_US;
+    case CMD_SETPACKETTYPE:
+        if (n < 1) {
+            break;
+        }
+        psNode->ui8PacketType = p[0];
+        return SIM_BUSY_COMMAND_US;
+    case CMD_SETTXPARAMS:
+        if (n < 2) {
+            break;
+        }
+        psNode->i8Power = (int8_t)p[0];
+        return SIM_BUSY_COMMAND_US;
+    case CMD_SETMODULATIONPARAMS:
+        memcpy(psNode->pui8Modulation, p,
+               n < sizeof(psNode->pui8Modulation)
+                   ? n
+                   : sizeof(psNode->pui8Modulation));
+        return SIM_BUSY_COMMAND_US;
+    case CMD_SETPACKETPARAMS:
+        memcpy(psNode->pui8Packet, p,
+               n < sizeof(psNode->pui8Packet) ? n
+                                              : sizeof(psNode->pui8Packet));
+        return SIM_BUSY_COMMAND_US;
+    case CMD_SETCADPARAMS:
+        memcpy(psNode->pui8Cad, p,
+               n < sizeof(psNode->pui8Cad) ? n : sizeof(psNode->pui8Cad));
+        return SIM_BUSY_COMMAND_US;
+    case CMD_SETBUFFERBASEADDRESS:
+        if (n < 2) {
+            break;
+        }
+        psNode->ui8TxBase = p[0];
+        psNode->ui8RxBase = p[1];
+        return SIM_BUSY_COMMAND_US;
+    case CMD_SETLORASYMBNUMTIMEOUT: {
+        uint8_t ui8Mantissa = n ? p[0] >> 1 : 0, ui8Exponent = 0;
+
+        while (ui8Mantissa > 31) {
+            ui8Mantissa >>= 2;
+            ui8Exponent++;
+        }
+        psNode->pui8Register[REG_LORASYNCTIMEOUT] =
+            (ui8Mantissa << 3) | ui8Exponent;
+        return SIM_BUSY_COMMAND_US;
+    }
+    case CMD_STOPTIMERONPREAMBLE:
+        psNode->bStopOnPreamble = n && p[0];
+        return SIM_BUSY_COMMAND_US;
+    case CMD_RESETSTATS:
+        psNode->ui16PacketsReceived = 0;
+        psNode->ui16CrcErrors = 0;
+        psNode->ui16HeaderErrors = 0;
+        return SIM_BUSY_COMMAND_US;
+    default:
+        break;
+    }
+
+    psNode->ui8CommandStatus = STATUS_CMD_ERROR;
+    return SIM_BUSY_COMMAND_US;
+}
+
+// Falling NSS wakes a sleeping chip, which then ignores the frame.  A frame
+// sent while BUSY is high is dropped as well and counted.
+void sim_sx1262_select(sim_sx1262_t *psNode)
+{
+    uint32_t ui32Wake;
+
+    psNode->bSelected = true;
+    psNode->bIgnored = false;
+    psNode->ui32FrameLength = 0;
+
+    if (!sim_sx1262_busy(psNode)) {
+        return;
+    }
+
+    psNode->bIgnored = true;
+
+    if ((psNode->eMode == SIM_MODE_SLEEP) || psNode->bDutyAsleep) {
+        ui32Wake = SIM_BUSY_WAKE_WARM_US;
+        if ((psNode->eMode == SIM_MODE_SLEEP) && !psNode->bWarmStart) {
+            sim_sx1262_defaults(psNode);
+            ui32Wake = SIM_BUSY_WAKE_COLD_US;
+        }
+
+        psNode->sStats.ui32Wakeups++;
+        sim_sx1262_mode_set(psNode, SIM_MODE_STDBY_RC);
+        sim_sx1262_busy_set(psNode, ui32Wake);
+        return;
+    }
+
+    if (psNode->eMode != SIM_MODE_RESET) {
+        psNode->sStats.ui32BusyViolations++;
+    }
+}
+
+uint8_t sim_sx1262_exchange(sim_sx1262_t *psNode, uint8_t ui8Mosi,
+                            uint32_t ui32Clock)
+{
+    uint32_t ui32Index = psNode->ui32FrameLength;
+    uint32_t ui32ClockMax = psNode->sConfig.ui32SpiClockMax
+                                ? psNode->sConfig.ui32SpiClockMax
+                                : AM_HAL_IOM_16MHZ;
+    uint8_t ui8Miso;
+
+    if (!psNode->bSelected || psNode->bIgnored) {
+        return 0xFF;
+    }
+
+    if (ui32Index < SIM_FRAME_SIZE) {
+        psNode->pui8Frame[ui32Index] = ui8Mosi;
+        psNode->ui32FrameLength++;
+    }
+
+    ui8Miso = sim_sx1262_miso(psNode, ui32Index);
+
+    // the link is unreliable above the rated clock
+    if (ui32Clock > ui32ClockMax) {
+        ui8Miso ^= 0x01;
+    }
+
+    return ui8Miso;
+}
+
+// commands take effect on the rising edge of NSS
+void sim_sx1262_deselect(sim_sx1262_t *psNode)
+{
+    uint32_t ui32Busy;
+
+    if (!psNode->bSelected) {
+        return;
+    }
+
+    psNode->bSelected = false;
+    if (psNode->bIgnored || (psNode->ui32FrameLength == 0)) {
+        return;
+    }
+
+    psNode->sStats.ui32Commands++;
+    ui32Busy = sim_sx1262_command_execute(psNode);
+    if (psNode->ui32BusyTraceIndex < psNode->ui32BusyTraceLength) {
+        ui32Busy = psNode->pui32BusyTrace[psNode->ui32BusyTraceIndex++];
+    }
+    if (ui32Busy) {
+        sim_sx1262_busy_set(psNode, ui32Busy);
+    }
+}
+
+void sim_sx1262_reset_drive(uint32_t ui32Pin, bool bLevel)
+{
+    for (uint32_t i = 0; i < SIM_SX1262_NODES_MAX; i++) {
+        sim_sx1262_t *psNode = &gpsNodes[i];
+
+        if (!psNode->bUsed || (psNode->sConfig.ui32PinReset != ui32Pin)) {
+            continue;
+        }
+
+        if (!bLevel && (psNode->eMode != SIM_MODE_RESET)) {
+            sim_sx1262_mode_set(psNode, SIM_MODE_RESET);
+            sim_sx1262_defaults(psNode);
+            sim_sx1262_dio_update(psNode);
+        } else if (bLevel && (psNode->eMode == SIM_MODE_RESET)) {
+            sim_sx1262_mode_set(psNode, SIM_MODE_STDBY_RC);
+            sim_sx1262_busy_set(psNode, SIM_BUSY_BOOT_US);
+        }
+    }
+}
+
+//
+// nodes
+//
+void sim_sx1262_init(void)
+{
+    memset(gpsNodes, 0, sizeof(gpsNodes));
+}
+
+sim_sx1262_t *sim_sx1262_find(uint32_t ui32Module, uint32_t ui32ChipSelect)
+{
+    for (uint32_t i = 0; i < SIM_SX1262_NODES_MAX; i++) {
+        sim_sx1262_t *psNode = &gpsNodes[i];
+
+        if (psNode->bUsed && (psNode->sConfig.ui32IomModule == ui32Module) &&
+            (psNode->sConfig.ui32ChipSelect == ui32ChipSelect)) {
+            return psNode;
+        }
+    }
+
+    return NULL;
+}
+
+static sim_sx1262_t *sim_sx1262_get(int32_t i32Node)
+{
+    if ((i32Node < 0) || (i32Node >= SIM_SX1262_NODES_MAX) ||
+        !gpsNodes[i32Node].bUsed) {
+        return NULL;
+    }
+
+    return &gpsNodes[i32Node];
+}
+
+// a new radio powers up and boots into STDBY_RC
+int32_t sim_sx1262_create(const sim_sx1262_config_t *psConfig)
+{
+    for (int32_t i = 0; i < SIM_SX1262_NODES_MAX; i++) {
+        sim_sx1262_t *psNode = &gpsNodes[i];
+
+        if (psNode->bUsed) {
+            continue;
+        }
+
+        memset(psNode, 0, sizeof(sim_sx1262_t));
+        psNode->bUsed = true;
+        psNode->i32Index = i;
+        psNode->sConfig = *psConfig;
+        psNode->eMode = SIM_MODE_STDBY_RC;
+        psNode->ui32Noise = 0x9E3779B9u * (uint32_t)(i + 1);
+        sim_sx1262_defaults(psNode);
+        sim_channel_position_set(i, psConfig->dX, psConfig->dY);
+
+        sim_gpio_input_drive(psConfig->ui32PinBusy, false);
+        sim_gpio_input_drive(psConfig->ui32PinDio1, false);
+        sim_gpio_input_drive(psConfig->ui32PinDio3, false);
+        sim_sx1262_busy_set(psNode, SIM_BUSY_BOOT_US);
+
+        return i;
+    }
+
+    return -1;
+}
+
+void sim_sx1262_position_set(int32_t i32Node, double dX, double dY)
+{
+    sim_sx1262_t *psNode = sim_sx1262_get(i32Node);
+
+    if (psNode) {
+        psNode->sConfig.dX = dX;
+        psNode->sConfig.dY = dY;
+        sim_channel_position_set(i32Node, dX, dY);
+    }
+}
+
+void sim_sx1262_stats_get(int32_t i32Node, sim_sx1262_stats_t *psStats)
+{
+    sim_sx1262_t *psNode = sim_sx1262_get(i32Node);
+
+    if (psNode) {
+        *psStats = psNode->sStats;
+    } else {
+        memset(psStats, 0, sizeof(sim_sx1262_stats_t));
+    }
+}
+
+void sim_sx1262_busy_trace_set(int32_t i32Node, const uint32_t *pui32Us,
+                               uint32_t ui32Count)
+{
+    sim_sx1262_t *psNode = sim_sx1262_get(i32Node);
+
+    if (psNode) {
+        psNode->pui32BusyTrace = pui32Us;
+        psNode->ui32BusyTraceLength = pui32Us ? ui32Count : 0;
+        psNode->ui32BusyTraceIndex = 0;
+    }
+}
+
+uint32_t sim_sx1262_busy_trace_position(int32_t i32Node)
+{
+    sim_sx1262_t *psNode = sim_sx1262_get(i32Node);
+
+    return psNode ? psNode->ui32BusyTraceIndex : 0;
+}
+
+void sim_sx1262_stats_reset(int32_t i32Node)
+{
+    sim_sx1262_t *psNode = sim_sx1262_get(i32Node);
+
+    if (psNode) {
+        memset(&psNode->sStats, 0, sizeof(sim_sx1262_stats_t));
+    }
+}
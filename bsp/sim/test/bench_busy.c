@@ -0,0 +1,264 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+// BUSY line waits of the SX1262 driver replayed from a trace: the same
+// command sequence runs once with polling and once with the wait hook, and
+// the latency of the sequence, the BUSY waits, the pin polls and the share
+// of time the processor could not sleep are compared.  All times are in
+// us.
+//
+// Without an argument a synthetic trace is used.  A recorded one is passed
+// as a text file with one BUSY high time per line in the order the
+// commands were sent, lines starting with # are skipped.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <semphr.h>
+#include <task.h>
+
+#include "nm_devices_lora.h"
+#include "sim.h"
+#include "test.h"
+
+#define BENCH_TASK_PRIORITY 2
+#define BENCH_ROUNDS 50
+#define BENCH_TRACE_MAX 4096
+
+static uint32_t gpui32Trace[BENCH_TRACE_MAX];
+static uint32_t gui32TraceLength;
+
+static SemaphoreHandle_t gsBusySemaphore;
+static SemaphoreHandle_t gsDone;
+static int32_t gi32Node;
+
+typedef struct {
+    uint64_t ui64Elapsed;
+    uint64_t ui64Idle;
+    uint32_t ui32Polls;
+    uint32_t ui32Commands;
+    lora_radio_busy_stats_t sBusy;
+} bench_result_t;
+
+// Mostly short command times, mode changes now and then and a few
+// calibration length waits, from a fixed seed so runs compare.
+static void bench_trace_synthetic(void)
+{
+    srand(1);
+    for (uint32_t i = 0; i < BENCH_TRACE_MAX; i++) {
+        uint32_t ui32Class = rand() % 100;
+
+        if (ui32Class < 70) {
+            gpui32Trace[i] = 2 + rand() % 20;
+        } else if (ui32Class < 95) {
+            gpui32Trace[i] = 30 + rand() % 320;
+        } else {
+            gpui32Trace[i] = 2000 + rand() % 1500;
+        }
+    }
+    gui32TraceLength = BENCH_TRACE_MAX;
+}
+
+static uint8_t bench_trace_load(const char *pcPath)
+{
+    FILE *psFile = fopen(pcPath, "r");
+    char pcLine[64];
+
+    if (!psFile) {
+        return 0;
+    }
+
+    gui32TraceLength = 0;
+    while (fgets(pcLine, sizeof(pcLine), psFile) &&
+           (gui32TraceLength < BENCH_TRACE_MAX)) {
+        if ((pcLine[0] == '#') || (pcLine[0] == '\n')) {
+            continue;
+        }
+        gpui32Trace[gui32TraceLength++] = strtoul(pcLine, NULL, 10);
+    }
+    fclose(psFile);
+
+    return gui32TraceLength != 0;
+}
+
+static void bench_busy_wait(uint32_t ui32Ticks)
+{
+    TickType_t xTicks =
+        pdMS_TO_TICKS((ui32Ticks * 1000) / LORA_RADIO_TIMER_FREQUENCY) + 1;
+
+    xSemaphoreTake(gsBusySemaphore, xTicks);
+}
+
+static void bench_busy_release(void *pvArg)
+{
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+    xSemaphoreGiveFromISR(gsBusySemaphore, &xHigherPriorityTaskWoken);
+
+    portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+}
+
+// a receiver hopping between two channels and data rates
+static void bench_workload(void *pvParameters)
+{
+    lora_radio_modulation_t sModulation = {
+        .eSpreadingFactor = LORA_RADIO_SF7,
+        .eBandwidth = LORA_RADIO_BW_125,
+        .eCodingRate = LORA_CR_4_5,
+        .eLowDataRateOptimization = LORA_RADIO_LDR_OPT_OFF};
+    lora_radio_packet_t sPacket = {
+        .ui16PreambleLength = 8,
+        .ePacketLength = LORA_RADIO_PACKET_LENGTH_VARIABLE,
+        .ui8PayloadLength = LORA_RADIO_MAX_PHYSICAL_PACKET,
+        .eCRC = LORA_RADIO_CRC_ON,
+        .eIQ = LORA_RADIO_IQ_STANDARD};
+    lora_radio_profile_t psProfile[2];
+    lora_radio_transfer_t sRx = {.ui32Timeout = 0xFFFFFF00,
+                                 .eMode = LORA_RADIO_RX};
+
+    lora_radio_profile_init(&psProfile[0], &sModulation, &sPacket, 0x12);
+    sModulation.eSpreadingFactor = LORA_RADIO_SF9;
+    lora_radio_profile_init(&psProfile[1], &sModulation, &sPacket, 0x12);
+
+    lora_radio_initialize(NULL);
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        sRx.psProfile = &psProfile[i & 1];
+        sRx.ui32Frequency = (i & 1) ? 868100000 : 915000000;
+        lora_radio_transfer(NULL, &sRx);
+        lora_radio_power_ctrl(NULL, LORA_RADIO_SLEEP);
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    lora_radio_power_ctrl(NULL, LORA_RADIO_STANDBY);
+
+    xSemaphoreGive(gsDone);
+    vTaskDelete(NULL);
+}
+
+static void bench_run(bool bBlocking, bench_result_t *psResult)
+{
+    sim_sx1262_config_t sConfig = SIM_SX1262_BOARD_CONFIG;
+    sim_sx1262_stats_t sStats;
+    uint64_t ui64Start;
+
+    sim_init();
+    sim_freertos_init();
+    gi32Node = sim_sx1262_create(&sConfig);
+    sim_time_advance(10000);
+    sim_sx1262_busy_trace_set(gi32Node, gpui32Trace, gui32TraceLength);
+
+    gsBusySemaphore = xSemaphoreCreateBinary();
+    gsDone = xSemaphoreCreateBinary();
+    if (bBlocking) {
+        lora_radio_busy_wait_register(bench_busy_wait, bench_busy_release);
+    } else {
+        lora_radio_busy_wait_register(NULL, NULL);
+    }
+
+    ui64Start = sim_time_get();
+    xTaskCreate(bench_workload, "radio", 512, NULL, BENCH_TASK_PRIORITY,
+                NULL);
+    xSemaphoreTake(gsDone, portMAX_DELAY);
+
+    psResult->ui64Elapsed = sim_time_get() - ui64Start;
+    psResult->ui64Idle = sim_freertos_idle_time();
+    psResult->ui32Polls = sim_gpio_read_count(sConfig.ui32PinBusy);
+    sim_sx1262_stats_get(gi32Node, &sStats);
+    psResult->ui32Commands = sStats.ui32Commands;
+    lora_radio_busy_stats_get(NULL, &psResult->sBusy);
+
+    TEST_CHECK(sStats.ui32BusyViolations == 0);
+    TEST_CHECK(psResult->sBusy.ui32Timeouts == 0);
+
+    lora_radio_busy_wait_register(NULL, NULL);
+    lora_radio_deinitialize(NULL);
+}
+
+static uint64_t bench_ticks_to_us(uint64_t ui64Ticks)
+{
+    return ui64Ticks * 1000000 / LORA_RADIO_TIMER_FREQUENCY;
+}
+
+static void bench_report(const char *pcName, const bench_result_t *psResult)
+{
+    const lora_radio_busy_stats_t *psBusy = &psResult->sBusy;
+    uint64_t ui64Active = psResult->ui64Elapsed - psResult->ui64Idle;
+
+    printf("  %-8s sequence %llu, busy waits %u avg %llu max %llu, "
+           "polls %u, cpu %llu%%\n",
+           pcName, (unsigned long long)psResult->ui64Elapsed,
+           psBusy->ui32Waits,
+           (unsigned long long)bench_ticks_to_us(
+               psBusy->ui32Waits ? psBusy->ui64TotalTicks / psBusy->ui32Waits
+                                 : 0),
+           (unsigned long long)bench_ticks_to_us(psBusy->ui32MaxTicks),
+           psResult->ui32Polls,
+           (unsigned long long)(ui64Active * 100 / psResult->ui64Elapsed));
+}
+
+static void bench_busy_trace(void)
+{
+    bench_result_t sPolling, sBlocking;
+
+    bench_run(false, &sPolling);
+    bench_run(true, &sBlocking);
+
+    // both runs sent the same commands and saw the same BUSY times
+    TEST_CHECK(sPolling.ui32Commands == sBlocking.ui32Commands);
+    TEST_CHECK(sPolling.sBusy.ui32Waits == sBlocking.sBusy.ui32Waits);
+    TEST_CHECK(sBlocking.sBusy.ui32Blocked == sBlocking.sBusy.ui32Waits);
+    TEST_CHECK(sBlocking.ui32Polls < sPolling.ui32Polls);
+
+    printf("  %u commands, trace of %u entries\n", sPolling.ui32Commands,
+           gui32TraceLength);
+    bench_report("polling", &sPolling);
+    bench_report("blocking", &sBlocking);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        if (!bench_trace_load(argv[1])) {
+            fprintf(stderr, "bench_busy: cannot read trace %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        bench_trace_synthetic();
+    }
+
+    TEST_RUN(bench_busy_trace);
+
+    return test_summary("bench_busy");
+}
@@ -0,0 +1,260 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+// lora_direct timing on the simulator: the software overhead around each
+// packet in virtual time, with the radio switching times of the SX1262
+// model.  All figures are in us.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <semphr.h>
+#include <task.h>
+
+#include "nm_devices_lora.h"
+#include "sim.h"
+#include "test.h"
+
+#include "task_message.h"
+
+#include "lora_direct_config.h"
+#include "lora_direct_filter.h"
+#include "lora_direct_link.h"
+#include "lora_direct_task.h"
+
+#define BENCH_TASK_PRIORITY 3
+#define BENCH_ROUNDS 50
+#define BENCH_BURST 4
+#define BENCH_LENGTH 16
+
+static void *gpPeer;
+static lora_radio_profile_t gsPeerProfile;
+static QueueHandle_t gsEvents;
+static volatile uint64_t gui64PeerTxDone;
+
+static const lora_radio_hw_config_t gsPeerConfig = {.ui32IomModule = 0,
+                                                    .ui32PinReset = 10,
+                                                    .ui32PinBusy = 11,
+                                                    .ui32PinDio1 = 12,
+                                                    .ui32PinDio3 = 13};
+
+void lora_direct_radio_configuration_reset(void)
+{
+    gsLoRaModulationParameter.eSpreadingFactor = LORA_RADIO_SF7;
+    gsLoRaModulationParameter.eBandwidth = LORA_RADIO_BW_125;
+    gsLoRaModulationParameter.eCodingRate = LORA_CR_4_5;
+    gsLoRaModulationParameter.eLowDataRateOptimization =
+        LORA_RADIO_LDR_OPT_OFF;
+
+    gsLoRaPacketParameter.ui16PreambleLength = 8;
+    gsLoRaPacketParameter.ePacketLength = LORA_RADIO_PACKET_LENGTH_VARIABLE;
+    gsLoRaPacketParameter.ui8PayloadLength = LORA_RADIO_MAX_PHYSICAL_PACKET;
+    gsLoRaPacketParameter.eCRC = LORA_RADIO_CRC_ON;
+    gsLoRaPacketParameter.eIQ = LORA_RADIO_IQ_STANDARD;
+}
+
+void am_iomaster0_isr(void)
+{
+    lora_radio_iom_isr(gpPeer);
+}
+
+static void peer_tx_done(void *pvArg)
+{
+    gui64PeerTxDone = sim_time_get();
+}
+
+static uint64_t bench_event_wait(uint32_t ui32Event)
+{
+    task_message_t sMessage;
+
+    while (xQueueReceive(gsEvents, &sMessage, pdMS_TO_TICKS(1000)) ==
+           pdPASS) {
+        if (sMessage.ui32Event == RXDONE) {
+            lora_radio_packet_release(sMessage.psContent);
+        }
+        if (sMessage.ui32Event == ui32Event) {
+            return sim_time_get();
+        }
+    }
+
+    TEST_CHECK(0);
+    return sim_time_get();
+}
+
+static void bench_setup(void)
+{
+    sim_sx1262_config_t sLocal = SIM_SX1262_BOARD_CONFIG;
+    sim_sx1262_config_t sPeer = {.ui32IomModule = 0,
+                                 .ui32PinReset = 10,
+                                 .ui32PinBusy = 11,
+                                 .ui32PinDio1 = 12,
+                                 .ui32PinDio3 = 13,
+                                 .dX = 100};
+
+    sim_freertos_init();
+    sim_sx1262_create(&sLocal);
+    sim_sx1262_create(&sPeer);
+
+    xTaskCreate(lora_direct_task, "lora", 512, NULL, BENCH_TASK_PRIORITY,
+                &lora_direct_task_handle);
+    lora_direct_stats_reset();
+
+    lora_radio_instance_initialize(&gpPeer, &gsPeerConfig);
+    lora_radio_callback_list_init(gpPeer);
+    lora_radio_callback_register(gpPeer, LORA_RADIO_TXDONE, peer_tx_done);
+    lora_radio_profile_init(&gsPeerProfile, &gsLoRaModulationParameter,
+                            &gsLoRaPacketParameter, lora_radio_syncword);
+
+    gsEvents = xQueueCreate(8, sizeof(task_message_t));
+    lora_direct_message_subscribe_events(
+        gsEvents, LORA_DIRECT_EVENT(TXDONE) | LORA_DIRECT_EVENT(RXDONE),
+        LORA_DIRECT_NOTIFY_DROP);
+}
+
+static uint32_t bench_airtime(void)
+{
+    return lora_radio_time_on_air(&gsLoRaModulationParameter,
+                                  &gsLoRaPacketParameter, BENCH_LENGTH);
+}
+
+static void bench_teardown(void)
+{
+    lora_radio_deinitialize(gpPeer);
+}
+
+// lora_direct_send() to TXDONE beyond the time on air
+static void bench_send_latency(void)
+{
+    uint8_t pui8Payload[BENCH_LENGTH] = {0};
+    uint64_t ui64Total = 0, ui64Max = 0;
+    uint32_t ui32Airtime;
+
+    bench_setup();
+    ui32Airtime = bench_airtime();
+
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        uint64_t ui64Start = sim_time_get();
+        uint64_t ui64Overhead;
+
+        lora_direct_send(lora_radio_frequency, 14, pui8Payload, BENCH_LENGTH);
+        ui64Overhead = bench_event_wait(TXDONE) - ui64Start - ui32Airtime;
+        ui64Total += ui64Overhead;
+        if (ui64Overhead > ui64Max) {
+            ui64Max = ui64Overhead;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    printf("  send to TXDONE overhead: avg %llu max %llu (airtime %u)\n",
+           (unsigned long long)(ui64Total / BENCH_ROUNDS),
+           (unsigned long long)ui64Max, ui32Airtime);
+
+    bench_teardown();
+}
+
+// gap between packets queued back to back
+static void bench_send_burst(void)
+{
+    uint8_t pui8Payload[BENCH_LENGTH] = {0};
+    uint64_t ui64Total = 0;
+    uint32_t ui32Airtime;
+
+    bench_setup();
+    ui32Airtime = bench_airtime();
+
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        uint64_t ui64First, ui64Last;
+
+        for (uint32_t j = 0; j < BENCH_BURST; j++) {
+            lora_direct_send(lora_radio_frequency, 14, pui8Payload,
+                             BENCH_LENGTH);
+        }
+
+        ui64First = bench_event_wait(TXDONE);
+        for (uint32_t j = 1; j < BENCH_BURST; j++) {
+            ui64Last = bench_event_wait(TXDONE);
+        }
+        ui64Total += ui64Last - ui64First - (BENCH_BURST - 1) * ui32Airtime;
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    printf("  back to back gap: avg %llu\n",
+           (unsigned long long)(ui64Total /
+                                (BENCH_ROUNDS * (BENCH_BURST - 1))));
+
+    bench_teardown();
+}
+
+// end of a packet on the air to the RXDONE notification of a subscriber
+static void bench_receive_latency(void)
+{
+    uint8_t pui8Payload[BENCH_LENGTH] = {0};
+    lora_radio_transfer_t sTx = {.ui32Timeout = 0xFFFFFF00,
+                                 .psProfile = &gsPeerProfile,
+                                 .pui8Payload = pui8Payload,
+                                 .ui8PayloadLength = BENCH_LENGTH,
+                                 .ui8Power = 14,
+                                 .eMode = LORA_RADIO_TX};
+    uint64_t ui64Total = 0, ui64Max = 0;
+
+    bench_setup();
+    sTx.ui32Frequency = lora_radio_frequency;
+
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        uint64_t ui64Latency;
+
+        lora_radio_transfer(gpPeer, &sTx);
+        ui64Latency = bench_event_wait(RXDONE) - gui64PeerTxDone;
+        ui64Total += ui64Latency;
+        if (ui64Latency > ui64Max) {
+            ui64Max = ui64Latency;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    printf("  end of packet to RXDONE: avg %llu max %llu\n",
+           (unsigned long long)(ui64Total / BENCH_ROUNDS),
+           (unsigned long long)ui64Max);
+
+    bench_teardown();
+}
+
+int main(void)
+{
+    TEST_RUN(bench_send_latency);
+    TEST_RUN(bench_send_burst);
+    TEST_RUN(bench_receive_latency);
+
+    return test_summary("bench_lora_direct");
+}
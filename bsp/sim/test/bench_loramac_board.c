@@ -0,0 +1,232 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+// LoRaMAC board layer timing on the simulator: the virtual time each
+// sx1262-board.c access takes including its BUSY waits, the BUSY pin
+// reads spent polling, wake up from sleep and the latency from SetTx to
+// the DIO1 handler beyond the time on air.  The LoRaMac-node core is not
+// built, so the figures cover the board layer only.  All times are in us.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sx126x-board.h>
+
+#include "sim.h"
+#include "test.h"
+
+#define BENCH_ROUNDS 50
+#define BENCH_FREQUENCY 915000000
+#define BENCH_LENGTH 16
+
+static int32_t gi32Board;
+static volatile uint64_t gui64Dio1;
+static uint8_t gpui8Buffer[255];
+
+static void board_dio1(void *pvContext)
+{
+    gui64Dio1 = sim_time_get();
+}
+
+static void bench_setup(void)
+{
+    sim_sx1262_config_t sBoard = SIM_SX1262_BOARD_CONFIG;
+
+    gi32Board = sim_sx1262_create(&sBoard);
+
+    SX126xIoInit();
+    SX126xReset();
+    SX126xIoIrqInit(board_dio1);
+    SX126xWakeup();
+}
+
+static void bench_teardown(void)
+{
+    sim_sx1262_stats_t sStats;
+
+    sim_sx1262_stats_get(gi32Board, &sStats);
+    TEST_CHECK(sStats.ui32BusyViolations == 0);
+
+    SX126xIoDeInit();
+}
+
+static void bench_write_register(void)
+{
+    SX126xWriteRegister(REG_LR_SYNCWORD, 0x34);
+}
+
+static void bench_read_register(void)
+{
+    SX126xReadRegister(REG_LR_SYNCWORD);
+}
+
+static void bench_write_buffer(void)
+{
+    SX126xWriteBuffer(0x00, gpui8Buffer, sizeof(gpui8Buffer));
+}
+
+static void bench_read_buffer(void)
+{
+    SX126xReadBuffer(0x00, gpui8Buffer, sizeof(gpui8Buffer));
+}
+
+static void bench_standby(void)
+{
+    uint8_t ui8Config = 0x00;
+
+    SX126xWriteCommand(RADIO_SET_STANDBY, &ui8Config, 1);
+}
+
+static void bench_status(void)
+{
+    uint8_t ui8Unused;
+
+    SX126xReadCommand(RADIO_GET_STATUS, &ui8Unused, 0);
+}
+
+// average over the rounds, with bWake the chip is put to warm sleep before
+// each call
+static void bench_call(const char *pszName, void (*pfnCall)(void), bool bWake)
+{
+    uint64_t ui64Total = 0;
+    uint32_t ui32Reads = 0;
+
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        uint64_t ui64Start;
+        uint32_t ui32Reads0;
+
+        if (bWake) {
+            uint8_t ui8Sleep = 0x04;
+
+            SX126xWriteCommand(RADIO_SET_SLEEP, &ui8Sleep, 1);
+            SX126xSetOperatingMode(MODE_SLEEP);
+            test_run_for(1000);
+        }
+
+        ui64Start = sim_time_get();
+        ui32Reads0 = sim_gpio_read_count(AM_BSP_GPIO_RADIO_BUSY);
+        pfnCall();
+        ui64Total += sim_time_get() - ui64Start;
+        ui32Reads += sim_gpio_read_count(AM_BSP_GPIO_RADIO_BUSY) - ui32Reads0;
+    }
+
+    printf("  %-22s %5llu, %4u BUSY reads\n", pszName,
+           (unsigned long long)(ui64Total / BENCH_ROUNDS),
+           ui32Reads / BENCH_ROUNDS);
+}
+
+static void bench_access(void)
+{
+    bench_setup();
+
+    bench_call("write register:", bench_write_register, false);
+    bench_call("read register:", bench_read_register, false);
+    bench_call("write buffer 255 B:", bench_write_buffer, false);
+    bench_call("read buffer 255 B:", bench_read_buffer, false);
+    bench_call("set standby:", bench_standby, false);
+    bench_call("get status:", bench_status, false);
+    bench_call("wake up from sleep:", bench_read_register, true);
+
+    bench_teardown();
+}
+
+// SetTx to the DIO1 handler beyond the time on air, with the commands
+// RadioSetTxConfig() and RadioSend() issue for a packet
+static void bench_transmit(void)
+{
+    uint32_t ui32Frequency =
+        (uint32_t)(((uint64_t)BENCH_FREQUENCY << 25) / 32000000);
+    uint8_t pui8Type[1] = {0x01};
+    uint8_t pui8Frequency[4] = {ui32Frequency >> 24, ui32Frequency >> 16,
+                                ui32Frequency >> 8, ui32Frequency};
+    uint8_t pui8Modulation[4] = {7, 0x04, 0x01, 0x00};
+    uint8_t pui8Packet[6] = {0x00, 8, 0x00, BENCH_LENGTH, 0x01, 0x00};
+    uint8_t pui8Base[2] = {0x00, 0x00};
+    uint8_t pui8Irq[8] = {0x02, 0x03, 0x02, 0x03, 0, 0, 0, 0};
+    uint8_t pui8Clear[2] = {0xFF, 0xFF};
+    uint8_t pui8Timeout[3] = {0x00, 0x00, 0x00};
+    uint64_t ui64Total = 0, ui64Max = 0, ui64Setup = 0;
+    uint32_t ui32Airtime;
+    sim_sx1262_stats_t sStats;
+
+    bench_setup();
+
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        uint64_t ui64Start = sim_time_get();
+        uint64_t ui64Tx;
+
+        SX126xWriteCommand(RADIO_SET_PACKETTYPE, pui8Type, 1);
+        SX126xWriteCommand(RADIO_SET_RFFREQUENCY, pui8Frequency, 4);
+        SX126xWriteCommand(RADIO_SET_MODULATIONPARAMS, pui8Modulation, 4);
+        SX126xWriteCommand(RADIO_SET_PACKETPARAMS, pui8Packet, 6);
+        SX126xWriteCommand(RADIO_SET_BUFFERBASEADDRESS, pui8Base, 2);
+        SX126xWriteCommand(RADIO_CFG_DIOIRQ, pui8Irq, 8);
+        SX126xSetRfTxPower(14);
+        SX126xWriteBuffer(0x00, gpui8Buffer, BENCH_LENGTH);
+
+        ui64Tx = sim_time_get();
+        ui64Setup += ui64Tx - ui64Start;
+        gui64Dio1 = 0;
+        SX126xWriteCommand(RADIO_SET_TX, pui8Timeout, 3);
+        SX126xSetOperatingMode(MODE_TX);
+        test_run_for(100000);
+        TEST_CHECK(gui64Dio1 != 0);
+
+        ui64Total += gui64Dio1 - ui64Tx;
+        if (gui64Dio1 - ui64Tx > ui64Max) {
+            ui64Max = gui64Dio1 - ui64Tx;
+        }
+        SX126xWriteCommand(RADIO_CLR_IRQSTATUS, pui8Clear, 2);
+        SX126xSetOperatingMode(MODE_STDBY_RC);
+    }
+
+    sim_sx1262_stats_get(gi32Board, &sStats);
+    TEST_CHECK(sStats.ui32TxPackets == BENCH_ROUNDS);
+    ui32Airtime = sStats.ui64TxAirtime / BENCH_ROUNDS;
+
+    printf("  %-22s %5llu\n", "configure and load:",
+           (unsigned long long)(ui64Setup / BENCH_ROUNDS));
+    printf("  SetTx to DIO1 beyond time on air: avg %llu max %llu "
+           "(time on air %u)\n",
+           (unsigned long long)(ui64Total / BENCH_ROUNDS - ui32Airtime),
+           (unsigned long long)(ui64Max - ui32Airtime), ui32Airtime);
+
+    bench_teardown();
+}
+
+int main(void)
+{
+    TEST_RUN(bench_access);
+    TEST_RUN(bench_transmit);
+
+    return test_summary("bench_loramac_board");
+}
@@ -0,0 +1,237 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Interrupt latency of the application while lora_direct drives the radio.
+// A device on a spare pin raises an edge about every millisecond and the
+// handler records how long it waited for the CPU, all figures are in us of
+// virtual time.  Only the lora_direct and lora_radio calls that predate the
+// radio lock are used, so the same program builds against an older
+// platform/lora_direct through LORA_DIRECT_DIR, see the Makefile.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <task.h>
+
+#include "nm_devices_lora.h"
+#include "sim.h"
+#include "test.h"
+
+#include "task_message.h"
+
+#include "lora_direct_config.h"
+// older trees have no receive filter
+#if __has_include("lora_direct_filter.h")
+#include "lora_direct_filter.h"
+#endif
+#include "lora_direct_link.h"
+#include "lora_direct_task.h"
+
+#define BENCH_TASK_PRIORITY 3
+#define BENCH_ROUNDS 20
+#define BENCH_LENGTH 16
+#define BENCH_PIN 20
+#define BENCH_PERIOD 997
+
+typedef struct {
+    uint32_t ui32Count;
+    uint64_t ui64Total;
+    uint64_t ui64Max;
+} bench_latency_t;
+
+static void *gpPeer;
+static lora_radio_profile_t gsPeerProfile;
+static QueueHandle_t gsEvents;
+static uint64_t gui64Edge;
+static bench_latency_t *gpsLatency;
+
+static const lora_radio_hw_config_t gsPeerConfig = {.ui32IomModule = 0,
+                                                    .ui32PinReset = 10,
+                                                    .ui32PinBusy = 11,
+                                                    .ui32PinDio1 = 12,
+                                                    .ui32PinDio3 = 13};
+
+void lora_direct_radio_configuration_reset(void)
+{
+    gsLoRaModulationParameter.eSpreadingFactor = LORA_RADIO_SF7;
+    gsLoRaModulationParameter.eBandwidth = LORA_RADIO_BW_125;
+    gsLoRaModulationParameter.eCodingRate = LORA_CR_4_5;
+    gsLoRaModulationParameter.eLowDataRateOptimization =
+        LORA_RADIO_LDR_OPT_OFF;
+
+    gsLoRaPacketParameter.ui16PreambleLength = 8;
+    gsLoRaPacketParameter.ePacketLength = LORA_RADIO_PACKET_LENGTH_VARIABLE;
+    gsLoRaPacketParameter.ui8PayloadLength = LORA_RADIO_MAX_PHYSICAL_PACKET;
+    gsLoRaPacketParameter.eCRC = LORA_RADIO_CRC_ON;
+    gsLoRaPacketParameter.eIQ = LORA_RADIO_IQ_STANDARD;
+}
+
+void am_iomaster0_isr(void)
+{
+    lora_radio_iom_isr(gpPeer);
+}
+
+// the next edge follows the previous one once it was served, a handler
+// held off for longer than the period never misses an edge
+static void bench_pin_isr(void)
+{
+    uint64_t ui64Now = sim_time_get();
+    uint64_t ui64Latency = ui64Now - gui64Edge;
+
+    gpsLatency->ui32Count++;
+    gpsLatency->ui64Total += ui64Latency;
+    if (ui64Latency > gpsLatency->ui64Max) {
+        gpsLatency->ui64Max = ui64Latency;
+    }
+
+    gui64Edge = ui64Now + BENCH_PERIOD;
+    sim_gpio_drive_at(BENCH_PIN, false, ui64Now);
+    sim_gpio_drive_at(BENCH_PIN, true, gui64Edge);
+}
+
+static void bench_latency_print(const char *pszName,
+                                const bench_latency_t *psLatency)
+{
+    TEST_CHECK(psLatency->ui32Count > 0);
+    if (psLatency->ui32Count == 0) {
+        return;
+    }
+
+    printf("  %-24s interrupts %u avg %llu max %llu\n", pszName,
+           psLatency->ui32Count,
+           (unsigned long long)(psLatency->ui64Total / psLatency->ui32Count),
+           (unsigned long long)psLatency->ui64Max);
+}
+
+static bool bench_event_wait(uint32_t ui32Event)
+{
+    task_message_t sMessage;
+
+    while (xQueueReceive(gsEvents, &sMessage, pdMS_TO_TICKS(1000)) ==
+           pdPASS) {
+        if (sMessage.ui32Event == RXDONE) {
+            lora_radio_packet_release(sMessage.psContent);
+        }
+        if (sMessage.ui32Event == ui32Event) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// task start, then a packet each way per round with the receiver moving
+// between the 868 and 915 MHz bands so every setup recalibrates the image
+static void bench_interrupt_latency(void)
+{
+    sim_sx1262_config_t sLocal = SIM_SX1262_BOARD_CONFIG;
+    sim_sx1262_config_t sPeer = {.ui32IomModule = 0,
+                                 .ui32PinReset = 10,
+                                 .ui32PinBusy = 11,
+                                 .ui32PinDio1 = 12,
+                                 .ui32PinDio3 = 13,
+                                 .dX = 100};
+    static const uint32_t pui32Frequency[] = {868100000, 915000000};
+    uint8_t pui8Payload[BENCH_LENGTH] = {0};
+    lora_radio_transfer_t sTx = {.ui32Timeout = 0xFFFFFF00,
+                                 .psProfile = &gsPeerProfile,
+                                 .pui8Payload = pui8Payload,
+                                 .ui8PayloadLength = BENCH_LENGTH,
+                                 .ui8Power = 14,
+                                 .eMode = LORA_RADIO_TX};
+    bench_latency_t sStart = {0}, sTraffic = {0};
+    uint32_t ui32Failures = 0;
+
+    sim_freertos_init();
+    sim_sx1262_create(&sLocal);
+    sim_sx1262_create(&sPeer);
+
+    gpsLatency = &sStart;
+    am_hal_gpio_pinconfig(BENCH_PIN, g_AM_HAL_GPIO_INPUT);
+    am_hal_gpio_interrupt_register(BENCH_PIN, bench_pin_isr);
+    am_hal_gpio_interrupt_clear(AM_HAL_GPIO_BIT(BENCH_PIN));
+    am_hal_gpio_interrupt_enable(AM_HAL_GPIO_BIT(BENCH_PIN));
+    gui64Edge = sim_time_get() + BENCH_PERIOD;
+    sim_gpio_drive_at(BENCH_PIN, false, sim_time_get());
+    sim_gpio_drive_at(BENCH_PIN, true, gui64Edge);
+
+    xTaskCreate(lora_direct_task, "lora", 512, NULL, BENCH_TASK_PRIORITY,
+                &lora_direct_task_handle);
+    vTaskDelay(pdMS_TO_TICKS(20));
+
+    // the board radio is the first instance, the task has reset the
+    // subscriptions and loaded the radio configuration by now
+    lora_radio_instance_initialize(&gpPeer, &gsPeerConfig);
+    lora_radio_callback_list_init(gpPeer);
+    gsEvents = xQueueCreate(8, sizeof(task_message_t));
+    lora_direct_message_subscribe(gsEvents, TXDONE);
+    lora_direct_message_subscribe(gsEvents, RXDONE);
+    lora_radio_profile_init(&gsPeerProfile, &gsLoRaModulationParameter,
+                            &gsLoRaPacketParameter, lora_radio_syncword);
+
+    gpsLatency = &sTraffic;
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        uint32_t ui32Frequency = pui32Frequency[i & 1];
+
+        // older trees go back to receive on lora_radio_frequency after a
+        // transmission
+        lora_radio_frequency = ui32Frequency;
+        lora_direct_receive(ui32Frequency);
+        lora_direct_send(ui32Frequency, 14, pui8Payload, BENCH_LENGTH);
+        if (!bench_event_wait(TXDONE)) {
+            ui32Failures++;
+        }
+
+        sTx.ui32Frequency = ui32Frequency;
+        lora_radio_transfer(gpPeer, &sTx);
+        if (!bench_event_wait(RXDONE)) {
+            ui32Failures++;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    TEST_CHECK(ui32Failures == 0);
+
+    am_hal_gpio_interrupt_disable(AM_HAL_GPIO_BIT(BENCH_PIN));
+    bench_latency_print("task start", &sStart);
+    bench_latency_print("traffic", &sTraffic);
+
+    lora_radio_deinitialize(gpPeer);
+}
+
+int main(void)
+{
+    TEST_RUN(bench_interrupt_latency);
+
+    return test_summary("bench_radio_lock");
+}
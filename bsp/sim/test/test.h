@@ -0,0 +1,79 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SIM_TEST_H
+#define SIM_TEST_H
+
+// Minimal helpers shared by the host tests.  Every test program is a plain
+// executable that returns non-zero when a check failed, so "make test" can
+// run them one after the other.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sim.h"
+
+static uint32_t gui32TestChecks;
+static uint32_t gui32TestFailures;
+
+#define TEST_CHECK(x)                                                          \
+    do {                                                                       \
+        gui32TestChecks++;                                                     \
+        if (!(x)) {                                                            \
+            gui32TestFailures++;                                               \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #x);       \
+        }                                                                      \
+    } while (0)
+
+#define TEST_RUN(pfnTest)                                                      \
+    do {                                                                       \
+        uint32_t ui32Failures = gui32TestFailures;                             \
+        sim_init();                                                            \
+        pfnTest();                                                             \
+        printf("%-40s %s\n", #pfnTest,                                         \
+               ui32Failures == gui32TestFailures ? "ok" : "FAILED");           \
+    } while (0)
+
+static inline int test_summary(const char *pszName)
+{
+    printf("%s: %u checks, %u failed\n", pszName, gui32TestChecks,
+           gui32TestFailures);
+
+    return gui32TestFailures ? 1 : 0;
+}
+
+// runs the virtual clock for the given time from now
+static inline void test_run_for(uint64_t ui64Microseconds)
+{
+    sim_run_until(sim_time_get() + ui64Microseconds);
+}
+
+#endif // SIM_TEST_H
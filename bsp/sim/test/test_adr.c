@@ -0,0 +1,282 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// lora_direct_adr on its own: the spreading factor and power follow the
+// latest link measurement, hold after a change and return to the configured
+// spreading factor and full power on losses.  Announcements of the peers
+// decide the spreading factor to listen at and to send with until they
+// lapse.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nm_devices_lora.h"
+#include "sim.h"
+#include "test.h"
+
+#include "lora_direct_link.h"
+#include "lora_direct_adr.h"
+
+#define TEST_PEER 7
+
+// 10 dB margin, peers send at 22 dBm, SF7 is the fastest
+static const lora_direct_adr_config_t gsTestConfig = {
+    .ui8PowerMin = 2,
+    .ui8PowerMax = 22,
+    .ui8PeerPower = 22,
+    .i16Margin = 10 * LORA_RADIO_QDB_PER_DB,
+    .eSpreadingFactorMin = LORA_RADIO_SF7};
+
+static lora_direct_link_t gsLink;
+
+// the next packet from the peer at SF7 with the given SNR in dB
+static uint8_t test_adr_packet(int16_t i16Snr)
+{
+    gsLink.ui32Packets++;
+    gsLink.i16Snr = i16Snr * LORA_RADIO_QDB_PER_DB;
+    lora_direct_adr_update(TEST_PEER, LORA_RADIO_SF7, &gsLink);
+
+    return lora_direct_adr_power_get(TEST_PEER);
+}
+
+static void test_adr_setup(const lora_direct_adr_config_t *psConfig)
+{
+    memset(&gsLink, 0, sizeof(gsLink));
+    gsLink.ui32Peer = TEST_PEER;
+    lora_direct_adr_init(psConfig);
+}
+
+// SF7 needs -7.5 dB, 10 dB SNR leaves 7.5 dB above the margin: two 3 dB
+// steps below the power the peer used
+static void test_adr_absolute(void)
+{
+    test_adr_setup(&gsTestConfig);
+
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 22);
+    for (uint32_t i = 0; i < 3; i++) {
+        TEST_CHECK(test_adr_packet(10) == 22);
+    }
+    TEST_CHECK(test_adr_packet(10) == 16);
+
+    // the same measurement keeps giving the same power
+    for (uint32_t i = 0; i < 32; i++) {
+        test_adr_packet(10);
+    }
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 16);
+
+    // other peers are not affected
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER + 1) == 22);
+}
+
+static void test_adr_limits(void)
+{
+    lora_direct_adr_config_t sConfig = gsTestConfig;
+    lora_direct_link_t sLink;
+
+    test_adr_setup(&gsTestConfig);
+    for (uint32_t i = 0; i < 4; i++) {
+        test_adr_packet(30);
+    }
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 2);
+
+    // a peer at 14 dBm heard 1 dB short of the margin gets one step more
+    sConfig.ui8PeerPower = 14;
+    test_adr_setup(&sConfig);
+    for (uint32_t i = 0; i < 4; i++) {
+        test_adr_packet(1);
+    }
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 17);
+
+    // configured at SF12 the same SNR first buys the fastest spreading
+    // factor, SF7 keeps its two steps of power
+    test_adr_setup(&gsTestConfig);
+    memset(&sLink, 0, sizeof(sLink));
+    sLink.ui32Packets = 4;
+    sLink.i16Snr = 10 * LORA_RADIO_QDB_PER_DB;
+    lora_direct_adr_update(TEST_PEER, LORA_RADIO_SF12, &sLink);
+    TEST_CHECK(lora_direct_adr_sf_get(TEST_PEER) == LORA_RADIO_SF7);
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 16);
+}
+
+// configured at SF10 every 2.5 dB of SNR above the margin is one spreading
+// factor less, the power only comes down at SF7
+static void test_adr_ladder(void)
+{
+    static const struct {
+        int16_t i16Snr;
+        uint8_t ui8Sf;
+        uint8_t ui8Power;
+    } psSteps[] = {{-5, 0, 22},
+                   {-2, LORA_RADIO_SF9, 22},
+                   {0, LORA_RADIO_SF8, 22},
+                   {5, LORA_RADIO_SF7, 22},
+                   {15, LORA_RADIO_SF7, 10}};
+    lora_direct_link_t sLink;
+
+    for (uint32_t i = 0; i < sizeof(psSteps) / sizeof(psSteps[0]); i++) {
+        test_adr_setup(&gsTestConfig);
+        memset(&sLink, 0, sizeof(sLink));
+        sLink.ui32Packets = 4;
+        sLink.i16Snr = psSteps[i].i16Snr * LORA_RADIO_QDB_PER_DB;
+        lora_direct_adr_update(TEST_PEER, LORA_RADIO_SF10, &sLink);
+        TEST_CHECK(lora_direct_adr_sf_get(TEST_PEER) == psSteps[i].ui8Sf);
+        TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) ==
+                   psSteps[i].ui8Power);
+    }
+
+    // failed deliveries return to the configured spreading factor
+    lora_direct_adr_tx_result(TEST_PEER, 0);
+    lora_direct_adr_tx_result(TEST_PEER, 0);
+    TEST_CHECK(lora_direct_adr_sf_get(TEST_PEER) == 0);
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 22);
+}
+
+// a change waits for LORA_DIRECT_ADR_MIN_PACKETS new samples
+static void test_adr_hold(void)
+{
+    test_adr_setup(&gsTestConfig);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        test_adr_packet(10);
+    }
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 16);
+
+    for (uint32_t i = 0; i < 3; i++) {
+        TEST_CHECK(test_adr_packet(-10) == 16);
+    }
+    TEST_CHECK(test_adr_packet(-10) == 22);
+}
+
+// losses give full power without touching anything else, the power comes
+// back down once the link recovered
+static void test_adr_losses(void)
+{
+    test_adr_setup(&gsTestConfig);
+
+    for (uint32_t i = 0; i < 8; i++) {
+        test_adr_packet(10);
+    }
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 16);
+
+    gsLink.ui16Per = LORA_DIRECT_LINK_PER_MAX / 2;
+    for (uint32_t i = 0; i < 16; i++) {
+        gsLink.ui32Errors++;
+        lora_direct_adr_update(TEST_PEER, LORA_RADIO_SF7, &gsLink);
+        TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 22);
+    }
+
+    gsLink.ui16Per = 0;
+    for (uint32_t i = 0; i < 4; i++) {
+        test_adr_packet(10);
+    }
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 16);
+}
+
+static void test_adr_delivery(void)
+{
+    test_adr_setup(&gsTestConfig);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        test_adr_packet(10);
+    }
+
+    // a failure between deliveries is not a trend
+    lora_direct_adr_tx_result(TEST_PEER, 0);
+    lora_direct_adr_tx_result(TEST_PEER, 1);
+    lora_direct_adr_tx_result(TEST_PEER, 0);
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 16);
+
+    lora_direct_adr_tx_result(TEST_PEER, 0);
+    TEST_CHECK(lora_direct_adr_power_get(TEST_PEER) == 22);
+
+    // the good measurements from before do not undo the fallback at once
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_CHECK(test_adr_packet(10) == 22);
+    }
+    TEST_CHECK(test_adr_packet(10) == 16);
+}
+
+// A node listens at the slowest spreading factor requested and sends to a
+// peer at the one the peer listens at, both until the announcement lapses.
+static void test_adr_rate(void)
+{
+    uint32_t ui32Remaining;
+
+    test_adr_setup(&gsTestConfig);
+    TEST_CHECK(lora_direct_adr_listen_get(0, &ui32Remaining) == 0);
+    TEST_CHECK(ui32Remaining == UINT32_MAX);
+    TEST_CHECK(lora_direct_adr_tx_sf_get(TEST_PEER, 0) == 0);
+
+    lora_direct_adr_rate_update(TEST_PEER, LORA_RADIO_SF9, LORA_RADIO_SF7,
+                                1000);
+    TEST_CHECK(lora_direct_adr_listen_get(1000, NULL) == LORA_RADIO_SF7);
+    TEST_CHECK(lora_direct_adr_tx_sf_get(TEST_PEER, 1000) == LORA_RADIO_SF9);
+
+    lora_direct_adr_rate_update(TEST_PEER + 1, LORA_RADIO_SF9, LORA_RADIO_SF8,
+                                2000);
+    TEST_CHECK(lora_direct_adr_listen_get(2000, &ui32Remaining) ==
+               LORA_RADIO_SF8);
+    TEST_CHECK(ui32Remaining == LORA_DIRECT_ADR_RATE_HOLD_MS - 1000);
+
+    // a peer content with the configured spreading factor holds it
+    lora_direct_adr_rate_update(TEST_PEER + 2, LORA_RADIO_SF9, 0, 3000);
+    TEST_CHECK(lora_direct_adr_listen_get(3000, NULL) == 0);
+
+    // the first two lapse, then the last one
+    TEST_CHECK(lora_direct_adr_listen_get(LORA_DIRECT_ADR_RATE_HOLD_MS + 2000,
+                                          &ui32Remaining) == 0);
+    TEST_CHECK(ui32Remaining == 1000);
+    TEST_CHECK(lora_direct_adr_tx_sf_get(
+                   TEST_PEER, LORA_DIRECT_ADR_RATE_HOLD_MS + 1000) == 0);
+    lora_direct_adr_rate_update(TEST_PEER + 2, LORA_RADIO_SF9, LORA_RADIO_SF7,
+                                LORA_DIRECT_ADR_RATE_HOLD_MS + 2000);
+    TEST_CHECK(lora_direct_adr_listen_get(LORA_DIRECT_ADR_RATE_HOLD_MS + 2000,
+                                          NULL) == LORA_RADIO_SF7);
+    TEST_CHECK(lora_direct_adr_listen_get(
+                   2 * LORA_DIRECT_ADR_RATE_HOLD_MS + 2000, &ui32Remaining) ==
+               0);
+    TEST_CHECK(ui32Remaining == UINT32_MAX);
+}
+
+int main(void)
+{
+    TEST_RUN(test_adr_absolute);
+    TEST_RUN(test_adr_limits);
+    TEST_RUN(test_adr_ladder);
+    TEST_RUN(test_adr_hold);
+    TEST_RUN(test_adr_losses);
+    TEST_RUN(test_adr_delivery);
+    TEST_RUN(test_adr_rate);
+
+    return test_summary("test_adr");
+}
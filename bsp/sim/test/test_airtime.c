@@ -0,0 +1,287 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Time on air against the formula of the Semtech LoRa modem designer's
+// guide (AN1200.13) and the duty cycle accounting of lora_direct_airtime.
+// Neither touches the radio or the RTOS, the simulator only provides the
+// driver the symbol count comes from.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nm_devices_lora.h"
+#include "sim.h"
+#include "test.h"
+
+#include "lora_direct_airtime.h"
+
+static const double pdBandwidthHz[] = {7810,   10420,  15630,  20830,  31250,
+                                       41670,  62500,  125000, 250000, 500000};
+
+// Semtech time on air in us, low data rate optimization as the driver
+// enables it once a symbol lasts 16 ms or more
+static double
+test_airtime_reference(const lora_radio_modulation_t *psModulation,
+                       const lora_radio_packet_t *psPacket, uint8_t ui8Length)
+{
+    double dSymbol = (double)(1 << psModulation->eSpreadingFactor) /
+                     pdBandwidthHz[psModulation->eBandwidth];
+    int32_t i32SpreadingFactor = psModulation->eSpreadingFactor;
+    int32_t i32Header =
+        psPacket->ePacketLength == LORA_RADIO_PACKET_LENGTH_FIXED;
+    int32_t i32Crc = psPacket->eCRC == LORA_RADIO_CRC_ON;
+    int32_t i32Ldro = dSymbol >= 0.016;
+    double dSymbols;
+
+    dSymbols = ceil((double)(8 * ui8Length - 4 * i32SpreadingFactor + 28 +
+                             16 * i32Crc - 20 * i32Header) /
+                    (4 * (i32SpreadingFactor - 2 * i32Ldro))) *
+               (psModulation->eCodingRate + 5);
+    if (dSymbols < 0) {
+        dSymbols = 0;
+    }
+    dSymbols += 8 + psPacket->ui16PreambleLength + 4.25;
+
+    return dSymbols * dSymbol * 1e6;
+}
+
+static void test_airtime_set(lora_radio_modulation_t *psModulation,
+                             lora_radio_packet_t *psPacket,
+                             lora_radio_spreading_factor_e eSpreadingFactor,
+                             lora_radio_bandwidth_e eBandwidth,
+                             uint16_t ui16Preamble, bool bImplicit)
+{
+    memset(psModulation, 0, sizeof(lora_radio_modulation_t));
+    psModulation->eSpreadingFactor = eSpreadingFactor;
+    psModulation->eBandwidth = eBandwidth;
+    psModulation->eCodingRate = LORA_CR_4_5;
+
+    memset(psPacket, 0, sizeof(lora_radio_packet_t));
+    psPacket->ui16PreambleLength = ui16Preamble;
+    psPacket->ePacketLength = bImplicit ? LORA_RADIO_PACKET_LENGTH_FIXED
+                                        : LORA_RADIO_PACKET_LENGTH_VARIABLE;
+    psPacket->eCRC = LORA_RADIO_CRC_ON;
+}
+
+static bool test_airtime_matches(const lora_radio_modulation_t *psModulation,
+                                 const lora_radio_packet_t *psPacket,
+                                 uint8_t ui8Length)
+{
+    double dReference =
+        test_airtime_reference(psModulation, psPacket, ui8Length);
+    uint32_t ui32Airtime =
+        lora_direct_airtime_get(psModulation, psPacket, ui8Length);
+
+    // both round down to whole us
+    return fabs(ui32Airtime - dReference) < 1.0;
+}
+
+// values of the Semtech LoRa calculator
+static void test_airtime_known(void)
+{
+    lora_radio_modulation_t sModulation;
+    lora_radio_packet_t sPacket;
+
+    test_airtime_set(&sModulation, &sPacket, LORA_RADIO_SF7,
+                     LORA_RADIO_BW_125, 8, false);
+    TEST_CHECK(lora_direct_airtime_get(&sModulation, &sPacket, 10) == 41216);
+
+    // LoRaWAN EU868 DR0 with the largest payload, needs LDRO
+    test_airtime_set(&sModulation, &sPacket, LORA_RADIO_SF12,
+                     LORA_RADIO_BW_125, 8, false);
+    TEST_CHECK(lora_direct_airtime_get(&sModulation, &sPacket, 64) ==
+               2793472);
+
+    // the table lookup and the driver agree
+    TEST_CHECK(lora_direct_airtime_get(&sModulation, &sPacket, 64) ==
+               lora_radio_time_on_air(&sModulation, &sPacket, 64));
+}
+
+static void test_airtime_formula(void)
+{
+    static const lora_radio_bandwidth_e peBandwidth[] = {
+        LORA_RADIO_BW_125, LORA_RADIO_BW_250, LORA_RADIO_BW_500};
+    static const uint8_t pui8Length[] = {0, 1, 13, 51, 222, 255};
+    lora_radio_modulation_t sModulation;
+    lora_radio_packet_t sPacket;
+    uint32_t ui32Mismatch = 0;
+
+    for (uint32_t sf = LORA_RADIO_SF7; sf <= LORA_RADIO_SF12; sf++) {
+        for (uint32_t bw = 0; bw < 3; bw++) {
+            for (uint32_t ih = 0; ih < 2; ih++) {
+                for (uint32_t l = 0; l < sizeof(pui8Length); l++) {
+                    test_airtime_set(&sModulation, &sPacket,
+                                     (lora_radio_spreading_factor_e)sf,
+                                     peBandwidth[bw], 8, ih);
+                    if (!test_airtime_matches(&sModulation, &sPacket,
+                                              pui8Length[l])) {
+                        ui32Mismatch++;
+                    }
+                }
+            }
+        }
+    }
+
+    TEST_CHECK(ui32Mismatch == 0);
+}
+
+static void test_airtime_implicit_header(void)
+{
+    lora_radio_modulation_t sModulation;
+    lora_radio_packet_t sPacket;
+    uint32_t ui32Explicit;
+
+    test_airtime_set(&sModulation, &sPacket, LORA_RADIO_SF9,
+                     LORA_RADIO_BW_125, 8, false);
+    ui32Explicit = lora_direct_airtime_get(&sModulation, &sPacket, 18);
+
+    test_airtime_set(&sModulation, &sPacket, LORA_RADIO_SF9,
+                     LORA_RADIO_BW_125, 8, true);
+    TEST_CHECK(test_airtime_matches(&sModulation, &sPacket, 18));
+    TEST_CHECK(lora_direct_airtime_get(&sModulation, &sPacket, 18) <
+               ui32Explicit);
+}
+
+// SF11 and SF12 at 125 kHz and SF12 at 250 kHz spend two bits less per
+// symbol, SF11 at 250 kHz does not
+static void test_airtime_ldro(void)
+{
+    lora_radio_modulation_t sModulation;
+    lora_radio_packet_t sPacket;
+
+    test_airtime_set(&sModulation, &sPacket, LORA_RADIO_SF11,
+                     LORA_RADIO_BW_125, 8, false);
+    TEST_CHECK(test_airtime_matches(&sModulation, &sPacket, 20));
+    TEST_CHECK(lora_direct_airtime_get(&sModulation, &sPacket, 20) == 741376);
+
+    test_airtime_set(&sModulation, &sPacket, LORA_RADIO_SF12,
+                     LORA_RADIO_BW_250, 8, false);
+    TEST_CHECK(test_airtime_matches(&sModulation, &sPacket, 20));
+    TEST_CHECK(lora_direct_airtime_get(&sModulation, &sPacket, 20) == 659456);
+
+    test_airtime_set(&sModulation, &sPacket, LORA_RADIO_SF11,
+                     LORA_RADIO_BW_250, 8, false);
+    TEST_CHECK(test_airtime_matches(&sModulation, &sPacket, 20));
+}
+
+// duty cycled receivers rely on preambles of thousands of symbols
+static void test_airtime_long_preamble(void)
+{
+    lora_radio_modulation_t sModulation;
+    lora_radio_packet_t sPacket;
+
+    test_airtime_set(&sModulation, &sPacket, LORA_RADIO_SF10,
+                     LORA_RADIO_BW_125, 1000, false);
+    TEST_CHECK(test_airtime_matches(&sModulation, &sPacket, 32));
+
+    // more than 2^32 quarter symbol us
+    test_airtime_set(&sModulation, &sPacket, LORA_RADIO_SF12,
+                     LORA_RADIO_BW_125, 0xFFFF, false);
+    TEST_CHECK(test_airtime_matches(&sModulation, &sPacket, 255));
+    TEST_CHECK(lora_direct_airtime_get(&sModulation, &sPacket, 255) ==
+               2156208128);
+}
+
+// 1 % of a 16 s window in 1 s buckets, 160 ms of airtime
+static const lora_direct_subband_t gsTestSubband = {868000000, 868600000, 100};
+
+static void test_airtime_duty_cycle(void)
+{
+    uint32_t ui32Delay;
+
+    lora_direct_airtime_init(&gsTestSubband, 1, 16000);
+
+    // outside the sub-band nothing is limited
+    TEST_CHECK(lora_direct_airtime_check(915000000, 1000000, 0, &ui32Delay) ==
+               LORA_DIRECT_AIRTIME_ALLOW);
+    lora_direct_airtime_record(915000000, 1000000, 0);
+    TEST_CHECK(lora_direct_airtime_usage(915000000, 0) == 0);
+
+    TEST_CHECK(lora_direct_airtime_check(868100000, 200000, 0, &ui32Delay) ==
+               LORA_DIRECT_AIRTIME_REJECT);
+    TEST_CHECK(lora_direct_airtime_check(868100000, 100000, 500, &ui32Delay) ==
+               LORA_DIRECT_AIRTIME_ALLOW);
+    lora_direct_airtime_record(868100000, 100000, 500);
+    TEST_CHECK(lora_direct_airtime_usage(868100000, 500) == 100000);
+
+    // the budget frees up once the first bucket leaves the window
+    TEST_CHECK(lora_direct_airtime_check(868100000, 100000, 2500,
+                                         &ui32Delay) ==
+               LORA_DIRECT_AIRTIME_DEFER);
+    TEST_CHECK(ui32Delay == 13500);
+    TEST_CHECK(lora_direct_airtime_check(868100000, 100000, 16000,
+                                         &ui32Delay) ==
+               LORA_DIRECT_AIRTIME_ALLOW);
+    TEST_CHECK(lora_direct_airtime_usage(868100000, 16000) == 0);
+}
+
+// a packet that never made it to the transmit queue gives its airtime back
+static void test_airtime_release(void)
+{
+    uint32_t ui32Delay;
+
+    lora_direct_airtime_init(&gsTestSubband, 1, 16000);
+
+    lora_direct_airtime_record(868100000, 60000, 1000);
+    lora_direct_airtime_record(868100000, 100000, 2000);
+    TEST_CHECK(lora_direct_airtime_check(868100000, 60000, 2000, &ui32Delay) ==
+               LORA_DIRECT_AIRTIME_DEFER);
+
+    lora_direct_airtime_release(868100000, 100000, 2000);
+    TEST_CHECK(lora_direct_airtime_usage(868100000, 2000) == 60000);
+    TEST_CHECK(lora_direct_airtime_check(868100000, 60000, 2000, &ui32Delay) ==
+               LORA_DIRECT_AIRTIME_ALLOW);
+
+    // never below zero and nothing once the bucket expired
+    lora_direct_airtime_release(868100000, 100000, 1000);
+    TEST_CHECK(lora_direct_airtime_usage(868100000, 2000) == 0);
+    lora_direct_airtime_record(868100000, 50000, 3000);
+    lora_direct_airtime_usage(868100000, 20000);
+    lora_direct_airtime_record(868100000, 50000, 20000);
+    lora_direct_airtime_release(868100000, 50000, 3000);
+    TEST_CHECK(lora_direct_airtime_usage(868100000, 20000) == 50000);
+}
+
+int main(void)
+{
+    TEST_RUN(test_airtime_known);
+    TEST_RUN(test_airtime_formula);
+    TEST_RUN(test_airtime_implicit_header);
+    TEST_RUN(test_airtime_ldro);
+    TEST_RUN(test_airtime_long_preamble);
+    TEST_RUN(test_airtime_duty_cycle);
+    TEST_RUN(test_airtime_release);
+
+    return test_summary("test_airtime");
+}
@@ -0,0 +1,567 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// lora_direct_arq between two nodes over a channel that loses, duplicates
+// and reorders frames, and a sender that restarts.  The module keeps its
+// state at file scope, so the test builds it in and swaps the state of the
+// two nodes in and out around every call.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nm_devices_lora.h"
+#include "sim.h"
+#include "test.h"
+
+#include "lora_direct_arq.c"
+
+#define TEST_NODES 2
+#define TEST_MESSAGES 200
+#define TEST_FRAMES 256
+#define TEST_LENGTH 20
+#define TEST_TIME_MAX 1200000
+
+typedef struct {
+    lora_direct_arq_config_t sConfig;
+    arq_peer_t psPeers[LORA_DIRECT_ARQ_PEERS];
+    lora_direct_arq_stats_t sStats;
+    uint32_t ui32Random;
+    uint8_t ui8Session;
+
+    // towards the other node
+    uint16_t ui16Next;
+    uint16_t ui16Count;
+    uint16_t pui16Message[256]; // message of each sequence number
+    uint8_t pui8Result[TEST_MESSAGES];
+
+    // from the other node
+    uint8_t pui8Delivered[TEST_MESSAGES];
+    uint32_t ui32BusyUntil;
+    uint8_t ui8Rate; // last data rate announcement
+} test_node_t;
+
+typedef struct {
+    bool bUsed;
+    uint32_t ui32Node;
+    uint32_t ui32Time;
+    uint8_t ui8Length;
+    uint8_t pui8Frame[LORA_RADIO_MAX_PHYSICAL_PACKET];
+} test_frame_t;
+
+// percent of frames lost and duplicated, ms a frame may be held back
+typedef struct {
+    uint32_t ui32Loss;
+    uint32_t ui32Duplicate;
+    uint32_t ui32Reorder;
+} test_channel_t;
+
+static const uint16_t pui16Address[TEST_NODES] = {0x1001, 0x2002};
+
+static test_node_t gpsNodes[TEST_NODES];
+static test_frame_t gpsFrames[TEST_FRAMES];
+static test_channel_t gsChannel;
+static uint32_t gui32Now;
+static uint32_t gui32TestRandom;
+static uint32_t gui32Refuse;  // transmissions to refuse
+static uint32_t gui32Backoff; // ms the radio keeps refusing
+
+static uint32_t test_random(uint32_t ui32Range)
+{
+    gui32TestRandom ^= gui32TestRandom << 13;
+    gui32TestRandom ^= gui32TestRandom >> 17;
+    gui32TestRandom ^= gui32TestRandom << 5;
+
+    return gui32TestRandom % ui32Range;
+}
+
+static void test_node_enter(uint32_t ui32Node)
+{
+    test_node_t *psNode = &gpsNodes[ui32Node];
+
+    memcpy(&gsConfig, &psNode->sConfig, sizeof(gsConfig));
+    memcpy(gpsPeers, psNode->psPeers, sizeof(gpsPeers));
+    memcpy(&gsStats, &psNode->sStats, sizeof(gsStats));
+    gui32Random = psNode->ui32Random;
+    gui8Session = psNode->ui8Session;
+}
+
+static void test_node_leave(uint32_t ui32Node)
+{
+    test_node_t *psNode = &gpsNodes[ui32Node];
+
+    memcpy(&psNode->sConfig, &gsConfig, sizeof(gsConfig));
+    memcpy(psNode->psPeers, gpsPeers, sizeof(gpsPeers));
+    memcpy(&psNode->sStats, &gsStats, sizeof(gsStats));
+    psNode->ui32Random = gui32Random;
+    psNode->ui8Session = gui8Session;
+}
+
+static uint32_t test_airtime(void *pvContext, uint8_t ui8Length)
+{
+    return 20000 + ui8Length * 400;
+}
+
+static uint32_t test_backoff(void *pvContext, uint16_t ui16Peer,
+                             uint8_t ui8Length)
+{
+    return gui32Backoff;
+}
+
+// each node announces its own data rate
+static uint8_t test_rate(void *pvContext, uint16_t ui16Peer)
+{
+    return (LORA_RADIO_SF8 << 4) | (LORA_RADIO_SF7 + (uintptr_t)pvContext);
+}
+
+static void test_rate_update(void *pvContext, uint16_t ui16Peer,
+                             uint8_t ui8Rate)
+{
+    uint32_t ui32Node = (uint32_t)(uintptr_t)pvContext;
+
+    TEST_CHECK(ui16Peer == pui16Address[!ui32Node]);
+    gpsNodes[ui32Node].ui8Rate = ui8Rate;
+}
+
+static void test_frame_queue(uint32_t ui32Node, uint32_t ui32Time,
+                             const uint8_t *pui8Frame, uint8_t ui8Length)
+{
+    for (uint32_t i = 0; i < TEST_FRAMES; i++) {
+        test_frame_t *psFrame = &gpsFrames[i];
+
+        if (!psFrame->bUsed) {
+            psFrame->bUsed = true;
+            psFrame->ui32Node = ui32Node;
+            psFrame->ui32Time = ui32Time;
+            psFrame->ui8Length = ui8Length;
+            memcpy(psFrame->pui8Frame, pui8Frame, ui8Length);
+            return;
+        }
+    }
+
+    TEST_CHECK(0);
+}
+
+// one frame on the air at a time per node, then the channel decides
+static uint8_t test_transmit(void *pvContext, uint16_t ui16Peer,
+                             const uint8_t *pui8Frame, uint8_t ui8Length)
+{
+    uint32_t ui32Node = (uint32_t)(uintptr_t)pvContext;
+    test_node_t *psNode = &gpsNodes[ui32Node];
+    uint32_t ui32End;
+
+    TEST_CHECK(ui16Peer == pui16Address[!ui32Node]);
+    if (gui32Refuse) {
+        gui32Refuse--;
+        return false;
+    }
+
+    ui32End = psNode->ui32BusyUntil > gui32Now ? psNode->ui32BusyUntil
+                                               : gui32Now;
+    ui32End += (test_airtime(NULL, ui8Length) + 999) / 1000;
+    psNode->ui32BusyUntil = ui32End;
+
+    if (test_random(100) < gsChannel.ui32Loss) {
+        return true;
+    }
+
+    test_frame_queue(!ui32Node,
+                     ui32End + test_random(gsChannel.ui32Reorder + 1),
+                     pui8Frame, ui8Length);
+    if (test_random(100) < gsChannel.ui32Duplicate) {
+        test_frame_queue(!ui32Node,
+                         ui32End + test_random(gsChannel.ui32Reorder + 1),
+                         pui8Frame, ui8Length);
+    }
+
+    return true;
+}
+
+static void test_deliver(void *pvContext, uint16_t ui16Peer,
+                         const uint8_t *pui8Payload, uint8_t ui8Length)
+{
+    test_node_t *psNode = &gpsNodes[(uintptr_t)pvContext];
+    uint16_t ui16Message = pui8Payload[0] | (pui8Payload[1] << 8);
+
+    TEST_CHECK(ui8Length == TEST_LENGTH);
+    TEST_CHECK(ui16Message < TEST_MESSAGES);
+    if (ui16Message < TEST_MESSAGES) {
+        psNode->pui8Delivered[ui16Message]++;
+    }
+}
+
+static void test_result(void *pvContext, uint16_t ui16Peer,
+                        uint8_t ui8Sequence, uint8_t ui8Delivered)
+{
+    test_node_t *psNode = &gpsNodes[(uintptr_t)pvContext];
+
+    psNode->pui8Result[psNode->pui16Message[ui8Sequence]] =
+        ui8Delivered ? 1 : 2;
+}
+
+// (re)starts a node, the messages it still has to send are kept.  The
+// margin covers a full window waiting for the transmitter.
+static void test_node_init(uint32_t ui32Node, uint32_t ui32Seed)
+{
+    lora_direct_arq_config_t sConfig = {.ui16Address = pui16Address[ui32Node],
+                                        .ui8Window = LORA_DIRECT_ARQ_WINDOW,
+                                        .ui8Retries = 8,
+                                        .ui32AckDelay = 50,
+                                        .ui32Margin = 200,
+                                        .ui32Seed = ui32Seed,
+                                        .pfnTransmit = test_transmit,
+                                        .pfnAirtime = test_airtime,
+                                        .pfnBackoff = test_backoff,
+                                        .pfnDeliver = test_deliver,
+                                        .pfnResult = test_result,
+                                        .pfnRate = test_rate,
+                                        .pfnRateUpdate = test_rate_update,
+                                        .pvContext =
+                                            (void *)(uintptr_t)ui32Node};
+
+    TEST_CHECK(lora_direct_arq_init(&sConfig));
+    test_node_leave(ui32Node);
+}
+
+static void test_setup(const test_channel_t *psChannel)
+{
+    memset(gpsNodes, 0, sizeof(gpsNodes));
+    memset(gpsFrames, 0, sizeof(gpsFrames));
+    gsChannel = *psChannel;
+    gui32Now = 0;
+    gui32TestRandom = 0x2545F491;
+    gui32Refuse = 0;
+    gui32Backoff = 0;
+
+    test_node_init(0, 0x1000);
+    test_node_init(1, 0x1001);
+}
+
+static bool test_done(void)
+{
+    for (uint32_t i = 0; i < TEST_FRAMES; i++) {
+        if (gpsFrames[i].bUsed) {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < TEST_NODES; i++) {
+        test_node_t *psNode = &gpsNodes[i];
+
+        for (uint32_t j = 0; j < psNode->ui16Count; j++) {
+            if (psNode->pui8Result[j] == 0) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// both nodes send their messages as fast as the window lets them, 1 ms
+// per step
+static void test_run(void)
+{
+    for (; gui32Now < TEST_TIME_MAX && !test_done(); gui32Now++) {
+        for (uint32_t i = 0; i < TEST_FRAMES; i++) {
+            test_frame_t sFrame = gpsFrames[i];
+
+            if (!sFrame.bUsed || sFrame.ui32Time > gui32Now) {
+                continue;
+            }
+
+            gpsFrames[i].bUsed = false;
+            test_node_enter(sFrame.ui32Node);
+            lora_direct_arq_receive(sFrame.pui8Frame, sFrame.ui8Length,
+                                    gui32Now);
+            test_node_leave(sFrame.ui32Node);
+        }
+
+        for (uint32_t i = 0; i < TEST_NODES; i++) {
+            test_node_t *psNode = &gpsNodes[i];
+
+            test_node_enter(i);
+            while (psNode->ui16Next < psNode->ui16Count) {
+                uint8_t pui8Payload[TEST_LENGTH] = {
+                    psNode->ui16Next & 0xFF, psNode->ui16Next >> 8};
+                uint32_t ui32Sequence = lora_direct_arq_send(
+                    pui16Address[!i], pui8Payload, TEST_LENGTH, gui32Now);
+
+                if (ui32Sequence == 0) {
+                    break;
+                }
+                psNode->pui16Message[ui32Sequence - 1] = psNode->ui16Next++;
+            }
+            lora_direct_arq_process(gui32Now);
+            test_node_leave(i);
+        }
+    }
+
+    TEST_CHECK(test_done());
+}
+
+// every message has an outcome that matches what the other node got:
+// acknowledged ones were delivered, none of them twice
+static uint32_t test_check_delivery(uint32_t ui32Node)
+{
+    test_node_t *psNode = &gpsNodes[ui32Node];
+    test_node_t *psPeer = &gpsNodes[!ui32Node];
+    uint32_t ui32Delivered = 0;
+
+    for (uint32_t i = 0; i < psNode->ui16Count; i++) {
+        TEST_CHECK(psPeer->pui8Delivered[i] <= 1);
+        TEST_CHECK(psNode->pui8Result[i] != 1 || psPeer->pui8Delivered[i]);
+        TEST_CHECK(psNode->pui8Result[i] != 0);
+        ui32Delivered += psPeer->pui8Delivered[i] ? 1 : 0;
+    }
+
+    return ui32Delivered;
+}
+
+static void test_arq_clean(void)
+{
+    const test_channel_t sChannel = {0};
+
+    test_setup(&sChannel);
+    gpsNodes[0].ui16Count = TEST_MESSAGES;
+    gpsNodes[1].ui16Count = TEST_MESSAGES;
+    test_run();
+
+    for (uint32_t i = 0; i < TEST_NODES; i++) {
+        TEST_CHECK(test_check_delivery(i) == TEST_MESSAGES);
+        TEST_CHECK(gpsNodes[i].sStats.ui32Sent == TEST_MESSAGES);
+        TEST_CHECK(gpsNodes[i].sStats.ui32Acknowledged == TEST_MESSAGES);
+        TEST_CHECK(gpsNodes[i].sStats.ui32Retransmissions == 0);
+        TEST_CHECK(gpsNodes[i].sStats.ui32Duplicates == 0);
+        TEST_CHECK(gpsNodes[i].ui8Rate == test_rate((void *)(uintptr_t)!i,
+                                                    pui16Address[i]));
+    }
+}
+
+// 20 % loss, 10 % duplicates and frames held back by up to two frame times
+static void test_arq_lossy(void)
+{
+    const test_channel_t sChannel = {
+        .ui32Loss = 20, .ui32Duplicate = 10, .ui32Reorder = 60};
+
+    test_setup(&sChannel);
+    gpsNodes[0].ui16Count = TEST_MESSAGES;
+    gpsNodes[1].ui16Count = TEST_MESSAGES;
+    test_run();
+
+    for (uint32_t i = 0; i < TEST_NODES; i++) {
+        lora_direct_arq_stats_t *psStats = &gpsNodes[i].sStats;
+
+        TEST_CHECK(test_check_delivery(i) >= TEST_MESSAGES * 95 / 100);
+        TEST_CHECK(psStats->ui32Acknowledged + psStats->ui32Failed ==
+                   TEST_MESSAGES);
+        TEST_CHECK(psStats->ui32Retransmissions > 0);
+        TEST_CHECK(psStats->ui32Duplicates > 0);
+    }
+}
+
+// a frame the radio refused goes out later without counting as a
+// retransmission
+static void test_arq_refused(void)
+{
+    const test_channel_t sChannel = {0};
+
+    test_setup(&sChannel);
+    gpsNodes[0].ui16Count = 1;
+    gui32Refuse = 3;
+    test_run();
+
+    TEST_CHECK(test_check_delivery(0) == 1);
+    TEST_CHECK(gpsNodes[0].pui8Result[0] == 1);
+    TEST_CHECK(gpsNodes[0].sStats.ui32Retransmissions == 0);
+    TEST_CHECK(gpsNodes[0].sStats.ui32Refused == 3);
+    TEST_CHECK(gui32Refuse == 0);
+}
+
+// A radio that keeps refusing fails the frame after ui8Retries + 1 offers,
+// each one after the backoff the radio asked for rather than the margin.
+static void test_arq_refused_bound(void)
+{
+    const test_channel_t sChannel = {0};
+
+    test_setup(&sChannel);
+    gpsNodes[0].ui16Count = 1;
+    gui32Refuse = 1000;
+    gui32Backoff = 5000;
+    test_run();
+
+    TEST_CHECK(gpsNodes[0].pui8Result[0] == 2);
+    TEST_CHECK(gpsNodes[0].sStats.ui32Failed == 1);
+    TEST_CHECK(gpsNodes[0].sStats.ui32Refused == 9);
+    TEST_CHECK(gui32Refuse == 1000 - 9);
+    TEST_CHECK(gui32Now == 8 * 5001 + 1);
+
+    // a frame that never fits the budget fails on the first refusal
+    test_setup(&sChannel);
+    gpsNodes[0].ui16Count = 1;
+    gui32Refuse = 1000;
+    gui32Backoff = UINT32_MAX;
+    test_run();
+
+    TEST_CHECK(gpsNodes[0].pui8Result[0] == 2);
+    TEST_CHECK(gpsNodes[0].sStats.ui32Refused == 1);
+    TEST_CHECK(gui32Now == 1);
+}
+
+// session and first sequence number of a node started with the seed
+static void test_node_first(uint32_t ui32Seed, uint8_t *pui8Session,
+                            uint8_t *pui8Sequence)
+{
+    arq_peer_t *psPeer;
+
+    test_node_init(0, ui32Seed);
+    test_node_enter(0);
+    psPeer = arq_peer_get(pui16Address[1], gui32Now);
+    *pui8Session = gui8Session;
+    *pui8Sequence = psPeer->ui8TxNext;
+    test_node_leave(0);
+}
+
+// seeds as close as the chip IDs of one lot still start apart
+static void test_arq_seed(void)
+{
+    const test_channel_t sChannel = {0};
+    uint8_t ui8SessionA, ui8SequenceA, ui8SessionB, ui8SequenceB;
+
+    test_setup(&sChannel);
+    test_node_first(0x1000, &ui8SessionA, &ui8SequenceA);
+    test_node_first(0x1001, &ui8SessionB, &ui8SequenceB);
+    TEST_CHECK(ui8SessionA != ui8SessionB);
+    TEST_CHECK(ui8SequenceA != ui8SequenceB);
+
+    test_node_first(0x1000, &ui8SessionB, &ui8SequenceB);
+    TEST_CHECK(ui8SessionA == ui8SessionB);
+    TEST_CHECK(ui8SequenceA == ui8SequenceB);
+}
+
+// The sender restarts and its new first sequence number is the last one
+// the receiver saw, which looks like a copy of an old frame unless the
+// session tells them apart.
+static void test_arq_restart(void)
+{
+    const test_channel_t sChannel = {0};
+    uint8_t ui8Session, ui8Sequence;
+    arq_peer_t *psPeer;
+    uint8_t ui8RxSession, ui8RxLast;
+    uint32_t ui32Seed;
+
+    test_setup(&sChannel);
+    gpsNodes[0].ui16Count = TEST_MESSAGES / 2;
+    test_run();
+    TEST_CHECK(test_check_delivery(0) == TEST_MESSAGES / 2);
+
+    test_node_enter(1);
+    psPeer = arq_peer_find(pui16Address[0]);
+    ui8RxSession = psPeer->ui8RxSession;
+    ui8RxLast = psPeer->ui8RxNext - 1;
+    test_node_leave(1);
+
+    for (ui32Seed = 1; ui32Seed < 0x100000; ui32Seed++) {
+        test_node_first(ui32Seed, &ui8Session, &ui8Sequence);
+        if (ui8Session != ui8RxSession && ui8Sequence == ui8RxLast) {
+            break;
+        }
+    }
+    TEST_CHECK(ui32Seed < 0x100000);
+
+    test_node_init(0, ui32Seed);
+    gpsNodes[0].ui16Count = TEST_MESSAGES;
+    test_run();
+
+    TEST_CHECK(test_check_delivery(0) == TEST_MESSAGES);
+    for (uint32_t i = 0; i < TEST_MESSAGES; i++) {
+        TEST_CHECK(gpsNodes[0].pui8Result[i] == 1);
+    }
+    TEST_CHECK(gpsNodes[1].sStats.ui32Duplicates == 0);
+}
+
+// The sender restarts while both nodes keep sending over a lossy channel.
+// The receiver acknowledges frames of the old session on its data until it
+// hears the new one, and the new first sequence number is one those
+// acknowledgements cover, so without the session echo the sender takes
+// frames the receiver never got as delivered.  The other way round frames
+// held back behind the first one the restarted node hears still count.
+static void test_arq_restart_lossy(void)
+{
+    const test_channel_t sChannel = {
+        .ui32Loss = 20, .ui32Duplicate = 10, .ui32Reorder = 60};
+    uint8_t ui8Session, ui8Sequence;
+    arq_peer_t *psPeer;
+    uint8_t ui8RxSession, ui8RxLast;
+    uint32_t ui32Seed;
+
+    test_setup(&sChannel);
+    gpsNodes[0].ui16Count = TEST_MESSAGES / 2;
+    gpsNodes[1].ui16Count = TEST_MESSAGES / 2;
+    test_run();
+
+    test_node_enter(1);
+    psPeer = arq_peer_find(pui16Address[0]);
+    ui8RxSession = psPeer->ui8RxSession;
+    ui8RxLast = psPeer->ui8RxNext - 1;
+    test_node_leave(1);
+
+    for (ui32Seed = 1; ui32Seed < 0x100000; ui32Seed++) {
+        test_node_first(ui32Seed, &ui8Session, &ui8Sequence);
+        if (ui8Session != ui8RxSession && ui8Sequence == ui8RxLast) {
+            break;
+        }
+    }
+    TEST_CHECK(ui32Seed < 0x100000);
+
+    test_node_init(0, ui32Seed);
+    gpsNodes[0].ui16Count = TEST_MESSAGES;
+    gpsNodes[1].ui16Count = TEST_MESSAGES;
+    test_run();
+
+    for (uint32_t i = 0; i < TEST_NODES; i++) {
+        TEST_CHECK(test_check_delivery(i) >= TEST_MESSAGES * 95 / 100);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_arq_clean);
+    TEST_RUN(test_arq_lossy);
+    TEST_RUN(test_arq_refused);
+    TEST_RUN(test_arq_refused_bound);
+    TEST_RUN(test_arq_seed);
+    TEST_RUN(test_arq_restart);
+    TEST_RUN(test_arq_restart_lossy);
+
+    return test_summary("test_arq");
+}
@@ -0,0 +1,659 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+// lora_direct on the FreeRTOS shim.  The board radio belongs to the
+// lora_direct task, a peer radio is driven directly through the driver.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <semphr.h>
+#include <task.h>
+
+#include "nm_devices_lora.h"
+#include "sim.h"
+#include "test.h"
+
+#include "task_message.h"
+
+#include "lora_direct_airtime.h"
+#include "lora_direct_config.h"
+#include "lora_direct_filter.h"
+#include "lora_direct_link.h"
+#include "lora_direct_adr.h"
+#include "lora_direct_task.h"
+
+#define TEST_TASK_PRIORITY 3
+
+static void *gpPeer;
+static int32_t gi32NodeLocal;
+static int32_t gi32NodePeer;
+static lora_radio_profile_t gsPeerProfile;
+static QueueHandle_t gsEvents;
+
+static volatile uint32_t gui32PeerTxDone;
+static volatile uint32_t gui32PeerRxDone;
+static uint8_t gpui8PeerPayload[256];
+static uint8_t gui8PeerLength;
+static int16_t gi16PeerRssi;
+
+static const lora_radio_hw_config_t gsPeerConfig = {.ui32IomModule = 0,
+                                                    .ui32PinReset = 10,
+                                                    .ui32PinBusy = 11,
+                                                    .ui32PinDio1 = 12,
+                                                    .ui32PinDio3 = 13};
+
+// the application owns the lora_direct radio configuration
+void lora_direct_radio_configuration_reset(void)
+{
+    gsLoRaModulationParameter.eSpreadingFactor = LORA_RADIO_SF7;
+    gsLoRaModulationParameter.eBandwidth = LORA_RADIO_BW_125;
+    gsLoRaModulationParameter.eCodingRate = LORA_CR_4_5;
+    gsLoRaModulationParameter.eLowDataRateOptimization =
+        LORA_RADIO_LDR_OPT_OFF;
+
+    gsLoRaPacketParameter.ui16PreambleLength = 8;
+    gsLoRaPacketParameter.ePacketLength = LORA_RADIO_PACKET_LENGTH_VARIABLE;
+    gsLoRaPacketParameter.ui8PayloadLength = LORA_RADIO_MAX_PHYSICAL_PACKET;
+    gsLoRaPacketParameter.eCRC = LORA_RADIO_CRC_ON;
+    gsLoRaPacketParameter.eIQ = LORA_RADIO_IQ_STANDARD;
+}
+
+// 1 % of a 16 s window around 868.3 MHz, three short SF7 packets fit
+static const lora_direct_subband_t gsTestSubband = {868000000, 868600000, 100};
+
+// replaces the EU 868 MHz default
+void lora_direct_airtime_configuration_reset(void)
+{
+    lora_direct_airtime_init(&gsTestSubband, 1, 16000);
+}
+
+void am_iomaster0_isr(void)
+{
+    lora_radio_iom_isr(gpPeer);
+}
+
+static void peer_tx_done(void *pvArg)
+{
+    gui32PeerTxDone++;
+}
+
+static void peer_rx_done(void *pvArg)
+{
+    lora_radio_physical_packet_t *psPacket = pvArg;
+
+    gui32PeerRxDone++;
+    gui8PeerLength = psPacket->ui8PayloadLength;
+    gi16PeerRssi = psPacket->i16Rssi;
+    memcpy(gpui8PeerPayload, psPacket->pui8Payload, gui8PeerLength);
+}
+
+static void peer_receive(void)
+{
+    lora_radio_transfer_t sRx = {.ui32Frequency = lora_radio_frequency,
+                                 .ui32Timeout = 0xFFFFFF00,
+                                 .psProfile = &gsPeerProfile,
+                                 .eMode = LORA_RADIO_RX};
+
+    TEST_CHECK(lora_radio_transfer(gpPeer, &sRx) ==
+               LORA_RADIO_STATUS_SUCCESS);
+}
+
+static void peer_transmit(const uint8_t *pui8Payload, uint8_t ui8Length)
+{
+    lora_radio_transfer_t sTx = {.ui32Frequency = lora_radio_frequency,
+                                 .ui32Timeout = 0xFFFFFF00,
+                                 .psProfile = &gsPeerProfile,
+                                 .pui8Payload = (uint8_t *)pui8Payload,
+                                 .ui8PayloadLength = ui8Length,
+                                 .ui8Power = 14,
+                                 .eMode = LORA_RADIO_TX};
+
+    TEST_CHECK(lora_radio_transfer(gpPeer, &sTx) ==
+               LORA_RADIO_STATUS_SUCCESS);
+}
+
+// waits for a lora_direct notification, returns 0 on timeout
+static uint8_t test_event_wait(uint32_t ui32Event, uint32_t ui32Ms,
+                               task_message_t *psMessage)
+{
+    TickType_t xEnd = xTaskGetTickCount() + pdMS_TO_TICKS(ui32Ms);
+    task_message_t sMessage;
+
+    while (xTaskGetTickCount() < xEnd) {
+        if (xQueueReceive(gsEvents, &sMessage, xEnd - xTaskGetTickCount()) !=
+            pdPASS) {
+            break;
+        }
+        if (sMessage.ui32Event == ui32Event) {
+            if (psMessage) {
+                *psMessage = sMessage;
+            } else if (ui32Event == RXDONE) {
+                lora_radio_packet_release(sMessage.psContent);
+            }
+            return 1;
+        }
+        if (sMessage.ui32Event == RXDONE) {
+            lora_radio_packet_release(sMessage.psContent);
+        }
+    }
+
+    return 0;
+}
+
+static void test_setup(void)
+{
+    sim_sx1262_config_t sLocal = SIM_SX1262_BOARD_CONFIG;
+    sim_sx1262_config_t sPeer = {.ui32IomModule = 0,
+                                 .ui32PinReset = 10,
+                                 .ui32PinBusy = 11,
+                                 .ui32PinDio1 = 12,
+                                 .ui32PinDio3 = 13,
+                                 .dX = 100};
+
+    sim_freertos_init();
+
+    gi32NodeLocal = sim_sx1262_create(&sLocal);
+    gi32NodePeer = sim_sx1262_create(&sPeer);
+
+    // the task runs up to its first wait and takes the first radio context
+    xTaskCreate(lora_direct_task, "lora", 512, NULL, TEST_TASK_PRIORITY,
+                &lora_direct_task_handle);
+
+    gui32PeerTxDone = 0;
+    gui32PeerRxDone = 0;
+    TEST_CHECK(lora_radio_instance_initialize(&gpPeer, &gsPeerConfig) ==
+               LORA_RADIO_STATUS_SUCCESS);
+    lora_radio_callback_list_init(gpPeer);
+    lora_radio_callback_register(gpPeer, LORA_RADIO_TXDONE, peer_tx_done);
+    lora_radio_callback_register(gpPeer, LORA_RADIO_RXDONE, peer_rx_done);
+    lora_radio_profile_init(&gsPeerProfile, &gsLoRaModulationParameter,
+                            &gsLoRaPacketParameter, lora_radio_syncword);
+
+    // lora_direct keeps its counters across task restarts
+    lora_direct_stats_reset();
+
+    gsEvents = xQueueCreate(8, sizeof(task_message_t));
+    lora_direct_message_subscribe_events(
+        gsEvents,
+        LORA_DIRECT_EVENT(TXDONE) | LORA_DIRECT_EVENT(RXDONE) |
+            LORA_DIRECT_EVENT(TIMEOUT),
+        LORA_DIRECT_NOTIFY_DROP);
+}
+
+static void test_teardown(void)
+{
+    lora_radio_deinitialize(gpPeer);
+}
+
+static void test_send(void)
+{
+    uint8_t pui8Payload[] = "hello";
+
+    test_setup();
+
+    peer_receive();
+    TEST_CHECK(lora_direct_send(lora_radio_frequency, 14, pui8Payload,
+                                sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    TEST_CHECK(test_event_wait(TXDONE, 100, NULL));
+
+    vTaskDelay(pdMS_TO_TICKS(10));
+    TEST_CHECK(gui32PeerRxDone == 1);
+    TEST_CHECK(gui8PeerLength == sizeof(pui8Payload));
+    TEST_CHECK(memcmp(gpui8PeerPayload, pui8Payload, sizeof(pui8Payload)) ==
+               0);
+
+    test_teardown();
+}
+
+// after a transmission the task goes back to receive
+static void test_receive(void)
+{
+    uint8_t pui8Payload[] = "world";
+    lora_radio_physical_packet_t *psPacket;
+    lora_radio_packet_pool_stats_t sPool;
+    task_message_t sMessage;
+    uint8_t ui8Received;
+
+    test_setup();
+
+    for (uint32_t i = 0; i < 2; i++) {
+        peer_transmit(pui8Payload, sizeof(pui8Payload));
+        ui8Received = test_event_wait(RXDONE, 100, &sMessage);
+        TEST_CHECK(ui8Received);
+        if (!ui8Received) {
+            break;
+        }
+
+        psPacket = sMessage.psContent;
+        TEST_CHECK(psPacket->ui8PayloadLength == sizeof(pui8Payload));
+        TEST_CHECK(memcmp(psPacket->pui8Payload, pui8Payload,
+                          sizeof(pui8Payload)) == 0);
+        lora_radio_packet_release(psPacket);
+
+        lora_direct_send(lora_radio_frequency, 14, pui8Payload, 1);
+        TEST_CHECK(test_event_wait(TXDONE, 100, NULL));
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(10));
+    lora_radio_packet_pool_stats_get(NULL, &sPool);
+    TEST_CHECK(sPool.ui32InUse == 0);
+
+    test_teardown();
+}
+
+// queued packets go out back to back
+static void test_send_queue(void)
+{
+    uint8_t pui8Payload[16] = {0};
+    lora_direct_stats_t sStats;
+    uint32_t ui32TxDone = 0;
+
+    test_setup();
+
+    peer_receive();
+    for (uint32_t i = 0; i < 4; i++) {
+        pui8Payload[0] = i;
+        TEST_CHECK(lora_direct_send(lora_radio_frequency, 14, pui8Payload,
+                                    sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    }
+
+    while (test_event_wait(TXDONE, 200, NULL)) {
+        ui32TxDone++;
+        peer_receive();
+    }
+
+    TEST_CHECK(ui32TxDone == 4);
+    lora_direct_stats_get(&sStats);
+    TEST_CHECK(sStats.ui32TxCount == 4);
+    TEST_CHECK(sStats.ui32TxDropped == 0);
+    TEST_CHECK(sStats.ui32EventDropped == 0);
+
+    test_teardown();
+}
+
+// the duty cycle limit and a full transmit queue are told apart and only
+// packets that were queued count against the budget
+static void test_send_refused(void)
+{
+    uint8_t pui8Payload[16] = {0};
+    lora_direct_stats_t sStats;
+    uint32_t ui32Airtime;
+    uint32_t ui32Refused = 0;
+
+    test_setup();
+
+    ui32Airtime = lora_direct_airtime_get(&gsLoRaModulationParameter,
+                                          &gsLoRaPacketParameter,
+                                          sizeof(pui8Payload));
+    for (uint32_t i = 0; i < 3; i++) {
+        TEST_CHECK(lora_direct_send(868100000, 14, pui8Payload,
+                                    sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    }
+    TEST_CHECK(lora_direct_send(868100000, 14, pui8Payload,
+                                sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_DUTY_CYCLE);
+    TEST_CHECK(lora_direct_airtime_used(868100000) == 3 * ui32Airtime);
+
+    // the statistics take the radio lock, let the transmissions finish
+    while (test_event_wait(TXDONE, 200, NULL)) {
+    }
+    lora_direct_stats_get(&sStats);
+    TEST_CHECK(sStats.ui32TxCount == 3);
+    TEST_CHECK(sStats.ui32TxDropped == 1);
+    TEST_CHECK(sStats.ui32TxDutyCycle == 1);
+
+    // 915 MHz is not limited, sending faster than the radio fills the queue
+    for (uint32_t i = 0; i < 8; i++) {
+        lora_direct_send_e eResult = lora_direct_send(
+            lora_radio_frequency, 14, pui8Payload, sizeof(pui8Payload));
+
+        if (eResult != LORA_DIRECT_SEND_SUCCESS) {
+            TEST_CHECK(eResult == LORA_DIRECT_SEND_QUEUE_FULL);
+            ui32Refused++;
+        }
+    }
+    TEST_CHECK(ui32Refused > 0);
+    TEST_CHECK(lora_direct_airtime_used(868100000) == 3 * ui32Airtime);
+
+    while (test_event_wait(TXDONE, 200, NULL)) {
+    }
+    lora_direct_stats_get(&sStats);
+    TEST_CHECK(sStats.ui32TxCount == 3 + 8 - ui32Refused);
+    TEST_CHECK(sStats.ui32TxDropped == 1 + ui32Refused);
+    TEST_CHECK(sStats.ui32TxDutyCycle == 1);
+
+    test_teardown();
+}
+
+// lora_direct_send_to keeps the modulation the peer listens with and only
+// lowers the power once the link has margin to spare
+static void test_send_to(void)
+{
+    uint8_t pui8Payload[] = "peer";
+    lora_radio_physical_packet_t sPacket = {0};
+    int16_t i16Rssi;
+
+    test_setup();
+
+    peer_receive();
+    TEST_CHECK(lora_direct_send_to(5, pui8Payload, sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    TEST_CHECK(test_event_wait(TXDONE, 100, NULL));
+    vTaskDelay(pdMS_TO_TICKS(10));
+    TEST_CHECK(gui32PeerRxDone == 1);
+    i16Rssi = gi16PeerRssi;
+
+    // SF7 at 10 dB SNR is 7.5 dB above the 10 dB margin, 6 dB less power
+    sPacket.i16Snr = 10 * LORA_RADIO_QDB_PER_DB;
+    for (uint32_t i = 0; i < 8; i++) {
+        lora_direct_link_quality_update(5, lora_radio_frequency, &sPacket);
+    }
+
+    peer_receive();
+    TEST_CHECK(lora_direct_send_to(5, pui8Payload, sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    TEST_CHECK(test_event_wait(TXDONE, 100, NULL));
+    vTaskDelay(pdMS_TO_TICKS(10));
+    TEST_CHECK(gui32PeerRxDone == 2);
+    TEST_CHECK(gi16PeerRssi - i16Rssi <= -5 * LORA_RADIO_QDB_PER_DB);
+    TEST_CHECK(gi16PeerRssi - i16Rssi >= -7 * LORA_RADIO_QDB_PER_DB);
+
+    test_teardown();
+}
+
+// the peer radio at another spreading factor than the configured one
+static void peer_spreading_factor_set(lora_radio_spreading_factor_e eSF)
+{
+    lora_radio_modulation_t sModulation = gsLoRaModulationParameter;
+
+    sModulation.eSpreadingFactor = eSF;
+    lora_radio_profile_init(&gsPeerProfile, &sModulation,
+                            &gsLoRaPacketParameter, lora_radio_syncword);
+}
+
+// A peer announcing SF9 moves the receiver to SF9 and gets sent to at
+// SF9, packets at the configured SF7 are no longer heard.  Once the
+// announcement lapses both return to SF7.
+static void test_send_to_rate(void)
+{
+    uint8_t pui8Payload[] = "rate";
+
+    test_setup();
+
+    // the task re-arms the receiver before the peer starts
+    lora_direct_rate_update(5, (LORA_RADIO_SF9 << 4) | LORA_RADIO_SF9);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    TEST_CHECK(lora_direct_rate_announce(5) ==
+               ((LORA_RADIO_SF7 << 4) | LORA_RADIO_SF9));
+
+    peer_spreading_factor_set(LORA_RADIO_SF9);
+    peer_transmit(pui8Payload, sizeof(pui8Payload));
+    TEST_CHECK(test_event_wait(RXDONE, 500, NULL));
+
+    peer_receive();
+    TEST_CHECK(lora_direct_send_to(5, pui8Payload, sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    TEST_CHECK(test_event_wait(TXDONE, 500, NULL));
+    vTaskDelay(pdMS_TO_TICKS(10));
+    TEST_CHECK(gui32PeerRxDone == 1);
+
+    peer_spreading_factor_set(LORA_RADIO_SF7);
+    peer_transmit(pui8Payload, sizeof(pui8Payload));
+    TEST_CHECK(!test_event_wait(RXDONE, 100, NULL));
+
+    vTaskDelay(pdMS_TO_TICKS(LORA_DIRECT_ADR_RATE_HOLD_MS));
+    TEST_CHECK(lora_direct_rate_announce(5) ==
+               ((LORA_RADIO_SF7 << 4) | LORA_RADIO_SF7));
+    peer_transmit(pui8Payload, sizeof(pui8Payload));
+    TEST_CHECK(test_event_wait(RXDONE, 100, NULL));
+
+    peer_receive();
+    TEST_CHECK(lora_direct_send_to(5, pui8Payload, sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    TEST_CHECK(test_event_wait(TXDONE, 100, NULL));
+    vTaskDelay(pdMS_TO_TICKS(10));
+    TEST_CHECK(gui32PeerRxDone == 2);
+
+    test_teardown();
+}
+
+// A window gives up after LORA_DIRECT_RX_WINDOW_SYMBOLS and is not opened
+// again until the next transmission.  Continuous reception afterwards must
+// not inherit the symbol timeout the window left in the radio.
+static void test_receive_window(void)
+{
+    uint8_t pui8Payload[] = "window";
+    lora_direct_stats_t sStats;
+
+    test_setup();
+
+    lora_direct_receive_mode_set(LORA_DIRECT_RX_WINDOW);
+    lora_direct_receive(lora_radio_frequency);
+    TEST_CHECK(test_event_wait(TIMEOUT, 50, NULL));
+    TEST_CHECK(!test_event_wait(TIMEOUT, 100, NULL));
+
+    TEST_CHECK(lora_direct_send(lora_radio_frequency, 14, pui8Payload,
+                                sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    TEST_CHECK(test_event_wait(TXDONE, 100, NULL));
+    TEST_CHECK(test_event_wait(TIMEOUT, 50, NULL));
+
+    lora_direct_receive_mode_set(LORA_DIRECT_RX_CONTINUOUS);
+    lora_direct_receive(lora_radio_frequency);
+    TEST_CHECK(!test_event_wait(TIMEOUT, 200, NULL));
+    peer_transmit(pui8Payload, sizeof(pui8Payload));
+    TEST_CHECK(test_event_wait(RXDONE, 100, NULL));
+
+    lora_direct_stats_get(&sStats);
+    TEST_CHECK(sStats.ui32Timeouts == 2);
+
+    test_teardown();
+}
+
+// every subscriber owns a reference, the buffer returns to the pool with
+// the last one
+static void test_receive_shared(void)
+{
+    uint8_t pui8Payload[] = "shared";
+    lora_radio_packet_pool_stats_t sPool;
+    task_message_t sFirst, sSecond;
+    QueueHandle_t sQueue;
+
+    test_setup();
+
+    sQueue = xQueueCreate(4, sizeof(task_message_t));
+    TEST_CHECK(lora_direct_message_subscribe(sQueue, RXDONE));
+
+    peer_transmit(pui8Payload, sizeof(pui8Payload));
+    TEST_CHECK(test_event_wait(RXDONE, 100, &sFirst));
+    TEST_CHECK(xQueueReceive(sQueue, &sSecond, pdMS_TO_TICKS(10)) == pdPASS);
+    TEST_CHECK(sFirst.psContent == sSecond.psContent);
+
+    lora_radio_packet_pool_stats_get(NULL, &sPool);
+    TEST_CHECK(sPool.ui32InUse == 1);
+
+    lora_radio_packet_release(sFirst.psContent);
+    lora_radio_packet_pool_stats_get(NULL, &sPool);
+    TEST_CHECK(sPool.ui32InUse == 1);
+    TEST_CHECK(memcmp(((lora_radio_physical_packet_t *)sSecond.psContent)
+                          ->pui8Payload,
+                      pui8Payload, sizeof(pui8Payload)) == 0);
+
+    lora_radio_packet_release(sSecond.psContent);
+    lora_radio_packet_pool_stats_get(NULL, &sPool);
+    TEST_CHECK(sPool.ui32InUse == 0);
+
+    lora_direct_message_unsubscribe(sQueue, RXDONE);
+    test_teardown();
+}
+
+// Requests from other tasks wait for the transmission in flight instead of
+// aborting it, which used to leave the transmit queue stuck.
+static void test_receive_during_transmit(void)
+{
+    uint8_t pui8Payload[32] = {0};
+    uint32_t ui32TxDone = 0;
+
+    test_setup();
+
+    for (uint32_t i = 0; i < 2; i++) {
+        TEST_CHECK(lora_direct_send(lora_radio_frequency, 14, pui8Payload,
+                                    sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+        lora_direct_receive(lora_radio_frequency);
+    }
+
+    while (test_event_wait(TXDONE, 200, NULL)) {
+        ui32TxDone++;
+    }
+    TEST_CHECK(ui32TxDone == 2);
+
+    // the receiver is armed once the queue is empty
+    peer_transmit(pui8Payload, 4);
+    TEST_CHECK(test_event_wait(RXDONE, 100, NULL));
+
+    TEST_CHECK(lora_direct_send(lora_radio_frequency, 14, pui8Payload, 4) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    TEST_CHECK(test_event_wait(TXDONE, 100, NULL));
+
+    test_teardown();
+}
+
+// channel activity detection finds the radio busy with the transmission
+// and backs off until it is done
+static void test_lbt_during_transmit(void)
+{
+    uint8_t pui8Payload[32] = {0};
+    uint32_t ui32TxDone = 0;
+
+    test_setup();
+
+    peer_receive();
+    TEST_CHECK(lora_direct_send(lora_radio_frequency, 14, pui8Payload,
+                                sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    TEST_CHECK(lora_direct_send_lbt(lora_radio_frequency, 14, pui8Payload,
+                                    4) == LORA_DIRECT_SEND_SUCCESS);
+
+    while (test_event_wait(TXDONE, 200, NULL)) {
+        ui32TxDone++;
+        peer_receive();
+    }
+    TEST_CHECK(ui32TxDone == 2);
+    TEST_CHECK(gui32PeerRxDone == 2);
+    TEST_CHECK(gui8PeerLength == 4);
+
+    test_teardown();
+}
+
+// a holder of the radio lock may call functions that take it again
+static void test_radio_lock_nested(void)
+{
+    uint8_t pui8Payload[] = "hello";
+    lora_direct_stats_t sStats;
+
+    test_setup();
+
+    lora_direct_radio_lock();
+    lora_direct_stats_get(&sStats);
+    lora_direct_radio_unlock();
+
+    // released by the outermost unlock, the task gets the radio again
+    peer_receive();
+    TEST_CHECK(lora_direct_send(lora_radio_frequency, 14, pui8Payload,
+                                sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    TEST_CHECK(test_event_wait(TXDONE, 100, NULL));
+    vTaskDelay(pdMS_TO_TICKS(10));
+    TEST_CHECK(gui32PeerRxDone == 1);
+
+    test_teardown();
+}
+
+// a radio reset behind the back of the task is caught by the watchdog
+static void test_transmit_watchdog(void)
+{
+    uint8_t pui8Payload[32] = {0};
+    lora_direct_stats_t sStats;
+
+    test_setup();
+
+    peer_receive();
+    TEST_CHECK(lora_direct_send(lora_radio_frequency, 14, pui8Payload,
+                                sizeof(pui8Payload)) ==
+               LORA_DIRECT_SEND_SUCCESS);
+
+    // the console deinit and init commands while the packet is on air
+    vTaskDelay(pdMS_TO_TICKS(10));
+    lora_direct_radio_lock();
+    lora_radio_deinitialize(NULL);
+    lora_radio_initialize(NULL);
+    lora_direct_radio_unlock();
+
+    TEST_CHECK(test_event_wait(TXDONE, 1000, NULL));
+    vTaskDelay(pdMS_TO_TICKS(10));
+    TEST_CHECK(gui32PeerRxDone == 1);
+
+    TEST_CHECK(lora_direct_send(lora_radio_frequency, 14, pui8Payload, 4) ==
+               LORA_DIRECT_SEND_SUCCESS);
+    TEST_CHECK(test_event_wait(TXDONE, 100, NULL));
+
+    lora_direct_stats_get(&sStats);
+    TEST_CHECK(sStats.ui32TxCount == 2);
+    TEST_CHECK(sStats.ui32TxDropped == 0);
+
+    test_teardown();
+}
+
+int main(void)
+{
+    TEST_RUN(test_send);
+    TEST_RUN(test_receive);
+    TEST_RUN(test_send_queue);
+    TEST_RUN(test_send_refused);
+    TEST_RUN(test_send_to);
+    TEST_RUN(test_send_to_rate);
+    TEST_RUN(test_receive_shared);
+    TEST_RUN(test_receive_window);
+    TEST_RUN(test_receive_during_transmit);
+    TEST_RUN(test_lbt_during_transmit);
+    TEST_RUN(test_transmit_watchdog);
+    TEST_RUN(test_radio_lock_nested);
+
+    return test_summary("test_lora_direct");
+}
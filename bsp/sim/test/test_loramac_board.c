@@ -0,0 +1,384 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+// LoRaMAC board layer tests: features/loramac-node/src/boards/nm180100/
+// sx1262-board.c unchanged against a simulated radio on the board wiring,
+// with a second radio driven by nm_devices_sx1262 as the far end.  The
+// LoRaMac-node core is not built, the tests issue the SX126x commands the
+// core would.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sx126x-board.h>
+
+#include "nm_devices_lora.h"
+#include "sim.h"
+#include "test.h"
+
+#define TEST_FREQUENCY 915000000
+#define TEST_LENGTH 20
+
+static void *gpPeer;
+static int32_t gi32Board;
+static int32_t gi32Peer;
+
+static volatile uint32_t gui32Dio1;
+static uint32_t gui32PeerTxDone;
+static uint32_t gui32PeerRxDone;
+static uint8_t gpui8PeerPayload[256];
+static uint8_t gui8PeerLength;
+
+static lora_radio_profile_t gsProfile;
+static uint8_t gpui8Payload[TEST_LENGTH];
+
+static const lora_radio_hw_config_t gsPeerConfig = {.ui32IomModule = 0,
+                                                    .ui32ChipSelect = 0,
+                                                    .ui32PinReset = 10,
+                                                    .ui32PinBusy = 11,
+                                                    .ui32PinDio1 = 12,
+                                                    .ui32PinDio3 = 13};
+
+void am_iomaster0_isr(void)
+{
+    lora_radio_iom_isr(gpPeer);
+}
+
+static void board_dio1(void *pvContext)
+{
+    gui32Dio1++;
+}
+
+static void peer_tx_done(void *pvArg)
+{
+    gui32PeerTxDone++;
+}
+
+static void peer_rx_done(void *pvArg)
+{
+    lora_radio_physical_packet_t *psPacket = pvArg;
+
+    gui32PeerRxDone++;
+    if (psPacket && !psPacket->ui8CrcError) {
+        gui8PeerLength = psPacket->ui8PayloadLength;
+        memcpy(gpui8PeerPayload, psPacket->pui8Payload, gui8PeerLength);
+    }
+}
+
+// the start of SX126xInit() in LoRaMac-node
+static void test_setup(void)
+{
+    sim_sx1262_config_t sBoard = SIM_SX1262_BOARD_CONFIG;
+    sim_sx1262_config_t sPeer = {.ui32IomModule = 0,
+                                 .ui32PinReset = 10,
+                                 .ui32PinBusy = 11,
+                                 .ui32PinDio1 = 12,
+                                 .ui32PinDio3 = 13,
+                                 .dX = 100};
+
+    gui32Dio1 = 0;
+    gui32PeerTxDone = 0;
+    gui32PeerRxDone = 0;
+    gui8PeerLength = 0;
+    for (uint32_t i = 0; i < sizeof(gpui8Payload); i++) {
+        gpui8Payload[i] = i * 11;
+    }
+
+    gi32Board = sim_sx1262_create(&sBoard);
+    gi32Peer = sim_sx1262_create(&sPeer);
+
+    SX126xIoInit();
+    SX126xReset();
+    SX126xIoIrqInit(board_dio1);
+    SX126xWakeup();
+}
+
+static void test_teardown(void)
+{
+    SX126xIoDeInit();
+    if (gpPeer) {
+        lora_radio_deinitialize(gpPeer);
+        gpPeer = NULL;
+    }
+}
+
+static void test_peer_setup(void)
+{
+    lora_radio_modulation_t sModulation = {LORA_RADIO_SF7, LORA_RADIO_BW_125,
+                                           LORA_CR_4_5, 0};
+    lora_radio_packet_t sPacket = {8, LORA_RADIO_PACKET_LENGTH_VARIABLE, 255,
+                                   LORA_RADIO_CRC_ON, LORA_RADIO_IQ_STANDARD};
+
+    TEST_CHECK(lora_radio_instance_initialize(&gpPeer, &gsPeerConfig) ==
+               LORA_RADIO_STATUS_SUCCESS);
+    lora_radio_callback_list_init(gpPeer);
+    lora_radio_callback_register(gpPeer, LORA_RADIO_TXDONE, peer_tx_done);
+    lora_radio_callback_register(gpPeer, LORA_RADIO_RXDONE, peer_rx_done);
+    TEST_CHECK(lora_radio_profile_init(&gsProfile, &sModulation, &sPacket,
+                                       0x1424) == LORA_RADIO_STATUS_SUCCESS);
+}
+
+// LoRa at SF7, 125 kHz, 4/5 with the profile of the peer, the way
+// RadioSetTxConfig() and RadioSetRxConfig() program the chip
+static void test_board_lora_setup(uint8_t ui8Length)
+{
+    uint32_t ui32Frequency =
+        (uint32_t)(((uint64_t)TEST_FREQUENCY << 25) / 32000000);
+    uint8_t pui8Type[1] = {0x01};
+    uint8_t pui8Frequency[4] = {ui32Frequency >> 24, ui32Frequency >> 16,
+                                ui32Frequency >> 8, ui32Frequency};
+    uint8_t pui8Modulation[4] = {7, 0x04, 0x01, 0x00};
+    uint8_t pui8Packet[6] = {0x00, 8, 0x00, ui8Length, 0x01, 0x00};
+    uint8_t pui8Base[2] = {0x00, 0x00};
+    uint8_t pui8Irq[8] = {0x02, 0x03, 0x02, 0x03, 0, 0, 0, 0};
+
+    SX126xWriteCommand(RADIO_SET_PACKETTYPE, pui8Type, 1);
+    SX126xWriteCommand(RADIO_SET_RFFREQUENCY, pui8Frequency, 4);
+    SX126xWriteCommand(RADIO_SET_MODULATIONPARAMS, pui8Modulation, 4);
+    SX126xWriteCommand(RADIO_SET_PACKETPARAMS, pui8Packet, 6);
+    SX126xWriteCommand(RADIO_SET_BUFFERBASEADDRESS, pui8Base, 2);
+    SX126xWriteCommand(RADIO_CFG_DIOIRQ, pui8Irq, 8);
+}
+
+static uint16_t test_board_irq_take(void)
+{
+    uint8_t pui8Status[2];
+    uint8_t pui8Clear[2] = {0xFF, 0xFF};
+
+    SX126xReadCommand(RADIO_GET_IRQSTATUS, pui8Status, 2);
+    SX126xWriteCommand(RADIO_CLR_IRQSTATUS, pui8Clear, 2);
+
+    return (pui8Status[0] << 8) | pui8Status[1];
+}
+
+static uint32_t test_busy_violations(int32_t i32Node)
+{
+    sim_sx1262_stats_t sStats;
+
+    sim_sx1262_stats_get(i32Node, &sStats);
+    return sStats.ui32BusyViolations;
+}
+
+// reset, wake up and status through the board layer, no command may reach
+// the chip while BUSY is high
+static void test_board_init(void)
+{
+    uint8_t ui8Unused;
+    uint8_t ui8Status;
+
+    test_setup();
+
+    TEST_CHECK(SX126xGetDeviceId() == SX1262);
+    TEST_CHECK(SX126xGetOperatingMode() == MODE_STDBY_RC);
+
+    ui8Status = SX126xReadCommand(RADIO_GET_STATUS, &ui8Unused, 0);
+    TEST_CHECK(((ui8Status >> 4) & 0x07) == 0x02);
+
+    SX126xIoRfSwitchInit();
+    TEST_CHECK(test_busy_violations(gi32Board) == 0);
+
+    test_teardown();
+}
+
+static void test_board_registers(void)
+{
+    uint8_t pui8Sync[2] = {0x34, 0x44};
+    uint8_t pui8Read[2] = {0};
+
+    test_setup();
+
+    SX126xReadRegisters(REG_LR_SYNCWORD, pui8Read, 2);
+    TEST_CHECK((pui8Read[0] == 0x14) && (pui8Read[1] == 0x24));
+
+    SX126xWriteRegisters(REG_LR_SYNCWORD, pui8Sync, 2);
+    SX126xReadRegisters(REG_LR_SYNCWORD, pui8Read, 2);
+    TEST_CHECK(memcmp(pui8Read, pui8Sync, 2) == 0);
+    TEST_CHECK(SX126xReadRegister(REG_LR_SYNCWORD + 1) == 0x44);
+
+    SX126xWriteRegister(REG_OCP, 0x20);
+    TEST_CHECK(SX126xReadRegister(REG_OCP) == 0x20);
+
+    TEST_CHECK(test_busy_violations(gi32Board) == 0);
+
+    test_teardown();
+}
+
+static void test_board_buffer(void)
+{
+    uint8_t pui8Write[255];
+    uint8_t pui8Read[255];
+
+    test_setup();
+
+    for (uint32_t i = 0; i < sizeof(pui8Write); i++) {
+        pui8Write[i] = i ^ 0xA5;
+    }
+
+    SX126xWriteBuffer(0x00, pui8Write, 255);
+    memset(pui8Read, 0, sizeof(pui8Read));
+    SX126xReadBuffer(0x00, pui8Read, 255);
+    TEST_CHECK(memcmp(pui8Read, pui8Write, 255) == 0);
+
+    // an offset into the buffer
+    memset(pui8Read, 0, sizeof(pui8Read));
+    SX126xReadBuffer(0x40, pui8Read, 16);
+    TEST_CHECK(memcmp(pui8Read, &pui8Write[0x40], 16) == 0);
+
+    TEST_CHECK(test_busy_violations(gi32Board) == 0);
+
+    test_teardown();
+}
+
+// SX126xSetRfTxPower() goes through SX126xSetTxParams() of the core
+static void test_board_tx_power(void)
+{
+    test_setup();
+
+    SX126xSetRfTxPower(30);
+    TEST_CHECK(SX126xReadRegister(REG_OCP) == 0x38);
+    TEST_CHECK((SX126xReadRegister(REG_TX_CLAMP_CFG) & 0x1E) == 0x1E);
+    TEST_CHECK(test_busy_violations(gi32Board) == 0);
+
+    test_teardown();
+}
+
+// A register access to a sleeping chip wakes it through
+// SX126xCheckDeviceReady(), a warm start keeps the registers.
+static void test_board_sleep_wakeup(void)
+{
+    uint8_t ui8Sleep = 0x04;
+    sim_sx1262_stats_t sStats;
+
+    test_setup();
+
+    SX126xWriteRegister(REG_LR_SYNCWORD, 0x34);
+    SX126xWriteCommand(RADIO_SET_SLEEP, &ui8Sleep, 1);
+    SX126xSetOperatingMode(MODE_SLEEP);
+    test_run_for(1000);
+
+    TEST_CHECK(SX126xReadRegister(REG_LR_SYNCWORD) == 0x34);
+    TEST_CHECK(SX126xGetOperatingMode() == MODE_STDBY_RC);
+
+    sim_sx1262_stats_get(gi32Board, &sStats);
+    TEST_CHECK(sStats.ui32Wakeups == 1);
+    TEST_CHECK(sStats.ui32BusyViolations == 0);
+
+    test_teardown();
+}
+
+// a packet each way between the board and the peer, DIO1 reaches the
+// handler given to SX126xIoIrqInit()
+static void test_board_transfer(void)
+{
+    uint8_t pui8Timeout[3] = {0x00, 0x00, 0x00};
+    uint8_t pui8RxStatus[2];
+    uint8_t pui8Read[TEST_LENGTH];
+    lora_radio_transfer_t sRx = {.ui32Frequency = TEST_FREQUENCY,
+                                 .ui32Timeout = 0xFFFFFF00,
+                                 .psProfile = &gsProfile,
+                                 .eMode = LORA_RADIO_RX};
+    lora_radio_transfer_t sTx = {.ui32Frequency = TEST_FREQUENCY,
+                                 .ui32Timeout = 0xFFFFFF00,
+                                 .psProfile = &gsProfile,
+                                 .pui8Payload = gpui8Payload,
+                                 .ui8PayloadLength = TEST_LENGTH,
+                                 .ui8Power = 14,
+                                 .eMode = LORA_RADIO_TX};
+
+    test_setup();
+    test_peer_setup();
+
+    // board to peer
+    TEST_CHECK(lora_radio_transfer(gpPeer, &sRx) ==
+               LORA_RADIO_STATUS_SUCCESS);
+    test_board_lora_setup(TEST_LENGTH);
+    SX126xSetRfTxPower(14);
+    SX126xWriteBuffer(0x00, gpui8Payload, TEST_LENGTH);
+    SX126xWriteCommand(RADIO_SET_TX, pui8Timeout, 3);
+    SX126xSetOperatingMode(MODE_TX);
+    test_run_for(200000);
+
+    TEST_CHECK(gui32Dio1 == 1);
+    TEST_CHECK(test_board_irq_take() == IRQ_TX_DONE);
+    TEST_CHECK(gui32PeerRxDone == 1);
+    TEST_CHECK(gui8PeerLength == TEST_LENGTH);
+    TEST_CHECK(memcmp(gpui8PeerPayload, gpui8Payload, TEST_LENGTH) == 0);
+
+    // peer to board
+    test_board_lora_setup(255);
+    SX126xWriteCommand(RADIO_SET_RX, pui8Timeout, 3);
+    SX126xSetOperatingMode(MODE_RX);
+    TEST_CHECK(lora_radio_transfer(gpPeer, &sTx) ==
+               LORA_RADIO_STATUS_SUCCESS);
+    test_run_for(200000);
+
+    TEST_CHECK(gui32PeerTxDone == 1);
+    TEST_CHECK(gui32Dio1 == 2);
+    TEST_CHECK(test_board_irq_take() == IRQ_RX_DONE);
+    SX126xReadCommand(RADIO_GET_RXBUFFERSTATUS, pui8RxStatus, 2);
+    TEST_CHECK(pui8RxStatus[0] == TEST_LENGTH);
+    SX126xReadBuffer(pui8RxStatus[1], pui8Read, pui8RxStatus[0]);
+    TEST_CHECK(memcmp(pui8Read, gpui8Payload, TEST_LENGTH) == 0);
+
+    TEST_CHECK(test_busy_violations(gi32Board) == 0);
+
+    test_teardown();
+}
+
+// after SX126xIoDeInit() DIO1 no longer reaches the handler
+static void test_board_deinit(void)
+{
+    uint8_t pui8Timeout[3] = {0x00, 0x00, 0x00};
+
+    test_setup();
+
+    test_board_lora_setup(TEST_LENGTH);
+    SX126xWriteBuffer(0x00, gpui8Payload, TEST_LENGTH);
+    SX126xWriteCommand(RADIO_SET_TX, pui8Timeout, 3);
+    SX126xIoDeInit();
+    test_run_for(200000);
+
+    TEST_CHECK(gui32Dio1 == 0);
+}
+
+int main(void)
+{
+    TEST_RUN(test_board_init);
+    TEST_RUN(test_board_registers);
+    TEST_RUN(test_board_buffer);
+    TEST_RUN(test_board_tx_power);
+    TEST_RUN(test_board_sleep_wakeup);
+    TEST_RUN(test_board_transfer);
+    TEST_RUN(test_board_deinit);
+
+    return test_summary("test_loramac_board");
+}
@@ -0,0 +1,699 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+// Driver level tests: nm_devices_sx1262 against simulated radios.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nm_devices_lora.h"
+#include "sim.h"
+#include "test.h"
+
+#define TEST_FREQUENCY 915000000
+
+typedef struct {
+    uint32_t ui32TxDone;
+    uint32_t ui32RxDone;
+    uint32_t ui32CrcErrors;
+    uint32_t ui32Timeouts;
+    uint32_t ui32CadDone;
+    uint32_t ui32CadDetected;
+    uint8_t pui8Payload[256];
+    uint8_t ui8Length;
+} test_events_t;
+
+static void *gpRadioA;
+static void *gpRadioB;
+static void *gpRadioC;
+static int32_t gi32NodeA;
+static int32_t gi32NodeB;
+static test_events_t gsEventsA;
+static test_events_t gsEventsB;
+
+static lora_radio_profile_t gsProfile;
+static uint8_t gpui8Payload[32];
+
+static const lora_radio_hw_config_t gsConfigB = {
+    .ui32IomModule = 0,
+    .ui32ChipSelect = 0,
+    .ui32PinReset = 10,
+    .ui32PinBusy = 11,
+    .ui32PinDio1 = 12,
+    .ui32PinDio3 = 13};
+
+static const lora_radio_hw_config_t gsConfigC = {
+    .ui32IomModule = 1,
+    .ui32ChipSelect = 0,
+    .ui32PinReset = 20,
+    .ui32PinBusy = 21,
+    .ui32PinDio1 = 22,
+    .ui32PinDio3 = 23,
+    .ui32SpiClock = AM_HAL_IOM_8MHZ};
+
+void am_iomaster0_isr(void)
+{
+    lora_radio_iom_isr(gpRadioB);
+}
+
+void am_iomaster1_isr(void)
+{
+    lora_radio_iom_isr(gpRadioC);
+}
+
+static void test_events_record(test_events_t *psEvents, lora_radio_irq_e eIrq,
+                               void *pvArg)
+{
+    lora_radio_physical_packet_t *psPacket = pvArg;
+
+    switch (eIrq) {
+    case LORA_RADIO_TXDONE:
+        psEvents->ui32TxDone++;
+        break;
+    case LORA_RADIO_RXDONE:
+        psEvents->ui32RxDone++;
+        if (psPacket) {
+            psEvents->ui32CrcErrors += psPacket->ui8CrcError ? 1 : 0;
+            psEvents->ui8Length = psPacket->ui8PayloadLength;
+            memcpy(psEvents->pui8Payload, psPacket->pui8Payload,
+                   psPacket->ui8PayloadLength);
+        }
+        break;
+    case LORA_RADIO_TIMEOUT:
+        psEvents->ui32Timeouts++;
+        break;
+    case LORA_RADIO_CADDONE:
+        psEvents->ui32CadDone++;
+        break;
+    case LORA_RADIO_CADDETECTED:
+        psEvents->ui32CadDetected++;
+        break;
+    default:
+        break;
+    }
+}
+
+static void a_tx_done(void *pvArg)
+{
+    test_events_record(&gsEventsA, LORA_RADIO_TXDONE, pvArg);
+}
+
+static void b_rx_done(void *pvArg)
+{
+    test_events_record(&gsEventsB, LORA_RADIO_RXDONE, pvArg);
+}
+
+static void b_timeout(void *pvArg)
+{
+    test_events_record(&gsEventsB, LORA_RADIO_TIMEOUT, pvArg);
+}
+
+static void b_cad_done(void *pvArg)
+{
+    test_events_record(&gsEventsB, LORA_RADIO_CADDONE, pvArg);
+}
+
+static void b_cad_detected(void *pvArg)
+{
+    test_events_record(&gsEventsB, LORA_RADIO_CADDETECTED, pvArg);
+}
+
+// radio A on the board wiring transmits to radio B 100 m away
+static void test_setup(void)
+{
+    sim_sx1262_config_t sNodeA = SIM_SX1262_BOARD_CONFIG;
+    sim_sx1262_config_t sNodeB = {.ui32IomModule = 0,
+                                  .ui32PinReset = 10,
+                                  .ui32PinBusy = 11,
+                                  .ui32PinDio1 = 12,
+                                  .ui32PinDio3 = 13,
+                                  .dX = 100};
+    lora_radio_modulation_t sModulation = {LORA_RADIO_SF7, LORA_RADIO_BW_125,
+                                           LORA_CR_4_5, 0};
+    lora_radio_packet_t sPacket = {8, LORA_RADIO_PACKET_LENGTH_VARIABLE, 255,
+                                   LORA_RADIO_CRC_ON, LORA_RADIO_IQ_STANDARD};
+
+    memset(&gsEventsA, 0, sizeof(gsEventsA));
+    memset(&gsEventsB, 0, sizeof(gsEventsB));
+    for (uint32_t i = 0; i < sizeof(gpui8Payload); i++) {
+        gpui8Payload[i] = i * 7;
+    }
+
+    gi32NodeA = sim_sx1262_create(&sNodeA);
+    gi32NodeB = sim_sx1262_create(&sNodeB);
+
+    TEST_CHECK(lora_radio_initialize(&gpRadioA) == LORA_RADIO_STATUS_SUCCESS);
+    TEST_CHECK(lora_radio_instance_initialize(&gpRadioB, &gsConfigB) ==
+               LORA_RADIO_STATUS_SUCCESS);
+
+    lora_radio_callback_list_init(gpRadioA);
+    lora_radio_callback_list_init(gpRadioB);
+    lora_radio_callback_register(gpRadioA, LORA_RADIO_TXDONE, a_tx_done);
+    lora_radio_callback_register(gpRadioB, LORA_RADIO_RXDONE, b_rx_done);
+    lora_radio_callback_register(gpRadioB, LORA_RADIO_TIMEOUT, b_timeout);
+    lora_radio_callback_register(gpRadioB, LORA_RADIO_CADDONE, b_cad_done);
+    lora_radio_callback_register(gpRadioB, LORA_RADIO_CADDETECTED,
+                                 b_cad_detected);
+
+    TEST_CHECK(lora_radio_profile_init(&gsProfile, &sModulation, &sPacket,
+                                       0x1424) == LORA_RADIO_STATUS_SUCCESS);
+}
+
+static void test_teardown(void)
+{
+    lora_radio_deinitialize(gpRadioA);
+    lora_radio_deinitialize(gpRadioB);
+    if (gpRadioC) {
+        lora_radio_deinitialize(gpRadioC);
+        gpRadioC = NULL;
+    }
+}
+
+static void test_transmit(void *pHandle)
+{
+    lora_radio_transfer_t sTx = {.ui32Frequency = TEST_FREQUENCY,
+                                 .ui32Timeout = 0xFFFFFF00,
+                                 .psProfile = &gsProfile,
+                                 .pui8Payload = gpui8Payload,
+                                 .ui8PayloadLength = 20,
+                                 .ui8Power = 14,
+                                 .eMode = LORA_RADIO_TX};
+
+    TEST_CHECK(lora_radio_transfer(pHandle, &sTx) ==
+               LORA_RADIO_STATUS_SUCCESS);
+}
+
+static void test_receive(void *pHandle, uint32_t ui32Timeout)
+{
+    lora_radio_transfer_t sRx = {.ui32Frequency = TEST_FREQUENCY,
+                                 .ui32Timeout = ui32Timeout,
+                                 .psProfile = &gsProfile,
+                                 .eMode = LORA_RADIO_RX};
+
+    TEST_CHECK(lora_radio_transfer(pHandle, &sRx) ==
+               LORA_RADIO_STATUS_SUCCESS);
+}
+
+static void test_cad(void *pHandle)
+{
+    lora_radio_cad_t sCad = {LORA_RADIO_CAD_SYMBOL_2, 22, 10,
+                             LORA_RADIO_CAD_ONLY};
+    lora_radio_transfer_t sTransfer = {.ui32Frequency = TEST_FREQUENCY,
+                                       .psProfile = &gsProfile,
+                                       .psCadParameters = &sCad,
+                                       .eMode = LORA_RADIO_CAD};
+
+    TEST_CHECK(lora_radio_transfer(pHandle, &sTransfer) ==
+               LORA_RADIO_STATUS_SUCCESS);
+}
+
+static void test_packet_delivery(void)
+{
+    sim_sx1262_stats_t sStats;
+
+    test_setup();
+
+    for (uint32_t i = 1; i <= 2; i++) {
+        test_receive(gpRadioB, 0xFFFFFF00);
+        test_transmit(gpRadioA);
+        test_run_for(200000);
+
+        TEST_CHECK(gsEventsA.ui32TxDone == i);
+        TEST_CHECK(gsEventsB.ui32RxDone == i);
+    }
+
+    TEST_CHECK(gsEventsB.ui8Length == 20);
+    TEST_CHECK(memcmp(gsEventsB.pui8Payload, gpui8Payload, 20) == 0);
+    TEST_CHECK(gsEventsB.ui32CrcErrors == 0);
+
+    // the driver and the simulator agree on the time on air
+    sim_sx1262_stats_get(gi32NodeA, &sStats);
+    TEST_CHECK(sStats.ui64TxAirtime ==
+               2 * (uint64_t)lora_radio_time_on_air(&gsProfile.sModulation,
+                                                    &gsProfile.sPacket, 20));
+    TEST_CHECK(sStats.ui32BusyViolations == 0);
+
+    test_teardown();
+}
+
+static void test_channel_activity(void)
+{
+    test_setup();
+
+    test_transmit(gpRadioA);
+    test_run_for(5000);
+    test_cad(gpRadioB);
+    test_run_for(200000);
+    TEST_CHECK(gsEventsB.ui32CadDone == 1);
+    TEST_CHECK(gsEventsB.ui32CadDetected == 1);
+
+    test_cad(gpRadioB);
+    test_run_for(50000);
+    TEST_CHECK(gsEventsB.ui32CadDone == 2);
+    TEST_CHECK(gsEventsB.ui32CadDetected == 1);
+
+    test_teardown();
+}
+
+static void test_receive_timeout(void)
+{
+    test_setup();
+
+    // single reception with a 100 ms timeout
+    test_receive(gpRadioB, 6400 << 8);
+    test_run_for(90000);
+    TEST_CHECK(gsEventsB.ui32Timeouts == 0);
+    test_run_for(60000);
+    TEST_CHECK(gsEventsB.ui32Timeouts == 1);
+
+    test_teardown();
+}
+
+// The chip keeps the symbol timeout across receptions.  A window left it
+// set and the continuous reception after it timed out at once, so every
+// reception programs it again.
+static void test_symbol_timeout(void)
+{
+    test_setup();
+
+    // 8 symbols at SF7 and 125 kHz take 8.2 ms
+    test_receive(gpRadioB, 8);
+    test_run_for(6000);
+    TEST_CHECK(gsEventsB.ui32Timeouts == 0);
+    test_run_for(6000);
+    TEST_CHECK(gsEventsB.ui32Timeouts == 1);
+
+    // the symbol count is ignored for continuous reception
+    test_receive(gpRadioB, 0xFFFFFF04);
+    test_run_for(100000);
+    TEST_CHECK(gsEventsB.ui32Timeouts == 1);
+    test_transmit(gpRadioA);
+    test_run_for(200000);
+    TEST_CHECK(gsEventsB.ui32RxDone == 1);
+    TEST_CHECK(gsEventsB.ui32Timeouts == 1);
+
+    // a single reception without a symbol count waits for a packet
+    test_receive(gpRadioB, 8);
+    test_run_for(20000);
+    TEST_CHECK(gsEventsB.ui32Timeouts == 2);
+    test_receive(gpRadioB, 0);
+    test_run_for(100000);
+    TEST_CHECK(gsEventsB.ui32Timeouts == 2);
+
+    // counts above 63 are programmed as mantissa and exponent in the sync
+    // timeout register, 200 symbols take 204.8 ms
+    test_receive(gpRadioB, 200);
+    test_run_for(190000);
+    TEST_CHECK(gsEventsB.ui32Timeouts == 2);
+    test_run_for(30000);
+    TEST_CHECK(gsEventsB.ui32Timeouts == 3);
+
+    test_teardown();
+}
+
+static void test_out_of_range(void)
+{
+    sim_sx1262_stats_t sStats;
+
+    test_setup();
+
+    sim_sx1262_position_set(gi32NodeB, 100000, 0);
+    test_receive(gpRadioB, 0xFFFFFF00);
+    test_transmit(gpRadioA);
+    test_run_for(200000);
+    TEST_CHECK(gsEventsB.ui32RxDone == 0);
+
+    sim_sx1262_stats_get(gi32NodeB, &sStats);
+    TEST_CHECK(sStats.ui32MissedBelowSensitivity == 1);
+
+    test_teardown();
+}
+
+// every radio draws its own numbers and can receive again afterwards
+static void test_random(void)
+{
+    uint32_t ui32A1 = 0, ui32A2 = 0, ui32B = 0;
+
+    test_setup();
+
+    TEST_CHECK(lora_radio_random(gpRadioA, &ui32A1) ==
+               LORA_RADIO_STATUS_SUCCESS);
+    TEST_CHECK(lora_radio_random(gpRadioA, &ui32A2) ==
+               LORA_RADIO_STATUS_SUCCESS);
+    TEST_CHECK(lora_radio_random(gpRadioB, &ui32B) ==
+               LORA_RADIO_STATUS_SUCCESS);
+    TEST_CHECK(ui32A1 != 0);
+    TEST_CHECK(ui32A1 != ui32A2);
+    TEST_CHECK(ui32A1 != ui32B);
+
+    test_receive(gpRadioB, 0xFFFFFF00);
+    test_transmit(gpRadioA);
+    test_run_for(200000);
+    TEST_CHECK(gsEventsA.ui32TxDone == 1);
+    TEST_CHECK(gsEventsB.ui32RxDone == 1);
+    TEST_CHECK(gsEventsB.ui32Timeouts == 0);
+
+    test_teardown();
+}
+
+// a command to a sleeping radio wakes it up first
+static void test_sleep_wakeup(void)
+{
+    sim_sx1262_stats_t sStats;
+    lora_radio_busy_stats_t sBusy;
+
+    test_setup();
+
+    TEST_CHECK(lora_radio_power_ctrl(gpRadioB, LORA_RADIO_SLEEP) ==
+               LORA_RADIO_STATUS_SUCCESS);
+    test_receive(gpRadioB, 0xFFFFFF00);
+    test_transmit(gpRadioA);
+    test_run_for(200000);
+    TEST_CHECK(gsEventsB.ui32RxDone == 1);
+
+    sim_sx1262_stats_get(gi32NodeB, &sStats);
+    TEST_CHECK(sStats.ui32Wakeups == 1);
+    TEST_CHECK(sStats.ui32BusyViolations == 0);
+
+    // the chip is woken up before anything waits on its BUSY line
+    lora_radio_busy_stats_get(gpRadioB, &sBusy);
+    TEST_CHECK(sBusy.ui32Timeouts == 0);
+
+    test_teardown();
+}
+
+// the link test settles on a clock the radio can follow and the third
+// radio collides with A at B
+static void test_spi_clock_and_collision(void)
+{
+    sim_sx1262_config_t sNodeC = {.ui32IomModule = 1,
+                                  .ui32PinReset = 20,
+                                  .ui32PinBusy = 21,
+                                  .ui32PinDio1 = 22,
+                                  .ui32PinDio3 = 23,
+                                  .ui32SpiClockMax = AM_HAL_IOM_2MHZ,
+                                  .dX = 200};
+    sim_sx1262_stats_t sStats;
+    int32_t i32NodeC;
+
+    test_setup();
+
+    i32NodeC = sim_sx1262_create(&sNodeC);
+    TEST_CHECK(lora_radio_instance_initialize(&gpRadioC, &gsConfigC) ==
+               LORA_RADIO_STATUS_SUCCESS);
+    TEST_CHECK(lora_radio_spi_clock_get(gpRadioC) <= AM_HAL_IOM_2MHZ);
+
+    test_receive(gpRadioB, 0xFFFFFF00);
+    test_transmit(gpRadioA);
+    test_transmit(gpRadioC);
+    test_run_for(200000);
+
+    sim_sx1262_stats_get(gi32NodeB, &sStats);
+    TEST_CHECK(sStats.ui32RxCollisions == 1);
+    TEST_CHECK(gsEventsB.ui32CrcErrors == 1);
+    sim_sx1262_stats_get(i32NodeC, &sStats);
+    TEST_CHECK(sStats.ui32TxPackets == 1);
+
+    test_teardown();
+}
+
+static void test_receive_duty_cycle(void)
+{
+    lora_radio_transfer_t sRx = {.ui32Frequency = TEST_FREQUENCY,
+                                 .psProfile = &gsProfile,
+                                 .eMode = LORA_RADIO_RX_DUTY_CYCLE};
+    uint32_t ui32RxPeriod;
+
+    test_setup();
+
+    lora_radio_rx_duty_cycle_get(&gsProfile.sModulation, &gsProfile.sPacket,
+                                 &ui32RxPeriod, &sRx.ui32SleepPeriod);
+    TEST_CHECK(lora_radio_transfer(gpRadioB, &sRx) ==
+               LORA_RADIO_STATUS_SUCCESS);
+
+    // the packet starts at an arbitrary point of the cycle
+    test_run_for(12345);
+    test_transmit(gpRadioA);
+    test_run_for(200000);
+    TEST_CHECK(gsEventsB.ui32RxDone == 1);
+
+    test_teardown();
+}
+
+static volatile uint32_t gui32Deferred;
+
+static void test_irq_defer(void *pvArg)
+{
+    gui32Deferred++;
+}
+
+// services deferred radio interrupts as a task would
+static void test_run_deferred(uint64_t ui64Microseconds)
+{
+    uint64_t ui64End = sim_time_get() + ui64Microseconds;
+
+    while (sim_time_get() < ui64End) {
+        sim_run_until(sim_time_get() + 1000);
+        while (gui32Deferred) {
+            gui32Deferred--;
+            lora_radio_irq_service(NULL);
+        }
+    }
+}
+
+// Callbacks and the defer hook registered before the radio is brought up,
+// as lora_direct does, survive initialization and a deinit / init cycle.
+static void test_registration_before_init(void)
+{
+    sim_sx1262_config_t sNodeA = SIM_SX1262_BOARD_CONFIG;
+    lora_radio_modulation_t sModulation = {LORA_RADIO_SF7, LORA_RADIO_BW_125,
+                                           LORA_CR_4_5, 0};
+    lora_radio_packet_t sPacket = {8, LORA_RADIO_PACKET_LENGTH_VARIABLE, 255,
+                                   LORA_RADIO_CRC_ON, LORA_RADIO_IQ_STANDARD};
+    lora_radio_irq_stats_t sIrqStats;
+
+    memset(&gsEventsA, 0, sizeof(gsEventsA));
+    gui32Deferred = 0;
+    sim_sx1262_create(&sNodeA);
+    lora_radio_profile_init(&gsProfile, &sModulation, &sPacket, 0x1424);
+
+    lora_radio_callback_list_init(NULL);
+    lora_radio_callback_register(NULL, LORA_RADIO_TXDONE, a_tx_done);
+    lora_radio_irq_defer_register(NULL, test_irq_defer);
+
+    for (uint32_t i = 1; i <= 2; i++) {
+        TEST_CHECK(lora_radio_initialize(&gpRadioA) ==
+                   LORA_RADIO_STATUS_SUCCESS);
+
+        test_transmit(gpRadioA);
+        test_run_deferred(100000);
+        TEST_CHECK(gsEventsA.ui32TxDone == 1);
+
+        lora_radio_irq_stats_get(gpRadioA, &sIrqStats);
+        TEST_CHECK(sIrqStats.ui32Deferred == 1);
+
+        lora_radio_deinitialize(gpRadioA);
+        gsEventsA.ui32TxDone = 0;
+    }
+
+    lora_radio_irq_defer_register(NULL, NULL);
+}
+
+#define TEST_HELD_MAX 16
+
+static lora_radio_physical_packet_t *gpsHeld[TEST_HELD_MAX];
+static uint32_t gui32Held;
+
+// a consumer that keeps every packet beyond the callback
+static void b_rx_hold(void *pvArg)
+{
+    lora_radio_physical_packet_t *psPacket = pvArg;
+
+    if (psPacket && (gui32Held < TEST_HELD_MAX)) {
+        lora_radio_packet_retain(psPacket);
+        gpsHeld[gui32Held++] = psPacket;
+    }
+}
+
+// receives one packet on B carrying ui8Tag
+static void test_pool_receive(uint8_t ui8Tag)
+{
+    gpui8Payload[0] = ui8Tag;
+    test_receive(gpRadioB, 0xFFFFFF00);
+    test_transmit(gpRadioA);
+    test_run_for(200000);
+}
+
+// Buffers held by a consumer are never reused, an exhausted pool drops
+// packets and counts them, and a release too many does not upset the
+// accounting.
+static void test_packet_pool(void)
+{
+    lora_radio_packet_pool_stats_t sPool;
+    uint32_t ui32Size;
+
+    test_setup();
+    gui32Held = 0;
+    lora_radio_callback_register(gpRadioB, LORA_RADIO_RXDONE, b_rx_hold);
+
+    for (uint32_t i = 0; i < TEST_HELD_MAX; i++) {
+        test_pool_receive(i);
+        lora_radio_packet_pool_stats_get(gpRadioB, &sPool);
+        if (sPool.ui32Dropped) {
+            break;
+        }
+    }
+
+    ui32Size = gui32Held;
+    TEST_CHECK(ui32Size > 0);
+    TEST_CHECK(sPool.ui32Allocated == ui32Size);
+    TEST_CHECK(sPool.ui32InUse == ui32Size);
+    TEST_CHECK(sPool.ui32Dropped == 1);
+    TEST_CHECK(gsEventsB.ui32RxDone == ui32Size);
+
+    // every held packet still carries its own payload
+    for (uint32_t i = 0; i < ui32Size; i++) {
+        TEST_CHECK(gpsHeld[i]->ui8References == 1);
+        TEST_CHECK(gpsHeld[i]->pui8Payload[0] == i);
+    }
+
+    // shared packets go back to the pool with the last reference
+    lora_radio_packet_retain(gpsHeld[0]);
+    lora_radio_packet_release(gpsHeld[0]);
+    lora_radio_packet_pool_stats_get(gpRadioB, &sPool);
+    TEST_CHECK(sPool.ui32InUse == ui32Size);
+
+    for (uint32_t i = 0; i < ui32Size; i++) {
+        lora_radio_packet_release(gpsHeld[i]);
+    }
+    lora_radio_packet_pool_stats_get(gpRadioB, &sPool);
+    TEST_CHECK(sPool.ui32InUse == 0);
+
+    // a second release stops at zero
+    lora_radio_packet_release(gpsHeld[0]);
+    TEST_CHECK(gpsHeld[0]->ui8References == 0);
+    lora_radio_packet_pool_stats_get(gpRadioB, &sPool);
+    TEST_CHECK(sPool.ui32InUse == 0);
+
+    // and the whole pool is available again
+    gui32Held = 0;
+    for (uint32_t i = 0; i < ui32Size; i++) {
+        test_pool_receive(0x80 + i);
+    }
+    lora_radio_packet_pool_stats_get(gpRadioB, &sPool);
+    TEST_CHECK(gui32Held == ui32Size);
+    TEST_CHECK(sPool.ui32Allocated == 2 * ui32Size);
+    TEST_CHECK(sPool.ui32InUse == ui32Size);
+    TEST_CHECK(sPool.ui32Dropped == 1);
+    for (uint32_t i = 0; i < gui32Held; i++) {
+        TEST_CHECK(gpsHeld[i]->pui8Payload[0] == 0x80 + i);
+        lora_radio_packet_release(gpsHeld[i]);
+    }
+
+    test_teardown();
+}
+
+static volatile bool gbBusyReleased;
+
+// sleeps until the BUSY interrupt releases the wait, as a task would
+static void test_busy_wait(uint32_t ui32Ticks)
+{
+    uint64_t ui64End =
+        sim_time_get() +
+        (uint64_t)ui32Ticks * 1000000 / LORA_RADIO_TIMER_FREQUENCY;
+
+    while (!gbBusyReleased && (sim_time_get() < ui64End)) {
+        uint64_t ui64Next = sim_time_next();
+
+        sim_run_until((ui64Next < ui64End) ? ui64Next : ui64End);
+    }
+    gbBusyReleased = false;
+}
+
+static void test_busy_release(void *pvArg)
+{
+    gbBusyReleased = true;
+}
+
+// Replayed BUSY times reach the driver command by command, and every wait
+// from initialization on is ended by the BUSY interrupt.
+static void test_busy_trace(void)
+{
+    static const uint32_t pui32Init[] = {500, 500, 500, 500, 500, 500,
+                                         500, 500, 500, 500, 500, 500};
+    static const uint32_t pui32Standby[] = {2000};
+    sim_sx1262_config_t sNodeA = SIM_SX1262_BOARD_CONFIG;
+    lora_radio_busy_stats_t sBusy;
+    uint32_t ui32Expected = 2000 * LORA_RADIO_TIMER_FREQUENCY / 1000000;
+
+    gi32NodeA = sim_sx1262_create(&sNodeA);
+    sim_sx1262_busy_trace_set(gi32NodeA, pui32Init, 12);
+    lora_radio_busy_wait_register(test_busy_wait, test_busy_release);
+
+    TEST_CHECK(lora_radio_initialize(&gpRadioA) == LORA_RADIO_STATUS_SUCCESS);
+    TEST_CHECK(sim_sx1262_busy_trace_position(gi32NodeA) == 12);
+
+    lora_radio_busy_stats_get(gpRadioA, &sBusy);
+    TEST_CHECK(sBusy.ui32Waits > 0);
+    TEST_CHECK(sBusy.ui32Blocked == sBusy.ui32Waits);
+    TEST_CHECK(sBusy.ui32Timeouts == 0);
+    TEST_CHECK(sBusy.ui32MaxTicks < LORA_RADIO_TIMER_FREQUENCY / 100);
+
+    // the next command waits out the 2 ms of the one before
+    sim_sx1262_busy_trace_set(gi32NodeA, pui32Standby, 1);
+    lora_radio_power_ctrl(gpRadioA, LORA_RADIO_STANDBY);
+    lora_radio_power_ctrl(gpRadioA, LORA_RADIO_STANDBY);
+    lora_radio_busy_stats_get(gpRadioA, &sBusy);
+    TEST_CHECK(sBusy.ui32LastTicks + 2 >= ui32Expected);
+    TEST_CHECK(sBusy.ui32LastTicks <= ui32Expected + 2);
+
+    lora_radio_busy_wait_register(NULL, NULL);
+    lora_radio_deinitialize(gpRadioA);
+}
+
+int main(void)
+{
+    TEST_RUN(test_registration_before_init);
+    TEST_RUN(test_packet_delivery);
+    TEST_RUN(test_channel_activity);
+    TEST_RUN(test_receive_timeout);
+    TEST_RUN(test_symbol_timeout);
+    TEST_RUN(test_out_of_range);
+    TEST_RUN(test_sleep_wakeup);
+    TEST_RUN(test_random);
+    TEST_RUN(test_spi_clock_and_collision);
+    TEST_RUN(test_receive_duty_cycle);
+    TEST_RUN(test_packet_pool);
+    TEST_RUN(test_busy_trace);
+
+    return test_summary("test_sx1262");
+}
@@ -292,6 +292,9 @@ void SX126xReset(void)
     am_util_delay_us(100);
     am_hal_gpio_state_write(RADIO_NRESET, AM_HAL_GPIO_OUTPUT_SET);
     am_util_delay_us(100);
+
+    // BUSY stays high for the ~3.5 ms the chip takes to boot
+    SX126xWaitOnBusy();
 }
 
 void SX126xWaitOnBusy(void)
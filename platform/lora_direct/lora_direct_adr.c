@@ -0,0 +1,339 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <nm_devices_lora.h>
+
+#include "lora_direct_link.h"
+#include "lora_direct_adr.h"
+
+// Picks the spreading factor and transmit power for each peer from the SNR
+// margin of its link, like LoRaWAN ADR.  The path is taken to be
+// reciprocal: a peer heard with more SNR than the spreading factor needs
+// also hears us at a faster one or with that much less power.  The SNR
+// does not depend on the spreading factor the packets came with, the
+// choice is derived from the latest measurement and the power the peer
+// sent with, never from the previous setting, so updates do not compound.
+// Losses return the peer to the configured spreading factor and full
+// power, and after any change the peer is held until
+// LORA_DIRECT_ADR_MIN_PACKETS new samples reflect it.  The announcements of
+// the peers are kept next to it and lapse after
+// LORA_DIRECT_ADR_RATE_HOLD_MS, so a node that lost its peers returns to
+// the configured spreading factor.  Like the link estimator this does not
+// depend on the RTOS.
+
+// demodulation floor per spreading factor, SF5 needs -2.5 dB and every
+// further step 2.5 dB less, 0.25 dB
+#define ADR_SNR_STEP 10
+
+// power change per step, dB
+#define ADR_POWER_STEP 3
+
+// packets needed before the link statistics are trusted, and new samples
+// needed after a change before the next one
+#ifndef LORA_DIRECT_ADR_MIN_PACKETS
+#define LORA_DIRECT_ADR_MIN_PACKETS 4
+#endif
+
+// packet error rate above which the peer gets full power
+#ifndef LORA_DIRECT_ADR_PER_LIMIT
+#define LORA_DIRECT_ADR_PER_LIMIT (LORA_DIRECT_LINK_PER_MAX / 4)
+#endif
+
+// consecutive unacknowledged transmissions before falling back
+#ifndef LORA_DIRECT_ADR_FAILURE_LIMIT
+#define LORA_DIRECT_ADR_FAILURE_LIMIT 2
+#endif
+
+typedef struct {
+    uint32_t ui32Peer;
+    uint32_t ui32Hold; // link samples when the choice last changed
+    uint8_t ui8Power;
+    uint8_t ui8Sf;
+    uint8_t ui8Failures;
+    uint8_t ui8LastUse;
+    bool bHold; // take the sample count at the next update
+
+    // last announcement of the peer
+    bool bRate;
+    uint8_t ui8Listen;
+    uint8_t ui8Request;
+    uint32_t ui32RateTime;
+} lora_direct_adr_peer_t;
+
+static lora_direct_adr_config_t gsAdrConfig;
+static lora_direct_adr_peer_t psPeerList[LORA_DIRECT_ADR_PEERS];
+static uint8_t gui8PeerCount;
+static uint8_t gui8PeerClock;
+
+void lora_direct_adr_init(const lora_direct_adr_config_t *psConfig)
+{
+    memcpy(&gsAdrConfig, psConfig, sizeof(lora_direct_adr_config_t));
+    if (gsAdrConfig.ui8PowerMin > gsAdrConfig.ui8PowerMax) {
+        gsAdrConfig.ui8PowerMin = gsAdrConfig.ui8PowerMax;
+    }
+    if (gsAdrConfig.eSpreadingFactorMin < LORA_RADIO_SF5) {
+        gsAdrConfig.eSpreadingFactorMin = LORA_RADIO_SF5;
+    }
+
+    memset(psPeerList, 0, sizeof(psPeerList));
+    gui8PeerCount = 0;
+    gui8PeerClock = 0;
+}
+
+static lora_direct_adr_peer_t *lora_direct_adr_find(uint32_t ui32Peer)
+{
+    for (uint32_t i = 0; i < gui8PeerCount; i++) {
+        if (psPeerList[i].ui32Peer == ui32Peer) {
+            return &psPeerList[i];
+        }
+    }
+
+    return NULL;
+}
+
+// new peers start at the configured spreading factor and full power, the
+// least recently used peer is recycled once the table is full
+static lora_direct_adr_peer_t *lora_direct_adr_claim(uint32_t ui32Peer)
+{
+    lora_direct_adr_peer_t *psPeer = lora_direct_adr_find(ui32Peer);
+
+    if (psPeer == NULL) {
+        if (gui8PeerCount < LORA_DIRECT_ADR_PEERS) {
+            psPeer = &psPeerList[gui8PeerCount++];
+        } else {
+            psPeer = &psPeerList[0];
+            for (uint32_t i = 1; i < LORA_DIRECT_ADR_PEERS; i++) {
+                if ((uint8_t)(gui8PeerClock - psPeerList[i].ui8LastUse) >
+                    (uint8_t)(gui8PeerClock - psPeer->ui8LastUse)) {
+                    psPeer = &psPeerList[i];
+                }
+            }
+        }
+
+        memset(psPeer, 0, sizeof(lora_direct_adr_peer_t));
+        psPeer->ui32Peer = ui32Peer;
+        psPeer->ui8Power = gsAdrConfig.ui8PowerMax;
+    }
+
+    psPeer->ui8LastUse = ++gui8PeerClock;
+
+    return psPeer;
+}
+
+// SNR above the floor of the spreading factor and the margin, 0.25 dB
+static int32_t lora_direct_adr_excess(uint32_t ui32Sf,
+                                      const lora_direct_link_t *psLink)
+{
+    return psLink->i16Snr + ADR_SNR_STEP * ((int32_t)ui32Sf - 4) -
+           gsAdrConfig.i16Margin;
+}
+
+// The fastest spreading factor down from the configured one that leaves
+// the margin on the measured link, then the power the rest of it allows.
+// Leaves the configured spreading factor as 0.
+static void lora_direct_adr_choose(lora_radio_spreading_factor_e eSF,
+                                   const lora_direct_link_t *psLink,
+                                   uint8_t *pui8Sf, uint8_t *pui8Power)
+{
+    uint32_t ui32Sf = eSF;
+    int32_t i32Excess, i32Steps, i32Power;
+
+    *pui8Sf = 0;
+    if (psLink->ui16Per > LORA_DIRECT_ADR_PER_LIMIT) {
+        *pui8Power = gsAdrConfig.ui8PowerMax;
+        return;
+    }
+
+    while ((ui32Sf > gsAdrConfig.eSpreadingFactorMin) &&
+           (lora_direct_adr_excess(ui32Sf - 1, psLink) >= 0)) {
+        ui32Sf--;
+    }
+    if (ui32Sf != eSF) {
+        *pui8Sf = ui32Sf;
+    }
+
+    i32Excess = lora_direct_adr_excess(ui32Sf, psLink);
+
+    // whole steps, a shortfall rounds towards more power
+    i32Steps = ADR_POWER_STEP * LORA_RADIO_QDB_PER_DB;
+    if (i32Excess >= 0) {
+        i32Steps = i32Excess / i32Steps;
+    } else {
+        i32Steps = -((-i32Excess + i32Steps - 1) / i32Steps);
+    }
+
+    i32Power = gsAdrConfig.ui8PeerPower - i32Steps * ADR_POWER_STEP;
+    if (i32Power < gsAdrConfig.ui8PowerMin) {
+        i32Power = gsAdrConfig.ui8PowerMin;
+    }
+    if (i32Power > gsAdrConfig.ui8PowerMax) {
+        i32Power = gsAdrConfig.ui8PowerMax;
+    }
+
+    *pui8Power = i32Power;
+}
+
+void lora_direct_adr_update(uint32_t ui32Peer,
+                            lora_radio_spreading_factor_e eSpreadingFactor,
+                            const lora_direct_link_t *psLink)
+{
+    lora_direct_adr_peer_t *psPeer = lora_direct_adr_claim(ui32Peer);
+    uint32_t ui32Samples = psLink->ui32Packets + psLink->ui32Errors;
+    uint8_t ui8Sf, ui8Power;
+
+    if (psLink->ui32Packets < LORA_DIRECT_ADR_MIN_PACKETS) {
+        return;
+    }
+
+    if (psPeer->bHold) {
+        psPeer->bHold = false;
+        psPeer->ui32Hold = ui32Samples;
+        return;
+    }
+
+    // the averages still mostly reflect the time before the last change
+    if ((psPeer->ui32Hold != 0) &&
+        (ui32Samples - psPeer->ui32Hold < LORA_DIRECT_ADR_MIN_PACKETS)) {
+        return;
+    }
+
+    lora_direct_adr_choose(eSpreadingFactor, psLink, &ui8Sf, &ui8Power);
+    if ((ui8Sf != psPeer->ui8Sf) || (ui8Power != psPeer->ui8Power)) {
+        psPeer->ui8Sf = ui8Sf;
+        psPeer->ui8Power = ui8Power;
+        psPeer->ui32Hold = ui32Samples;
+    }
+}
+
+void lora_direct_adr_tx_result(uint32_t ui32Peer, uint8_t ui8Delivered)
+{
+    lora_direct_adr_peer_t *psPeer = lora_direct_adr_claim(ui32Peer);
+
+    if (ui8Delivered) {
+        psPeer->ui8Failures = 0;
+        return;
+    }
+
+    if (++psPeer->ui8Failures >= LORA_DIRECT_ADR_FAILURE_LIMIT) {
+        psPeer->ui8Failures = 0;
+        if ((psPeer->ui8Sf != 0) ||
+            (psPeer->ui8Power < gsAdrConfig.ui8PowerMax)) {
+            psPeer->ui8Sf = 0;
+            psPeer->ui8Power = gsAdrConfig.ui8PowerMax;
+            psPeer->bHold = true;
+        }
+    }
+}
+
+uint8_t lora_direct_adr_power_get(uint32_t ui32Peer)
+{
+    lora_direct_adr_peer_t *psPeer = lora_direct_adr_find(ui32Peer);
+
+    return psPeer ? psPeer->ui8Power : gsAdrConfig.ui8PowerMax;
+}
+
+uint8_t lora_direct_adr_sf_get(uint32_t ui32Peer)
+{
+    lora_direct_adr_peer_t *psPeer = lora_direct_adr_find(ui32Peer);
+
+    return psPeer ? psPeer->ui8Sf : 0;
+}
+
+// time left of the announcement of the peer, 0 once it lapsed
+static uint32_t lora_direct_adr_rate_left(const lora_direct_adr_peer_t *psPeer,
+                                          uint32_t ui32Now)
+{
+    uint32_t ui32Age = ui32Now - psPeer->ui32RateTime;
+
+    if (!psPeer->bRate || (ui32Age >= LORA_DIRECT_ADR_RATE_HOLD_MS)) {
+        return 0;
+    }
+
+    return LORA_DIRECT_ADR_RATE_HOLD_MS - ui32Age;
+}
+
+void lora_direct_adr_rate_update(uint32_t ui32Peer, uint8_t ui8Listen,
+                                 uint8_t ui8Request, uint32_t ui32Now)
+{
+    lora_direct_adr_peer_t *psPeer = lora_direct_adr_claim(ui32Peer);
+
+    psPeer->bRate = true;
+    psPeer->ui8Listen = ui8Listen;
+    psPeer->ui8Request = ui8Request;
+    psPeer->ui32RateTime = ui32Now;
+}
+
+uint8_t lora_direct_adr_tx_sf_get(uint32_t ui32Peer, uint32_t ui32Now)
+{
+    lora_direct_adr_peer_t *psPeer = lora_direct_adr_find(ui32Peer);
+
+    if (psPeer == NULL || lora_direct_adr_rate_left(psPeer, ui32Now) == 0) {
+        return 0;
+    }
+
+    return psPeer->ui8Listen;
+}
+
+uint8_t lora_direct_adr_listen_get(uint32_t ui32Now, uint32_t *pui32Remaining)
+{
+    uint32_t ui32Remaining = UINT32_MAX;
+    uint8_t ui8Listen = 0;
+
+    for (uint32_t i = 0; i < gui8PeerCount; i++) {
+        lora_direct_adr_peer_t *psPeer = &psPeerList[i];
+        uint32_t ui32Left = lora_direct_adr_rate_left(psPeer, ui32Now);
+
+        if (ui32Left == 0) {
+            continue;
+        }
+
+        // a peer content with the configured spreading factor holds it
+        if ((psPeer->ui8Request == 0) || (ui8Listen == 0xFF)) {
+            ui8Listen = 0xFF;
+        } else if (psPeer->ui8Request > ui8Listen) {
+            ui8Listen = psPeer->ui8Request;
+        }
+
+        if (ui32Left < ui32Remaining) {
+            ui32Remaining = ui32Left;
+        }
+    }
+
+    if (pui32Remaining) {
+        *pui32Remaining = ui32Remaining;
+    }
+
+    return ui8Listen == 0xFF ? 0 : ui8Listen;
+}
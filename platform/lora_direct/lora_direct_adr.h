@@ -0,0 +1,92 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef _LORA_DIRECT_ADR_H_
+#define _LORA_DIRECT_ADR_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif // defined(__cplusplus)
+
+#define LORA_DIRECT_ADR_PEERS 16
+
+// ms a data rate announced by a peer stays valid without being renewed
+#ifndef LORA_DIRECT_ADR_RATE_HOLD_MS
+#define LORA_DIRECT_ADR_RATE_HOLD_MS 60000
+#endif
+
+// Spreading factor and transmit power per peer from the SNR margin of its
+// link.  The spreading factor comes down from the configured one first,
+// the power only once it reached eSpreadingFactorMin.  A receiver listens
+// at one spreading factor, so the choice is only a request: peers announce
+// the spreading factor they would like to send with and the one they listen
+// at, a node listens at the slowest one requested and sends to a peer at
+// the one it listens at.  Spreading factors are 0 where the configured one
+// applies.
+typedef struct {
+    uint8_t ui8PowerMin;  // dBm
+    uint8_t ui8PowerMax;  // dBm, used for peers without history
+    uint8_t ui8PeerPower; // dBm the peers send the measured packets with
+    int16_t i16Margin;    // SNR kept in reserve, 0.25 dB
+    lora_radio_spreading_factor_e eSpreadingFactorMin;
+} lora_direct_adr_config_t;
+
+extern void lora_direct_adr_init(const lora_direct_adr_config_t *psConfig);
+// Re-evaluates the peer from the link quality measured on its packets.  The
+// choice starts at the configured spreading factor and follows from the
+// measurement alone, so repeated updates do not compound.
+extern void
+lora_direct_adr_update(uint32_t ui32Peer,
+                       lora_radio_spreading_factor_e eSpreadingFactor,
+                       const lora_direct_link_t *psLink);
+// outcome of a transmission that expected an acknowledgement
+extern void lora_direct_adr_tx_result(uint32_t ui32Peer, uint8_t ui8Delivered);
+// dBm to send to the peer with
+extern uint8_t lora_direct_adr_power_get(uint32_t ui32Peer);
+// spreading factor this node would like to send to the peer with
+extern uint8_t lora_direct_adr_sf_get(uint32_t ui32Peer);
+// the peer announced the spreading factor it listens at and the one it
+// would like to send to this node with, times are in ms
+extern void lora_direct_adr_rate_update(uint32_t ui32Peer, uint8_t ui8Listen,
+                                        uint8_t ui8Request, uint32_t ui32Now);
+// spreading factor to send to the peer with, the one it listens at
+extern uint8_t lora_direct_adr_tx_sf_get(uint32_t ui32Peer, uint32_t ui32Now);
+// Spreading factor to listen at, the slowest one requested within
+// LORA_DIRECT_ADR_RATE_HOLD_MS.  pui32Remaining gets the ms until an
+// announcement lapses, UINT32_MAX if none is held.
+extern uint8_t lora_direct_adr_listen_get(uint32_t ui32Now,
+                                          uint32_t *pui32Remaining);
+
+#if defined(__cplusplus)
+}
+#endif // defined(__cplusplus)
+
+#endif /* _LORA_DIRECT_ADR_H_ */
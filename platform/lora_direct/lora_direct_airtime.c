@@ -0,0 +1,257 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nm_devices_lora.h>
+
+#include "lora_direct_airtime.h"
+
+// The airtime library does not depend on the RTOS; time is passed in by the
+// caller so the accounting can be exercised on a host.
+
+// symbol time in us for SF7 to SF12 at 125, 250 and 500 kHz
+static const uint16_t pui16SymbolTime[6][3] = {
+    {1024, 512, 256},     {2048, 1024, 512},   {4096, 2048, 1024},
+    {8192, 4096, 2048},   {16384, 8192, 4096}, {32768, 16384, 8192},
+};
+
+typedef struct {
+    lora_direct_subband_t sConfig;
+    uint32_t ui32Epoch; // bucket index of the most recent bucket
+    uint32_t pui32Bucket[LORA_DIRECT_AIRTIME_BUCKETS]; // airtime in us
+} lora_direct_subband_state_t;
+
+static lora_direct_subband_state_t
+    psSubbandList[LORA_DIRECT_AIRTIME_MAX_SUBBANDS];
+static uint32_t gui32SubbandCount;
+static uint32_t gui32BucketMs;
+
+uint32_t lora_direct_airtime_get(const lora_radio_modulation_t *psModulation,
+                                 const lora_radio_packet_t *psPacket,
+                                 uint8_t ui8PayloadLength)
+{
+    uint32_t ui32Column;
+
+    switch (psModulation->eBandwidth) {
+    case LORA_RADIO_BW_125:
+        ui32Column = 0;
+        break;
+    case LORA_RADIO_BW_250:
+        ui32Column = 1;
+        break;
+    case LORA_RADIO_BW_500:
+        ui32Column = 2;
+        break;
+    default:
+        return lora_radio_time_on_air(psModulation, psPacket,
+                                      ui8PayloadLength);
+    }
+
+    if (psModulation->eSpreadingFactor < LORA_RADIO_SF7) {
+        return lora_radio_time_on_air(psModulation, psPacket,
+                                      ui8PayloadLength);
+    }
+
+    uint32_t ui32QuarterSymbols = lora_radio_time_on_air_symbols(
+        psModulation, psPacket, ui8PayloadLength);
+
+    // a long preamble at SF12 takes the product past 32 bits
+    return (uint32_t)(((uint64_t)ui32QuarterSymbols *
+                       pui16SymbolTime[psModulation->eSpreadingFactor -
+                                       LORA_RADIO_SF7][ui32Column]) /
+                      4);
+}
+
+static lora_direct_subband_state_t *lora_direct_subband_find(uint32_t freq)
+{
+    for (uint32_t i = 0; i < gui32SubbandCount; i++) {
+        if ((freq >= psSubbandList[i].sConfig.ui32FrequencyMin) &&
+            (freq <= psSubbandList[i].sConfig.ui32FrequencyMax)) {
+            return &psSubbandList[i];
+        }
+    }
+
+    return NULL;
+}
+
+// retire the buckets that fell out of the sliding window
+static void lora_direct_subband_advance(lora_direct_subband_state_t *psSubband,
+                                        uint32_t ui32NowMs)
+{
+    uint32_t ui32Epoch = ui32NowMs / gui32BucketMs;
+    uint32_t ui32Expired = ui32Epoch - psSubband->ui32Epoch;
+
+    if (ui32Expired > LORA_DIRECT_AIRTIME_BUCKETS) {
+        ui32Expired = LORA_DIRECT_AIRTIME_BUCKETS;
+    }
+
+    for (uint32_t i = 1; i <= ui32Expired; i++) {
+        psSubband->pui32Bucket[(psSubband->ui32Epoch + i) %
+                               LORA_DIRECT_AIRTIME_BUCKETS] = 0;
+    }
+
+    psSubband->ui32Epoch = ui32Epoch;
+}
+
+static uint32_t lora_direct_subband_usage(lora_direct_subband_state_t *psSubband)
+{
+    uint32_t ui32Usage = 0;
+
+    for (uint32_t i = 0; i < LORA_DIRECT_AIRTIME_BUCKETS; i++) {
+        ui32Usage += psSubband->pui32Bucket[i];
+    }
+
+    return ui32Usage;
+}
+
+static uint32_t lora_direct_subband_budget(lora_direct_subband_state_t *psSubband)
+{
+    return (uint32_t)((uint64_t)gui32BucketMs * LORA_DIRECT_AIRTIME_BUCKETS *
+                      1000 * psSubband->sConfig.ui32DutyCycle / 10000);
+}
+
+void lora_direct_airtime_init(const lora_direct_subband_t *psSubband,
+                              uint32_t ui32Count, uint32_t ui32WindowMs)
+{
+    if (ui32Count > LORA_DIRECT_AIRTIME_MAX_SUBBANDS) {
+        ui32Count = LORA_DIRECT_AIRTIME_MAX_SUBBANDS;
+    }
+
+    memset(psSubbandList, 0, sizeof(psSubbandList));
+    for (uint32_t i = 0; i < ui32Count; i++) {
+        memcpy(&psSubbandList[i].sConfig, &psSubband[i],
+               sizeof(lora_direct_subband_t));
+    }
+
+    gui32SubbandCount = ui32Count;
+    gui32BucketMs = ui32WindowMs / LORA_DIRECT_AIRTIME_BUCKETS;
+    if (gui32BucketMs == 0) {
+        gui32BucketMs = 1;
+    }
+}
+
+lora_direct_airtime_e lora_direct_airtime_check(uint32_t ui32Frequency,
+                                                uint32_t ui32AirtimeUs,
+                                                uint32_t ui32NowMs,
+                                                uint32_t *pui32DelayMs)
+{
+    lora_direct_subband_state_t *psSubband =
+        lora_direct_subband_find(ui32Frequency);
+
+    *pui32DelayMs = 0;
+
+    // frequencies outside the configured sub-bands are not regulated
+    if (psSubband == NULL) {
+        return LORA_DIRECT_AIRTIME_ALLOW;
+    }
+
+    lora_direct_subband_advance(psSubband, ui32NowMs);
+
+    uint32_t ui32Budget = lora_direct_subband_budget(psSubband);
+    uint32_t ui32Usage = lora_direct_subband_usage(psSubband);
+
+    if (ui32AirtimeUs > ui32Budget) {
+        return LORA_DIRECT_AIRTIME_REJECT;
+    }
+
+    if (ui32Usage + ui32AirtimeUs <= ui32Budget) {
+        return LORA_DIRECT_AIRTIME_ALLOW;
+    }
+
+    // walk from the oldest bucket until enough airtime has been released
+    for (uint32_t i = 1; i < LORA_DIRECT_AIRTIME_BUCKETS; i++) {
+        ui32Usage -= psSubband->pui32Bucket[(psSubband->ui32Epoch + i) %
+                                            LORA_DIRECT_AIRTIME_BUCKETS];
+        if (ui32Usage + ui32AirtimeUs <= ui32Budget) {
+            *pui32DelayMs = i * gui32BucketMs - (ui32NowMs % gui32BucketMs);
+            return LORA_DIRECT_AIRTIME_DEFER;
+        }
+    }
+
+    return LORA_DIRECT_AIRTIME_REJECT;
+}
+
+void lora_direct_airtime_record(uint32_t ui32Frequency, uint32_t ui32AirtimeUs,
+                                uint32_t ui32NowMs)
+{
+    lora_direct_subband_state_t *psSubband =
+        lora_direct_subband_find(ui32Frequency);
+
+    if (psSubband == NULL) {
+        return;
+    }
+
+    lora_direct_subband_advance(psSubband, ui32NowMs);
+    psSubband->pui32Bucket[psSubband->ui32Epoch %
+                           LORA_DIRECT_AIRTIME_BUCKETS] += ui32AirtimeUs;
+}
+
+void lora_direct_airtime_release(uint32_t ui32Frequency,
+                                 uint32_t ui32AirtimeUs, uint32_t ui32RecordMs)
+{
+    lora_direct_subband_state_t *psSubband =
+        lora_direct_subband_find(ui32Frequency);
+    uint32_t ui32Epoch;
+    uint32_t *pui32Bucket;
+
+    if (psSubband == NULL) {
+        return;
+    }
+
+    // nothing to give back once the bucket has left the window
+    ui32Epoch = ui32RecordMs / gui32BucketMs;
+    if (psSubband->ui32Epoch - ui32Epoch >= LORA_DIRECT_AIRTIME_BUCKETS) {
+        return;
+    }
+
+    pui32Bucket =
+        &psSubband->pui32Bucket[ui32Epoch % LORA_DIRECT_AIRTIME_BUCKETS];
+    *pui32Bucket -= (ui32AirtimeUs < *pui32Bucket) ? ui32AirtimeUs
+                                                   : *pui32Bucket;
+}
+
+uint32_t lora_direct_airtime_usage(uint32_t ui32Frequency, uint32_t ui32NowMs)
+{
+    lora_direct_subband_state_t *psSubband =
+        lora_direct_subband_find(ui32Frequency);
+
+    if (psSubband == NULL) {
+        return 0;
+    }
+
+    lora_direct_subband_advance(psSubband, ui32NowMs);
+
+    return lora_direct_subband_usage(psSubband);
+}
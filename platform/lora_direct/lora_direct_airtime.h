@@ -0,0 +1,79 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef _LORA_DIRECT_AIRTIME_H_
+#define _LORA_DIRECT_AIRTIME_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif // defined(__cplusplus)
+
+#define LORA_DIRECT_AIRTIME_MAX_SUBBANDS 8
+#define LORA_DIRECT_AIRTIME_BUCKETS      16
+
+typedef enum {
+    LORA_DIRECT_AIRTIME_ALLOW,
+    LORA_DIRECT_AIRTIME_DEFER,
+    LORA_DIRECT_AIRTIME_REJECT
+} lora_direct_airtime_e;
+
+typedef struct {
+    uint32_t ui32FrequencyMin;
+    uint32_t ui32FrequencyMax;
+    uint32_t ui32DutyCycle; // allowed airtime in 1/10000 of the window
+} lora_direct_subband_t;
+
+extern uint32_t
+lora_direct_airtime_get(const lora_radio_modulation_t *psModulation,
+                        const lora_radio_packet_t *psPacket,
+                        uint8_t ui8PayloadLength);
+
+extern void lora_direct_airtime_init(const lora_direct_subband_t *psSubband,
+                                     uint32_t ui32Count, uint32_t ui32WindowMs);
+extern lora_direct_airtime_e lora_direct_airtime_check(uint32_t ui32Frequency,
+                                                       uint32_t ui32AirtimeUs,
+                                                       uint32_t ui32NowMs,
+                                                       uint32_t *pui32DelayMs);
+extern void lora_direct_airtime_record(uint32_t ui32Frequency,
+                                       uint32_t ui32AirtimeUs,
+                                       uint32_t ui32NowMs);
+// gives back airtime recorded at ui32RecordMs for a packet that was not sent
+extern void lora_direct_airtime_release(uint32_t ui32Frequency,
+                                        uint32_t ui32AirtimeUs,
+                                        uint32_t ui32RecordMs);
+extern uint32_t lora_direct_airtime_usage(uint32_t ui32Frequency,
+                                          uint32_t ui32NowMs);
+
+#if defined(__cplusplus)
+}
+#endif // defined(__cplusplus)
+
+#endif /* _LORA_DIRECT_AIRTIME_H_ */
@@ -0,0 +1,632 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <nm_devices_lora.h>
+
+#include "lora_direct_arq.h"
+
+// Selective repeat ARQ.  Each peer entry keeps the frames in flight towards
+// the peer together with their retransmission deadline and the receive
+// state of the frames coming from it: the next sequence number expected and
+// a bitmap of the 8 after it.  Acknowledgements wait ui32AckDelay for a data
+// frame to ride on before they are sent on their own.  The receive state
+// belongs to one session of the peer, the session byte of a SYNC frame
+// tells a restarted sender from a copy of an old frame and the echo byte
+// keeps a receiver that still counts frames of the previous session from
+// acknowledging frames of the current one.
+
+// sequence numbers the selective acknowledgement covers
+#define ARQ_SACK_BITS 8
+
+// cap on the backoff doubling
+#define ARQ_BACKOFF_MAX 5
+
+#define ARQ_OFFSET_FLAGS 0
+#define ARQ_OFFSET_SOURCE 1
+#define ARQ_OFFSET_DESTINATION 3
+#define ARQ_OFFSET_SEQUENCE 5
+#define ARQ_OFFSET_ACK 6
+#define ARQ_OFFSET_SACK 7
+#define ARQ_OFFSET_SESSION 8
+#define ARQ_OFFSET_ECHO 9
+#define ARQ_OFFSET_RATE 10
+
+typedef struct {
+    uint8_t bBusy;
+    uint8_t ui8Sequence;
+    uint8_t ui8Length;
+    uint8_t ui8Attempts;
+    uint8_t ui8Refusals;
+    uint32_t ui32Deadline;
+    uint8_t pui8Frame[LORA_RADIO_MAX_PHYSICAL_PACKET];
+} arq_slot_t;
+
+typedef struct {
+    uint8_t bUsed;
+    uint16_t ui16Address;
+    uint32_t ui32LastActivity;
+
+    // towards the peer
+    uint8_t bTxSynced;
+    uint8_t ui8TxNext;
+    arq_slot_t psSlot[LORA_DIRECT_ARQ_WINDOW];
+
+    // from the peer
+    uint8_t bRxSynced;
+    uint8_t ui8RxSession;
+    uint8_t ui8RxNext;
+    uint8_t ui8RxBits;
+    uint8_t bAckPending;
+    uint32_t ui32AckDeadline;
+} arq_peer_t;
+
+static lora_direct_arq_config_t gsConfig;
+static arq_peer_t gpsPeers[LORA_DIRECT_ARQ_PEERS];
+static lora_direct_arq_stats_t gsStats;
+static uint32_t gui32Random;
+static uint8_t gui8Session;
+
+static inline bool arq_time_before(uint32_t ui32A, uint32_t ui32B)
+{
+    return (int32_t)(ui32A - ui32B) < 0;
+}
+
+// xorshift32, kept apart from rand() so the application cannot reseed it
+static uint32_t arq_random(void)
+{
+    gui32Random ^= gui32Random << 13;
+    gui32Random ^= gui32Random >> 17;
+    gui32Random ^= gui32Random << 5;
+
+    return gui32Random;
+}
+
+// spreads seeds that differ in a few bits only, like chip IDs of one lot,
+// over the whole state
+static void arq_random_seed(uint32_t ui32Seed)
+{
+    ui32Seed ^= ui32Seed >> 16;
+    ui32Seed *= 0x85EBCA6B;
+    ui32Seed ^= ui32Seed >> 13;
+    ui32Seed *= 0xC2B2AE35;
+    ui32Seed ^= ui32Seed >> 16;
+
+    // the one state xorshift never leaves
+    gui32Random = ui32Seed ? ui32Seed : 0x9E3779B9;
+}
+
+static uint32_t arq_airtime_ms(uint8_t ui8Length)
+{
+    return (gsConfig.pfnAirtime(gsConfig.pvContext, ui8Length) + 999) / 1000;
+}
+
+static void arq_put16(uint8_t *pui8Buffer, uint16_t ui16Value)
+{
+    pui8Buffer[0] = ui16Value >> 8;
+    pui8Buffer[1] = ui16Value & 0xFF;
+}
+
+static uint16_t arq_get16(const uint8_t *pui8Buffer)
+{
+    return ((uint16_t)pui8Buffer[0] << 8) | pui8Buffer[1];
+}
+
+static arq_peer_t *arq_peer_find(uint16_t ui16Address)
+{
+    for (uint32_t i = 0; i < LORA_DIRECT_ARQ_PEERS; i++) {
+        if (gpsPeers[i].bUsed && gpsPeers[i].ui16Address == ui16Address) {
+            return &gpsPeers[i];
+        }
+    }
+
+    return NULL;
+}
+
+static bool arq_peer_idle(const arq_peer_t *psPeer)
+{
+    if (psPeer->bAckPending) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < LORA_DIRECT_ARQ_WINDOW; i++) {
+        if (psPeer->psSlot[i].bBusy) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Finds the peer or takes a free entry, the idle peer heard from the
+// longest time ago gives up its entry when none is free.
+static arq_peer_t *arq_peer_get(uint16_t ui16Address, uint32_t ui32Now)
+{
+    arq_peer_t *psPeer = arq_peer_find(ui16Address);
+    if (psPeer) {
+        return psPeer;
+    }
+
+    for (uint32_t i = 0; i < LORA_DIRECT_ARQ_PEERS; i++) {
+        if (!gpsPeers[i].bUsed) {
+            psPeer = &gpsPeers[i];
+            break;
+        }
+
+        if (arq_peer_idle(&gpsPeers[i]) &&
+            (psPeer == NULL || arq_time_before(gpsPeers[i].ui32LastActivity,
+                                               psPeer->ui32LastActivity))) {
+            psPeer = &gpsPeers[i];
+        }
+    }
+
+    if (psPeer == NULL) {
+        return NULL;
+    }
+
+    memset(psPeer, 0, sizeof(arq_peer_t));
+    psPeer->bUsed = true;
+    psPeer->ui16Address = ui16Address;
+    psPeer->ui8TxNext = arq_random() & 0xFF;
+    psPeer->ui32LastActivity = ui32Now;
+
+    return psPeer;
+}
+
+static void arq_header_fill(arq_peer_t *psPeer, uint8_t *pui8Frame,
+                            uint8_t ui8Flags, uint8_t ui8Sequence)
+{
+    if ((ui8Flags & LORA_DIRECT_ARQ_FLAG_DATA) && !psPeer->bTxSynced) {
+        ui8Flags |= LORA_DIRECT_ARQ_FLAG_SYNC;
+    }
+
+    if (psPeer->bRxSynced) {
+        ui8Flags |= LORA_DIRECT_ARQ_FLAG_ACK;
+    }
+
+    pui8Frame[ARQ_OFFSET_FLAGS] = ui8Flags;
+    arq_put16(&pui8Frame[ARQ_OFFSET_SOURCE], gsConfig.ui16Address);
+    arq_put16(&pui8Frame[ARQ_OFFSET_DESTINATION], psPeer->ui16Address);
+    pui8Frame[ARQ_OFFSET_SEQUENCE] = ui8Sequence;
+    pui8Frame[ARQ_OFFSET_ACK] = psPeer->ui8RxNext;
+    pui8Frame[ARQ_OFFSET_SACK] = psPeer->ui8RxBits;
+    pui8Frame[ARQ_OFFSET_SESSION] = gui8Session;
+    pui8Frame[ARQ_OFFSET_ECHO] = psPeer->ui8RxSession;
+    pui8Frame[ARQ_OFFSET_RATE] =
+        gsConfig.pfnRate ? gsConfig.pfnRate(gsConfig.pvContext,
+                                            psPeer->ui16Address)
+                         : 0;
+}
+
+// ms until a refused frame is offered again, UINT32_MAX if it never fits
+static uint32_t arq_refusal_wait(arq_peer_t *psPeer, uint8_t ui8Length)
+{
+    uint32_t ui32Wait = 0;
+
+    if (gsConfig.pfnBackoff) {
+        ui32Wait = gsConfig.pfnBackoff(gsConfig.pvContext,
+                                       psPeer->ui16Address, ui8Length);
+    }
+
+    if (ui32Wait == UINT32_MAX) {
+        return ui32Wait;
+    }
+
+    return (ui32Wait > gsConfig.ui32Margin ? ui32Wait : gsConfig.ui32Margin) +
+           1;
+}
+
+static void arq_slot_complete(arq_peer_t *psPeer, arq_slot_t *psSlot,
+                              uint8_t bDelivered);
+
+// Sends the frame in the slot with the acknowledgement state of the moment
+// and arms its retransmission deadline.  A frame the radio did not take is
+// offered again after the backoff, the slot fails once the offers reach
+// ui8Retries + 1 or the frame never fits.
+static void arq_slot_transmit(arq_peer_t *psPeer, arq_slot_t *psSlot,
+                              uint32_t ui32Now)
+{
+    arq_header_fill(psPeer, psSlot->pui8Frame, LORA_DIRECT_ARQ_FLAG_DATA,
+                    psSlot->ui8Sequence);
+
+    if (!gsConfig.pfnTransmit(gsConfig.pvContext, psPeer->ui16Address,
+                              psSlot->pui8Frame, psSlot->ui8Length)) {
+        uint32_t ui32Wait = arq_refusal_wait(psPeer, psSlot->ui8Length);
+
+        gsStats.ui32Refused++;
+        psSlot->ui8Refusals++;
+        if (ui32Wait == UINT32_MAX ||
+            psSlot->ui8Attempts + psSlot->ui8Refusals >
+                gsConfig.ui8Retries) {
+            arq_slot_complete(psPeer, psSlot, false);
+            return;
+        }
+
+        psSlot->ui32Deadline = ui32Now + ui32Wait;
+        return;
+    }
+
+    if (psSlot->ui8Attempts) {
+        gsStats.ui32Retransmissions++;
+    }
+
+    if (psPeer->bAckPending) {
+        psPeer->bAckPending = false;
+        gsStats.ui32AcksPiggybacked++;
+    }
+
+    uint32_t ui32Frame = arq_airtime_ms(psSlot->ui8Length);
+    uint32_t ui32Timeout = ui32Frame +
+                           arq_airtime_ms(LORA_DIRECT_ARQ_HEADER_SIZE) +
+                           gsConfig.ui32AckDelay + gsConfig.ui32Margin;
+
+    uint8_t ui8Backoff = psSlot->ui8Attempts;
+    if (ui8Backoff > ARQ_BACKOFF_MAX) {
+        ui8Backoff = ARQ_BACKOFF_MAX;
+    }
+
+    ui32Timeout <<= ui8Backoff;
+    ui32Timeout += arq_random() % (ui32Frame + 1);
+
+    psSlot->ui8Attempts++;
+    psSlot->ui32Deadline = ui32Now + ui32Timeout;
+}
+
+static void arq_ack_transmit(arq_peer_t *psPeer, uint32_t ui32Now)
+{
+    uint8_t pui8Frame[LORA_DIRECT_ARQ_HEADER_SIZE];
+
+    arq_header_fill(psPeer, pui8Frame, 0, 0);
+    if (gsConfig.pfnTransmit(gsConfig.pvContext, psPeer->ui16Address,
+                             pui8Frame, sizeof(pui8Frame))) {
+        psPeer->bAckPending = false;
+        gsStats.ui32AcksSent++;
+    } else {
+        uint32_t ui32Wait = arq_refusal_wait(psPeer, sizeof(pui8Frame));
+
+        // a later data frame or duplicate asks for the acknowledgement again
+        if (ui32Wait == UINT32_MAX) {
+            psPeer->bAckPending = false;
+        } else {
+            psPeer->ui32AckDeadline = ui32Now + ui32Wait;
+        }
+    }
+}
+
+static void arq_slot_complete(arq_peer_t *psPeer, arq_slot_t *psSlot,
+                              uint8_t bDelivered)
+{
+    psSlot->bBusy = false;
+
+    if (bDelivered) {
+        gsStats.ui32Acknowledged++;
+    } else {
+        gsStats.ui32Failed++;
+    }
+
+    if (gsConfig.pfnResult) {
+        gsConfig.pfnResult(gsConfig.pvContext, psPeer->ui16Address,
+                           psSlot->ui8Sequence, bDelivered);
+    }
+}
+
+static void arq_ack_process(arq_peer_t *psPeer, uint8_t ui8Ack,
+                            uint8_t ui8Sack)
+{
+    psPeer->bTxSynced = true;
+
+    for (uint32_t i = 0; i < LORA_DIRECT_ARQ_WINDOW; i++) {
+        arq_slot_t *psSlot = &psPeer->psSlot[i];
+        if (!psSlot->bBusy) {
+            continue;
+        }
+
+        // everything before ui8Ack, then the bitmap after it
+        uint8_t ui8Behind = ui8Ack - psSlot->ui8Sequence;
+        uint8_t ui8Ahead = psSlot->ui8Sequence - ui8Ack - 1;
+        if ((ui8Behind >= 1 && ui8Behind <= 128) ||
+            (ui8Ahead < ARQ_SACK_BITS && (ui8Sack & (1 << ui8Ahead)))) {
+            arq_slot_complete(psPeer, psSlot, true);
+        }
+    }
+}
+
+// moves the receive window past ui8RxNext and every frame already received
+// right after it
+static void arq_rx_advance(arq_peer_t *psPeer)
+{
+    bool bReceived;
+
+    do {
+        bReceived = psPeer->ui8RxBits & 1;
+        psPeer->ui8RxBits >>= 1;
+        psPeer->ui8RxNext++;
+    } while (bReceived);
+}
+
+// Returns true when the frame is new.  A sender that gave up on a frame
+// leaves a gap, frames beyond the bitmap push the window over it.
+static bool arq_rx_accept(arq_peer_t *psPeer, uint8_t ui8Sequence,
+                          uint8_t ui8Flags, uint8_t ui8Session)
+{
+    uint8_t ui8Distance = ui8Sequence - psPeer->ui8RxNext;
+
+    // SYNC from the session the state came from is a frame sent before the
+    // first acknowledgement got through, from another one a restart
+    if ((ui8Flags & LORA_DIRECT_ARQ_FLAG_SYNC) &&
+        (ui8Session != psPeer->ui8RxSession)) {
+        psPeer->bRxSynced = false;
+    }
+
+    // A SYNC frame is the only one in flight.  Any other frame reaching a
+    // node without receive state, because it restarted, may have older
+    // ones still in flight behind it, the window opens far enough back to
+    // take them instead of counting them as copies.
+    if (!psPeer->bRxSynced) {
+        psPeer->bRxSynced = true;
+        psPeer->ui8RxSession = ui8Session;
+        psPeer->ui8RxBits = 0;
+        ui8Distance =
+            (ui8Flags & LORA_DIRECT_ARQ_FLAG_SYNC) ? 0 : ARQ_SACK_BITS;
+        psPeer->ui8RxNext = ui8Sequence - ui8Distance;
+    }
+
+    if (ui8Distance >= 128) {
+        return false;
+    }
+
+    while (ui8Distance > ARQ_SACK_BITS) {
+        arq_rx_advance(psPeer);
+        ui8Distance = ui8Sequence - psPeer->ui8RxNext;
+    }
+
+    if (ui8Distance == 0) {
+        arq_rx_advance(psPeer);
+        return true;
+    }
+
+    uint8_t ui8Bit = 1 << (ui8Distance - 1);
+    if (psPeer->ui8RxBits & ui8Bit) {
+        return false;
+    }
+
+    psPeer->ui8RxBits |= ui8Bit;
+    return true;
+}
+
+uint8_t lora_direct_arq_init(const lora_direct_arq_config_t *psConfig)
+{
+    if (psConfig == NULL || psConfig->pfnTransmit == NULL ||
+        psConfig->pfnAirtime == NULL || psConfig->pfnDeliver == NULL) {
+        return false;
+    }
+
+    if (psConfig->ui8Window < 1 ||
+        psConfig->ui8Window > LORA_DIRECT_ARQ_WINDOW) {
+        return false;
+    }
+
+    memcpy(&gsConfig, psConfig, sizeof(lora_direct_arq_config_t));
+    memset(gpsPeers, 0, sizeof(gpsPeers));
+    memset(&gsStats, 0, sizeof(gsStats));
+
+    arq_random_seed(psConfig->ui32Seed);
+    gui8Session = arq_random() & 0xFF;
+
+    return true;
+}
+
+uint32_t lora_direct_arq_send(uint16_t ui16Peer, const uint8_t *pui8Payload,
+                              uint8_t ui8Length, uint32_t ui32Now)
+{
+    if (ui8Length > LORA_DIRECT_ARQ_PAYLOAD_MAX) {
+        return 0;
+    }
+
+    arq_peer_t *psPeer = arq_peer_get(ui16Peer, ui32Now);
+    if (psPeer == NULL) {
+        return 0;
+    }
+
+    // The frames in flight must span less than the window for the
+    // receiver bitmap to cover them.  The receiver starts counting at the
+    // first frame it hears, so only one goes out until it answered.
+    uint8_t ui8Window = psPeer->bTxSynced ? gsConfig.ui8Window : 1;
+    arq_slot_t *psFree = NULL;
+    for (uint32_t i = 0; i < LORA_DIRECT_ARQ_WINDOW; i++) {
+        arq_slot_t *psSlot = &psPeer->psSlot[i];
+        if (!psSlot->bBusy) {
+            psFree = psSlot;
+        } else if ((uint8_t)(psPeer->ui8TxNext - psSlot->ui8Sequence) >=
+                   ui8Window) {
+            return 0;
+        }
+    }
+
+    if (psFree == NULL) {
+        return 0;
+    }
+
+    psFree->bBusy = true;
+    psFree->ui8Sequence = psPeer->ui8TxNext++;
+    psFree->ui8Length = ui8Length + LORA_DIRECT_ARQ_HEADER_SIZE;
+    psFree->ui8Attempts = 0;
+    psFree->ui8Refusals = 0;
+    memcpy(&psFree->pui8Frame[LORA_DIRECT_ARQ_HEADER_SIZE], pui8Payload,
+           ui8Length);
+
+    psPeer->ui32LastActivity = ui32Now;
+    gsStats.ui32Sent++;
+
+    arq_slot_transmit(psPeer, psFree, ui32Now);
+
+    return psFree->ui8Sequence + 1;
+}
+
+void lora_direct_arq_receive(const uint8_t *pui8Frame, uint8_t ui8Length,
+                             uint32_t ui32Now)
+{
+    if (ui8Length < LORA_DIRECT_ARQ_HEADER_SIZE) {
+        gsStats.ui32Rejected++;
+        return;
+    }
+
+    if (arq_get16(&pui8Frame[ARQ_OFFSET_DESTINATION]) != gsConfig.ui16Address) {
+        return;
+    }
+
+    uint8_t ui8Flags = pui8Frame[ARQ_OFFSET_FLAGS];
+    uint16_t ui16Source = arq_get16(&pui8Frame[ARQ_OFFSET_SOURCE]);
+
+    if (gsConfig.pfnRateUpdate && pui8Frame[ARQ_OFFSET_RATE]) {
+        gsConfig.pfnRateUpdate(gsConfig.pvContext, ui16Source,
+                               pui8Frame[ARQ_OFFSET_RATE]);
+    }
+
+    arq_peer_t *psPeer;
+    if (ui8Flags & LORA_DIRECT_ARQ_FLAG_DATA) {
+        psPeer = arq_peer_get(ui16Source, ui32Now);
+    } else {
+        // an acknowledgement is only of use to a peer with frames in flight
+        psPeer = arq_peer_find(ui16Source);
+    }
+
+    if (psPeer == NULL) {
+        gsStats.ui32Rejected++;
+        return;
+    }
+
+    psPeer->ui32LastActivity = ui32Now;
+
+    // the peer may still count frames of the session before a restart of
+    // this node, their numbers say nothing about the frames in flight
+    if ((ui8Flags & LORA_DIRECT_ARQ_FLAG_ACK) &&
+        pui8Frame[ARQ_OFFSET_ECHO] == gui8Session) {
+        arq_ack_process(psPeer, pui8Frame[ARQ_OFFSET_ACK],
+                        pui8Frame[ARQ_OFFSET_SACK]);
+    }
+
+    if (!(ui8Flags & LORA_DIRECT_ARQ_FLAG_DATA)) {
+        return;
+    }
+
+    // duplicates are acknowledged again, the earlier acknowledgement may
+    // have been lost
+    if (!psPeer->bAckPending) {
+        psPeer->bAckPending = true;
+        psPeer->ui32AckDeadline = ui32Now + gsConfig.ui32AckDelay;
+    }
+
+    if (arq_rx_accept(psPeer, pui8Frame[ARQ_OFFSET_SEQUENCE], ui8Flags,
+                      pui8Frame[ARQ_OFFSET_SESSION])) {
+        gsStats.ui32Received++;
+        gsConfig.pfnDeliver(gsConfig.pvContext, ui16Source,
+                            &pui8Frame[LORA_DIRECT_ARQ_HEADER_SIZE],
+                            ui8Length - LORA_DIRECT_ARQ_HEADER_SIZE);
+    } else {
+        gsStats.ui32Duplicates++;
+    }
+}
+
+uint32_t lora_direct_arq_process(uint32_t ui32Now)
+{
+    uint32_t ui32Next = UINT32_MAX;
+
+    for (uint32_t i = 0; i < LORA_DIRECT_ARQ_PEERS; i++) {
+        arq_peer_t *psPeer = &gpsPeers[i];
+        if (!psPeer->bUsed) {
+            continue;
+        }
+
+        for (uint32_t j = 0; j < LORA_DIRECT_ARQ_WINDOW; j++) {
+            arq_slot_t *psSlot = &psPeer->psSlot[j];
+            if (!psSlot->bBusy) {
+                continue;
+            }
+
+            if (!arq_time_before(ui32Now, psSlot->ui32Deadline)) {
+                if (psSlot->ui8Attempts + psSlot->ui8Refusals >
+                    gsConfig.ui8Retries) {
+                    arq_slot_complete(psPeer, psSlot, false);
+                    continue;
+                }
+
+                arq_slot_transmit(psPeer, psSlot, ui32Now);
+                if (!psSlot->bBusy) {
+                    continue;
+                }
+            }
+
+            if (psSlot->ui32Deadline - ui32Now < ui32Next) {
+                ui32Next = psSlot->ui32Deadline - ui32Now;
+            }
+        }
+
+        if (psPeer->bAckPending &&
+            !arq_time_before(ui32Now, psPeer->ui32AckDeadline)) {
+            arq_ack_transmit(psPeer, ui32Now);
+        }
+
+        if (psPeer->bAckPending &&
+            psPeer->ui32AckDeadline - ui32Now < ui32Next) {
+            ui32Next = psPeer->ui32AckDeadline - ui32Now;
+        }
+    }
+
+    return ui32Next;
+}
+
+uint8_t lora_direct_arq_pending(uint16_t ui16Peer)
+{
+    arq_peer_t *psPeer = arq_peer_find(ui16Peer);
+    uint8_t ui8Pending = 0;
+
+    if (psPeer) {
+        for (uint32_t i = 0; i < LORA_DIRECT_ARQ_WINDOW; i++) {
+            ui8Pending += psPeer->psSlot[i].bBusy;
+        }
+    }
+
+    return ui8Pending;
+}
+
+void lora_direct_arq_stats_get(lora_direct_arq_stats_t *psStats)
+{
+    memcpy(psStats, &gsStats, sizeof(lora_direct_arq_stats_t));
+}
+
+void lora_direct_arq_stats_reset(void)
+{
+    memset(&gsStats, 0, sizeof(gsStats));
+}
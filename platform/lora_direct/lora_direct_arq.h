@@ -0,0 +1,193 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef _LORA_DIRECT_ARQ_H_
+#define _LORA_DIRECT_ARQ_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif // defined(__cplusplus)
+
+// Reliable delivery over lora_direct: selective repeat ARQ with 8 bit
+// sequence numbers per peer, cumulative and selective acknowledgements
+// that ride on data frames whenever there is traffic in both directions,
+// and duplicate suppression at the receiver.  Frames are delivered as they
+// arrive, they are not put back in order.
+//
+// The application owns the wiring: pfnTransmit queues the frame with
+// lora_direct_send or lora_direct_send_to, pfnAirtime returns
+// lora_direct_airtime_get() for the modulation in use, pfnBackoff
+// lora_direct_airtime_wait() for the frequency, RXDONE packets are
+// passed to lora_direct_arq_receive and pfnResult can feed
+// lora_direct_delivery_report so ADR sees the losses.  pfnRate and
+// pfnRateUpdate carry lora_direct_rate_announce() to
+// lora_direct_rate_update() at the peer, so lora_direct_send_to follows the
+// data rate the peer listens at; pfnAirtime then uses the configured
+// modulation, the slowest one in use.  ui32Margin has to cover the time a
+// frame waits in the transmit queue and for listen before talk.
+//
+// Every frame starts with a LORA_DIRECT_ARQ_HEADER_SIZE byte header:
+//   [0]    flags, LORA_DIRECT_ARQ_FLAG_*
+//   [1..2] source address, big endian
+//   [3..4] destination address, big endian, matches a lora_direct_filter_t
+//          with ui8AddressOffset 3 and ui8AddressSize 2
+//   [5]    sequence number of the data
+//   [6]    next sequence number expected from the destination
+//   [7]    bit n set if sequence number [6] + 1 + n was received as well
+//   [8]    session of the source, drawn at lora_direct_arq_init()
+//   [9]    session of the destination [6] and [7] refer to, an
+//          acknowledgement for an earlier session of the destination is
+//          ignored
+//   [10]   data rate announcement of the source from pfnRate, 0 without
+
+#define LORA_DIRECT_ARQ_HEADER_SIZE 11
+#define LORA_DIRECT_ARQ_PAYLOAD_MAX                                            \
+    (LORA_RADIO_MAX_PHYSICAL_PACKET - LORA_DIRECT_ARQ_HEADER_SIZE)
+
+#define LORA_DIRECT_ARQ_FLAG_DATA 0x01
+#define LORA_DIRECT_ARQ_FLAG_ACK 0x02
+// set until the peer acknowledged the first frame, a receiver whose state
+// came from another session of the sender starts over at this frame
+#define LORA_DIRECT_ARQ_FLAG_SYNC 0x04
+
+// peers tracked at the same time
+#ifndef LORA_DIRECT_ARQ_PEERS
+#define LORA_DIRECT_ARQ_PEERS 4
+#endif
+
+// frames in flight per peer the buffers are sized for, the selective
+// acknowledgement covers up to 8
+#ifndef LORA_DIRECT_ARQ_WINDOW
+#define LORA_DIRECT_ARQ_WINDOW 4
+#endif
+
+#if (LORA_DIRECT_ARQ_WINDOW < 1) || (LORA_DIRECT_ARQ_WINDOW > 8)
+#error "LORA_DIRECT_ARQ_WINDOW must be between 1 and 8"
+#endif
+
+// hands a frame to the radio, returns 0 if it could not be queued and the
+// frame is offered again after the backoff
+typedef uint8_t (*lora_direct_arq_transmit_t)(void *pvContext,
+                                              uint16_t ui16Peer,
+                                              const uint8_t *pui8Frame,
+                                              uint8_t ui8Length);
+// time on air of a frame in us, see lora_direct_airtime_get()
+typedef uint32_t (*lora_direct_arq_airtime_t)(void *pvContext,
+                                              uint8_t ui8Length);
+// ms until the radio can take a frame of the length, UINT32_MAX if it never
+// will, see lora_direct_airtime_wait()
+typedef uint32_t (*lora_direct_arq_backoff_t)(void *pvContext,
+                                              uint16_t ui16Peer,
+                                              uint8_t ui8Length);
+// data rate announcement for frames to the peer, see
+// lora_direct_rate_announce()
+typedef uint8_t (*lora_direct_arq_rate_t)(void *pvContext, uint16_t ui16Peer);
+// the announcement of every frame from the peer, see
+// lora_direct_rate_update()
+typedef void (*lora_direct_arq_rate_update_t)(void *pvContext,
+                                              uint16_t ui16Peer,
+                                              uint8_t ui8Rate);
+// a new frame from the peer, duplicates are not reported
+typedef void (*lora_direct_arq_deliver_t)(void *pvContext, uint16_t ui16Peer,
+                                          const uint8_t *pui8Payload,
+                                          uint8_t ui8Length);
+// outcome of a frame handed to lora_direct_arq_send()
+typedef void (*lora_direct_arq_result_t)(void *pvContext, uint16_t ui16Peer,
+                                         uint8_t ui8Sequence,
+                                         uint8_t ui8Delivered);
+
+// A frame is sent again when no acknowledgement arrived within the time on
+// air of the frame and of an acknowledgement, ui32AckDelay and ui32Margin.
+// The wait doubles with every attempt and a random part of up to one frame
+// time keeps two senders from colliding over and over.  A frame the radio
+// refused is offered again after pfnBackoff, at least ui32Margin, and
+// counts against ui8Retries like a transmission.
+typedef struct {
+    uint16_t ui16Address;  // this node
+    uint8_t ui8Window;     // frames in flight per peer, 1 to
+                           // LORA_DIRECT_ARQ_WINDOW
+    uint8_t ui8Retries;    // offers to the radio after the first one
+    uint32_t ui32AckDelay; // ms an acknowledgement waits for data to ride on
+    uint32_t ui32Margin;   // ms, turnaround and processing time
+    // Draws the session, the first sequence number towards each peer and
+    // the backoff.  It must differ between nodes and between starts of the
+    // same node, e.g. the chip ID mixed with a free running counter or a
+    // random number from the radio.
+    uint32_t ui32Seed;
+    lora_direct_arq_transmit_t pfnTransmit;
+    lora_direct_arq_airtime_t pfnAirtime;
+    lora_direct_arq_backoff_t pfnBackoff; // optional
+    lora_direct_arq_deliver_t pfnDeliver;
+    lora_direct_arq_result_t pfnResult; // optional
+    lora_direct_arq_rate_t pfnRate;     // optional
+    lora_direct_arq_rate_update_t pfnRateUpdate; // optional
+    void *pvContext;
+} lora_direct_arq_config_t;
+
+typedef struct {
+    uint32_t ui32Sent;            // frames handed to lora_direct_arq_send
+    uint32_t ui32Retransmissions;
+    uint32_t ui32Acknowledged;
+    uint32_t ui32Failed;          // frames given up after all retries
+    uint32_t ui32Refused;         // frames the radio did not take
+    uint32_t ui32Received;        // frames delivered
+    uint32_t ui32Duplicates;
+    uint32_t ui32AcksSent;        // acknowledgements sent on their own
+    uint32_t ui32AcksPiggybacked; // acknowledgements sent with data
+    uint32_t ui32Rejected;        // malformed frames or no free peer entry
+} lora_direct_arq_stats_t;
+
+// Times are in ms from any free running clock.  The module does not depend
+// on the RTOS, the caller serializes all calls and makes sure the hooks do
+// not call back into it.
+extern uint8_t lora_direct_arq_init(const lora_direct_arq_config_t *psConfig);
+// Returns the sequence number + 1 of the frame, or 0 if the window towards
+// the peer is full or the payload is too long.  A frame the radio refused
+// for good is reported to pfnResult before this returns.
+extern uint32_t lora_direct_arq_send(uint16_t ui16Peer,
+                                     const uint8_t *pui8Payload,
+                                     uint8_t ui8Length, uint32_t ui32Now);
+// every received packet, frames for other nodes are ignored
+extern void lora_direct_arq_receive(const uint8_t *pui8Frame,
+                                    uint8_t ui8Length, uint32_t ui32Now);
+// Sends due retransmissions and acknowledgements.  Returns the ms until the
+// next call is needed, UINT32_MAX when nothing is pending.
+extern uint32_t lora_direct_arq_process(uint32_t ui32Now);
+// frames in flight towards the peer
+extern uint8_t lora_direct_arq_pending(uint16_t ui16Peer);
+extern void lora_direct_arq_stats_get(lora_direct_arq_stats_t *psStats);
+extern void lora_direct_arq_stats_reset(void);
+
+#if defined(__cplusplus)
+}
+#endif // defined(__cplusplus)
+
+#endif /* _LORA_DIRECT_ARQ_H_ */
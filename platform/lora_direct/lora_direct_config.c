@@ -36,12 +36,15 @@
 
 #include <nm_devices_lora.h>
 
+#include "lora_direct_airtime.h"
+
 const char LORA_RADIO_FREQUENCY[] = "freq";
 const char LORA_RADIO_POWER[] = "power";
 const char LORA_RADIO_SPREADING_FACTOR[] = "sf";
 const char LORA_RADIO_BANDWIDTH[] = "bw";
 const char LORA_RADIO_CODING_RATE[] = "cr";
 const char LORA_RADIO_SYNCWORD[] = "sync";
+const char LORA_RADIO_PREAMBLE[] = "preamble";
 
 uint32_t lora_radio_frequency = 915000000;
 uint32_t lora_radio_power = 22;
@@ -74,3 +77,26 @@ void lora_direct_radio_configuration_reset(void)
 	memcpy(&gsLoRaPacketParameter, &defaultLoRaPacketParameter, sizeof(lora_radio_packet_t));
 }
 */
+
+// duty cycle observation period of ETSI EN 300 220
+#ifndef LORA_DIRECT_AIRTIME_WINDOW_MS
+#define LORA_DIRECT_AIRTIME_WINDOW_MS 3600000
+#endif
+
+// EU 868 MHz sub-bands of ETSI EN 300 220, frequencies outside of them are
+// not limited so the table does no harm in other regions
+static const lora_direct_subband_t defaultLoRaSubband[] = {
+    {863000000, 864999999, 10},   {865000000, 867999999, 100},
+    {868000000, 868600000, 100},  {868700000, 869200000, 10},
+    {869400000, 869650000, 1000}, {869700000, 870000000, 100}};
+
+extern void lora_direct_airtime_configuration_reset(void) __attribute((
+    weak, alias("lora_direct_default_airtime_configuration_reset")));
+
+void lora_direct_default_airtime_configuration_reset(void)
+{
+    lora_direct_airtime_init(defaultLoRaSubband,
+                             sizeof(defaultLoRaSubband) /
+                                 sizeof(defaultLoRaSubband[0]),
+                             LORA_DIRECT_AIRTIME_WINDOW_MS);
+}
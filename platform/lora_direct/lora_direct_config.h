@@ -43,6 +43,7 @@ extern const char LORA_RADIO_SPREADING_FACTOR[];
 extern const char LORA_RADIO_BANDWIDTH[];
 extern const char LORA_RADIO_CODING_RATE[];
 extern const char LORA_RADIO_SYNCWORD[];
+extern const char LORA_RADIO_PREAMBLE[];
 
 extern uint32_t lora_radio_frequency;
 extern uint32_t lora_radio_power;
@@ -53,6 +54,10 @@ extern lora_radio_modulation_t gsLoRaModulationParameter;
 extern lora_radio_packet_t gsLoRaPacketParameter;
 
 extern void lora_direct_radio_configuration_reset(void);
+// Loads the duty cycle sub-bands when the task starts.  The default covers
+// the EU 868 MHz band, an application overrides it by defining its own
+// version that calls lora_direct_airtime_init() with the regional table.
+extern void lora_direct_airtime_configuration_reset(void);
 
 #if defined(__cplusplus)
 }
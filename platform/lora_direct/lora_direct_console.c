@@ -46,6 +46,8 @@
 
 #include "lora_direct_config.h"
 #include "lora_direct_console.h"
+#include "lora_direct_filter.h"
+#include "lora_direct_link.h"
 #include "lora_direct_task.h"
 
 TaskHandle_t lora_direct_console_task_handle;
@@ -77,6 +79,7 @@ static void LoRaHelpSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
         strcat(pcWriteBuffer, "  send     transmit message\r\n");
         strcat(pcWriteBuffer, "  rx       continuous receive\r\n");
         strcat(pcWriteBuffer, "  get      get LoRa radio parameters\r\n");
+        strcat(pcWriteBuffer, "  stats    show or reset link statistics\r\n");
         strcat(pcWriteBuffer,
                "  display  show/hide received payload content\r\n");
         strcat(pcWriteBuffer, "  help     show command details\r\n");
@@ -103,8 +106,15 @@ static void LoRaHelpSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
         strcat(pcWriteBuffer,
                "Note: freq and power must be specified together.\r\n");
     } else if (strncmp(pcParameterString, "rx", 2) == 0) {
-        strcat(pcWriteBuffer, "usage: lora rx [freq]\r\n");
-        strcat(pcWriteBuffer, "  freq is in MHz, real scalar\r\n");
+        strcat(pcWriteBuffer, "usage: lora rx [freq] [sniff|window]\r\n");
+        strcat(pcWriteBuffer, "  freq   is in MHz, real scalar\r\n");
+        strcat(pcWriteBuffer,
+               "  sniff  duty cycle the receiver, needs a long preamble\r\n");
+        strcat(pcWriteBuffer,
+               "  window listen once, stop if no preamble is found\r\n");
+    } else if (strncmp(pcParameterString, "stats", 5) == 0) {
+        strcat(pcWriteBuffer, "usage: lora stats [reset]\r\n");
+        strcat(pcWriteBuffer, "  reset clear all counters\r\n");
     } else if (strncmp(pcParameterString, "get", 3) == 0) {
         strcat(pcWriteBuffer, "usage: lora get [parameter]\r\n\r\n");
         strcat(pcWriteBuffer, "valid parameter are:\r\n");
@@ -114,6 +124,7 @@ static void LoRaHelpSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
         strcat(pcWriteBuffer, "  bw     bandwidth\r\n");
         strcat(pcWriteBuffer, "  cr     coding rate\r\n");
         strcat(pcWriteBuffer, "  sync   sync word\r\n");
+        strcat(pcWriteBuffer, "  preamble preamble length in symbols\r\n");
     } else if (strncmp(pcParameterString, "set", 3) == 0) {
         strcat(pcWriteBuffer, "usage: lora set [parameter] [value]\r\n\r\n");
         strcat(pcWriteBuffer, "valid parameter are:\r\n");
@@ -123,6 +134,7 @@ static void LoRaHelpSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
         strcat(pcWriteBuffer, "  bw     bandwidth\r\n");
         strcat(pcWriteBuffer, "  cr     coding rate\r\n");
         strcat(pcWriteBuffer, "  sync   sync word\r\n");
+        strcat(pcWriteBuffer, "  preamble preamble length in symbols\r\n");
     } else {
         strcat(pcWriteBuffer, "unknown command option\r\n");
     }
@@ -132,22 +144,28 @@ static void LoRaInitSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
                                const char *pcCommandString)
 {
     lora_direct_radio_configuration_reset();
+    lora_direct_radio_lock();
     lora_radio_initialize(NULL);
+    lora_direct_radio_unlock();
     strcat(pcWriteBuffer, "LoRa radio initialized\r\n");
 }
 
 static void LoRaDeinitSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
                                  const char *pcCommandString)
 {
+    lora_direct_radio_lock();
     lora_radio_power_ctrl(NULL, LORA_RADIO_DEEPSLEEP);
     lora_radio_deinitialize(NULL);
+    lora_direct_radio_unlock();
     strcat(pcWriteBuffer, "LoRa radio de-initialized\r\n");
 }
 
 static void LoRaResetSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
                                 const char *pcCommandString)
 {
+    lora_direct_radio_lock();
     lora_radio_reset(NULL);
+    lora_direct_radio_unlock();
     strcat(pcWriteBuffer, "LoRa radio reset\r\n");
 }
 
@@ -189,6 +207,27 @@ static void LoRaTxcwSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
                           f, power);
 }
 
+// queues the message and explains a refusal
+static uint8_t LoRaSend(char *pcWriteBuffer, uint32_t freq, uint8_t power,
+                        const uint8_t *message, uint8_t length)
+{
+    switch (lora_direct_send(freq, power, message, length)) {
+    case LORA_DIRECT_SEND_SUCCESS:
+        return 1;
+    case LORA_DIRECT_SEND_DUTY_CYCLE:
+        strcat(pcWriteBuffer, "error: duty cycle limit exceeded\r\n");
+        break;
+    case LORA_DIRECT_SEND_QUEUE_FULL:
+        strcat(pcWriteBuffer, "error: transmit queue full\r\n");
+        break;
+    default:
+        strcat(pcWriteBuffer, "error: invalid radio configuration\r\n");
+        break;
+    }
+
+    return 0;
+}
+
 static void LoRaSendSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
                                const char *pcCommandString)
 {
@@ -203,9 +242,11 @@ static void LoRaSendSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
         FreeRTOS_CLIGetParameter(pcCommandString, 2, &xParameterStringLength);
 
     if (argc == 2) {
-        lora_direct_send(lora_radio_frequency, lora_radio_power,
-                         (const uint8_t *)pcParameterString,
-                         xParameterStringLength);
+        if (!LoRaSend(pcWriteBuffer, lora_radio_frequency, lora_radio_power,
+                      (const uint8_t *)pcParameterString,
+                      xParameterStringLength)) {
+            return;
+        }
         am_util_stdio_sprintf(buffer,
                               "\r\nTransmit Parameters:\r\n%0.2f MHz at %d "
                               "dBm\r\n\r\nPayload:\r\n",
@@ -240,8 +281,11 @@ static void LoRaSendSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
             return;
         }
 
-        lora_direct_send(freq, power, (const uint8_t *)pcParameterString,
-                         xParameterStringLength);
+        if (!LoRaSend(pcWriteBuffer, freq, power,
+                      (const uint8_t *)pcParameterString,
+                      xParameterStringLength)) {
+            return;
+        }
 
         am_util_stdio_sprintf(buffer,
                               "\r\nTransmit Parameters:\r\n%0.2f MHz at %d "
@@ -273,6 +317,18 @@ static void LoRaRxSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
         freq = (uint32_t)(f * 1e6);
     }
 
+    pcParameterString =
+        FreeRTOS_CLIGetParameter(pcCommandString, 3, &xParameterStringLength);
+    if ((pcParameterString != NULL) &&
+        (strncmp(pcParameterString, "sniff", 5) == 0)) {
+        lora_direct_receive_mode_set(LORA_DIRECT_RX_DUTY_CYCLE);
+    } else if ((pcParameterString != NULL) &&
+               (strncmp(pcParameterString, "window", 6) == 0)) {
+        lora_direct_receive_mode_set(LORA_DIRECT_RX_WINDOW);
+    } else {
+        lora_direct_receive_mode_set(LORA_DIRECT_RX_CONTINUOUS);
+    }
+
     lora_direct_receive(freq);
 
     char *buffer = pcWriteBuffer + strlen(pcWriteBuffer);
@@ -460,6 +516,48 @@ static void LoRaSetSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
                     redundancy);
             }
         }
+    } else if (strncmp(pcParameterString, LORA_RADIO_PREAMBLE,
+                       xParameterStringLength) == 0) {
+        pcParameterString = FreeRTOS_CLIGetParameter(pcCommandString, 3,
+                                                     &xParameterStringLength);
+
+        if (pcParameterString == NULL) {
+            strcat(pcWriteBuffer, "error: missing preamble length\r\n");
+            return;
+        }
+
+        // the radio takes 1 to 65535 symbols
+        char *pcEnd;
+        unsigned long ulPreamble = strtoul(pcParameterString, &pcEnd, 10);
+        if ((pcParameterString[0] < '0') || (pcParameterString[0] > '9') ||
+            (pcEnd != pcParameterString + xParameterStringLength) ||
+            (ulPreamble < 1) || (ulPreamble > 0xFFFF)) {
+            strcat(pcWriteBuffer, "error: preamble length must be 1 to "
+                                  "65535 symbols\r\n");
+            return;
+        }
+
+        // sniffing receivers sleep within the preamble, it has to leave
+        // room for a sleep period
+        if (lora_direct_receive_mode_get() == LORA_DIRECT_RX_DUTY_CYCLE) {
+            lora_radio_packet_t sPacket = gsLoRaPacketParameter;
+            uint32_t ui32RxPeriod, ui32SleepPeriod;
+
+            sPacket.ui16PreambleLength = (uint16_t)ulPreamble;
+            lora_radio_rx_duty_cycle_get(&gsLoRaModulationParameter,
+                                         &sPacket, &ui32RxPeriod,
+                                         &ui32SleepPeriod);
+            if (ui32SleepPeriod == 0) {
+                strcat(pcWriteBuffer, "error: preamble too short for sniff "
+                                      "mode\r\n");
+                return;
+            }
+        }
+
+        gsLoRaPacketParameter.ui16PreambleLength = (uint16_t)ulPreamble;
+
+        am_util_stdio_sprintf(buffer, "\r\nPreamble: %d symbols\r\n",
+                              gsLoRaPacketParameter.ui16PreambleLength);
     } else {
         strcat(buffer, "\r\nunknown parameter specified\r\n");
     }
@@ -553,11 +651,133 @@ static void LoRaGetSubcommand(char *pcWriteBuffer, size_t xWriteBufferLen,
                        xParameterStringLength) == 0) {
         am_util_stdio_sprintf(buffer, "\r\nSync Word: 0x%08X\r\n",
                               lora_radio_syncword);
+    } else if (strncmp(pcParameterString, LORA_RADIO_PREAMBLE,
+                       xParameterStringLength) == 0) {
+        am_util_stdio_sprintf(buffer, "\r\nPreamble: %d symbols\r\n",
+                              gsLoRaPacketParameter.ui16PreambleLength);
     } else {
         strcat(buffer, "\r\nunknown parameter specified\r\n");
     }
 }
 
+static void LoRaStatsLink(char *buffer, const lora_direct_stats_t *psStats)
+{
+    am_util_stdio_sprintf(
+        buffer,
+        "\r\nLink:\r\n"
+        "  tx       %u packets, %u dropped, %u ms airtime\r\n"
+        "  duty     %u dropped, %u ms used at %0.2f MHz\r\n"
+        "  rx       %u packets, %u filtered, %u timeouts\r\n"
+        "  notify   %u dropped, %u events dropped\r\n"
+        "  rssi     last %0.2f dBm, average %0.2f dBm\r\n"
+        "  snr      last %0.2f dB, average %0.2f dB\r\n",
+        psStats->ui32TxCount, psStats->ui32TxDropped,
+        (uint32_t)(psStats->ui64Airtime / 1000), psStats->ui32TxDutyCycle,
+        lora_direct_airtime_used(lora_radio_frequency) / 1000,
+        lora_radio_frequency / 1e6, psStats->ui32RxCount,
+        psStats->ui32RxFiltered, psStats->ui32Timeouts,
+        psStats->ui32NotifyDropped, psStats->ui32EventDropped,
+        (float)psStats->i16RssiLast / LORA_RADIO_QDB_PER_DB,
+        (float)psStats->i16RssiAverage / LORA_RADIO_QDB_PER_DB,
+        (float)psStats->i16SnrLast / LORA_RADIO_QDB_PER_DB,
+        (float)psStats->i16SnrAverage / LORA_RADIO_QDB_PER_DB);
+
+    lora_direct_link_t sLink;
+    if (lora_direct_link_quality_get(LORA_DIRECT_LINK_ANY_PEER,
+                                     lora_radio_frequency, &sLink)) {
+        buffer += strlen(buffer);
+        am_util_stdio_sprintf(
+            buffer,
+            "  quality  rssi %0.2f dBm, snr %0.2f dB, per %0.1f%%\r\n",
+            (float)sLink.i16Rssi / LORA_RADIO_QDB_PER_DB,
+            (float)sLink.i16Snr / LORA_RADIO_QDB_PER_DB,
+            sLink.ui16Per * 100.0f / LORA_DIRECT_LINK_PER_MAX);
+    }
+}
+
+static void LoRaStatsRadio(char *buffer, const lora_direct_stats_t *psStats)
+{
+    am_util_stdio_sprintf(
+        buffer,
+        "\r\nRadio:\r\n"
+        "  events   %u tx, %u rx, %u crc errors, %u timeouts\r\n"
+        "  device   %u rx, %u crc errors, %u header errors\r\n"
+        "  errors   0x%04X\r\n"
+        "  irq      %u, latency max %u ticks\r\n"
+        "  lock     hold max %u, wait max %u ticks\r\n",
+        psStats->sRadio.ui32TxDone, psStats->sRadio.ui32RxDone,
+        psStats->sRadio.ui32CrcErrors, psStats->sRadio.ui32Timeouts,
+        psStats->sDevice.ui16PacketsReceived, psStats->sDevice.ui16CrcErrors,
+        psStats->sDevice.ui16HeaderErrors, psStats->sDevice.ui16DeviceErrors,
+        psStats->sIrq.ui32Count, psStats->sIrq.ui32MaxLatency,
+        psStats->ui32RadioHoldMax, psStats->ui32RadioWaitMax);
+}
+
+static void LoRaStatsBusy(char *buffer, const lora_direct_stats_t *psStats)
+{
+    am_util_stdio_sprintf(buffer,
+                          "\r\nBUSY (ticks):\r\n"
+                          "  waits    %u of %u checks, %u timeouts, max %u\r\n"
+                          "  wait     <1: %u",
+                          psStats->sBusy.ui32Waits, psStats->sBusy.ui32Count,
+                          psStats->sBusy.ui32Timeouts,
+                          psStats->sBusy.ui32MaxTicks,
+                          psStats->sBusy.pui32Histogram[0]);
+
+    for (uint32_t i = 1; i < LORA_RADIO_BUSY_HISTOGRAM_BINS; i++) {
+        buffer += strlen(buffer);
+        if (i < LORA_RADIO_BUSY_HISTOGRAM_BINS - 1) {
+            am_util_stdio_sprintf(buffer, ", <%u: %u", 1 << i,
+                                  psStats->sBusy.pui32Histogram[i]);
+        } else {
+            am_util_stdio_sprintf(buffer, ", >=%u: %u\r\n", 1 << (i - 1),
+                                  psStats->sBusy.pui32Histogram[i]);
+        }
+    }
+}
+
+// The statistics do not fit the CLI output buffer at once.  They are
+// written one section per call from a snapshot taken on the first, the CLI
+// calls again as long as pdTRUE is returned.
+static lora_direct_stats_t gsStatsSnapshot;
+static uint32_t gui32StatsSection;
+
+static portBASE_TYPE LoRaStatsSubcommand(char *pcWriteBuffer,
+                                         size_t xWriteBufferLen,
+                                         const char *pcCommandString)
+{
+    const char *pcParameterString;
+    portBASE_TYPE xParameterStringLength;
+
+    pcParameterString =
+        FreeRTOS_CLIGetParameter(pcCommandString, 2, &xParameterStringLength);
+
+    if ((pcParameterString != NULL) &&
+        (strncmp(pcParameterString, "reset", 5) == 0)) {
+        lora_direct_stats_reset();
+        strcat(pcWriteBuffer, "LoRa statistics reset\r\n");
+        return pdFALSE;
+    }
+
+    if (gui32StatsSection == 0) {
+        lora_direct_stats_get(&gsStatsSnapshot);
+    }
+
+    char *buffer = pcWriteBuffer + strlen(pcWriteBuffer);
+    switch (gui32StatsSection++) {
+    case 0:
+        LoRaStatsLink(buffer, &gsStatsSnapshot);
+        return pdTRUE;
+    case 1:
+        LoRaStatsRadio(buffer, &gsStatsSnapshot);
+        return pdTRUE;
+    default:
+        LoRaStatsBusy(buffer, &gsStatsSnapshot);
+        gui32StatsSection = 0;
+        return pdFALSE;
+    }
+}
+
 portBASE_TYPE prvLoRaCommand(char *pcWriteBuffer, size_t xWriteBufferLen,
                              const char *pcCommandString)
 {
@@ -586,6 +806,9 @@ portBASE_TYPE prvLoRaCommand(char *pcWriteBuffer, size_t xWriteBufferLen,
         LoRaTxcwSubcommand(pcWriteBuffer, xWriteBufferLen, pcCommandString);
     } else if (strncmp(pcParameterString, "send", 4) == 0) {
         LoRaSendSubcommand(pcWriteBuffer, xWriteBufferLen, pcCommandString);
+    } else if (strncmp(pcParameterString, "stats", 5) == 0) {
+        return LoRaStatsSubcommand(pcWriteBuffer, xWriteBufferLen,
+                                   pcCommandString);
     } else if (strncmp(pcParameterString, "set", 3) == 0) {
         LoRaSetSubcommand(pcWriteBuffer, xWriteBufferLen, pcCommandString);
     } else if (strncmp(pcParameterString, "get", 3) == 0) {
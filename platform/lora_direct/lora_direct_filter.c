@@ -0,0 +1,105 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "lora_direct_filter.h"
+
+// Decides from a few payload bytes whether a received packet is of any
+// interest to this node, so that frames for other nodes on a shared channel
+// are dropped before they reach a queue.  Like the link estimator this does
+// not depend on the RTOS.
+
+void lora_direct_filter_init(lora_direct_filter_t *psFilter)
+{
+    memset(psFilter, 0, sizeof(lora_direct_filter_t));
+    psFilter->ui8LengthMax = 0xFF;
+}
+
+static uint8_t
+lora_direct_filter_address(const lora_direct_filter_t *psFilter,
+                           const uint8_t *pui8Payload, uint8_t ui8Length)
+{
+    uint32_t ui32Address = 0;
+
+    if (psFilter->ui8AddressSize == 0) {
+        return 1;
+    }
+
+    if ((uint32_t)psFilter->ui8AddressOffset + psFilter->ui8AddressSize >
+        ui8Length) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < psFilter->ui8AddressSize; i++) {
+        ui32Address = (ui32Address << 8) |
+                      pui8Payload[psFilter->ui8AddressOffset + i];
+    }
+
+    for (uint8_t i = 0; i < psFilter->ui8AddressCount; i++) {
+        const lora_direct_filter_address_t *psEntry = &psFilter->psAddress[i];
+
+        if ((ui32Address & psEntry->ui32Mask) == psEntry->ui32Address) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+uint8_t lora_direct_filter_match(const lora_direct_filter_t *psFilter,
+                                 const uint8_t *pui8Payload, uint8_t ui8Length)
+{
+    uint8_t ui8Port;
+
+    if ((ui8Length < psFilter->ui8LengthMin) ||
+        (ui8Length > psFilter->ui8LengthMax)) {
+        return 0;
+    }
+
+    if (!lora_direct_filter_address(psFilter, pui8Payload, ui8Length)) {
+        return 0;
+    }
+
+    if (psFilter->ui8PortCheck) {
+        if (psFilter->ui8PortOffset >= ui8Length) {
+            return 0;
+        }
+        ui8Port = pui8Payload[psFilter->ui8PortOffset];
+        if (!(psFilter->pui32Ports[ui8Port >> 5] & (1UL << (ui8Port & 0x1F)))) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,82 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef _LORA_DIRECT_FILTER_H_
+#define _LORA_DIRECT_FILTER_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif // defined(__cplusplus)
+
+#ifndef LORA_DIRECT_FILTER_ADDRESSES
+#define LORA_DIRECT_FILTER_ADDRESSES 4
+#endif
+
+// An address matches an entry when (address & ui32Mask) == ui32Address.
+// The node address is an entry with all address bits in the mask, a group
+// is an entry of its own or a prefix with a shorter mask.
+typedef struct {
+    uint32_t ui32Address;
+    uint32_t ui32Mask;
+} lora_direct_filter_address_t;
+
+// Receive filter, a packet is accepted when all enabled checks pass:
+//   - the payload length is within ui8LengthMin to ui8LengthMax
+//   - with ui8AddressSize set, the big endian destination address at
+//     ui8AddressOffset matches one of the ui8AddressCount entries
+//   - with ui8PortCheck set, the byte at ui8PortOffset is set in pui32Ports
+// Packets too short to hold the address or port byte are rejected.
+typedef struct {
+    uint8_t ui8LengthMin;
+    uint8_t ui8LengthMax;
+    uint8_t ui8AddressOffset;
+    uint8_t ui8AddressSize; // 1 to 4 bytes, 0 to accept any address
+    uint8_t ui8AddressCount;
+    lora_direct_filter_address_t psAddress[LORA_DIRECT_FILTER_ADDRESSES];
+    uint8_t ui8PortCheck;
+    uint8_t ui8PortOffset;
+    uint32_t pui32Ports[8]; // one bit per port value
+} lora_direct_filter_t;
+
+#define LORA_DIRECT_FILTER_PORT_SET(psFilter, port)                            \
+    ((psFilter)->pui32Ports[(uint8_t)(port) >> 5] |= 1UL << ((port)&0x1F))
+
+// accepts every packet
+extern void lora_direct_filter_init(lora_direct_filter_t *psFilter);
+extern uint8_t lora_direct_filter_match(const lora_direct_filter_t *psFilter,
+                                        const uint8_t *pui8Payload,
+                                        uint8_t ui8Length);
+
+#if defined(__cplusplus)
+}
+#endif // defined(__cplusplus)
+
+#endif /* _LORA_DIRECT_FILTER_H_ */
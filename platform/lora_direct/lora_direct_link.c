@@ -0,0 +1,174 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <nm_devices_lora.h>
+
+#include "lora_direct_link.h"
+
+// Like the airtime accounting this does not depend on the RTOS, the caller
+// serializes access.  The averages keep log2(LORA_DIRECT_LINK_EWMA_WEIGHT)
+// extra fraction bits so that small steps are not lost to truncation.
+
+typedef struct {
+    lora_direct_link_t sLink;
+    int32_t i32Rssi;
+    int32_t i32Snr;
+    uint32_t ui32Per;
+    uint32_t ui32LastUse;
+    bool bValid;
+} lora_direct_link_state_t;
+
+static lora_direct_link_state_t psLinkList[LORA_DIRECT_LINK_ENTRIES];
+static uint32_t gui32LinkClock;
+
+void lora_direct_link_init(void)
+{
+    memset(psLinkList, 0, sizeof(psLinkList));
+    gui32LinkClock = 0;
+}
+
+static lora_direct_link_state_t *lora_direct_link_find(uint32_t ui32Peer,
+                                                       uint32_t ui32Frequency)
+{
+    for (uint32_t i = 0; i < LORA_DIRECT_LINK_ENTRIES; i++) {
+        if (psLinkList[i].bValid &&
+            (psLinkList[i].sLink.ui32Peer == ui32Peer) &&
+            (psLinkList[i].sLink.ui32Frequency == ui32Frequency)) {
+            return &psLinkList[i];
+        }
+    }
+
+    return NULL;
+}
+
+// finds the entry or recycles the least recently used one
+static lora_direct_link_state_t *lora_direct_link_claim(uint32_t ui32Peer,
+                                                        uint32_t ui32Frequency)
+{
+    lora_direct_link_state_t *psState =
+        lora_direct_link_find(ui32Peer, ui32Frequency);
+
+    if (psState == NULL) {
+        psState = &psLinkList[0];
+        for (uint32_t i = 0; i < LORA_DIRECT_LINK_ENTRIES; i++) {
+            if (!psLinkList[i].bValid) {
+                psState = &psLinkList[i];
+                break;
+            }
+            if ((gui32LinkClock - psLinkList[i].ui32LastUse) >
+                (gui32LinkClock - psState->ui32LastUse)) {
+                psState = &psLinkList[i];
+            }
+        }
+
+        memset(psState, 0, sizeof(lora_direct_link_state_t));
+        psState->sLink.ui32Peer = ui32Peer;
+        psState->sLink.ui32Frequency = ui32Frequency;
+    }
+
+    psState->ui32LastUse = ++gui32LinkClock;
+
+    return psState;
+}
+
+static void lora_direct_link_per_update(lora_direct_link_state_t *psState,
+                                        uint32_t ui32Sample)
+{
+    psState->ui32Per = psState->ui32Per -
+                       psState->ui32Per / LORA_DIRECT_LINK_EWMA_WEIGHT +
+                       ui32Sample;
+}
+
+void lora_direct_link_update(uint32_t ui32Peer, uint32_t ui32Frequency,
+                             const lora_radio_physical_packet_t *psPacket)
+{
+    lora_direct_link_state_t *psState =
+        lora_direct_link_claim(ui32Peer, ui32Frequency);
+
+    // the first packet seeds the averages
+    if (!psState->bValid) {
+        psState->i32Rssi = psPacket->i16Rssi * LORA_DIRECT_LINK_EWMA_WEIGHT;
+        psState->i32Snr = psPacket->i16Snr * LORA_DIRECT_LINK_EWMA_WEIGHT;
+        psState->bValid = true;
+    } else {
+        psState->i32Rssi += psPacket->i16Rssi -
+                            psState->i32Rssi / LORA_DIRECT_LINK_EWMA_WEIGHT;
+        psState->i32Snr += psPacket->i16Snr -
+                           psState->i32Snr / LORA_DIRECT_LINK_EWMA_WEIGHT;
+    }
+
+    psState->sLink.ui32Packets++;
+    if (psPacket->ui8CrcError) {
+        psState->sLink.ui32Errors++;
+        lora_direct_link_per_update(psState, LORA_DIRECT_LINK_PER_MAX);
+    } else {
+        lora_direct_link_per_update(psState, 0);
+    }
+}
+
+void lora_direct_link_loss(uint32_t ui32Peer, uint32_t ui32Frequency,
+                           uint32_t ui32Count)
+{
+    lora_direct_link_state_t *psState =
+        lora_direct_link_find(ui32Peer, ui32Frequency);
+
+    // losses are only meaningful for a link that has been heard before
+    if (psState == NULL) {
+        return;
+    }
+
+    psState->sLink.ui32Errors += ui32Count;
+    while (ui32Count--) {
+        lora_direct_link_per_update(psState, LORA_DIRECT_LINK_PER_MAX);
+    }
+}
+
+uint8_t lora_direct_link_get(uint32_t ui32Peer, uint32_t ui32Frequency,
+                             lora_direct_link_t *psLink)
+{
+    lora_direct_link_state_t *psState =
+        lora_direct_link_find(ui32Peer, ui32Frequency);
+
+    if (psState == NULL) {
+        return 0;
+    }
+
+    memcpy(psLink, &psState->sLink, sizeof(lora_direct_link_t));
+    psLink->i16Rssi = psState->i32Rssi / LORA_DIRECT_LINK_EWMA_WEIGHT;
+    psLink->i16Snr = psState->i32Snr / LORA_DIRECT_LINK_EWMA_WEIGHT;
+    psLink->ui16Per = psState->ui32Per / LORA_DIRECT_LINK_EWMA_WEIGHT;
+
+    return 1;
+}
@@ -0,0 +1,78 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Northern Mechatronics, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef _LORA_DIRECT_LINK_H_
+#define _LORA_DIRECT_LINK_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif // defined(__cplusplus)
+
+#define LORA_DIRECT_LINK_ENTRIES 8
+
+// a new sample contributes 1/LORA_DIRECT_LINK_EWMA_WEIGHT to the averages,
+// must be a power of two
+#ifndef LORA_DIRECT_LINK_EWMA_WEIGHT
+#define LORA_DIRECT_LINK_EWMA_WEIGHT 8
+#endif
+
+// packets that cannot be attributed to a peer are accounted here
+#define LORA_DIRECT_LINK_ANY_PEER 0
+
+// packet error rate at which every packet is lost
+#define LORA_DIRECT_LINK_PER_MAX 0xFFFF
+
+typedef struct {
+    uint32_t ui32Peer;
+    uint32_t ui32Frequency;
+    int16_t i16Rssi;      // average in 0.25 dBm
+    int16_t i16Snr;       // average in 0.25 dB
+    uint16_t ui16Per;     // average packet error rate, LORA_DIRECT_LINK_PER_MAX
+                          // when every packet is lost
+    uint32_t ui32Packets; // packets received
+    uint32_t ui32Errors;  // packets that failed the CRC or were reported lost
+} lora_direct_link_t;
+
+extern void lora_direct_link_init(void);
+extern void
+lora_direct_link_update(uint32_t ui32Peer, uint32_t ui32Frequency,
+                        const lora_radio_physical_packet_t *psPacket);
+// packets known to be missing, for instance from a sequence number gap
+extern void lora_direct_link_loss(uint32_t ui32Peer, uint32_t ui32Frequency,
+                                  uint32_t ui32Count);
+extern uint8_t lora_direct_link_get(uint32_t ui32Peer, uint32_t ui32Frequency,
+                                    lora_direct_link_t *psLink);
+
+#if defined(__cplusplus)
+}
+#endif // defined(__cplusplus)
+
+#endif /* _LORA_DIRECT_LINK_H_ */
@@ -31,11 +31,11 @@
  */
 #include <stdbool.h>
 #include <stdint.h>
-#include <stdlib.h>
 #include <string.h>
 
 #include <FreeRTOS.h>
 #include <queue.h>
+#include <semphr.h>
 #include <task.h>
 
 #include <am_mcu_apollo.h>
@@ -43,91 +43,845 @@
 
 #include "task_message.h"
 
+#include "lora_direct_airtime.h"
 #include "lora_direct_config.h"
+#include "lora_direct_link.h"
+#include "lora_direct_adr.h"
+#include "lora_direct_filter.h"
 #include "lora_direct_task.h"
 
+// one entry per queue, a free entry has no queue
 typedef struct {
     QueueHandle_t sTaskQueue;
-    uint32_t ui32Event;
+    uint32_t ui32Events; // LORA_DIRECT_EVENT() bits
+    lora_direct_notify_policy_e ePolicy;
+    uint32_t ui32Overflows; // notifications lost to a full queue
 } lora_direct_subscriber_t;
 
 TaskHandle_t lora_direct_task_handle;
 
 #define LORA_TASK_MESSAGE_QUEUE_SIZE 10
+
+// radio interrupts are serviced by the task, the event only wakes it up
+#define LORA_TASK_EVENT_IRQ (UNKNOWN + 1)
+// Requests from other tasks.  Only the task changes the radio mode, so
+// nothing can abort a transmission it is waiting on.
+#define LORA_TASK_EVENT_CAD (UNKNOWN + 2)
+#define LORA_TASK_EVENT_CAD_DONE (UNKNOWN + 3)
+#define LORA_TASK_EVENT_CARRIER (UNKNOWN + 4)
 static QueueHandle_t gsLoRaTaskQueue;
+static SemaphoreHandle_t gsLoRaBusySemaphore;
 
-static lora_radio_physical_packet_t gsLoRaRadioPhysicalPacket;
-static uint8_t
-    psLoRaRadioPhysicalPacketPayload[LORA_RADIO_MAX_PHYSICAL_PACKET] = {0};
+// Serializes the lora_radio_* calls of all tasks.  Unlike a critical
+// section it leaves interrupts and higher priority tasks running through
+// the SPI transfers and BUSY waits of a radio configuration.  It is
+// recursive, the holder and nesting depth are kept to time the outermost
+// hold and to catch a holder waiting on the task.
+static SemaphoreHandle_t gsLoRaRadioMutex;
+static TaskHandle_t gxLoRaRadioHolder;
+static uint32_t gui32LoRaRadioDepth;
+static uint32_t gui32LoRaRadioLockTick;
 
-#define MAX_SUBSCRIBERS 10
-static uint8_t gui8LoRaMessageSubscriberSize;
-static lora_direct_subscriber_t psLoRaMessageSubscriberList[MAX_SUBSCRIBERS] = {
-    0};
+// longest time lora_direct_send will wait for duty cycle budget to free up
+#ifndef LORA_DIRECT_AIRTIME_MAX_DEFER_MS
+#define LORA_DIRECT_AIRTIME_MAX_DEFER_MS 5000
+#endif
 
-void lora_direct_transmit_carrier(uint32_t frequency, uint8_t power)
+// listen-before-talk: CAD attempts before giving up and the initial random
+// backoff window, which doubles after every busy channel
+#ifndef LORA_DIRECT_LBT_ATTEMPTS
+#define LORA_DIRECT_LBT_ATTEMPTS 5
+#endif
+
+#ifndef LORA_DIRECT_LBT_BACKOFF_MS
+#define LORA_DIRECT_LBT_BACKOFF_MS 50
+#endif
+
+// symbols a receive window waits for a preamble
+#ifndef LORA_DIRECT_RX_WINDOW_SYMBOLS
+#define LORA_DIRECT_RX_WINDOW_SYMBOLS 8
+#endif
+
+#ifndef LORA_DIRECT_CAD_TIMEOUT_MS
+#define LORA_DIRECT_CAD_TIMEOUT_MS 1000
+#endif
+
+// a transmission that ends with neither TXDONE nor TIMEOUT this long after
+// its time on air was lost to a radio reset, it is sent once more
+#ifndef LORA_DIRECT_TX_WATCHDOG_MS
+#define LORA_DIRECT_TX_WATCHDOG_MS 500
+#endif
+
+// transmit power limits for lora_direct_send_to, peers start at
+// lora_radio_power and are assumed to send with it as well; the margin is
+// in 0.25 dB
+#ifndef LORA_DIRECT_ADR_POWER_MIN
+#define LORA_DIRECT_ADR_POWER_MIN 2
+#endif
+
+#ifndef LORA_DIRECT_ADR_MARGIN
+#define LORA_DIRECT_ADR_MARGIN (10 * LORA_RADIO_QDB_PER_DB)
+#endif
+
+// fastest spreading factor lora_direct_send_to asks a peer for, the
+// configured one is the slowest
+#ifndef LORA_DIRECT_ADR_SF_MIN
+#define LORA_DIRECT_ADR_SF_MIN LORA_RADIO_SF7
+#endif
+
+// transmit requests are queued and sent back to back by the task, the
+// receiver is only re-armed once the queue is empty
+#ifndef LORA_DIRECT_TX_QUEUE_SIZE
+#define LORA_DIRECT_TX_QUEUE_SIZE 4
+#endif
+
+// every message carries its own radio profile so that packets to different
+// peers can be queued back to back at their own data rate
+typedef struct {
+    lora_radio_profile_t sProfile;
+    uint32_t ui32Frequency;
+    uint32_t ui32Airtime;
+    uint8_t ui8Power;
+    uint8_t ui8Length;
+    uint8_t pui8Payload[LORA_RADIO_MAX_PHYSICAL_PACKET];
+} lora_direct_tx_message_t;
+
+static QueueHandle_t gsLoRaTxQueue;
+static lora_direct_tx_message_t gsLoRaTxMessage;
+static bool gbLoRaTransmitting;
+static bool gbLoRaTxRetried;
+static TickType_t gxLoRaTxDeadline;
+
+static lora_direct_rx_mode_e geLoRaRxMode = LORA_DIRECT_RX_CONTINUOUS;
+// the receiver is re-armed here whenever the radio has nothing else to do
+static uint32_t gui32LoRaRxFrequency;
+static uint8_t gui8LoRaRxSpreadingFactor; // the receiver was last armed at
+
+// carrier requested while the radio was busy, started once it is idle
+static bool gbLoRaCarrierPending;
+static uint32_t gui32LoRaCarrierFrequency;
+static uint8_t gui8LoRaCarrierPower;
+
+// the averages are derived from the sums when the statistics are read
+static lora_direct_stats_t gsLoRaStats;
+static int32_t gi32LoRaRssiSum;
+static int32_t gi32LoRaSnrSum;
+
+// applied to every received packet before the task handles it
+static lora_direct_filter_t gsLoRaRxFilter = {.ui8LengthMax = 0xFF};
+
+// Backoff generator, seeded from the radio's noise so that nodes booted
+// together do not back off in lockstep
+static uint32_t gui32LoRaRandom;
+
+// events raised by the radio callbacks during one lora_radio_irq_service()
+#ifndef LORA_DIRECT_PENDING_EVENTS
+#define LORA_DIRECT_PENDING_EVENTS 4
+#endif
+
+static task_message_t gpsLoRaEvents[LORA_DIRECT_PENDING_EVENTS];
+static uint32_t gui32LoRaEventCount;
+
+static QueueHandle_t gsLoRaCadQueue;
+static SemaphoreHandle_t gsLoRaCadMutex;
+static volatile uint8_t gui8CadDetected;
+static uint32_t gui32LoRaCadFrequency;
+static bool gbLoRaCad;
+
+// CAD detection peak for SF5 to SF12 over two symbols
+static const uint8_t pui8CadDetectPeak[] = {22, 22, 22, 22, 23, 24, 25, 28};
+
+// subscriber queues, each one takes any number of events
+#ifndef LORA_DIRECT_MAX_SUBSCRIBERS
+#define LORA_DIRECT_MAX_SUBSCRIBERS 10
+#endif
+
+#if LORA_DIRECT_MAX_SUBSCRIBERS > 32
+#error "LORA_DIRECT_MAX_SUBSCRIBERS must not exceed 32"
+#endif
+
+#define LORA_DIRECT_EVENT_COUNT (UNKNOWN + 1)
+
+static lora_direct_subscriber_t
+    psLoRaMessageSubscriberList[LORA_DIRECT_MAX_SUBSCRIBERS];
+// entries of psLoRaMessageSubscriberList subscribed to each event
+static uint32_t pui32LoRaEventSubscribers[LORA_DIRECT_EVENT_COUNT];
+
+// Lock hold and wait times are tracked in STIMER ticks.  The mutex is
+// created when the task starts, locking before that is a bug.
+void lora_direct_radio_lock(void)
+{
+    uint32_t ui32Start = am_hal_stimer_counter_get();
+    uint32_t ui32Wait;
+
+    configASSERT(gsLoRaRadioMutex);
+    xSemaphoreTakeRecursive(gsLoRaRadioMutex, portMAX_DELAY);
+
+    if (gui32LoRaRadioDepth++) {
+        return;
+    }
+
+    gxLoRaRadioHolder = xTaskGetCurrentTaskHandle();
+    gui32LoRaRadioLockTick = am_hal_stimer_counter_get();
+    ui32Wait = gui32LoRaRadioLockTick - ui32Start;
+    if (ui32Wait > gsLoRaStats.ui32RadioWaitMax) {
+        gsLoRaStats.ui32RadioWaitMax = ui32Wait;
+    }
+}
+
+void lora_direct_radio_unlock(void)
+{
+    uint32_t ui32Hold;
+
+    configASSERT(gsLoRaRadioMutex &&
+                 (gxLoRaRadioHolder == xTaskGetCurrentTaskHandle()));
+
+    if (--gui32LoRaRadioDepth == 0) {
+        gxLoRaRadioHolder = NULL;
+        ui32Hold = am_hal_stimer_counter_get() - gui32LoRaRadioLockTick;
+        if (ui32Hold > gsLoRaStats.ui32RadioHoldMax) {
+            gsLoRaStats.ui32RadioHoldMax = ui32Hold;
+        }
+    }
+
+    xSemaphoreGiveRecursive(gsLoRaRadioMutex);
+}
+
+// posts a request to the task, which may be busy with the radio for a while
+static void lora_direct_request(uint32_t ui32Event)
+{
+    task_message_t sTaskMessage;
+
+    if (!gsLoRaTaskQueue) {
+        return;
+    }
+
+    // the task needs the radio lock to get through its queue
+    configASSERT(gxLoRaRadioHolder != xTaskGetCurrentTaskHandle());
+
+    sTaskMessage.ui32Event = ui32Event;
+    sTaskMessage.psContent = NULL;
+    xQueueSend(gsLoRaTaskQueue, &sTaskMessage, portMAX_DELAY);
+}
+
+// a transmission or channel activity detection owns the radio
+static bool lora_direct_radio_busy(void)
+{
+    return gbLoRaTransmitting || gbLoRaCad;
+}
+
+static void lora_direct_carrier_start(void)
 {
     lora_radio_transfer_t transaction;
 
-    transaction.ui32Frequency = frequency;
-    transaction.ui8Power = power;
+    transaction.ui32Frequency = gui32LoRaCarrierFrequency;
+    transaction.ui8Power = gui8LoRaCarrierPower;
     transaction.eMode = LORA_RADIO_TXCARRIER;
 
-    taskENTER_CRITICAL();
+    gbLoRaCarrierPending = false;
+
+    lora_direct_radio_lock();
     lora_radio_transfer(NULL, &transaction);
+    lora_direct_radio_unlock();
+}
+
+void lora_direct_transmit_carrier(uint32_t frequency, uint8_t power)
+{
+    taskENTER_CRITICAL();
+    gui32LoRaCarrierFrequency = frequency;
+    gui8LoRaCarrierPower = power;
     taskEXIT_CRITICAL();
+
+    lora_direct_request(LORA_TASK_EVENT_CARRIER);
 }
 
-void lora_direct_send(uint32_t frequency, uint8_t power, const uint8_t *message,
-                      uint8_t length)
+// sends gsLoRaTxMessage and arms the watchdog
+static void lora_direct_transmit_start(void)
 {
     lora_radio_transfer_t transaction;
 
-    transaction.psModulationParameters = &gsLoRaModulationParameter;
-    transaction.psPacketParameters = &gsLoRaPacketParameter;
-    transaction.ui32Frequency = frequency;
+    transaction.psProfile = &gsLoRaTxMessage.sProfile;
+    transaction.ui32Frequency = gsLoRaTxMessage.ui32Frequency;
     transaction.eMode = LORA_RADIO_TX;
-    transaction.ui8Power = power;
+    transaction.ui8Power = gsLoRaTxMessage.ui8Power;
     transaction.ui32Timeout = 0xFFFFFF00;
-    transaction.ui32SyncWord = lora_radio_syncword;
 
-    transaction.pui8Payload = (uint8_t *)message;
-    gsLoRaPacketParameter.ui8PayloadLength = length;
+    transaction.pui8Payload = gsLoRaTxMessage.pui8Payload;
+    transaction.ui8PayloadLength = gsLoRaTxMessage.ui8Length;
+
+    // the TX setup is queued to the radio in the background, fall back to a
+    // blocking transfer if a previous setup is still in flight
+    lora_direct_radio_lock();
+    if (lora_radio_transfer_nonblocking(NULL, &transaction, NULL, NULL) !=
+        LORA_RADIO_STATUS_SUCCESS) {
+        lora_radio_transfer(NULL, &transaction);
+    }
+    lora_direct_radio_unlock();
+
+    gbLoRaTransmitting = true;
+    gxLoRaTxDeadline =
+        xTaskGetTickCount() +
+        pdMS_TO_TICKS(gsLoRaTxMessage.ui32Airtime / 1000 +
+                      LORA_DIRECT_TX_WATCHDOG_MS);
+}
+
+// Start the next queued transmission, returns 0 once the queue is empty.
+// Consecutive packets with unchanged parameters only cost a FIFO write and
+// SetTx as the driver skips configuration the radio already holds.
+static uint8_t lora_direct_transmit_next(void)
+{
+    if (xQueueReceive(gsLoRaTxQueue, &gsLoRaTxMessage, 0) != pdPASS) {
+        gbLoRaTransmitting = false;
+        return 0;
+    }
+
+    gbLoRaTxRetried = false;
+    lora_direct_transmit_start();
+
+    return 1;
+}
+
+// profile for the configuration in lora_direct_config with the given
+// modulation, returns 0 if the configuration is not valid
+static uint8_t
+lora_direct_profile_build(lora_radio_profile_t *psProfile,
+                          const lora_radio_modulation_t *psModulation)
+{
+    return lora_radio_profile_init(psProfile, psModulation,
+                                   &gsLoRaPacketParameter,
+                                   lora_radio_syncword) ==
+           LORA_RADIO_STATUS_SUCCESS;
+}
+
+lora_direct_send_e
+lora_direct_send_profile(const lora_radio_profile_t *psProfile,
+                         uint32_t frequency, uint8_t power,
+                         const uint8_t *message, uint8_t length)
+{
+    lora_direct_tx_message_t sTxMessage;
+    lora_direct_airtime_e eAirtime;
+    uint32_t ui32Airtime;
+    uint32_t ui32Delay;
+    uint32_t ui32Now;
+
+    ui32Airtime = lora_direct_airtime_get(&psProfile->sModulation,
+                                          &psProfile->sPacket, length);
+
+    memcpy(&sTxMessage.sProfile, psProfile, sizeof(lora_radio_profile_t));
+    sTxMessage.ui32Frequency = frequency;
+    sTxMessage.ui32Airtime = ui32Airtime;
+    sTxMessage.ui8Power = power;
+    sTxMessage.ui8Length = length;
+    memcpy(sTxMessage.pui8Payload, message, length);
+
+    // hold the message until the sub-band has enough duty cycle budget left
+    while (1) {
+        taskENTER_CRITICAL();
+        ui32Now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        eAirtime = lora_direct_airtime_check(frequency, ui32Airtime, ui32Now,
+                                             &ui32Delay);
+        if (eAirtime != LORA_DIRECT_AIRTIME_DEFER) {
+            break;
+        }
+        taskEXIT_CRITICAL();
+
+        if (ui32Delay > LORA_DIRECT_AIRTIME_MAX_DEFER_MS) {
+            taskENTER_CRITICAL();
+            gsLoRaStats.ui32TxDropped++;
+            gsLoRaStats.ui32TxDutyCycle++;
+            taskEXIT_CRITICAL();
+            return LORA_DIRECT_SEND_DUTY_CYCLE;
+        }
+        vTaskDelay(pdMS_TO_TICKS(ui32Delay) + 1);
+    }
+
+    if (eAirtime == LORA_DIRECT_AIRTIME_REJECT) {
+        gsLoRaStats.ui32TxDropped++;
+        gsLoRaStats.ui32TxDutyCycle++;
+        taskEXIT_CRITICAL();
+        return LORA_DIRECT_SEND_DUTY_CYCLE;
+    }
+
+    if (uxQueueSpacesAvailable(gsLoRaTxQueue) == 0) {
+        gsLoRaStats.ui32TxDropped++;
+        taskEXIT_CRITICAL();
+        return LORA_DIRECT_SEND_QUEUE_FULL;
+    }
+
+    // claim the airtime before leaving the critical section so concurrent
+    // senders cannot both spend the last of the budget
+    lora_direct_airtime_record(frequency, ui32Airtime, ui32Now);
+    taskEXIT_CRITICAL();
+
+    if (xQueueSend(gsLoRaTxQueue, &sTxMessage, 0) != pdPASS) {
+        // another sender took the last queue slot
+        taskENTER_CRITICAL();
+        lora_direct_airtime_release(frequency, ui32Airtime, ui32Now);
+        gsLoRaStats.ui32TxDropped++;
+        taskEXIT_CRITICAL();
+        return LORA_DIRECT_SEND_QUEUE_FULL;
+    }
+
+    // wake the task in case it is idle, otherwise the message is picked up
+    // when the current transmission completes
+    lora_direct_request(TX);
+
+    return LORA_DIRECT_SEND_SUCCESS;
+}
+
+lora_direct_send_e lora_direct_send(uint32_t frequency, uint8_t power,
+                                    const uint8_t *message, uint8_t length)
+{
+    lora_radio_profile_t sProfile;
+
+    if (!lora_direct_profile_build(&sProfile, &gsLoRaModulationParameter)) {
+        return LORA_DIRECT_SEND_INVALID_ARG;
+    }
+
+    return lora_direct_send_profile(&sProfile, frequency, power, message,
+                                    length);
+}
+
+lora_direct_send_e lora_direct_send_to(uint32_t ui32Peer,
+                                       const uint8_t *message, uint8_t length)
+{
+    lora_radio_modulation_t sModulation = gsLoRaModulationParameter;
+    lora_radio_profile_t sProfile;
+    uint8_t ui8Power;
+    uint8_t ui8Sf;
 
     taskENTER_CRITICAL();
-    lora_radio_transfer(NULL, &transaction);
+    ui8Power = lora_direct_adr_power_get(ui32Peer);
+    ui8Sf = lora_direct_adr_tx_sf_get(ui32Peer, xTaskGetTickCount() *
+                                                    portTICK_PERIOD_MS);
     taskEXIT_CRITICAL();
+
+    if (ui8Sf) {
+        sModulation.eSpreadingFactor = (lora_radio_spreading_factor_e)ui8Sf;
+    }
+
+    if (!lora_direct_profile_build(&sProfile, &sModulation)) {
+        return LORA_DIRECT_SEND_INVALID_ARG;
+    }
+
+    return lora_direct_send_profile(&sProfile, lora_radio_frequency, ui8Power,
+                                    message, length);
 }
 
-void lora_direct_receive(uint32_t frequency)
+// Spreading factor to listen at, the configured one unless peers asked for
+// another.  Called in a critical section.
+static uint8_t lora_direct_listen_sf(uint32_t *pui32Remaining)
+{
+    uint8_t ui8Sf = lora_direct_adr_listen_get(
+        xTaskGetTickCount() * portTICK_PERIOD_MS, pui32Remaining);
+
+    return ui8Sf ? ui8Sf : gsLoRaModulationParameter.eSpreadingFactor;
+}
+
+uint8_t lora_direct_rate_announce(uint32_t ui32Peer)
+{
+    uint8_t ui8Request, ui8Listen;
+
+    taskENTER_CRITICAL();
+    ui8Request = lora_direct_adr_sf_get(ui32Peer);
+    if (ui8Request == 0) {
+        ui8Request = gsLoRaModulationParameter.eSpreadingFactor;
+    }
+    ui8Listen = lora_direct_listen_sf(NULL);
+    taskEXIT_CRITICAL();
+
+    return (ui8Request << 4) | ui8Listen;
+}
+
+void lora_direct_rate_update(uint32_t ui32Peer, uint8_t ui8Rate)
+{
+    uint8_t ui8Request = ui8Rate >> 4;
+    uint8_t ui8Listen = ui8Rate & 0x0F;
+    bool bChanged;
+
+    if ((ui8Request < LORA_RADIO_SF5) || (ui8Request > LORA_RADIO_SF12) ||
+        (ui8Listen < LORA_RADIO_SF5) || (ui8Listen > LORA_RADIO_SF12)) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    lora_direct_adr_rate_update(ui32Peer, ui8Listen, ui8Request,
+                                xTaskGetTickCount() * portTICK_PERIOD_MS);
+    bChanged = lora_direct_listen_sf(NULL) != gui8LoRaRxSpreadingFactor;
+    taskEXIT_CRITICAL();
+
+    // the task checks the receiver itself before it waits again
+    if (bChanged && (xTaskGetCurrentTaskHandle() != lora_direct_task_handle)) {
+        lora_direct_request(RX);
+    }
+}
+
+// runs in the task, a CAD requested while the radio is busy reports
+// activity right away
+static void lora_direct_cad_start(void)
 {
     lora_radio_transfer_t transaction;
+    lora_radio_profile_t sProfile;
+    lora_radio_cad_t sCad;
+    uint8_t ui8Detected = 1;
+
+    if (lora_direct_radio_busy() ||
+        !lora_direct_profile_build(&sProfile, &gsLoRaModulationParameter)) {
+        xQueueSend(gsLoRaCadQueue, &ui8Detected, 0);
+        return;
+    }
+
+    sCad.eSymbolNum = LORA_RADIO_CAD_SYMBOL_2;
+    sCad.ui8DetectPeak =
+        pui8CadDetectPeak[sProfile.sModulation.eSpreadingFactor -
+                          LORA_RADIO_SF5];
+    sCad.ui8DetectMin = 10;
+    sCad.eExitMode = LORA_RADIO_CAD_ONLY;
+
+    transaction.psProfile = &sProfile;
+    transaction.psCadParameters = &sCad;
+    transaction.ui32Frequency = gui32LoRaCadFrequency;
+    transaction.eMode = LORA_RADIO_CAD;
+    transaction.ui32Timeout = 0;
+
+    gbLoRaCad = true;
+
+    lora_direct_radio_lock();
+    gui8CadDetected = 0;
+    lora_radio_transfer(NULL, &transaction);
+    lora_direct_radio_unlock();
+}
+
+// Returns 1 if no LoRa activity was detected on the channel.  The task
+// runs the detection and goes back to receive or to queued transmissions
+// once it is done.
+static uint8_t lora_direct_channel_clear(uint32_t frequency)
+{
+    uint8_t ui8Detected;
+    BaseType_t xResult;
+
+    xSemaphoreTake(gsLoRaCadMutex, portMAX_DELAY);
+
+    xQueueReset(gsLoRaCadQueue);
+    gui32LoRaCadFrequency = frequency;
+    lora_direct_request(LORA_TASK_EVENT_CAD);
+
+    // a missing CADDONE is treated as a busy channel, the task is told to
+    // stop waiting for it
+    xResult = xQueueReceive(gsLoRaCadQueue, &ui8Detected,
+                            pdMS_TO_TICKS(LORA_DIRECT_CAD_TIMEOUT_MS));
+    if (xResult != pdPASS) {
+        lora_direct_request(LORA_TASK_EVENT_CAD_DONE);
+    }
+
+    xSemaphoreGive(gsLoRaCadMutex);
+
+    return (xResult == pdPASS) && !ui8Detected;
+}
+
+// xorshift32, senders on several tasks may draw at once
+static uint32_t lora_direct_random(void)
+{
+    uint32_t x;
+
+    taskENTER_CRITICAL();
+    x = gui32LoRaRandom;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gui32LoRaRandom = x;
+    taskEXIT_CRITICAL();
+
+    return x;
+}
+
+// the receiver stays armed between attempts as the task returns to it
+// after every detection
+lora_direct_send_e lora_direct_send_lbt(uint32_t frequency, uint8_t power,
+                                        const uint8_t *message,
+                                        uint8_t length)
+{
+    uint32_t ui32Window = LORA_DIRECT_LBT_BACKOFF_MS;
+
+    for (uint32_t i = 0; i < LORA_DIRECT_LBT_ATTEMPTS; i++) {
+        if (lora_direct_channel_clear(frequency)) {
+            return lora_direct_send(frequency, power, message, length);
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(lora_direct_random() % ui32Window) + 1);
+        ui32Window <<= 1;
+    }
 
-    transaction.psModulationParameters = &gsLoRaModulationParameter;
-    transaction.psPacketParameters = &gsLoRaPacketParameter;
-    transaction.ui32Frequency = frequency;
-    transaction.eMode = LORA_RADIO_RX;
-    transaction.ui32Timeout = 0xFFFFFF04;
-    transaction.ui32SyncWord = lora_radio_syncword;
+    return LORA_DIRECT_SEND_CHANNEL_BUSY;
+}
+
+void lora_direct_receive_mode_set(lora_direct_rx_mode_e eMode)
+{
+    geLoRaRxMode = eMode;
+}
+
+lora_direct_rx_mode_e lora_direct_receive_mode_get(void)
+{
+    return geLoRaRxMode;
+}
+
+static void lora_direct_receive_start(void)
+{
+    lora_radio_modulation_t sModulation = gsLoRaModulationParameter;
+    lora_radio_transfer_t transaction;
+    lora_radio_profile_t sProfile;
 
     taskENTER_CRITICAL();
+    sModulation.eSpreadingFactor =
+        (lora_radio_spreading_factor_e)lora_direct_listen_sf(NULL);
+    taskEXIT_CRITICAL();
+
+    if (!lora_direct_profile_build(&sProfile, &sModulation)) {
+        return;
+    }
+    gui8LoRaRxSpreadingFactor = sModulation.eSpreadingFactor;
+
+    transaction.psProfile = &sProfile;
+    transaction.ui32Frequency = gui32LoRaRxFrequency;
+
+    if (geLoRaRxMode == LORA_DIRECT_RX_DUTY_CYCLE) {
+        // windows are derived from the preamble length
+        transaction.eMode = LORA_RADIO_RX_DUTY_CYCLE;
+        transaction.ui32Timeout = 0;
+        transaction.ui32SleepPeriod = 0;
+    } else if (geLoRaRxMode == LORA_DIRECT_RX_WINDOW) {
+        // single reception, the radio gives up after the symbol timeout
+        transaction.eMode = LORA_RADIO_RX;
+        transaction.ui32Timeout = LORA_DIRECT_RX_WINDOW_SYMBOLS;
+    } else {
+        transaction.eMode = LORA_RADIO_RX;
+        transaction.ui32Timeout = 0xFFFFFF04;
+    }
+
+    lora_direct_radio_lock();
     lora_radio_transfer(NULL, &transaction);
+    lora_direct_radio_unlock();
+}
+
+// Nothing owns the radio any more: queued packets go first, then a carrier
+// requested in the meantime, otherwise the receiver is re-armed.
+static void lora_direct_radio_idle(void)
+{
+    if (lora_direct_transmit_next()) {
+        return;
+    }
+
+    if (gbLoRaCarrierPending) {
+        lora_direct_carrier_start();
+    } else {
+        lora_direct_receive_start();
+    }
+}
+
+void lora_direct_receive(uint32_t frequency)
+{
+    taskENTER_CRITICAL();
+    gui32LoRaRxFrequency = frequency;
+    taskEXIT_CRITICAL();
+
+    lora_direct_request(RX);
+}
+
+uint32_t lora_direct_airtime_used(uint32_t frequency)
+{
+    uint32_t ui32Usage;
+
+    taskENTER_CRITICAL();
+    ui32Usage = lora_direct_airtime_usage(
+        frequency, xTaskGetTickCount() * portTICK_PERIOD_MS);
+    taskEXIT_CRITICAL();
+
+    return ui32Usage;
+}
+
+uint32_t lora_direct_airtime_wait(uint32_t frequency, uint32_t ui32Airtime)
+{
+    lora_direct_airtime_e eAirtime;
+    uint32_t ui32Delay = 0;
+
+    taskENTER_CRITICAL();
+    eAirtime = lora_direct_airtime_check(
+        frequency, ui32Airtime, xTaskGetTickCount() * portTICK_PERIOD_MS,
+        &ui32Delay);
+    taskEXIT_CRITICAL();
+
+    if (eAirtime == LORA_DIRECT_AIRTIME_REJECT) {
+        return UINT32_MAX;
+    }
+
+    return eAirtime == LORA_DIRECT_AIRTIME_DEFER ? ui32Delay : 0;
+}
+
+void lora_direct_stats_get(lora_direct_stats_t *psStats)
+{
+    taskENTER_CRITICAL();
+    memcpy(psStats, &gsLoRaStats, sizeof(lora_direct_stats_t));
+    if (gsLoRaStats.ui32RxCount) {
+        psStats->i16RssiAverage =
+            gi32LoRaRssiSum / (int32_t)gsLoRaStats.ui32RxCount;
+        psStats->i16SnrAverage =
+            gi32LoRaSnrSum / (int32_t)gsLoRaStats.ui32RxCount;
+    }
+    taskEXIT_CRITICAL();
+
+    // reading the device counters takes SPI transfers
+    lora_direct_radio_lock();
+    lora_radio_event_stats_get(NULL, &psStats->sRadio);
+    lora_radio_device_stats_get(NULL, &psStats->sDevice);
+    lora_radio_busy_stats_get(NULL, &psStats->sBusy);
+    lora_radio_irq_stats_get(NULL, &psStats->sIrq);
+    lora_direct_radio_unlock();
+}
+
+void lora_direct_stats_reset(void)
+{
+    taskENTER_CRITICAL();
+    memset(&gsLoRaStats, 0, sizeof(lora_direct_stats_t));
+    gi32LoRaRssiSum = 0;
+    gi32LoRaSnrSum = 0;
+    taskEXIT_CRITICAL();
+
+    lora_direct_radio_lock();
+    lora_radio_event_stats_reset(NULL);
+    lora_radio_device_stats_reset(NULL);
+    lora_radio_busy_stats_reset(NULL);
+    lora_radio_irq_stats_reset(NULL);
+    lora_direct_radio_unlock();
+}
+
+static void lora_direct_stats_rx(lora_radio_physical_packet_t *psPacket)
+{
+    taskENTER_CRITICAL();
+    gsLoRaStats.ui32RxCount++;
+    gsLoRaStats.i16RssiLast = psPacket->i16Rssi;
+    gsLoRaStats.i16SnrLast = psPacket->i16Snr;
+    gi32LoRaRssiSum += psPacket->i16Rssi;
+    gi32LoRaSnrSum += psPacket->i16Snr;
+    lora_direct_link_update(LORA_DIRECT_LINK_ANY_PEER, lora_radio_frequency,
+                            psPacket);
+    taskEXIT_CRITICAL();
+}
+
+void lora_direct_link_quality_update(
+    uint32_t ui32Peer, uint32_t ui32Frequency,
+    const lora_radio_physical_packet_t *psPacket)
+{
+    lora_direct_link_t sLink;
+
+    taskENTER_CRITICAL();
+    lora_direct_link_update(ui32Peer, ui32Frequency, psPacket);
+    if ((ui32Peer != LORA_DIRECT_LINK_ANY_PEER) &&
+        lora_direct_link_get(ui32Peer, ui32Frequency, &sLink)) {
+        lora_direct_adr_update(ui32Peer,
+                               gsLoRaModulationParameter.eSpreadingFactor,
+                               &sLink);
+    }
     taskEXIT_CRITICAL();
 }
 
+void lora_direct_link_quality_loss(uint32_t ui32Peer, uint32_t ui32Frequency,
+                                   uint32_t ui32Count)
+{
+    lora_direct_link_t sLink;
+
+    taskENTER_CRITICAL();
+    lora_direct_link_loss(ui32Peer, ui32Frequency, ui32Count);
+    if ((ui32Peer != LORA_DIRECT_LINK_ANY_PEER) &&
+        lora_direct_link_get(ui32Peer, ui32Frequency, &sLink)) {
+        lora_direct_adr_update(ui32Peer,
+                               gsLoRaModulationParameter.eSpreadingFactor,
+                               &sLink);
+    }
+    taskEXIT_CRITICAL();
+}
+
+void lora_direct_delivery_report(uint32_t ui32Peer, uint8_t ui8Delivered)
+{
+    taskENTER_CRITICAL();
+    lora_direct_adr_tx_result(ui32Peer, ui8Delivered);
+    taskEXIT_CRITICAL();
+}
+
+uint8_t lora_direct_link_quality_get(uint32_t ui32Peer, uint32_t ui32Frequency,
+                                     lora_direct_link_t *psLink)
+{
+    uint8_t ui8Found;
+
+    taskENTER_CRITICAL();
+    ui8Found = lora_direct_link_get(ui32Peer, ui32Frequency, psLink);
+    taskEXIT_CRITICAL();
+
+    return ui8Found;
+}
+
+static int32_t lora_direct_subscriber_find(QueueHandle_t sTaskQueue)
+{
+    for (int32_t i = 0; i < LORA_DIRECT_MAX_SUBSCRIBERS; i++) {
+        if (psLoRaMessageSubscriberList[i].sTaskQueue == sTaskQueue) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// keeps the per event lists in step with the events of entry i
+static void lora_direct_subscriber_index(int32_t i)
+{
+    uint32_t ui32Events = psLoRaMessageSubscriberList[i].ui32Events;
+
+    for (uint32_t e = 0; e < LORA_DIRECT_EVENT_COUNT; e++) {
+        if (ui32Events & LORA_DIRECT_EVENT(e)) {
+            pui32LoRaEventSubscribers[e] |= 1UL << i;
+        } else {
+            pui32LoRaEventSubscribers[e] &= ~(1UL << i);
+        }
+    }
+}
+
 uint8_t lora_direct_message_subscribe(QueueHandle_t sTaskQueue,
                                       lora_task_state_e eEvent)
 {
-    if (gui8LoRaMessageSubscriberSize >= MAX_SUBSCRIBERS) {
+    return lora_direct_message_subscribe_events(
+        sTaskQueue, LORA_DIRECT_EVENT(eEvent), LORA_DIRECT_NOTIFY_DROP);
+}
+
+uint8_t
+lora_direct_message_subscribe_events(QueueHandle_t sTaskQueue,
+                                     uint32_t ui32Events,
+                                     lora_direct_notify_policy_e ePolicy)
+{
+    lora_direct_subscriber_t *psSubscriber;
+    int32_t i;
+
+    ui32Events &= LORA_DIRECT_EVENT(LORA_DIRECT_EVENT_COUNT) - 1;
+    if (!sTaskQueue || !ui32Events) {
         return 0;
     }
 
-    psLoRaMessageSubscriberList[gui8LoRaMessageSubscriberSize].sTaskQueue =
-        sTaskQueue;
-    psLoRaMessageSubscriberList[gui8LoRaMessageSubscriberSize].ui32Event =
-        eEvent;
+    taskENTER_CRITICAL();
+    i = lora_direct_subscriber_find(sTaskQueue);
+    if (i < 0) {
+        i = lora_direct_subscriber_find(NULL);
+        if (i < 0) {
+            taskEXIT_CRITICAL();
+            return 0;
+        }
+        psLoRaMessageSubscriberList[i].sTaskQueue = sTaskQueue;
+        psLoRaMessageSubscriberList[i].ui32Events = 0;
+        psLoRaMessageSubscriberList[i].ui32Overflows = 0;
+    }
 
-    gui8LoRaMessageSubscriberSize++;
+    psSubscriber = &psLoRaMessageSubscriberList[i];
+    psSubscriber->ui32Events |= ui32Events;
+    psSubscriber->ePolicy = ePolicy;
+    lora_direct_subscriber_index(i);
+    taskEXIT_CRITICAL();
 
     return 1;
 }
@@ -135,120 +889,455 @@ uint8_t lora_direct_message_subscribe(QueueHandle_t sTaskQueue,
 uint8_t lora_direct_message_unsubscribe(QueueHandle_t sTaskQueue,
                                         lora_task_state_e eEvent)
 {
-    uint8_t i = 0;
-    uint8_t ui8Found = 0;
+    return lora_direct_message_unsubscribe_events(sTaskQueue,
+                                                  LORA_DIRECT_EVENT(eEvent));
+}
 
-    for (i = 0; i < gui8LoRaMessageSubscriberSize; i++) {
-        if ((psLoRaMessageSubscriberList[i].sTaskQueue == sTaskQueue) &&
-            (psLoRaMessageSubscriberList[i].ui32Event == eEvent)) {
-            ui8Found = 1;
-            break;
-        }
+uint8_t lora_direct_message_unsubscribe_events(QueueHandle_t sTaskQueue,
+                                               uint32_t ui32Events)
+{
+    lora_direct_subscriber_t *psSubscriber;
+    int32_t i;
+
+    if (!sTaskQueue) {
+        return 0;
     }
 
-    if (ui8Found) {
-        while (i < (gui8LoRaMessageSubscriberSize - 1)) {
-            psLoRaMessageSubscriberList[i].sTaskQueue =
-                psLoRaMessageSubscriberList[i + 1].sTaskQueue;
-            psLoRaMessageSubscriberList[i].ui32Event =
-                psLoRaMessageSubscriberList[i + 1].ui32Event;
-            i++;
-        }
-        gui8LoRaMessageSubscriberSize--;
+    taskENTER_CRITICAL();
+    i = lora_direct_subscriber_find(sTaskQueue);
+    if ((i < 0) ||
+        !(psLoRaMessageSubscriberList[i].ui32Events & ui32Events)) {
+        taskEXIT_CRITICAL();
+        return 0;
+    }
 
-        return 1;
+    // the entry is freed along with its last event
+    psSubscriber = &psLoRaMessageSubscriberList[i];
+    psSubscriber->ui32Events &= ~ui32Events;
+    if (!psSubscriber->ui32Events) {
+        psSubscriber->sTaskQueue = NULL;
     }
+    lora_direct_subscriber_index(i);
+    taskEXIT_CRITICAL();
 
-    return 0;
+    return 1;
 }
 
+uint32_t lora_direct_message_overflows_get(QueueHandle_t sTaskQueue)
+{
+    uint32_t ui32Overflows = 0;
+    int32_t i;
+
+    if (!sTaskQueue) {
+        return 0;
+    }
+
+    taskENTER_CRITICAL();
+    i = lora_direct_subscriber_find(sTaskQueue);
+    if (i >= 0) {
+        ui32Overflows = psLoRaMessageSubscriberList[i].ui32Overflows;
+    }
+    taskEXIT_CRITICAL();
+
+    return ui32Overflows;
+}
+
+// Makes room by discarding the oldest message, which lora_direct queued
+// itself under the overwrite policy and may hold a packet reference.
+static BaseType_t lora_direct_notify_overwrite(QueueHandle_t sTaskQueue,
+                                               task_message_t *psMessage)
+{
+    task_message_t sOldest;
+
+    if ((xQueueReceive(sTaskQueue, &sOldest, 0) == pdPASS) &&
+        (sOldest.ui32Event == RXDONE)) {
+        lora_radio_packet_release(sOldest.psContent);
+    }
+
+    return xQueueSend(sTaskQueue, psMessage, 0);
+}
+
+// The radio task never blocks on a subscriber.  A full queue costs the
+// subscriber a notification, counted in its overflows, instead of stalling
+// the receiver for everybody.
 static void lora_direct_notify(uint32_t state, void *content)
 {
     task_message_t sTaskMessage;
+    lora_direct_subscriber_t *psSubscriber;
+    uint32_t ui32Subscribers;
+    BaseType_t xSent;
+
+    if (state >= LORA_DIRECT_EVENT_COUNT) {
+        return;
+    }
 
     sTaskMessage.ui32Event = state;
     sTaskMessage.psContent = content;
 
-    for (uint8_t i = 0; i < gui8LoRaMessageSubscriberSize; i++) {
-        if (psLoRaMessageSubscriberList[i].ui32Event == state) {
-            xQueueSend(psLoRaMessageSubscriberList[i].sTaskQueue, &sTaskMessage,
-                       portMAX_DELAY);
+    // only the subscribers of the event are visited, lowest entry first;
+    // each subscriber receiving a packet owns one reference to it
+    taskENTER_CRITICAL();
+    ui32Subscribers = pui32LoRaEventSubscribers[state];
+    while (ui32Subscribers) {
+        uint32_t i = __builtin_ctz(ui32Subscribers);
+
+        ui32Subscribers &= ui32Subscribers - 1;
+        psSubscriber = &psLoRaMessageSubscriberList[i];
+
+        if (state == RXDONE) {
+            lora_radio_packet_retain(content);
+        }
+
+        xSent = xQueueSend(psSubscriber->sTaskQueue, &sTaskMessage, 0);
+        if (xSent == pdPASS) {
+            continue;
+        }
+
+        psSubscriber->ui32Overflows++;
+        gsLoRaStats.ui32NotifyDropped++;
+
+        if (psSubscriber->ePolicy == LORA_DIRECT_NOTIFY_OVERWRITE) {
+            xSent = lora_direct_notify_overwrite(psSubscriber->sTaskQueue,
+                                                 &sTaskMessage);
+        }
+        if ((xSent != pdPASS) && (state == RXDONE)) {
+            lora_radio_packet_release(content);
         }
     }
+    taskEXIT_CRITICAL();
+}
+
+// Radio callbacks run in the task, from lora_radio_irq_service() with the
+// radio lock held.  Their events are kept here and handled once the lock is
+// released, without a round trip through the task queue.
+static bool lora_direct_event_post(uint32_t ui32Event, void *pvContent)
+{
+    if (gui32LoRaEventCount == LORA_DIRECT_PENDING_EVENTS) {
+        taskENTER_CRITICAL();
+        gsLoRaStats.ui32EventDropped++;
+        taskEXIT_CRITICAL();
+        return false;
+    }
+
+    gpsLoRaEvents[gui32LoRaEventCount].ui32Event = ui32Event;
+    gpsLoRaEvents[gui32LoRaEventCount].psContent = pvContent;
+    gui32LoRaEventCount++;
+
+    return true;
 }
 
 static void lora_direct_callback_txdone(void *arg)
 {
-    task_message_t sTaskMessage;
-    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+    lora_direct_event_post(TXDONE, NULL);
+}
 
-    sTaskMessage.ui32Event = TXDONE;
-    sTaskMessage.psContent = NULL;
+// Runs from the radio callback and counts the packets it rejects.
+static bool lora_direct_rx_filter_accept(lora_radio_physical_packet_t *psPacket)
+{
+    taskENTER_CRITICAL();
+    bool bAccept = lora_direct_filter_match(
+        &gsLoRaRxFilter, psPacket->pui8Payload, psPacket->ui8PayloadLength);
 
-    xQueueSendFromISR(gsLoRaTaskQueue, &sTaskMessage,
-                      &xHigherPriorityTaskWoken);
+    if (!bAccept) {
+        gsLoRaStats.ui32RxFiltered++;
+    }
+    taskEXIT_CRITICAL();
 
-    portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+    return bAccept;
+}
+
+uint8_t lora_direct_rx_filter_set(const lora_direct_filter_t *psFilter)
+{
+    lora_direct_filter_t sFilter;
+
+    if (psFilter) {
+        if ((psFilter->ui8LengthMin > psFilter->ui8LengthMax) ||
+            (psFilter->ui8AddressSize > sizeof(uint32_t)) ||
+            (psFilter->ui8AddressCount > LORA_DIRECT_FILTER_ADDRESSES)) {
+            return 0;
+        }
+        memcpy(&sFilter, psFilter, sizeof(lora_direct_filter_t));
+    } else {
+        lora_direct_filter_init(&sFilter);
+    }
+
+    taskENTER_CRITICAL();
+    memcpy(&gsLoRaRxFilter, &sFilter, sizeof(lora_direct_filter_t));
+    taskEXIT_CRITICAL();
+
+    return 1;
+}
+
+void lora_direct_rx_filter_get(lora_direct_filter_t *psFilter)
+{
+    taskENTER_CRITICAL();
+    memcpy(psFilter, &gsLoRaRxFilter, sizeof(lora_direct_filter_t));
+    taskEXIT_CRITICAL();
 }
 
 static void lora_direct_callback_rxdone(void *arg)
 {
     lora_radio_physical_packet_t *content = (lora_radio_physical_packet_t *)arg;
 
-    gsLoRaRadioPhysicalPacket.i8Rscp = content->i8Rscp;
-    gsLoRaRadioPhysicalPacket.i8Rssi = content->i8Rssi;
-    gsLoRaRadioPhysicalPacket.i8Snr = content->i8Snr;
-    gsLoRaRadioPhysicalPacket.ui8PayloadLength = content->ui8PayloadLength;
-    gsLoRaRadioPhysicalPacket.pui8Payload = psLoRaRadioPhysicalPacketPayload;
-    memcpy(psLoRaRadioPhysicalPacketPayload, content->pui8Payload,
-           content->ui8PayloadLength);
+    // packets for other nodes end here
+    if (!lora_direct_rx_filter_accept(content)) {
+        return;
+    }
 
-    task_message_t sTaskMessage;
-    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+    // the reference taken here is handed over to the event handler
+    lora_radio_packet_retain(content);
+    if (!lora_direct_event_post(RXDONE, content)) {
+        lora_radio_packet_release(content);
+    }
+}
+
+static void lora_direct_callback_timeout(void *arg)
+{
+    lora_direct_event_post(TIMEOUT, NULL);
+}
 
-    sTaskMessage.ui32Event = RXDONE;
-    sTaskMessage.psContent = &gsLoRaRadioPhysicalPacket;
+static void lora_direct_callback_caddetected(void *arg)
+{
+    gui8CadDetected = 1;
+}
 
-    xQueueSendFromISR(gsLoRaTaskQueue, &sTaskMessage,
-                      &xHigherPriorityTaskWoken);
+static void lora_direct_callback_caddone(void *arg)
+{
+    uint8_t ui8Detected = gui8CadDetected;
 
-    portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+    // the waiting sender has reset the queue, it never blocks here
+    xQueueSend(gsLoRaCadQueue, &ui8Detected, 0);
+    lora_direct_event_post(LORA_TASK_EVENT_CAD_DONE, NULL);
 }
 
-static void lora_direct_callback_timeout(void *arg)
+static void lora_direct_irq_defer(void *arg)
 {
     task_message_t sTaskMessage;
     portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
-    sTaskMessage.ui32Event = TIMEOUT;
+    sTaskMessage.ui32Event = LORA_TASK_EVENT_IRQ;
     sTaskMessage.psContent = NULL;
 
-    xQueueSendFromISR(gsLoRaTaskQueue, &sTaskMessage,
-                      &xHigherPriorityTaskWoken);
+    // if the queue is full the task is awake and services the radio on its
+    // next iteration
+    xQueueSendToFrontFromISR(gsLoRaTaskQueue, &sTaskMessage,
+                             &xHigherPriorityTaskWoken);
+
+    portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+}
+
+static void lora_direct_event_handle(const task_message_t *psMessage);
+
+// services the radio, then handles the events its callbacks raised
+static void lora_direct_irq_service(void)
+{
+    lora_direct_radio_lock();
+    lora_radio_irq_service(NULL);
+    lora_direct_radio_unlock();
+
+    for (uint32_t i = 0; i < gui32LoRaEventCount; i++) {
+        lora_direct_event_handle(&gpsLoRaEvents[i]);
+    }
+    gui32LoRaEventCount = 0;
+}
+
+static void lora_direct_busy_wait(uint32_t ui32Ticks)
+{
+    // cannot block with the scheduler suspended, the driver polls instead
+    if (xTaskGetSchedulerState() == taskSCHEDULER_SUSPENDED) {
+        return;
+    }
+
+    TickType_t xTicks =
+        pdMS_TO_TICKS((ui32Ticks * 1000) / LORA_RADIO_TIMER_FREQUENCY) + 1;
+
+    xSemaphoreTake(gsLoRaBusySemaphore, xTicks);
+}
+
+static void lora_direct_busy_release(void *arg)
+{
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+    xSemaphoreGiveFromISR(gsLoRaBusySemaphore, &xHigherPriorityTaskWoken);
 
     portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
 }
 
 static void lora_direct_task_init(void)
 {
+    lora_direct_adr_config_t sAdrConfig;
+
     memset(psLoRaMessageSubscriberList, 0,
-           MAX_SUBSCRIBERS * sizeof(lora_direct_subscriber_t));
-    gui8LoRaMessageSubscriberSize = 0;
+           sizeof(psLoRaMessageSubscriberList));
+    memset(pui32LoRaEventSubscribers, 0, sizeof(pui32LoRaEventSubscribers));
 
     taskENTER_CRITICAL();
-    lora_radio_callback_list_init();
+    lora_radio_callback_list_init(NULL);
 
-    lora_radio_callback_register(LORA_RADIO_TXDONE,
+    lora_radio_callback_register(NULL, LORA_RADIO_TXDONE,
                                  &lora_direct_callback_txdone);
-    lora_radio_callback_register(LORA_RADIO_RXDONE,
+    lora_radio_callback_register(NULL, LORA_RADIO_RXDONE,
                                  &lora_direct_callback_rxdone);
-    lora_radio_callback_register(LORA_RADIO_TIMEOUT,
+    lora_radio_callback_register(NULL, LORA_RADIO_TIMEOUT,
                                  &lora_direct_callback_timeout);
+    // callbacks run in registration order, CADDETECTED is raised together
+    // with CADDONE and must be seen first
+    lora_radio_callback_register(NULL, LORA_RADIO_CADDETECTED,
+                                 &lora_direct_callback_caddetected);
+    lora_radio_callback_register(NULL, LORA_RADIO_CADDONE,
+                                 &lora_direct_callback_caddone);
+    taskEXIT_CRITICAL();
+
+    lora_radio_busy_wait_register(&lora_direct_busy_wait,
+                                  &lora_direct_busy_release);
+    lora_radio_irq_defer_register(NULL, &lora_direct_irq_defer);
+
+    lora_direct_link_init();
+    sAdrConfig.ui8PowerMin = LORA_DIRECT_ADR_POWER_MIN;
+    sAdrConfig.ui8PowerMax = lora_radio_power;
+    sAdrConfig.ui8PeerPower = lora_radio_power;
+    sAdrConfig.i16Margin = LORA_DIRECT_ADR_MARGIN;
+    sAdrConfig.eSpreadingFactorMin = LORA_DIRECT_ADR_SF_MIN;
+    lora_direct_adr_init(&sAdrConfig);
+
+    taskENTER_CRITICAL();
+    lora_direct_airtime_configuration_reset();
     taskEXIT_CRITICAL();
 
     lora_direct_radio_configuration_reset();
+    lora_direct_radio_lock();
     lora_radio_initialize(NULL);
-    lora_direct_receive(lora_radio_frequency);
+    // xorshift never leaves zero
+    if ((lora_radio_random(NULL, &gui32LoRaRandom) !=
+         LORA_RADIO_STATUS_SUCCESS) ||
+        (gui32LoRaRandom == 0)) {
+        gui32LoRaRandom = 1;
+    }
+    lora_direct_radio_unlock();
+
+    gbLoRaTransmitting = false;
+    gbLoRaCad = false;
+    gui32LoRaEventCount = 0;
+    gbLoRaCarrierPending = false;
+    gui32LoRaRxFrequency = lora_radio_frequency;
+    lora_direct_receive_start();
+}
+
+// Ticks until the watchdog of the current transmission expires.  A
+// transmission it catches is sent once more, then dropped.
+static TickType_t lora_direct_tx_watchdog(void)
+{
+    TickType_t xRemaining = gxLoRaTxDeadline - xTaskGetTickCount();
+
+    if (!gbLoRaTransmitting) {
+        return portMAX_DELAY;
+    }
+
+    if ((xRemaining != 0) && (xRemaining < (portMAX_DELAY >> 1))) {
+        return xRemaining;
+    }
+
+    if (gbLoRaTxRetried) {
+        taskENTER_CRITICAL();
+        gsLoRaStats.ui32TxDropped++;
+        taskEXIT_CRITICAL();
+        lora_direct_radio_idle();
+    } else {
+        gbLoRaTxRetried = true;
+        lora_direct_transmit_start();
+    }
+
+    return lora_direct_tx_watchdog();
+}
+
+// Moves a receiver that is not listening at the spreading factor its peers
+// asked for, returns the ticks until the next announcement lapses.
+static TickType_t lora_direct_rate_hold(void)
+{
+    uint32_t ui32Remaining;
+    uint8_t ui8Sf;
+
+    taskENTER_CRITICAL();
+    ui8Sf = lora_direct_listen_sf(&ui32Remaining);
+    taskEXIT_CRITICAL();
+
+    if ((ui8Sf != gui8LoRaRxSpreadingFactor) && !lora_direct_radio_busy() &&
+        (geLoRaRxMode != LORA_DIRECT_RX_WINDOW)) {
+        lora_direct_receive_start();
+    }
+
+    if (ui32Remaining == UINT32_MAX) {
+        return portMAX_DELAY;
+    }
+
+    return pdMS_TO_TICKS(ui32Remaining) + 1;
+}
+
+// Requests from the task queue and events raised by the radio callbacks
+static void lora_direct_event_handle(const task_message_t *psMessage)
+{
+    switch (psMessage->ui32Event) {
+    case TX: {
+        if (!lora_direct_radio_busy()) {
+            lora_direct_transmit_next();
+        }
+    } break;
+    case RX: {
+        if (!lora_direct_radio_busy()) {
+            lora_direct_receive_start();
+        }
+    } break;
+    case TXDONE: {
+        taskENTER_CRITICAL();
+        gsLoRaStats.ui32TxCount++;
+        gsLoRaStats.ui64Airtime += gsLoRaTxMessage.ui32Airtime;
+        taskEXIT_CRITICAL();
+        lora_direct_notify(psMessage->ui32Event, NULL);
+        lora_direct_radio_idle();
+    } break;
+    case RXDONE: {
+        // the packet stays in the radio buffer pool, subscribers
+        // release their reference once they are done with it
+        lora_radio_physical_packet_t *content =
+            (lora_radio_physical_packet_t *)psMessage->psContent;
+        lora_direct_stats_rx(content);
+        lora_direct_notify(psMessage->ui32Event, content);
+        lora_radio_packet_release(content);
+        if (!lora_direct_radio_busy() &&
+            (geLoRaRxMode != LORA_DIRECT_RX_WINDOW)) {
+            lora_direct_receive_start();
+        }
+    } break;
+    case TIMEOUT: {
+        bool bTransmitting = gbLoRaTransmitting;
+
+        taskENTER_CRITICAL();
+        gsLoRaStats.ui32Timeouts++;
+        taskEXIT_CRITICAL();
+        lora_direct_notify(psMessage->ui32Event, NULL);
+        // an expired receive window leaves the radio in standby
+        if (bTransmitting) {
+            lora_direct_radio_idle();
+        } else if (!gbLoRaCad && (geLoRaRxMode != LORA_DIRECT_RX_WINDOW)) {
+            lora_direct_receive_start();
+        }
+    } break;
+    case LORA_TASK_EVENT_CAD: {
+        lora_direct_cad_start();
+    } break;
+    case LORA_TASK_EVENT_CAD_DONE: {
+        if (gbLoRaCad) {
+            gbLoRaCad = false;
+            lora_direct_radio_idle();
+        }
+    } break;
+    case LORA_TASK_EVENT_CARRIER: {
+        gbLoRaCarrierPending = true;
+        if (!lora_direct_radio_busy()) {
+            lora_direct_carrier_start();
+        }
+    } break;
+    }
 }
 
 void lora_direct_task(void *pvParameters)
@@ -257,29 +1346,25 @@ void lora_direct_task(void *pvParameters)
 
     gsLoRaTaskQueue =
         xQueueCreate(LORA_TASK_MESSAGE_QUEUE_SIZE, sizeof(task_message_t));
+    gsLoRaBusySemaphore = xSemaphoreCreateBinary();
+    gsLoRaRadioMutex = xSemaphoreCreateRecursiveMutex();
+    gxLoRaRadioHolder = NULL;
+    gui32LoRaRadioDepth = 0;
+    gsLoRaCadQueue = xQueueCreate(1, sizeof(uint8_t));
+    gsLoRaCadMutex = xSemaphoreCreateMutex();
+    gsLoRaTxQueue = xQueueCreate(LORA_DIRECT_TX_QUEUE_SIZE,
+                                 sizeof(lora_direct_tx_message_t));
 
     lora_direct_task_init();
 
     while (1) {
-        if (xQueueReceive(gsLoRaTaskQueue, &sTaskMessage, portMAX_DELAY) ==
-            pdPASS) {
-            switch (sTaskMessage.ui32Event) {
-            case TXDONE: {
-                lora_direct_notify(sTaskMessage.ui32Event, NULL);
-                lora_direct_receive(lora_radio_frequency);
-            } break;
-            case RXDONE: {
-                // no need for deep copy as content is already statically allocated in psLoRaRadioPhysicalPacketPayload
-                lora_radio_physical_packet_t *content =
-                    (lora_radio_physical_packet_t *)sTaskMessage.psContent;
-                lora_direct_notify(sTaskMessage.ui32Event, content);
-                lora_direct_receive(lora_radio_frequency);
-            } break;
-            case TIMEOUT: {
-                lora_direct_notify(sTaskMessage.ui32Event, NULL);
-                lora_direct_receive(lora_radio_frequency);
-            } break;
-            }
+        TickType_t xWait = lora_direct_tx_watchdog();
+        TickType_t xHold = lora_direct_rate_hold();
+
+        if (xQueueReceive(gsLoRaTaskQueue, &sTaskMessage,
+                          xHold < xWait ? xHold : xWait) == pdPASS) {
+            lora_direct_irq_service();
+            lora_direct_event_handle(&sTaskMessage);
         }
     }
 }
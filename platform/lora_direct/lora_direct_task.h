@@ -46,17 +46,174 @@ typedef enum {
     UNKNOWN
 } lora_task_state_e;
 
+// bit of an event in a subscription mask
+#define LORA_DIRECT_EVENT(e) (1UL << (e))
+
+// What happens to a notification for a subscriber whose queue is full.  The
+// overwrite policy pops messages off the queue and is only meant for queues
+// that receive nothing but lora_direct notifications.
+typedef enum {
+    LORA_DIRECT_NOTIFY_DROP,     // the new notification is discarded
+    LORA_DIRECT_NOTIFY_OVERWRITE // the oldest queued message is discarded
+} lora_direct_notify_policy_e;
+
+// Duty cycled receive sleeps between short listening windows and relies on
+// the transmitter sending a long preamble, see gsLoRaPacketParameter.
+// Window receive listens once after each lora_direct_receive() and after
+// every transmission, the radio returns to standby as soon as no preamble
+// shows up within LORA_DIRECT_RX_WINDOW_SYMBOLS.  With fixed length
+// (implicit header) packets this suits short telemetry frames.
+typedef enum {
+    LORA_DIRECT_RX_CONTINUOUS,
+    LORA_DIRECT_RX_DUTY_CYCLE,
+    LORA_DIRECT_RX_WINDOW
+} lora_direct_rx_mode_e;
+
+// outcome of the send functions, anything but SUCCESS leaves nothing queued
+typedef enum {
+    LORA_DIRECT_SEND_SUCCESS,
+    LORA_DIRECT_SEND_DUTY_CYCLE,   // the sub-band duty cycle budget is spent
+    LORA_DIRECT_SEND_QUEUE_FULL,   // the transmit queue is full
+    LORA_DIRECT_SEND_INVALID_ARG,  // the radio configuration is not valid
+    LORA_DIRECT_SEND_CHANNEL_BUSY  // listen-before-talk found no clear channel
+} lora_direct_send_e;
+
+// Link statistics kept by the task together with a snapshot of the radio
+// driver counters, see lora_direct_stats_get()
+typedef struct {
+    uint32_t ui32TxCount;    // packets transmitted
+    uint32_t ui32TxDropped;  // send requests refused by the duty cycle limit
+                             // or a full transmit queue, and packets
+                             // lost to a radio reset twice
+    // send requests of those refused by the duty cycle limit
+    uint32_t ui32TxDutyCycle;
+    uint64_t ui64Airtime;    // cumulative transmit airtime in us
+    uint32_t ui32RxCount;    // packets handed to subscribers
+    uint32_t ui32RxFiltered; // packets rejected by the receive filter
+    uint32_t ui32Timeouts;
+    // notifications lost to full subscriber queues
+    uint32_t ui32NotifyDropped;
+    // radio events lost because one interrupt raised more than the task
+    // keeps pending
+    uint32_t ui32EventDropped;
+    int16_t i16RssiLast; // 0.25 dBm
+    int16_t i16RssiAverage;
+    int16_t i16SnrLast; // 0.25 dB
+    int16_t i16SnrAverage;
+    lora_radio_event_stats_t sRadio;
+    lora_radio_device_stats_t sDevice;
+    lora_radio_busy_stats_t sBusy;
+    lora_radio_irq_stats_t sIrq; // worst DIO interrupt latency
+    // longest time a task held or waited for the radio lock, in STIMER
+    // ticks
+    uint32_t ui32RadioHoldMax;
+    uint32_t ui32RadioWaitMax;
+} lora_direct_stats_t;
+
 extern TaskHandle_t lora_direct_task_handle;
 
 extern void lora_direct_task(void *pvParameters);
+// Every lora_radio_* call made outside lora_direct has to hold the radio
+// lock.  It is a recursive mutex created when lora_direct_task starts,
+// interrupts keep running while it is held.  Mode changes made this way
+// bypass the task and abort whatever it is doing, a transmission cut short
+// is sent once more after LORA_DIRECT_TX_WATCHDOG_MS.  The lock must not be
+// held across the lora_direct_* calls below, they wait on the task, which
+// needs the lock itself.
+extern void lora_direct_radio_lock(void);
+extern void lora_direct_radio_unlock(void);
+// The carrier, receive and channel activity requests below are carried out
+// by the task and wait for queued transmissions to finish first.
 extern void lora_direct_transmit_carrier(uint32_t frequency, uint8_t power);
-extern void lora_direct_send(uint32_t frequency, uint8_t power,
-                             const uint8_t *message, uint8_t length);
+// Queues the message for transmission by the task, a TXDONE notification
+// follows for each packet sent.  A message that would exceed the sub-band
+// duty cycle budget or finds the transmit queue full is refused with the
+// reason.
+extern lora_direct_send_e lora_direct_send(uint32_t frequency, uint8_t power,
+                                           const uint8_t *message,
+                                           uint8_t length);
+// Same as lora_direct_send with a profile from lora_radio_profile_init().
+// The profile is copied, the caller keeps ownership.
+extern lora_direct_send_e
+lora_direct_send_profile(const lora_radio_profile_t *psProfile,
+                         uint32_t frequency, uint8_t power,
+                         const uint8_t *message, uint8_t length);
+// runs channel activity detection before transmitting and backs off for a
+// random time while the channel is busy
+extern lora_direct_send_e lora_direct_send_lbt(uint32_t frequency,
+                                               uint8_t power,
+                                               const uint8_t *message,
+                                               uint8_t length);
+// Sends on lora_radio_frequency with the spreading factor the peer
+// announced it listens at and the power the ADR controller picked for the
+// peer, see lora_direct_adr.h.  Peers without a valid announcement get the
+// configured modulation.
+extern lora_direct_send_e lora_direct_send_to(uint32_t ui32Peer,
+                                              const uint8_t *message,
+                                              uint8_t length);
+// Data rate announcement for a protocol header, see lora_direct_arq.h: the
+// high nibble is the spreading factor this node would like to send to the
+// peer with, the low nibble the one it listens at.
+extern uint8_t lora_direct_rate_announce(uint32_t ui32Peer);
+// The announcement of a peer.  The receiver moves to the slowest spreading
+// factor its peers asked for and returns to the configured one once no
+// request was renewed for LORA_DIRECT_ADR_RATE_HOLD_MS.
+extern void lora_direct_rate_update(uint32_t ui32Peer, uint8_t ui8Rate);
+extern void lora_direct_receive_mode_set(lora_direct_rx_mode_e eMode);
+extern lora_direct_rx_mode_e lora_direct_receive_mode_get(void);
+// Received packets that fail the filter are dropped before any subscriber
+// is notified, see lora_direct_filter.h.  NULL accepts every packet,
+// returns 0 for an invalid filter.
+extern uint8_t lora_direct_rx_filter_set(const lora_direct_filter_t *psFilter);
+extern void lora_direct_rx_filter_get(lora_direct_filter_t *psFilter);
+// the task returns to receive at this frequency whenever the radio is idle
 extern void lora_direct_receive(uint32_t frequency);
+// Airtime in us spent within the duty cycle window of the sub-band holding
+// the frequency, 0 outside the sub-bands, see
+// lora_direct_airtime_configuration_reset().
+extern uint32_t lora_direct_airtime_used(uint32_t frequency);
+// ms until a packet of the airtime in us fits the duty cycle budget of the
+// frequency, 0 if it fits now and UINT32_MAX if it never will.  Meant as
+// the backoff of a sender whose packet was refused, see lora_direct_arq.h.
+extern uint32_t lora_direct_airtime_wait(uint32_t frequency,
+                                         uint32_t ui32Airtime);
+// RXDONE messages carry a lora_radio_physical_packet_t from the radio
+// buffer pool.  The subscriber owns one reference to the packet and must
+// call lora_radio_packet_release() when it is done with it.
+extern void lora_direct_stats_get(lora_direct_stats_t *psStats);
+extern void lora_direct_stats_reset(void);
+// Link quality per peer and frequency, see lora_direct_link.h.  lora_direct
+// accounts every received packet to LORA_DIRECT_LINK_ANY_PEER on the receive
+// frequency, applications that know the sender add their own updates which
+// also drive the power used by lora_direct_send_to.
+extern void
+lora_direct_link_quality_update(uint32_t ui32Peer, uint32_t ui32Frequency,
+                                const lora_radio_physical_packet_t *psPacket);
+extern void lora_direct_link_quality_loss(uint32_t ui32Peer,
+                                          uint32_t ui32Frequency,
+                                          uint32_t ui32Count);
+extern uint8_t lora_direct_link_quality_get(uint32_t ui32Peer,
+                                            uint32_t ui32Frequency,
+                                            lora_direct_link_t *psLink);
+// acknowledged or missing reply from the peer, feeds the ADR fallback
+extern void lora_direct_delivery_report(uint32_t ui32Peer,
+                                        uint8_t ui8Delivered);
+// Subscriptions are kept per queue with a mask of LORA_DIRECT_EVENT() bits,
+// up to LORA_DIRECT_MAX_SUBSCRIBERS queues.  Subscribing again adds events
+// and replaces the policy of the queue.  Notifications are posted without
+// waiting, lora_direct_message_subscribe uses LORA_DIRECT_NOTIFY_DROP.
 extern uint8_t lora_direct_message_subscribe(QueueHandle_t sTaskQueue,
                                              lora_task_state_e eEvent);
+extern uint8_t
+lora_direct_message_subscribe_events(QueueHandle_t sTaskQueue,
+                                     uint32_t ui32Events,
+                                     lora_direct_notify_policy_e ePolicy);
 extern uint8_t lora_direct_message_unsubscribe(QueueHandle_t sTaskQueue,
                                                lora_task_state_e eEvent);
+extern uint8_t lora_direct_message_unsubscribe_events(QueueHandle_t sTaskQueue,
+                                                      uint32_t ui32Events);
+// notifications the queue lost because it was full
+extern uint32_t lora_direct_message_overflows_get(QueueHandle_t sTaskQueue);
 
 #if defined(__cplusplus)
 }